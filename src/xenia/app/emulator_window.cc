@@ -548,6 +548,9 @@ bool EmulatorWindow::Initialize() {
     cpu_menu->AddChild(MenuItem::Create(MenuItem::Type::kString,
                                         "&Pause/Resume Profiler", "`",
                                         []() { Profiler::TogglePause(); }));
+    cpu_menu->AddChild(
+        MenuItem::Create(MenuItem::Type::kString, "&Write Profiling Trace",
+                         []() { profiling::TraceRecorder::Write(); }));
   }
   cpu_menu->AddChild(MenuItem::Create(MenuItem::Type::kSeparator));
   {
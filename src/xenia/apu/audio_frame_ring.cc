@@ -0,0 +1,52 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/apu/audio_frame_ring.h"
+
+#include <cstring>
+
+#include "xenia/base/assert.h"
+
+namespace xe {
+namespace apu {
+
+AudioFrameRing::AudioFrameRing(uint32_t capacity_log2)
+    : frames_(new float[size_t(kFrameSamples) << capacity_log2]),
+      capacity_mask_((uint32_t(1) << capacity_log2) - 1) {
+  assert_true(capacity_log2 < 32);
+}
+
+bool AudioFrameRing::Push(const float* frame) {
+  uint32_t write_index = write_index_.load(std::memory_order_relaxed);
+  if (write_index - read_index_.load(std::memory_order_acquire) >
+      capacity_mask_) {
+    return false;
+  }
+  std::memcpy(&frames_[size_t(write_index & capacity_mask_) * kFrameSamples],
+              frame, kFrameSize);
+  write_index_.store(write_index + 1, std::memory_order_release);
+  return true;
+}
+
+const float* AudioFrameRing::Peek() const {
+  uint32_t read_index = read_index_.load(std::memory_order_relaxed);
+  if (read_index == write_index_.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  return &frames_[size_t(read_index & capacity_mask_) * kFrameSamples];
+}
+
+void AudioFrameRing::Pop() {
+  uint32_t read_index = read_index_.load(std::memory_order_relaxed);
+  assert_true(read_index != write_index_.load(std::memory_order_acquire));
+  read_index_.store(read_index + 1, std::memory_order_release);
+}
+
+}  // namespace apu
+}  // namespace xe
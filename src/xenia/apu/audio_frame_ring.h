@@ -0,0 +1,66 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_APU_AUDIO_FRAME_RING_H_
+#define XENIA_APU_AUDIO_FRAME_RING_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace xe {
+namespace apu {
+
+// Single-producer, single-consumer queue of audio frames submitted by the
+// guest, for passing them from the guest audio thread to the host audio API
+// thread without locking. Frames are stored as submitted (6 sequential
+// channels of big-endian samples), so conversion to the host format happens on
+// the consumer side, and storage is allocated once on creation, so submission
+// never allocates or waits for the consumer.
+class AudioFrameRing {
+ public:
+  static constexpr uint32_t kChannelCount = 6;
+  static constexpr uint32_t kChannelSamples = 256;
+  static constexpr uint32_t kFrameSamples = kChannelCount * kChannelSamples;
+  static constexpr uint32_t kFrameSize = sizeof(float) * kFrameSamples;
+
+  explicit AudioFrameRing(uint32_t capacity_log2);
+
+  uint32_t capacity() const { return capacity_mask_ + 1; }
+
+  // Producer. Copies the frame, returning false if the ring is full (which
+  // shouldn't happen if the producer is throttled by the number of frames
+  // consumed, as AudioSystem does with the client semaphores).
+  bool Push(const float* frame);
+
+  // Consumer. Returns the oldest frame, or nullptr if the ring is empty. The
+  // frame stays valid until Pop.
+  const float* Peek() const;
+  void Pop();
+
+  // Approximate when called concurrently with pushing or popping.
+  uint32_t size() const {
+    return write_index_.load(std::memory_order_acquire) -
+           read_index_.load(std::memory_order_acquire);
+  }
+
+ private:
+  std::unique_ptr<float[]> frames_;
+  uint32_t capacity_mask_;
+
+  // Free-running, wrapped by capacity_mask_ when accessing the frames. On
+  // separate cache lines to avoid false sharing between the threads.
+  alignas(64) std::atomic<uint32_t> write_index_ = {0};
+  alignas(64) std::atomic<uint32_t> read_index_ = {0};
+};
+
+}  // namespace apu
+}  // namespace xe
+
+#endif  // XENIA_APU_AUDIO_FRAME_RING_H_
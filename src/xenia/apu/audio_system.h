@@ -11,6 +11,7 @@
 #define XENIA_APU_AUDIO_SYSTEM_H_
 
 #include <atomic>
+#include <mutex>
 #include <queue>
 
 #include "xenia/base/mutex.h"
@@ -74,7 +75,9 @@ class AudioSystem {
   std::atomic<bool> worker_running_ = {false};
   kernel::object_ref<kernel::XHostThread> worker_thread_;
 
-  xe::global_critical_region global_critical_region_;
+  // Protects the clients, but is never taken by the host audio threads, so
+  // submission doesn't wait for them.
+  std::mutex clients_mutex_;
   static const size_t kMaximumClientCount = 8;
   struct {
     AudioDriver* driver;
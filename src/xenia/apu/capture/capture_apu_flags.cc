@@ -0,0 +1,29 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/apu/capture/capture_apu_flags.h"
+
+DEFINE_path(apu_capture_path, "",
+            "Directory to write the audio of each client to with the capture "
+            "audio system, or empty to only consume the frames.",
+            "APU");
+DEFINE_bool(apu_capture_raw, false,
+            "Write raw interleaved 32-bit float samples instead of WAV files "
+            "with the capture audio system.",
+            "APU");
+DEFINE_bool(apu_capture_realtime, true,
+            "Consume the frames at the 48 kHz playback rate with the capture "
+            "audio system, like a real audio device would, rather than as fast "
+            "as they're submitted.",
+            "APU");
+DEFINE_uint32(apu_capture_max_frames, 0,
+              "Number of frames to write for each client with the capture "
+              "audio system, or 0 for no limit. Frames are still consumed "
+              "after the limit is reached.",
+              "APU");
@@ -0,0 +1,20 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_APU_CAPTURE_CAPTURE_APU_FLAGS_H_
+#define XENIA_APU_CAPTURE_CAPTURE_APU_FLAGS_H_
+
+#include "xenia/base/cvar.h"
+
+DECLARE_path(apu_capture_path);
+DECLARE_bool(apu_capture_raw);
+DECLARE_bool(apu_capture_realtime);
+DECLARE_uint32(apu_capture_max_frames);
+
+#endif  // XENIA_APU_CAPTURE_CAPTURE_APU_FLAGS_H_
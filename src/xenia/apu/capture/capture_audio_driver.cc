@@ -0,0 +1,193 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/apu/capture/capture_audio_driver.h"
+
+#include <cstring>
+
+#include "xenia/apu/capture/capture_apu_flags.h"
+#include "xenia/apu/conversion.h"
+#include "xenia/apu/xma_decoder.h"
+#include "xenia/base/assert.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/profiling.h"
+
+namespace xe {
+namespace apu {
+namespace capture {
+
+CaptureAudioDriver::CaptureAudioDriver(Memory* memory,
+                                       xe::threading::Semaphore* semaphore,
+                                       XmaDecoder* xma_decoder,
+                                       const std::filesystem::path& file_path,
+                                       uint32_t sequence)
+    : AudioDriver(memory),
+      semaphore_(semaphore),
+      xma_decoder_(xma_decoder),
+      file_path_(file_path),
+      sequence_(sequence) {}
+
+CaptureAudioDriver::~CaptureAudioDriver() { assert_null(consumer_thread_); }
+
+bool CaptureAudioDriver::Initialize() {
+  if (!file_path_.empty()) {
+    if (!file_writer_.Open(file_path_, !cvars::apu_capture_raw,
+                           cvars::apu_capture_max_frames)) {
+      XELOGE("Capture audio driver: Failed to open {} for writing",
+             xe::path_to_utf8(file_path_));
+      return false;
+    }
+    interleaved_frame_ =
+        std::make_unique<float[]>(AudioFrameRing::kFrameSamples);
+    XELOGI("Capture audio driver: Writing client audio to {}",
+           xe::path_to_utf8(file_path_));
+  }
+
+  frame_event_ = xe::threading::Event::CreateAutoResetEvent(false);
+  shutdown_event_ = xe::threading::Event::CreateManualResetEvent(false);
+  if (!frame_event_ || !shutdown_event_) {
+    return false;
+  }
+  xe::threading::Thread::CreationParameters thread_params;
+  thread_params.stack_size = 64 * 1024;
+  consumer_thread_ = xe::threading::Thread::Create(
+      thread_params, [this]() { ConsumerThreadMain(); });
+  if (!consumer_thread_) {
+    return false;
+  }
+  consumer_thread_->set_name(fmt::format("Audio Capture {}", sequence_));
+  return true;
+}
+
+void CaptureAudioDriver::SubmitFrame(uint32_t frame_ptr) {
+  const auto input_frame = memory_->TranslateVirtual<const float*>(frame_ptr);
+  // The client semaphore limits the number of frames in flight to the
+  // capacity of the ring.
+  bool pushed = frame_ring_.Push(input_frame);
+  assert_true(pushed);
+  frames_submitted_.fetch_add(1, std::memory_order_relaxed);
+  frame_event_->Set();
+}
+
+void CaptureAudioDriver::Shutdown() {
+  if (consumer_thread_) {
+    shutdown_event_->Set();
+    xe::threading::Wait(consumer_thread_.get(), false);
+    consumer_thread_.reset();
+  }
+  // The consumer thread is not running anymore, safe to access its state.
+  file_writer_.Close();
+}
+
+void CaptureAudioDriver::ConsumerThreadMain() {
+  const uint64_t tick_frequency = Clock::QueryHostTickFrequency();
+  const uint64_t start_ticks = Clock::QueryHostTickCount();
+  uint64_t last_report_ticks = start_ticks;
+  // Number of frame periods elapsed on the simulated device clock.
+  uint64_t period_count = 0;
+  bool first_frame_consumed = false;
+  while (true) {
+    if (cvars::apu_capture_realtime) {
+      // Like a device, consume one frame (or play silence) per frame period.
+      uint64_t deadline_ticks =
+          start_ticks + (period_count + 1) * channel_samples_ *
+                            tick_frequency / frame_frequency_;
+      uint64_t now_ticks = Clock::QueryHostTickCount();
+      uint64_t wait_ms = 0;
+      if (deadline_ticks > now_ticks) {
+        wait_ms = (deadline_ticks - now_ticks) * 1000 / tick_frequency;
+      }
+      if (xe::threading::Wait(shutdown_event_.get(), false,
+                              std::chrono::milliseconds(wait_ms)) ==
+          xe::threading::WaitResult::kSuccess) {
+        break;
+      }
+      // Waiting has millisecond granularity, but the deadlines are absolute,
+      // so the early wakeups don't accumulate into drift.
+      ++period_count;
+      SCOPE_profile_cpu_f("apu");
+      const float* frame = frame_ring_.Peek();
+      if (frame) {
+        WriteFrame(frame);
+        frame_ring_.Pop();
+        ++frames_consumed_;
+        first_frame_consumed = true;
+        auto ret = semaphore_->Release(1, nullptr);
+        assert_true(ret);
+      } else if (first_frame_consumed) {
+        // Before the first frame, the client just hasn't started playing yet.
+        ++underruns_;
+        WriteFrame(nullptr);
+      }
+    } else {
+      xe::threading::WaitHandle* wait_handles[] = {shutdown_event_.get(),
+                                                   frame_event_.get()};
+      auto wait_result = xe::threading::WaitAny(
+          wait_handles, xe::countof(wait_handles), false,
+          std::chrono::milliseconds(1000));
+      if (wait_result.first == xe::threading::WaitResult::kSuccess &&
+          wait_result.second == 0) {
+        break;
+      }
+      SCOPE_profile_cpu_f("apu");
+      while (const float* frame = frame_ring_.Peek()) {
+        WriteFrame(frame);
+        frame_ring_.Pop();
+        ++frames_consumed_;
+        auto ret = semaphore_->Release(1, nullptr);
+        assert_true(ret);
+      }
+    }
+
+    uint64_t now_ticks = Clock::QueryHostTickCount();
+    if (now_ticks - last_report_ticks >= tick_frequency) {
+      LogStatistics(now_ticks - last_report_ticks);
+      last_report_ticks = now_ticks;
+    }
+  }
+}
+
+void CaptureAudioDriver::WriteFrame(const float* frame) {
+  if (!file_writer_.is_open()) {
+    return;
+  }
+  float* interleaved_frame = interleaved_frame_.get();
+  if (frame) {
+    conversion::sequential_6_BE_to_interleaved_6_LE(interleaved_frame, frame,
+                                                    channel_samples_);
+  } else {
+    std::memset(interleaved_frame, 0, AudioFrameRing::kFrameSize);
+  }
+  file_writer_.WriteFrame(interleaved_frame);
+}
+
+void CaptureAudioDriver::LogStatistics(uint64_t elapsed_ticks) {
+  uint64_t frames_submitted =
+      frames_submitted_.load(std::memory_order_relaxed);
+  uint64_t decode_time_us =
+      xma_decoder_ ? xma_decoder_->total_decode_time_us() : 0;
+  uint64_t elapsed_ms = elapsed_ticks * 1000 / Clock::QueryHostTickFrequency();
+  XELOGI(
+      "Capture audio driver {}: in {} ms, {} frames submitted, {} consumed, "
+      "{} underruns, {} us of XMA decoding",
+      sequence_, elapsed_ms, frames_submitted - reported_frames_submitted_,
+      frames_consumed_ - reported_frames_consumed_,
+      underruns_ - reported_underruns_,
+      decode_time_us - reported_decode_time_us_);
+  reported_frames_submitted_ = frames_submitted;
+  reported_frames_consumed_ = frames_consumed_;
+  reported_underruns_ = underruns_;
+  reported_decode_time_us_ = decode_time_us;
+}
+
+}  // namespace capture
+}  // namespace apu
+}  // namespace xe
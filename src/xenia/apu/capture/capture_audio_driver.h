@@ -0,0 +1,84 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_APU_CAPTURE_CAPTURE_AUDIO_DRIVER_H_
+#define XENIA_APU_CAPTURE_CAPTURE_AUDIO_DRIVER_H_
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+
+#include "xenia/apu/audio_driver.h"
+#include "xenia/apu/audio_frame_ring.h"
+#include "xenia/apu/capture/capture_file_writer.h"
+#include "xenia/base/threading.h"
+
+namespace xe {
+namespace apu {
+class XmaDecoder;
+}  // namespace apu
+}  // namespace xe
+
+namespace xe {
+namespace apu {
+namespace capture {
+
+class CaptureAudioDriver : public AudioDriver {
+ public:
+  // If file_path is empty, the frames are consumed without being written.
+  CaptureAudioDriver(Memory* memory, xe::threading::Semaphore* semaphore,
+                     XmaDecoder* xma_decoder,
+                     const std::filesystem::path& file_path, uint32_t sequence);
+  ~CaptureAudioDriver() override;
+
+  bool Initialize();
+  void SubmitFrame(uint32_t frame_ptr) override;
+  void Shutdown();
+
+ private:
+  void ConsumerThreadMain();
+  // Writes a frame (or silence if frame is nullptr) if the file is still open,
+  // closing it when apu_capture_max_frames or the WAV size limit is reached.
+  void WriteFrame(const float* frame);
+  void LogStatistics(uint64_t elapsed_ticks);
+
+  xe::threading::Semaphore* semaphore_ = nullptr;
+  XmaDecoder* xma_decoder_ = nullptr;
+  std::filesystem::path file_path_;
+  uint32_t sequence_;
+
+  static const uint32_t frame_frequency_ = 48000;
+  static const uint32_t channel_samples_ = AudioFrameRing::kChannelSamples;
+  // Enough for AudioSystem::kMaximumQueuedFrames.
+  static const uint32_t frame_ring_capacity_log2_ = 6;
+  AudioFrameRing frame_ring_{frame_ring_capacity_log2_};
+
+  std::unique_ptr<xe::threading::Event> frame_event_;
+  std::unique_ptr<xe::threading::Event> shutdown_event_;
+  std::unique_ptr<xe::threading::Thread> consumer_thread_;
+
+  // Owned by the consumer thread after Initialize.
+  CaptureFileWriter file_writer_{frame_frequency_};
+  std::unique_ptr<float[]> interleaved_frame_;
+
+  // Totals, and the values at the time of the last statistics report.
+  std::atomic<uint64_t> frames_submitted_ = {0};
+  uint64_t frames_consumed_ = 0;
+  uint64_t underruns_ = 0;
+  uint64_t reported_frames_submitted_ = 0;
+  uint64_t reported_frames_consumed_ = 0;
+  uint64_t reported_underruns_ = 0;
+  uint64_t reported_decode_time_us_ = 0;
+};
+
+}  // namespace capture
+}  // namespace apu
+}  // namespace xe
+
+#endif  // XENIA_APU_CAPTURE_CAPTURE_AUDIO_DRIVER_H_
@@ -0,0 +1,65 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/apu/capture/capture_audio_system.h"
+
+#include "xenia/apu/capture/capture_apu_flags.h"
+#include "xenia/apu/capture/capture_audio_driver.h"
+#include "xenia/base/assert.h"
+
+namespace xe {
+namespace apu {
+namespace capture {
+
+std::unique_ptr<AudioSystem> CaptureAudioSystem::Create(
+    cpu::Processor* processor) {
+  return std::make_unique<CaptureAudioSystem>(processor);
+}
+
+CaptureAudioSystem::CaptureAudioSystem(cpu::Processor* processor)
+    : AudioSystem(processor) {}
+
+CaptureAudioSystem::~CaptureAudioSystem() {}
+
+void CaptureAudioSystem::Initialize() { AudioSystem::Initialize(); }
+
+X_STATUS CaptureAudioSystem::CreateDriver(size_t index,
+                                          xe::threading::Semaphore* semaphore,
+                                          AudioDriver** out_driver) {
+  assert_not_null(out_driver);
+  uint32_t sequence = driver_sequence_.fetch_add(1, std::memory_order_relaxed);
+  std::filesystem::path file_path;
+  if (!cvars::apu_capture_path.empty()) {
+    file_path = cvars::apu_capture_path /
+                fmt::format("capture_{:02}_client_{}.{}", sequence, index,
+                            cvars::apu_capture_raw ? "raw" : "wav");
+  }
+  auto driver = new CaptureAudioDriver(memory_, semaphore, xma_decoder(),
+                                       file_path, sequence);
+  if (!driver->Initialize()) {
+    driver->Shutdown();
+    delete driver;
+    return X_STATUS_UNSUCCESSFUL;
+  }
+
+  *out_driver = driver;
+  return X_STATUS_SUCCESS;
+}
+
+void CaptureAudioSystem::DestroyDriver(AudioDriver* driver) {
+  assert_not_null(driver);
+  auto capture_driver = dynamic_cast<CaptureAudioDriver*>(driver);
+  assert_not_null(capture_driver);
+  capture_driver->Shutdown();
+  delete capture_driver;
+}
+
+}  // namespace capture
+}  // namespace apu
+}  // namespace xe
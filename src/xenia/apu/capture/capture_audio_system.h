@@ -0,0 +1,51 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_APU_CAPTURE_CAPTURE_AUDIO_SYSTEM_H_
+#define XENIA_APU_CAPTURE_CAPTURE_AUDIO_SYSTEM_H_
+
+#include <atomic>
+
+#include "xenia/apu/audio_system.h"
+
+namespace xe {
+namespace apu {
+namespace capture {
+
+// Audio system without a host audio device, consuming the frames at the
+// playback rate (or as fast as they're submitted) and optionally writing them
+// to files, for recording the audio and profiling the audio pipeline without
+// depending on the host audio API.
+class CaptureAudioSystem : public AudioSystem {
+ public:
+  explicit CaptureAudioSystem(cpu::Processor* processor);
+  ~CaptureAudioSystem() override;
+
+  static bool IsAvailable() { return true; }
+
+  static std::unique_ptr<AudioSystem> Create(cpu::Processor* processor);
+
+  X_STATUS CreateDriver(size_t index, xe::threading::Semaphore* semaphore,
+                        AudioDriver** out_driver) override;
+  void DestroyDriver(AudioDriver* driver) override;
+
+ protected:
+  void Initialize() override;
+
+ private:
+  // Clients may be registered again with the same index, so the files are
+  // numbered by the order of driver creation to avoid overwriting them.
+  std::atomic<uint32_t> driver_sequence_ = {0};
+};
+
+}  // namespace capture
+}  // namespace apu
+}  // namespace xe
+
+#endif  // XENIA_APU_CAPTURE_CAPTURE_AUDIO_SYSTEM_H_
@@ -0,0 +1,117 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/apu/capture/capture_file_writer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "xenia/base/assert.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+
+namespace xe {
+namespace apu {
+namespace capture {
+
+namespace {
+// Canonical header of a WAV file with IEEE float samples.
+struct WavHeader {
+  char riff_id[4];
+  uint32_t riff_size;
+  char wave_id[4];
+  char fmt_id[4];
+  uint32_t fmt_size;
+  uint16_t format_tag;
+  uint16_t channels;
+  uint32_t samples_per_second;
+  uint32_t bytes_per_second;
+  uint16_t block_align;
+  uint16_t bits_per_sample;
+  char data_id[4];
+  uint32_t data_size;
+};
+static_assert_size(WavHeader, CaptureFileWriter::kWavHeaderSize);
+constexpr uint16_t kWavFormatIeeeFloat = 3;
+}  // namespace
+
+bool CaptureFileWriter::Open(const std::filesystem::path& path, bool wav,
+                             uint32_t max_frames) {
+  Close();
+  xe::filesystem::CreateParentFolder(path);
+  file_ = xe::filesystem::OpenFile(path, "wb");
+  if (!file_) {
+    return false;
+  }
+  path_ = path;
+  wav_ = wav;
+  max_frames_ = max_frames;
+  if (wav_) {
+    max_frames_ = max_frames_ ? std::min(max_frames_, kMaxWavFrames)
+                              : kMaxWavFrames;
+    // Reserve the space for the header, written when the size is known.
+    WavHeader header = {};
+    fwrite(&header, sizeof(header), 1, file_);
+  }
+  frames_written_ = 0;
+  return true;
+}
+
+void CaptureFileWriter::WriteFrame(const float* interleaved_frame) {
+  if (!file_) {
+    return;
+  }
+  fwrite(interleaved_frame, AudioFrameRing::kFrameSize, 1, file_);
+  ++frames_written_;
+  if (max_frames_ && frames_written_ >= max_frames_) {
+    if (wav_ && frames_written_ >= kMaxWavFrames) {
+      XELOGW(
+          "Capture audio driver: Reached the 4 GiB WAV file size limit after "
+          "{} frames for {}, set apu_capture_raw to capture longer",
+          frames_written_, xe::path_to_utf8(path_));
+    } else {
+      XELOGI("Capture audio driver: Reached the limit of {} frames for {}",
+             frames_written_, xe::path_to_utf8(path_));
+    }
+    Close();
+  }
+}
+
+void CaptureFileWriter::Close() {
+  if (!file_) {
+    return;
+  }
+  if (wav_) {
+    // Can't overflow, frames_written_ is limited to kMaxWavFrames.
+    uint32_t data_size = frames_written_ * AudioFrameRing::kFrameSize;
+    WavHeader header;
+    std::memcpy(header.riff_id, "RIFF", 4);
+    header.riff_size = uint32_t(sizeof(header) - 8) + data_size;
+    std::memcpy(header.wave_id, "WAVE", 4);
+    std::memcpy(header.fmt_id, "fmt ", 4);
+    header.fmt_size = 16;
+    header.format_tag = kWavFormatIeeeFloat;
+    header.channels = AudioFrameRing::kChannelCount;
+    header.samples_per_second = samples_per_second_;
+    header.block_align =
+        uint16_t(sizeof(float) * AudioFrameRing::kChannelCount);
+    header.bytes_per_second = samples_per_second_ * header.block_align;
+    header.bits_per_sample = sizeof(float) * 8;
+    std::memcpy(header.data_id, "data", 4);
+    header.data_size = data_size;
+    fseek(file_, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file_);
+  }
+  fclose(file_);
+  file_ = nullptr;
+}
+
+}  // namespace capture
+}  // namespace apu
+}  // namespace xe
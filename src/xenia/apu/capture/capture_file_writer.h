@@ -0,0 +1,64 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_APU_CAPTURE_CAPTURE_FILE_WRITER_H_
+#define XENIA_APU_CAPTURE_CAPTURE_FILE_WRITER_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+
+#include "xenia/apu/audio_frame_ring.h"
+
+namespace xe {
+namespace apu {
+namespace capture {
+
+// Writes frames of interleaved little-endian 32-bit float samples to a WAV
+// file, with the sizes in the header patched when it's closed, or to a raw
+// file.
+class CaptureFileWriter {
+ public:
+  static constexpr uint32_t kWavHeaderSize = 44;
+  // The RIFF and data chunk sizes in the header are 32-bit, so a WAV file
+  // holds at most this many frames (about 62 minutes at 48 kHz) - longer
+  // captures need to be raw.
+  static constexpr uint32_t kMaxWavFrames =
+      (UINT32_MAX - (kWavHeaderSize - 8)) / AudioFrameRing::kFrameSize;
+
+  explicit CaptureFileWriter(uint32_t samples_per_second)
+      : samples_per_second_(samples_per_second) {}
+  ~CaptureFileWriter() { Close(); }
+
+  // max_frames is the number of frames after which the file is closed, or 0
+  // for no limit other than kMaxWavFrames for WAV files.
+  bool Open(const std::filesystem::path& path, bool wav, uint32_t max_frames);
+  bool is_open() const { return file_ != nullptr; }
+  uint32_t frames_written() const { return frames_written_; }
+
+  // Writes AudioFrameRing::kFrameSamples samples if the file is still open,
+  // closing it when the limit is reached.
+  void WriteFrame(const float* interleaved_frame);
+  void Close();
+
+ private:
+  uint32_t samples_per_second_;
+
+  std::filesystem::path path_;
+  FILE* file_ = nullptr;
+  bool wav_ = false;
+  uint32_t max_frames_ = 0;
+  uint32_t frames_written_ = 0;
+};
+
+}  // namespace capture
+}  // namespace apu
+}  // namespace xe
+
+#endif  // XENIA_APU_CAPTURE_CAPTURE_FILE_WRITER_H_
@@ -0,0 +1,17 @@
+project_root = "../../../.."
+include(project_root.."/tools/build")
+
+group("src")
+project("xenia-apu-capture")
+  uuid("5b8f2c1e-7d4a-4e3b-9c6f-2a1d8e0b4f37")
+  kind("StaticLib")
+  language("C++")
+  links({
+    "xenia-apu",
+    "xenia-base",
+  })
+  defines({
+  })
+  local_platform_files()
+
+include("testing")
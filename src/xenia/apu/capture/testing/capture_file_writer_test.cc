@@ -0,0 +1,137 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/apu/capture/capture_file_writer.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace xe {
+namespace apu {
+namespace capture {
+namespace test {
+
+static std::vector<uint8_t> ReadFile(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file),
+                              std::istreambuf_iterator<char>());
+}
+
+template <typename T>
+static T ReadField(const std::vector<uint8_t>& data, size_t offset) {
+  T value;
+  std::memcpy(&value, data.data() + offset, sizeof(T));
+  return value;
+}
+
+static std::string ReadId(const std::vector<uint8_t>& data, size_t offset) {
+  return std::string(reinterpret_cast<const char*>(data.data() + offset), 4);
+}
+
+static void WriteFrames(CaptureFileWriter& writer, uint32_t count) {
+  std::vector<float> frame(AudioFrameRing::kFrameSamples);
+  for (uint32_t i = 0; i < count; ++i) {
+    for (uint32_t j = 0; j < AudioFrameRing::kFrameSamples; ++j) {
+      frame[j] = float(i) + float(j) / AudioFrameRing::kFrameSamples;
+    }
+    writer.WriteFrame(frame.data());
+  }
+}
+
+TEST_CASE("capture_file_wav_header", "[capture]") {
+  auto path = std::filesystem::temp_directory_path() / "xenia_capture.wav";
+  CaptureFileWriter writer(48000);
+  REQUIRE(writer.Open(path, true, 0));
+  WriteFrames(writer, 3);
+  REQUIRE(writer.is_open());
+  writer.Close();
+  REQUIRE_FALSE(writer.is_open());
+
+  auto data = ReadFile(path);
+  uint32_t data_size = 3 * AudioFrameRing::kFrameSize;
+  REQUIRE(data.size() == CaptureFileWriter::kWavHeaderSize + data_size);
+  REQUIRE(ReadId(data, 0) == "RIFF");
+  REQUIRE(ReadField<uint32_t>(data, 4) == data.size() - 8);
+  REQUIRE(ReadId(data, 8) == "WAVE");
+  REQUIRE(ReadId(data, 12) == "fmt ");
+  REQUIRE(ReadField<uint32_t>(data, 16) == 16);
+  // IEEE float.
+  REQUIRE(ReadField<uint16_t>(data, 20) == 3);
+  REQUIRE(ReadField<uint16_t>(data, 22) == AudioFrameRing::kChannelCount);
+  REQUIRE(ReadField<uint32_t>(data, 24) == 48000);
+  REQUIRE(ReadField<uint32_t>(data, 28) ==
+          48000 * sizeof(float) * AudioFrameRing::kChannelCount);
+  REQUIRE(ReadField<uint16_t>(data, 32) ==
+          sizeof(float) * AudioFrameRing::kChannelCount);
+  REQUIRE(ReadField<uint16_t>(data, 34) == 32);
+  REQUIRE(ReadId(data, 36) == "data");
+  REQUIRE(ReadField<uint32_t>(data, 40) == data_size);
+
+  // The samples follow the header as written.
+  size_t last_frame_offset =
+      CaptureFileWriter::kWavHeaderSize + 2 * AudioFrameRing::kFrameSize;
+  REQUIRE(ReadField<float>(data, last_frame_offset) == 2.0f);
+  REQUIRE(ReadField<float>(data, last_frame_offset + 4 * sizeof(float)) ==
+          2.0f + 4.0f / AudioFrameRing::kFrameSamples);
+
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("capture_file_raw", "[capture]") {
+  auto path = std::filesystem::temp_directory_path() / "xenia_capture.raw";
+  CaptureFileWriter writer(48000);
+  REQUIRE(writer.Open(path, false, 0));
+  WriteFrames(writer, 2);
+  writer.Close();
+
+  auto data = ReadFile(path);
+  REQUIRE(data.size() == 2 * AudioFrameRing::kFrameSize);
+  REQUIRE(ReadField<float>(data, AudioFrameRing::kFrameSize) == 1.0f);
+
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("capture_file_frame_limit", "[capture]") {
+  auto path = std::filesystem::temp_directory_path() / "xenia_capture.wav";
+  CaptureFileWriter writer(48000);
+  REQUIRE(writer.Open(path, true, 2));
+  WriteFrames(writer, 2);
+  // Closed with the header written when the limit is reached, and the frames
+  // after it are dropped.
+  REQUIRE_FALSE(writer.is_open());
+  WriteFrames(writer, 1);
+  REQUIRE(writer.frames_written() == 2);
+
+  auto data = ReadFile(path);
+  REQUIRE(data.size() ==
+          CaptureFileWriter::kWavHeaderSize + 2 * AudioFrameRing::kFrameSize);
+  REQUIRE(ReadField<uint32_t>(data, 40) == 2 * AudioFrameRing::kFrameSize);
+
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("capture_file_wav_size_limit", "[capture]") {
+  // The largest WAV file still has its sizes representable in the header,
+  // without any room for another frame.
+  uint64_t riff_size = CaptureFileWriter::kWavHeaderSize - 8 +
+                       uint64_t(CaptureFileWriter::kMaxWavFrames) *
+                           AudioFrameRing::kFrameSize;
+  REQUIRE(riff_size <= UINT32_MAX);
+  REQUIRE(riff_size + AudioFrameRing::kFrameSize > UINT32_MAX);
+}
+
+}  // namespace test
+}  // namespace capture
+}  // namespace apu
+}  // namespace xe
@@ -0,0 +1,11 @@
+project_root = "../../../../.."
+include(project_root.."/tools/build")
+
+test_suite("xenia-apu-capture-tests", project_root, ".", {
+  links = {
+    "fmt",
+    "xenia-apu",
+    "xenia-apu-capture",
+    "xenia-base",
+  },
+})
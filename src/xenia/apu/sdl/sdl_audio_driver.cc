@@ -27,10 +27,7 @@ SDLAudioDriver::SDLAudioDriver(Memory* memory,
                                xe::threading::Semaphore* semaphore)
     : AudioDriver(memory), semaphore_(semaphore) {}
 
-SDLAudioDriver::~SDLAudioDriver() {
-  assert_true(frames_queued_.empty());
-  assert_true(frames_unused_.empty());
-};
+SDLAudioDriver::~SDLAudioDriver() = default;
 
 bool SDLAudioDriver::Initialize() {
   SDL_version ver = {};
@@ -87,24 +84,11 @@ bool SDLAudioDriver::Initialize() {
 }
 
 void SDLAudioDriver::SubmitFrame(uint32_t frame_ptr) {
-  const auto input_frame = memory_->TranslateVirtual<float*>(frame_ptr);
-  float* output_frame;
-  {
-    std::unique_lock<std::mutex> guard(frames_mutex_);
-    if (frames_unused_.empty()) {
-      output_frame = new float[frame_samples_];
-    } else {
-      output_frame = frames_unused_.top();
-      frames_unused_.pop();
-    }
-  }
-
-  std::memcpy(output_frame, input_frame, frame_samples_ * sizeof(float));
-
-  {
-    std::unique_lock<std::mutex> guard(frames_mutex_);
-    frames_queued_.push(output_frame);
-  }
+  const auto input_frame = memory_->TranslateVirtual<const float*>(frame_ptr);
+  // The client semaphore limits the number of frames in flight to the
+  // capacity of the ring.
+  bool pushed = frame_ring_.Push(input_frame);
+  assert_true(pushed);
 }
 
 void SDLAudioDriver::Shutdown() {
@@ -116,15 +100,6 @@ void SDLAudioDriver::Shutdown() {
     SDL_QuitSubSystem(SDL_INIT_AUDIO);
     sdl_initialized_ = false;
   }
-  std::unique_lock<std::mutex> guard(frames_mutex_);
-  while (!frames_unused_.empty()) {
-    delete[] frames_unused_.top();
-    frames_unused_.pop();
-  };
-  while (!frames_queued_.empty()) {
-    delete[] frames_queued_.front();
-    frames_queued_.pop();
-  };
 }
 
 void SDLAudioDriver::SDLCallback(void* userdata, Uint8* stream, int len) {
@@ -137,12 +112,10 @@ void SDLAudioDriver::SDLCallback(void* userdata, Uint8* stream, int len) {
   assert_true(len ==
               sizeof(float) * channel_samples_ * driver->sdl_device_channels_);
 
-  std::unique_lock<std::mutex> guard(driver->frames_mutex_);
-  if (driver->frames_queued_.empty()) {
+  const float* buffer = driver->frame_ring_.Peek();
+  if (!buffer) {
     std::memset(stream, 0, len);
   } else {
-    auto buffer = driver->frames_queued_.front();
-    driver->frames_queued_.pop();
     if (cvars::mute) {
       std::memset(stream, 0, len);
     } else {
@@ -160,7 +133,7 @@ void SDLAudioDriver::SDLCallback(void* userdata, Uint8* stream, int len) {
           break;
       }
     }
-    driver->frames_unused_.push(buffer);
+    driver->frame_ring_.Pop();
 
     auto ret = driver->semaphore_->Release(1, nullptr);
     assert_true(ret);
@@ -10,12 +10,9 @@
 #ifndef XENIA_APU_SDL_SDL_AUDIO_DRIVER_H_
 #define XENIA_APU_SDL_SDL_AUDIO_DRIVER_H_
 
-#include <mutex>
-#include <queue>
-#include <stack>
-
 #include "SDL.h"
 #include "xenia/apu/audio_driver.h"
+#include "xenia/apu/audio_frame_ring.h"
 #include "xenia/base/threading.h"
 
 namespace xe {
@@ -41,13 +38,12 @@ class SDLAudioDriver : public AudioDriver {
   uint8_t sdl_device_channels_ = 0;
 
   static const uint32_t frame_frequency_ = 48000;
-  static const uint32_t frame_channels_ = 6;
-  static const uint32_t channel_samples_ = 256;
-  static const uint32_t frame_samples_ = frame_channels_ * channel_samples_;
-  static const uint32_t frame_size_ = sizeof(float) * frame_samples_;
-  std::queue<float*> frames_queued_ = {};
-  std::stack<float*> frames_unused_ = {};
-  std::mutex frames_mutex_ = {};
+  static const uint32_t frame_channels_ = AudioFrameRing::kChannelCount;
+  static const uint32_t channel_samples_ = AudioFrameRing::kChannelSamples;
+  // Enough for AudioSystem::kMaximumQueuedFrames.
+  static const uint32_t frame_ring_capacity_log2_ = 6;
+  // Filled by the guest audio thread, drained by the SDL audio callback.
+  AudioFrameRing frame_ring_{frame_ring_capacity_log2_};
 };
 
 }  // namespace sdl
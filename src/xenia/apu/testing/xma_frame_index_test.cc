@@ -0,0 +1,314 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/apu/xma_frame_index.h"
+
+#include "third_party/catch/include/catch.hpp"
+#include "third_party/fmt/include/fmt/format.h"
+
+#include "xenia/apu/xma_helpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace xe {
+namespace apu {
+namespace test {
+
+static constexpr uint32_t kPayloadBitsPerPacket =
+    xma::kBitsPerPacket - xma::kBitsPerPacketHeader;
+
+static void WriteBits(std::vector<uint8_t>& buffer, uint32_t bit_offset,
+                      uint32_t value, uint32_t count) {
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t bit = bit_offset + i;
+    uint8_t mask = uint8_t(0x80 >> (bit & 7));
+    if ((value >> (count - 1 - i)) & 1) {
+      buffer[bit >> 3] |= mask;
+    } else {
+      buffer[bit >> 3] &= ~mask;
+    }
+  }
+}
+
+static uint32_t ReadBits(const std::vector<uint8_t>& buffer,
+                         uint32_t bit_offset, uint32_t count) {
+  uint32_t value = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t bit = bit_offset + i;
+    value = (value << 1) | ((buffer[bit >> 3] >> (7 - (bit & 7))) & 1);
+  }
+  return value;
+}
+
+static void WritePacketHeader(std::vector<uint8_t>& buffer, uint32_t packet,
+                              uint32_t frame_count,
+                              uint32_t first_frame_offset) {
+  uint32_t offset = packet * xma::kBitsPerPacket;
+  WriteBits(buffer, offset, frame_count, 6);
+  WriteBits(buffer, offset + 6, first_frame_offset, 15);
+  // XMA2 metadata, no skipped packets.
+  WriteBits(buffer, offset + 21, 1, 3);
+  WriteBits(buffer, offset + 24, 0, 8);
+}
+
+// A single XMA stream with the frames laid out back to back across packets,
+// like the encoder does, with the frame locations the index is expected to
+// find.
+struct XmaTestStream {
+  std::vector<uint8_t> buffer;
+  uint32_t packet_count;
+  std::vector<XmaFrameIndex::Frame> frames;
+};
+
+static XmaTestStream MakeXmaTestStream(
+    const std::vector<uint32_t>& frame_lengths) {
+  // Frame positions in the payload, which excludes the packet headers.
+  std::vector<uint32_t> payload_offsets;
+  uint32_t payload_size = 0;
+  for (uint32_t length : frame_lengths) {
+    payload_offsets.push_back(payload_size);
+    payload_size += length;
+  }
+  XmaTestStream stream;
+  stream.packet_count =
+      (payload_size + kPayloadBitsPerPacket - 1) / kPayloadBitsPerPacket;
+  stream.buffer.resize(stream.packet_count * xma::kBytesPerPacket);
+  auto to_buffer_offset = [](uint32_t payload_offset) {
+    return payload_offset / kPayloadBitsPerPacket * xma::kBitsPerPacket +
+           xma::kBitsPerPacketHeader + payload_offset % kPayloadBitsPerPacket;
+  };
+  auto write_payload_bits = [&](uint32_t payload_offset, uint32_t value,
+                                uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+      WriteBits(stream.buffer, to_buffer_offset(payload_offset + i),
+                (value >> (count - 1 - i)) & 1, 1);
+    }
+  };
+
+  std::vector<uint32_t> packet_frame_counts(stream.packet_count, 0);
+  std::vector<uint32_t> packet_first_frame_offsets(stream.packet_count,
+                                                   xma::kMaxFrameLength);
+  for (size_t i = 0; i < frame_lengths.size(); ++i) {
+    uint32_t start = payload_offsets[i];
+    uint32_t length = frame_lengths[i];
+    uint32_t packet = start / kPayloadBitsPerPacket;
+    uint32_t end_packet = (start + length - 1) / kPayloadBitsPerPacket;
+    bool next_in_same_packet =
+        i + 1 < frame_lengths.size() &&
+        payload_offsets[i + 1] / kPayloadBitsPerPacket == end_packet;
+    write_payload_bits(start, length, 15);
+    write_payload_bits(start + length - 1, next_in_same_packet ? 1 : 0, 1);
+    if (!packet_frame_counts[packet]++) {
+      packet_first_frame_offsets[packet] = start % kPayloadBitsPerPacket;
+    }
+
+    XmaFrameIndex::Frame frame;
+    frame.bit_offset = to_buffer_offset(start);
+    uint32_t packet_bits_remaining =
+        kPayloadBitsPerPacket - start % kPayloadBitsPerPacket;
+    frame.bit_length =
+        packet_bits_remaining >= 15 ? length : xma::kMaxFrameLength + 1;
+    frame.packet = uint16_t(packet);
+    frame.index_in_packet = uint16_t(packet_frame_counts[packet] - 1);
+    frame.is_split = length > packet_bits_remaining;
+    frame.next_bit_offset =
+        !frame.is_split && next_in_same_packet
+            ? to_buffer_offset(payload_offsets[i + 1])
+            : 0;
+    stream.frames.push_back(frame);
+  }
+  for (uint32_t i = 0; i < stream.packet_count; ++i) {
+    WritePacketHeader(stream.buffer, i, packet_frame_counts[i],
+                      packet_first_frame_offsets[i]);
+  }
+  // Frames beginning too close to the end of the packet for the header to
+  // point to aren't reachable.
+  auto is_unreachable = [&](const XmaFrameIndex::Frame& frame) {
+    uint32_t first_frame_offset =
+        xma::kBitsPerPacketHeader + packet_first_frame_offsets[frame.packet];
+    return first_frame_offset >
+           xma::kBitsPerPacket - (xma::kBitsPerPacketHeader + 1);
+  };
+  stream.frames.erase(std::remove_if(stream.frames.begin(),
+                                     stream.frames.end(), is_unreachable),
+                      stream.frames.end());
+  return stream;
+}
+
+static void RequireFramesEqual(const XmaFrameIndex::Frame& frame,
+                               const XmaFrameIndex::Frame& expected) {
+  REQUIRE(frame.bit_offset == expected.bit_offset);
+  REQUIRE(frame.bit_length == expected.bit_length);
+  REQUIRE(frame.packet == expected.packet);
+  REQUIRE(frame.index_in_packet == expected.index_in_packet);
+  REQUIRE(frame.is_split == expected.is_split);
+  REQUIRE(frame.next_bit_offset == expected.next_bit_offset);
+}
+
+TEST_CASE("xma_frame_index_golden", "[xma_frame_index]") {
+  // Two frames in the first packet, a third one split between the packets,
+  // and one more after the split one in the second packet.
+  XmaTestStream stream = MakeXmaTestStream({1000, 2000, 14000, 500});
+  REQUIRE(stream.packet_count == 2);
+  REQUIRE(ReadBits(stream.buffer, 0, 6) == 3);
+  REQUIRE(xma::GetPacketFrameOffset(stream.buffer.data()) == 32);
+  REQUIRE(xma::GetPacketFrameOffset(stream.buffer.data() +
+                                    xma::kBytesPerPacket) == 32 + 648);
+
+  XmaFrameIndex index;
+  REQUIRE_FALSE(index.IsBuiltFor(0x1000, 2));
+  index.Build(0x1000, stream.buffer.data(), stream.packet_count);
+  REQUIRE(index.IsBuiltFor(0x1000, 2));
+  REQUIRE_FALSE(index.IsBuiltFor(0x2000, 2));
+  REQUIRE_FALSE(index.IsBuiltFor(0x1000, 1));
+
+  REQUIRE(index.GetPacketFrameCount(0) == 3);
+  REQUIRE(index.IsPacketLastFrameSplit(0));
+  REQUIRE(index.GetPacketFrameCount(1) == 1);
+  REQUIRE_FALSE(index.IsPacketLastFrameSplit(1));
+
+  const XmaFrameIndex::Frame* frame = index.FindFrame(32);
+  REQUIRE(frame != nullptr);
+  REQUIRE(frame->bit_length == 1000);
+  REQUIRE(frame->next_bit_offset == 1032);
+  frame = index.FindFrame(1032);
+  REQUIRE(frame != nullptr);
+  REQUIRE(frame->index_in_packet == 1);
+  REQUIRE(frame->next_bit_offset == 3032);
+  frame = index.FindFrame(3032);
+  REQUIRE(frame != nullptr);
+  REQUIRE(frame->is_split);
+  REQUIRE(frame->next_bit_offset == 0);
+  frame = index.FindFrame(xma::kBitsPerPacket + 32 + 648);
+  REQUIRE(frame != nullptr);
+  REQUIRE(frame->packet == 1);
+  REQUIRE(frame->index_in_packet == 0);
+  REQUIRE(frame->bit_length == 500);
+  REQUIRE_FALSE(frame->is_split);
+  REQUIRE(frame->next_bit_offset == 0);
+
+  // Not at a frame boundary.
+  REQUIRE_FALSE(index.FindFrame(33));
+  REQUIRE_FALSE(index.FindFrame(xma::kBitsPerPacket));
+  REQUIRE_FALSE(index.FindFrame(2 * xma::kBitsPerPacket + 32));
+
+  index.Reset();
+  REQUIRE_FALSE(index.IsBuiltFor(0x1000, 2));
+}
+
+TEST_CASE("xma_frame_index_split_length_field", "[xma_frame_index]") {
+  // The second frame begins 10 bits before the end of the first packet, so
+  // its length field is split too.
+  XmaTestStream stream =
+      MakeXmaTestStream({kPayloadBitsPerPacket - 10, 3000, 700});
+  XmaFrameIndex index;
+  index.Build(0, stream.buffer.data(), stream.packet_count);
+  REQUIRE(index.frames().size() == stream.frames.size());
+  const XmaFrameIndex::Frame* frame =
+      index.FindFrame(xma::kBitsPerPacket - 10);
+  REQUIRE(frame != nullptr);
+  REQUIRE(frame->is_split);
+  REQUIRE(frame->bit_length == xma::kMaxFrameLength + 1);
+  REQUIRE(index.IsPacketLastFrameSplit(0));
+}
+
+TEST_CASE("xma_frame_index_random_streams", "[xma_frame_index]") {
+  std::mt19937 random(0x584D4132);
+  std::uniform_int_distribution<uint32_t> length_distribution(16, 6000);
+  for (uint32_t i = 0; i < 32; ++i) {
+    std::vector<uint32_t> frame_lengths(1 + random() % 200);
+    for (uint32_t& length : frame_lengths) {
+      length = length_distribution(random);
+    }
+    XmaTestStream stream = MakeXmaTestStream(frame_lengths);
+    XmaFrameIndex index;
+    index.Build(0, stream.buffer.data(), stream.packet_count);
+    REQUIRE(index.frames().size() == stream.frames.size());
+    for (size_t j = 0; j < stream.frames.size(); ++j) {
+      RequireFramesEqual(index.frames()[j], stream.frames[j]);
+      const XmaFrameIndex::Frame* frame =
+          index.FindFrame(stream.frames[j].bit_offset);
+      REQUIRE(frame == &index.frames()[j]);
+    }
+  }
+}
+
+// Finds the frame by walking the frames from the beginning of the packet, as
+// done for every frame before the index existed. Returns the index in the
+// packet, or -1.
+static int ScanPacketForFrame(const std::vector<uint8_t>& buffer,
+                              uint32_t bit_offset) {
+  uint32_t packet = bit_offset / xma::kBitsPerPacket;
+  uint32_t packet_offset = packet * xma::kBitsPerPacket;
+  uint32_t offset =
+      packet_offset + xma::GetPacketFrameOffset(buffer.data() +
+                                                packet * xma::kBytesPerPacket);
+  uint32_t packet_end = packet_offset + xma::kBitsPerPacket;
+  for (int frame_index = 0; offset + 15 <= packet_end; ++frame_index) {
+    if (offset == bit_offset) {
+      return frame_index;
+    }
+    uint32_t length = ReadBits(buffer, offset, 15);
+    if (length < 16 || offset + length > packet_end ||
+        !ReadBits(buffer, offset + length - 1, 1)) {
+      break;
+    }
+    offset += length;
+  }
+  return -1;
+}
+
+// Compares locating every frame of a buffer with the index against walking the
+// packet for each frame. Hidden, run with the [benchmark] tag.
+TEST_CASE("xma_frame_index_cost", "[.benchmark]") {
+  std::mt19937 random(0x584D4132);
+  std::uniform_int_distribution<uint32_t> length_distribution(500, 4000);
+  std::vector<uint32_t> frame_lengths(4096);
+  for (uint32_t& length : frame_lengths) {
+    length = length_distribution(random);
+  }
+  XmaTestStream stream = MakeXmaTestStream(frame_lengths);
+  const uint32_t iterations = 16;
+
+  auto report = [&](const char* name, std::chrono::nanoseconds duration) {
+    double ns_per_frame = double(duration.count()) / double(iterations) /
+                          double(stream.frames.size());
+    fmt::print("{}: {:.1f} ns per frame\n", name, ns_per_frame);
+  };
+
+  uint64_t checksum = 0;
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; ++i) {
+      for (const XmaFrameIndex::Frame& frame : stream.frames) {
+        checksum += ScanPacketForFrame(stream.buffer, frame.bit_offset);
+      }
+    }
+    report("packet walk", std::chrono::steady_clock::now() - start);
+  }
+  {
+    XmaFrameIndex index;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; ++i) {
+      index.Build(0, stream.buffer.data(), stream.packet_count);
+      for (const XmaFrameIndex::Frame& frame : stream.frames) {
+        checksum += index.FindFrame(frame.bit_offset)->index_in_packet;
+      }
+    }
+    report("index", std::chrono::steady_clock::now() - start);
+  }
+  REQUIRE(checksum != 0);
+}
+
+}  // namespace test
+}  // namespace apu
+}  // namespace xe
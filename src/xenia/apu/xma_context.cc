@@ -15,6 +15,7 @@
 #include "xenia/apu/xma_decoder.h"
 #include "xenia/apu/xma_helpers.h"
 #include "xenia/base/bit_stream.h"
+#include "xenia/base/clock.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/platform.h"
 #include "xenia/base/profiling.h"
@@ -98,13 +99,27 @@ bool XmaContext::Work() {
 
   set_is_enabled(false);
 
+  uint64_t decode_start = Clock::QueryHostTickCount();
   auto context_ptr = memory()->TranslateVirtual(guest_ptr());
   XMA_CONTEXT_DATA data(context_ptr);
   Decode(&data);
   data.Store(context_ptr);
+  uint64_t decode_time_us = (Clock::QueryHostTickCount() - decode_start) *
+                            1000000 / Clock::QueryHostTickFrequency();
+  ++decode_statistics_.work_count;
+  decode_statistics_.total_time_us += decode_time_us;
+  decode_statistics_.max_time_us =
+      std::max(decode_statistics_.max_time_us, decode_time_us);
   return true;
 }
 
+XmaContext::DecodeStatistics XmaContext::TakeDecodeStatistics() {
+  std::lock_guard<std::mutex> lock(lock_);
+  DecodeStatistics statistics = decode_statistics_;
+  decode_statistics_ = DecodeStatistics();
+  return statistics;
+}
+
 void XmaContext::Enable() {
   std::lock_guard<std::mutex> lock(lock_);
 
@@ -148,6 +163,10 @@ void XmaContext::Clear() {
   data.output_buffer_write_offset = 0;
 
   data.Store(context_ptr);
+
+  for (XmaFrameIndex& frame_index : input_buffer_frame_indices_) {
+    frame_index.Reset();
+  }
 }
 
 void XmaContext::Disable() {
@@ -173,6 +192,7 @@ void XmaContext::SwapInputBuffer(XMA_CONTEXT_DATA* data) {
   } else {
     data->input_buffer_1_valid = 0;
   }
+  input_buffer_frame_indices_[data->current_buffer].Reset();
   data->current_buffer ^= 1;
   data->input_buffer_read_offset = 0;
 }
@@ -225,56 +245,6 @@ int XmaContext::GetSampleRate(int id) {
   return 0;
 }
 
-bool XmaContext::ValidFrameOffset(uint8_t* block, size_t size_bytes,
-                                  size_t frame_offset_bits) {
-  uint32_t packet_num =
-      GetFramePacketNumber(block, size_bytes, frame_offset_bits);
-  if (packet_num == -1) {
-    // Invalid packet number
-    return false;
-  }
-
-  uint8_t* packet = block + (packet_num * kBytesPerPacket);
-  size_t relative_offset_bits = frame_offset_bits % kBitsPerPacket;
-
-  uint32_t first_frame_offset = xma::GetPacketFrameOffset(packet);
-  if (first_frame_offset == -1 || first_frame_offset > kBitsPerPacket) {
-    // Packet only contains a partial frame, so no frames can start here.
-    return false;
-  }
-
-  BitStream stream(packet, kBitsPerPacket);
-  stream.SetOffset(first_frame_offset);
-  while (true) {
-    if (stream.offset_bits() == relative_offset_bits) {
-      return true;
-    }
-
-    if (stream.BitsRemaining() < 15) {
-      // Not enough room for another frame header.
-      return false;
-    }
-
-    uint64_t size = stream.Read(15);
-    if ((size - 15) > stream.BitsRemaining()) {
-      // Last frame.
-      return false;
-    } else if (size == 0x7FFF) {
-      // Invalid frame (and last of this packet)
-      return false;
-    }
-
-    stream.Advance(size - 16);
-
-    // Read the trailing bit to see if frames follow
-    if (stream.Read(1) == 0) {
-      break;
-    }
-  }
-
-  return false;
-}
-
 static void dump_raw(AVFrame* frame, int id) {
   FILE* outfile = fopen(fmt::format("out{}.raw", id).c_str(), "ab");
   if (!outfile) {
@@ -356,6 +326,28 @@ void XmaContext::Decode(XMA_CONTEXT_DATA* data) {
       data->current_buffer ? input_buffer_1_size : input_buffer_0_size;
   size_t current_input_packet_count = current_input_size / kBytesPerPacket;
 
+  // Frame locations are parsed once per input buffer rather than by walking
+  // the packet for every frame. The guest doesn't modify a buffer while it's
+  // valid, and the index is dropped when the buffer is invalidated.
+  if (!data->input_buffer_0_valid) {
+    input_buffer_frame_indices_[0].Reset();
+  }
+  if (!data->input_buffer_1_valid) {
+    input_buffer_frame_indices_[1].Reset();
+  }
+  XmaFrameIndex& frame_index =
+      input_buffer_frame_indices_[data->current_buffer];
+  if (current_input_buffer) {
+    uint32_t current_input_ptr = data->current_buffer
+                                     ? data->input_buffer_1_ptr
+                                     : data->input_buffer_0_ptr;
+    if (!frame_index.IsBuiltFor(current_input_ptr,
+                                uint32_t(current_input_packet_count))) {
+      frame_index.Build(current_input_ptr, current_input_buffer,
+                        uint32_t(current_input_packet_count));
+    }
+  }
+
   // Output buffers are in raw PCM samples, 256 bytes per block.
   // Output buffer is a ring buffer. We need to write from the write offset
   // to the read offset.
@@ -402,7 +394,9 @@ void XmaContext::Decode(XMA_CONTEXT_DATA* data) {
     // Where are we in the buffer (in XMA jargon)
     int packet_idx, frame_idx, frame_count;
     uint8_t* packet;
-    bool frame_last_split;
+    // Only for a frame beginning at the read offset, not when continuing a
+    // split frame.
+    const XmaFrameIndex::Frame* frame = nullptr;
 
     BitStream stream(current_input_buffer, current_input_size * 8);
     stream.SetOffset(data->input_buffer_read_offset);
@@ -437,7 +431,7 @@ void XmaContext::Decode(XMA_CONTEXT_DATA* data) {
           GetFramePacketNumber(current_input_buffer, current_input_size,
                                data->input_buffer_read_offset);
       packet = current_input_buffer + packet_idx * kBytesPerPacket;
-      std::tie(frame_count, frame_last_split) = GetPacketFrameCount(packet);
+      frame_count = frame_index.GetPacketFrameCount(packet_idx);
       frame_idx = -1;
 
       stream =
@@ -495,8 +489,8 @@ void XmaContext::Decode(XMA_CONTEXT_DATA* data) {
         }
       }
 
-      if (!ValidFrameOffset(current_input_buffer, current_input_size,
-                            data->input_buffer_read_offset)) {
+      frame = frame_index.FindFrame(data->input_buffer_read_offset);
+      if (!frame) {
         XELOGAPU("XmaContext {}: Invalid read offset {}!", id(),
                  data->input_buffer_read_offset);
         SwapInputBuffer(data);
@@ -504,49 +498,37 @@ void XmaContext::Decode(XMA_CONTEXT_DATA* data) {
       }
 
       // Where are we in the buffer (in XMA jargon)
-      std::tie(packet_idx, frame_idx) =
-          GetFrameNumber(current_input_buffer, current_input_size,
-                         data->input_buffer_read_offset);
-      // TODO handle
-      assert_true(packet_idx >= 0);
-      assert_true(frame_idx >= 0);
+      packet_idx = frame->packet;
+      frame_idx = frame->index_in_packet;
       packet = current_input_buffer + packet_idx * kBytesPerPacket;
       // frames that belong to this packet
-      std::tie(frame_count, frame_last_split) = GetPacketFrameCount(packet);
-      assert_true(frame_count >= 0);  // TODO end
+      frame_count = frame_index.GetPacketFrameCount(packet_idx);
 
       PrepareDecoder(packet, data->sample_rate, bool(data->is_stereo));
 
       // Current frame is split to next packet:
-      bool frame_is_split = frame_last_split && (frame_idx >= frame_count - 1);
+      bool frame_is_split = frame->is_split;
 
-      stream =
-          BitStream(current_input_buffer, (packet_idx + 1) * kBitsPerPacket);
-      stream.SetOffset(data->input_buffer_read_offset);
-      // int frame_len;
-      // int frame_len_partial
-      split_frame_len_partial_ = static_cast<int>(stream.BitsRemaining());
-      if (split_frame_len_partial_ >= 15) {
-        split_frame_len_ = static_cast<int>(stream.Peek(15));
-      } else {
-        // assert_always();
-        split_frame_len_ = xma::kMaxFrameLength + 1;
-      }
+      split_frame_len_partial_ =
+          (packet_idx + 1) * kBitsPerPacket - data->input_buffer_read_offset;
+      split_frame_len_ = frame->bit_length;
       assert_true(frame_is_split ==
                   (split_frame_len_ > split_frame_len_partial_));
 
-      // TODO fix bitstream copy
-      std::memset(xma_frame_.data(), 0, xma_frame_.size());
-
-      {
-        auto offset =
-            stream.Copy(xma_frame_.data() + 1,
-                        std::min(split_frame_len_, split_frame_len_partial_));
-        assert_true(offset < 8);
-        split_frame_padding_start_ = static_cast<uint8_t>(offset);
-      }
-
       if (frame_is_split) {
+        // TODO fix bitstream copy
+        std::memset(xma_frame_.data(), 0, xma_frame_.size());
+        stream =
+            BitStream(current_input_buffer, (packet_idx + 1) * kBitsPerPacket);
+        stream.SetOffset(data->input_buffer_read_offset);
+        {
+          auto offset =
+              stream.Copy(xma_frame_.data() + 1,
+                          std::min(split_frame_len_, split_frame_len_partial_));
+          assert_true(offset < 8);
+          split_frame_padding_start_ = static_cast<uint8_t>(offset);
+        }
+
         // go to next xma packet of this stream
         packets_skip_ = xma::GetPacketSkipCount(packet) + 1;
         while (packets_skip_ > 0) {
@@ -568,6 +550,26 @@ void XmaContext::Decode(XMA_CONTEXT_DATA* data) {
         data->input_buffer_read_offset = packet_idx * kBitsPerPacket;
         continue;
       }
+
+      // The decoder is given the bit offset of the frame in the first byte, so
+      // a frame within one packet is passed as a plain copy of the bytes it
+      // occupies, with the bits of the neighboring data cleared, instead of
+      // being reassembled bit by bit.
+      const uint8_t* frame_bytes =
+          current_input_buffer + (data->input_buffer_read_offset >> 3);
+      uint32_t frame_padding_start = data->input_buffer_read_offset & 7;
+      uint32_t frame_byte_count =
+          (frame_padding_start + split_frame_len_ + 7) >> 3;
+      assert_true(1 + frame_byte_count + AV_INPUT_BUFFER_PADDING_SIZE <=
+                  xma_frame_.size());
+      std::memcpy(xma_frame_.data() + 1, frame_bytes, frame_byte_count);
+      std::memset(xma_frame_.data() + 1 + frame_byte_count, 0,
+                  AV_INPUT_BUFFER_PADDING_SIZE);
+      uint32_t frame_padding_end =
+          frame_byte_count * 8 - (frame_padding_start + split_frame_len_);
+      xma_frame_[1] &= uint8_t(0xFF >> frame_padding_start);
+      xma_frame_[frame_byte_count] &= uint8_t(0xFF << frame_padding_end);
+      split_frame_padding_start_ = static_cast<uint8_t>(frame_padding_start);
     }
 
     av_packet_->data = xma_frame_.data();
@@ -631,8 +633,7 @@ void XmaContext::Decode(XMA_CONTEXT_DATA* data) {
       // if (offset % (kBytesPerSample * 8) == 0) {
       //  offset = xma::GetPacketFrameOffset(packet);
       //}
-      offset = static_cast<uint32_t>(
-          GetNextFrame(current_input_buffer, current_input_size, offset));
+      offset = frame ? frame->next_bit_offset : 0;
       // assert_true((offset == 0) ==
       //            (frame_is_split || (frame_idx + 1 >= frame_count)));
       if (frame_idx + 1 >= frame_count) {
@@ -688,49 +689,6 @@ void XmaContext::Decode(XMA_CONTEXT_DATA* data) {
   }
 }
 
-size_t XmaContext::GetNextFrame(uint8_t* block, size_t size,
-                                size_t bit_offset) {
-  // offset = xma::GetPacketFrameOffset(packet);
-  // TODO meh
-  // auto next_packet = bit_offset - bit_offset % kBitsPerPacket +
-  // kBitsPerPacket;
-  auto packet_idx = GetFramePacketNumber(block, size, bit_offset);
-
-  BitStream stream(block, size * 8);
-  stream.SetOffset(bit_offset);
-
-  if (stream.BitsRemaining() < 15) {
-    return 0;
-  }
-
-  uint64_t len = stream.Read(15);
-  if ((len - 15) > stream.BitsRemaining()) {
-    assert_always("TODO");
-    // *bit_offset = next_packet;
-    // return false;
-    // return next_packet;
-    return 0;
-  } else if (len >= xma::kMaxFrameLength) {
-    assert_always("TODO");
-    // *bit_offset = next_packet;
-    // return false;
-    return 0;
-    // return next_packet;
-  }
-
-  stream.Advance(len - (15 + 1));
-  // Read the trailing bit to see if frames follow
-  if (stream.Read(1) == 0) {
-    return 0;
-  }
-
-  bit_offset += len;
-  if (packet_idx < GetFramePacketNumber(block, size, bit_offset)) {
-    return 0;
-  }
-  return bit_offset;
-}
-
 int XmaContext::GetFramePacketNumber(uint8_t* block, size_t size,
                                      size_t bit_offset) {
   size *= 8;
@@ -746,87 +704,6 @@ int XmaContext::GetFramePacketNumber(uint8_t* block, size_t size,
   return (uint32_t)packet_number;
 }
 
-std::tuple<int, int> XmaContext::GetFrameNumber(uint8_t* block, size_t size,
-                                                size_t bit_offset) {
-  auto packet_idx = GetFramePacketNumber(block, size, bit_offset);
-
-  if (packet_idx < 0 || (packet_idx + 1) * kBytesPerPacket > size) {
-    assert_always();
-    return {packet_idx, -2};
-  }
-
-  if (bit_offset == 0) {
-    return {packet_idx, -1};
-  }
-
-  uint8_t* packet = block + (packet_idx * kBytesPerPacket);
-  auto first_frame_offset = xma::GetPacketFrameOffset(packet);
-  BitStream stream(block, size * 8);
-  stream.SetOffset(packet_idx * kBitsPerPacket + first_frame_offset);
-
-  int frame_idx = 0;
-  while (true) {
-    if (stream.BitsRemaining() < 15) {
-      break;
-    }
-
-    if (stream.offset_bits() == bit_offset) {
-      break;
-    }
-
-    uint64_t size = stream.Read(15);
-    if ((size - 15) > stream.BitsRemaining()) {
-      // Last frame.
-      break;
-    } else if (size == 0x7FFF) {
-      // Invalid frame (and last of this packet)
-      break;
-    }
-
-    stream.Advance(size - (15 + 1));
-
-    // Read the trailing bit to see if frames follow
-    if (stream.Read(1) == 0) {
-      break;
-    }
-    frame_idx++;
-  }
-  return {packet_idx, frame_idx};
-}
-
-std::tuple<int, bool> XmaContext::GetPacketFrameCount(uint8_t* packet) {
-  auto first_frame_offset = xma::GetPacketFrameOffset(packet);
-  if (first_frame_offset > kBitsPerPacket - kBitsPerHeader) {
-    // frame offset is beyond packet end
-    return {0, false};
-  }
-
-  BitStream stream(packet, kBitsPerPacket);
-  stream.SetOffset(first_frame_offset);
-  int frame_count = 0;
-
-  while (true) {
-    frame_count++;
-    if (stream.BitsRemaining() < 15) {
-      return {frame_count, true};
-    }
-
-    uint64_t size = stream.Read(15);
-    if ((size - 15) > stream.BitsRemaining()) {
-      return {frame_count, true};
-    } else if (size == 0x7FFF) {
-      assert_always();
-      return {frame_count, true};
-    }
-
-    stream.Advance(size - (15 + 1));
-
-    if (stream.Read(1) == 0) {
-      return {frame_count, false};
-    }
-  }
-}
-
 int XmaContext::PrepareDecoder(uint8_t* packet, int sample_rate,
                                bool is_two_channel) {
   // Sanity check: Packet metadata is always 1 for XMA2/0 for XMA
@@ -16,6 +16,7 @@
 #include <queue>
 //#include <vector>
 
+#include "xenia/apu/xma_frame_index.h"
 #include "xenia/memory.h"
 #include "xenia/xbox.h"
 
@@ -150,6 +151,13 @@ class XmaContext {
   explicit XmaContext();
   ~XmaContext();
 
+  // Host time spent decoding the context, for balancing the decoder workers.
+  struct DecodeStatistics {
+    uint64_t work_count = 0;
+    uint64_t total_time_us = 0;
+    uint64_t max_time_us = 0;
+  };
+
   int Setup(uint32_t id, Memory* memory, uint32_t guest_ptr);
   bool Work();
 
@@ -169,30 +177,23 @@ class XmaContext {
   void set_is_allocated(bool is_allocated) { is_allocated_ = is_allocated; }
   void set_is_enabled(bool is_enabled) { is_enabled_ = is_enabled; }
 
+  // Returns the statistics gathered since the previous call and resets them.
+  DecodeStatistics TakeDecodeStatistics();
+
  private:
-  static void SwapInputBuffer(XMA_CONTEXT_DATA* data);
+  void SwapInputBuffer(XMA_CONTEXT_DATA* data);
   static bool TrySetupNextLoop(XMA_CONTEXT_DATA* data,
                                bool ignore_input_buffer_offset);
   static void NextPacket(XMA_CONTEXT_DATA* data);
   static int GetSampleRate(int id);
-  // Get the offset of the next frame. Does not traverse packets.
-  static size_t GetNextFrame(uint8_t* block, size_t size, size_t bit_offset);
   // Get the containing packet number of the frame pointed to by the offset.
   static int GetFramePacketNumber(uint8_t* block, size_t size,
                                   size_t bit_offset);
-  // Get the packet number and the index of the frame inside that packet
-  static std::tuple<int, int> GetFrameNumber(uint8_t* block, size_t size,
-                                             size_t bit_offset);
-  // Get the number of frames contained in the packet (including truncated) and
-  // if the last frame is split.
-  static std::tuple<int, bool> GetPacketFrameCount(uint8_t* packet);
 
   // Convert sample format and swap bytes
   static void ConvertFrame(const uint8_t** samples, bool is_two_channel,
                            uint8_t* output_buffer);
 
-  bool ValidFrameOffset(uint8_t* block, size_t size_bytes,
-                        size_t frame_offset_bits);
   void Decode(XMA_CONTEXT_DATA* data);
   int PrepareDecoder(uint8_t* packet, int sample_rate, bool is_two_channel);
 
@@ -204,6 +205,7 @@ class XmaContext {
   bool is_allocated_ = false;
   bool is_enabled_ = false;
   // bool is_dirty_ = true;
+  DecodeStatistics decode_statistics_;
 
   // ffmpeg structures
   AVPacket* av_packet_ = nullptr;
@@ -227,6 +229,8 @@ class XmaContext {
   uint8_t split_frame_padding_start_ = 0;
   // first byte contains bit offset information
   std::array<uint8_t, 1 + 4096> xma_frame_;
+  // Frame locations in input buffers 0 and 1, kept while the buffer is valid.
+  std::array<XmaFrameIndex, 2> input_buffer_frame_indices_;
 
   // uint8_t* current_frame_ = nullptr;
   // conversion buffer for 2 channel frame
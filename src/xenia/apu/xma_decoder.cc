@@ -9,7 +9,10 @@
 
 #include "xenia/apu/xma_decoder.h"
 
+#include <algorithm>
+
 #include "xenia/apu/xma_context.h"
+#include "xenia/base/clock.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
@@ -18,6 +21,7 @@
 #include "xenia/base/string_buffer.h"
 #include "xenia/cpu/processor.h"
 #include "xenia/cpu/thread_state.h"
+#include "xenia/kernel/kernel_state.h"
 #include "xenia/kernel/xthread.h"
 
 extern "C" {
@@ -50,6 +54,14 @@ extern "C" {
 
 DEFINE_bool(ffmpeg_verbose, false, "Verbose FFmpeg output (debug and above)",
             "APU");
+DEFINE_int32(xma_decoder_threads, 0,
+             "Number of threads decoding XMA contexts in parallel, or 0 to "
+             "choose based on the number of logical processors.",
+             "APU");
+DEFINE_bool(xma_decode_statistics, false,
+            "Log the host time spent decoding each XMA context when it's "
+            "released.",
+            "APU");
 
 namespace xe {
 namespace apu {
@@ -106,6 +118,8 @@ void av_log_callback(void* avcl, int level, const char* fmt, va_list va) {
 }
 
 X_STATUS XmaDecoder::Setup(kernel::KernelState* kernel_state) {
+  thread_affinity_policy_ = kernel_state->thread_affinity_policy();
+
   // Setup ffmpeg logging callback
   av_log_set_callback(av_log_callback);
 
@@ -137,72 +151,171 @@ X_STATUS XmaDecoder::Setup(kernel::KernelState* kernel_state) {
   register_file_[XmaRegister::NextContextIndex] = 1;
   context_bitmap_.Resize(kContextCount);
 
+  for (std::atomic<uint64_t>& kicked_contexts_word : kicked_contexts_) {
+    kicked_contexts_word.store(0, std::memory_order_relaxed);
+  }
+  idle_worker_mask_.store(0, std::memory_order_relaxed);
+
+  // Decoding a context may take a substantial fraction of a core when there
+  // are many voices, but a few workers are enough even for titles mixing
+  // dozens of them.
+  uint32_t worker_count;
+  if (cvars::xma_decoder_threads > 0) {
+    worker_count = uint32_t(cvars::xma_decoder_threads);
+  } else {
+    worker_count = std::min(
+        std::max(xe::threading::logical_processor_count() / 4, uint32_t(1)),
+        uint32_t(4));
+  }
+  worker_count = std::min(worker_count, kMaxWorkerCount);
+
   worker_running_ = true;
-  work_event_ = xe::threading::Event::CreateAutoResetEvent(false);
-  assert_not_null(work_event_);
-  worker_thread_ = kernel::object_ref<kernel::XHostThread>(
-      new kernel::XHostThread(kernel_state, 128 * 1024, 0, [this]() {
-        WorkerThreadMain();
-        return 0;
-      }));
-  worker_thread_->set_name("XMA Decoder");
-  worker_thread_->set_can_debugger_suspend(true);
-  worker_thread_->Create();
+  for (uint32_t i = 0; i < worker_count; ++i) {
+    auto work_event = xe::threading::Event::CreateAutoResetEvent(false);
+    assert_not_null(work_event);
+    work_events_.push_back(std::move(work_event));
+  }
+  for (uint32_t i = 0; i < worker_count; ++i) {
+    auto worker_thread = kernel::object_ref<kernel::XHostThread>(
+        new kernel::XHostThread(kernel_state, 128 * 1024, 0, [this, i]() {
+          WorkerThreadMain(i);
+          return 0;
+        }));
+    worker_thread->set_name(worker_count > 1
+                                ? fmt::format("XMA Decoder {}", i)
+                                : std::string("XMA Decoder"));
+    worker_thread->set_can_debugger_suspend(true);
+    worker_thread->set_affinity_role(kernel::ThreadAffinityRole::kAudioDecoder);
+    worker_thread->Create();
+    worker_threads_.push_back(std::move(worker_thread));
+  }
 
   return X_STATUS_SUCCESS;
 }
 
-void XmaDecoder::WorkerThreadMain() {
-  uint32_t idle_loop_count = 0;
+void XmaDecoder::WorkerThreadMain(uint32_t worker_index) {
+  uint32_t worker_bit = uint32_t(1) << worker_index;
+  xe::threading::Event& work_event = *work_events_[worker_index];
   while (worker_running_) {
-    // Okay, let's loop through XMA contexts to find ones we need to decode!
-    bool did_work = false;
-    for (uint32_t n = 0; n < kContextCount; n++) {
-      XmaContext& context = contexts_[n];
-      did_work = context.Work() || did_work;
-
-      // TODO: Need thread safety to do this.
-      // Probably not too important though.
-      // registers_.current_context = n;
-      // registers_.next_context = (n + 1) % kContextCount;
+    if (paused_.load(std::memory_order_acquire)) {
+      std::unique_lock<std::mutex> pause_lock(pause_mutex_);
+      if (paused_.load(std::memory_order_relaxed)) {
+        uint64_t resume_generation = resume_generation_;
+        ++paused_worker_count_;
+        pause_condition_.notify_all();
+        pause_condition_.wait(pause_lock, [this, resume_generation]() {
+          return resume_generation_ != resume_generation;
+        });
+        --paused_worker_count_;
+      }
+      continue;
     }
 
-    if (paused_) {
-      pause_fence_.Signal();
-      resume_fence_.Wait();
+    uint32_t context_id;
+    if (!ClaimKickedContext(context_id)) {
+      // Publish that this worker is idle before checking for kicks for the
+      // last time, so a kick happening concurrently will either be seen here
+      // or will wake this worker up. This is a store followed by a load of a
+      // different variable, mirrored by the kicker, so both sides must be
+      // sequentially consistent.
+      idle_worker_mask_.fetch_or(worker_bit, std::memory_order_seq_cst);
+      if (!ClaimKickedContext(context_id)) {
+        xe::threading::Wait(&work_event, false);
+        thread_affinity_policy_->SampleCurrentProcessor();
+        idle_worker_mask_.fetch_and(~worker_bit, std::memory_order_acq_rel);
+        continue;
+      }
+      idle_worker_mask_.fetch_and(~worker_bit, std::memory_order_acq_rel);
     }
 
-    if (!did_work) {
-      idle_loop_count++;
-    } else {
-      idle_loop_count = 0;
+    // Decodes once per kick - if the context is kicked again while it's being
+    // decoded, it will be claimed again, and the context lock will make the
+    // second decode happen after the first.
+    uint64_t work_start = Clock::QueryHostTickCount();
+    if (contexts_[context_id].Work()) {
+      total_decode_time_ticks_.fetch_add(
+          Clock::QueryHostTickCount() - work_start, std::memory_order_relaxed);
     }
+  }
+}
+
+uint64_t XmaDecoder::total_decode_time_us() const {
+  return total_decode_time_ticks_.load(std::memory_order_relaxed) * 1000000 /
+         Clock::QueryHostTickFrequency();
+}
 
-    if (idle_loop_count > 500) {
-      // Idle for an extended period. Introduce a 20ms wait.
-      xe::threading::Wait(work_event_.get(), false,
-                          std::chrono::milliseconds(20));
+bool XmaDecoder::ClaimKickedContext(uint32_t& context_id_out) {
+  for (uint32_t i = 0; i < kKickedContextWordCount; ++i) {
+    // Sequentially consistent for the idle worker handshake.
+    uint64_t kicked_contexts_word =
+        kicked_contexts_[i].load(std::memory_order_seq_cst);
+    uint32_t kicked_context_index;
+    while (xe::bit_scan_forward(kicked_contexts_word, &kicked_context_index)) {
+      uint64_t kicked_context_bit = uint64_t(1) << kicked_context_index;
+      // Another worker may have taken it in the meantime.
+      if (kicked_contexts_[i].fetch_and(~kicked_context_bit,
+                                        std::memory_order_acquire) &
+          kicked_context_bit) {
+        context_id_out = i * 64 + kicked_context_index;
+        return true;
+      }
+      kicked_contexts_word &= ~kicked_context_bit;
     }
+  }
+  return false;
+}
+
+void XmaDecoder::WakeIdleWorker() {
+  // Sequentially consistent for the idle worker handshake, see
+  // WorkerThreadMain.
+  uint32_t idle_worker_mask =
+      idle_worker_mask_.load(std::memory_order_seq_cst);
+  uint32_t worker_index;
+  while (xe::bit_scan_forward(idle_worker_mask, &worker_index)) {
+    uint32_t worker_bit = uint32_t(1) << worker_index;
+    // Only one kick should wake up a specific worker.
+    if (idle_worker_mask_.fetch_and(~worker_bit, std::memory_order_acq_rel) &
+        worker_bit) {
+      work_events_[worker_index]->Set();
+      return;
+    }
+    idle_worker_mask &= ~worker_bit;
+  }
+}
 
-    xe::threading::MaybeYield();
+void XmaDecoder::LogDecodeStatistics(XmaContext& context) {
+  XmaContext::DecodeStatistics statistics = context.TakeDecodeStatistics();
+  if (!cvars::xma_decode_statistics || !statistics.work_count) {
+    return;
   }
+  XELOGI(
+      "XMA context {}: decoded {} times, {} us total, {} us average, {} us "
+      "max",
+      context.id(), statistics.work_count, statistics.total_time_us,
+      statistics.total_time_us / statistics.work_count,
+      statistics.max_time_us);
 }
 
 void XmaDecoder::Shutdown() {
   worker_running_ = false;
 
-  if (work_event_) {
-    work_event_->Set();
+  for (auto& work_event : work_events_) {
+    work_event->Set();
   }
 
   if (paused_) {
     Resume();
   }
 
-  if (worker_thread_) {
-    // Wait for work thread.
-    xe::threading::Wait(worker_thread_->thread(), false);
-    worker_thread_.reset();
+  // Wait for the worker threads.
+  for (auto& worker_thread : worker_threads_) {
+    xe::threading::Wait(worker_thread->thread(), false);
+  }
+  worker_threads_.clear();
+  work_events_.clear();
+
+  for (XmaContext& context : contexts_) {
+    LogDecodeStatistics(context);
   }
 
   if (context_data_first_ptr_) {
@@ -242,6 +355,8 @@ void XmaDecoder::ReleaseContext(uint32_t guest_ptr) {
 
   XmaContext& context = contexts_[context_id];
   assert_true(context.is_allocated());
+  // Also resets the statistics for the next user of the context.
+  LogDecodeStatistics(context);
   context.Release();
   context_bitmap_.Release(context_id);
 }
@@ -313,10 +428,16 @@ void XmaDecoder::WriteRegister(uint32_t addr, uint32_t value) {
         uint32_t context_id = base_context_id + i;
         auto& context = contexts_[context_id];
         context.Enable();
+        // Signal a decoder worker to start processing, unless the context is
+        // already waiting for one.
+        uint64_t kicked_context_bit = uint64_t(1) << (context_id & 63);
+        if (!(kicked_contexts_[context_id >> 6].fetch_or(
+                  kicked_context_bit, std::memory_order_seq_cst) &
+              kicked_context_bit)) {
+          WakeIdleWorker();
+        }
       }
     }
-    // Signal the decoder thread to start processing.
-    work_event_->Set();
   } else if (r >= XmaRegister::Context0Lock && r <= XmaRegister::Context9Lock) {
     // Context lock command.
     // This requests a lock by flagging the context.
@@ -329,8 +450,8 @@ void XmaDecoder::WriteRegister(uint32_t addr, uint32_t value) {
         context.Disable();
       }
     }
-    // Signal the decoder thread to start processing.
-    // work_event_->Set();
+    // Signal the decoder workers to start processing.
+    // WakeIdleWorker();
   } else if (r >= XmaRegister::Context0Clear &&
              r <= XmaRegister::Context9Clear) {
     // Context clear command.
@@ -363,21 +484,35 @@ void XmaDecoder::WriteRegister(uint32_t addr, uint32_t value) {
 }
 
 void XmaDecoder::Pause() {
-  if (paused_) {
+  std::unique_lock<std::mutex> pause_lock(pause_mutex_);
+  if (paused_.load(std::memory_order_relaxed)) {
     return;
   }
-  paused_ = true;
+  paused_.store(true, std::memory_order_release);
 
-  pause_fence_.Wait();
+  // Wake up the idle workers so all of them acknowledge the pause. Workers
+  // still waking up from the previous pause are counted as paused until they
+  // leave the paused region, and they will see paused_ again before decoding.
+  for (auto& work_event : work_events_) {
+    work_event->Set();
+  }
+  // The events are created before the workers, so the count is final.
+  size_t worker_count = work_events_.size();
+  pause_condition_.wait(pause_lock, [this, worker_count]() {
+    return paused_worker_count_ == worker_count;
+  });
 }
 
 void XmaDecoder::Resume() {
-  if (!paused_) {
-    return;
+  {
+    std::unique_lock<std::mutex> pause_lock(pause_mutex_);
+    if (!paused_.load(std::memory_order_relaxed)) {
+      return;
+    }
+    paused_.store(false, std::memory_order_release);
+    ++resume_generation_;
   }
-  paused_ = false;
-
-  resume_fence_.Signal();
+  pause_condition_.notify_all();
 }
 
 }  // namespace apu
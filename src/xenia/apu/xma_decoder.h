@@ -11,8 +11,11 @@
 #define XENIA_APU_XMA_DECODER_H_
 
 #include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <queue>
+#include <vector>
 
 #include "xenia/apu/xma_context.h"
 #include "xenia/apu/xma_register_file.h"
@@ -47,7 +50,10 @@ class XmaDecoder {
   uint32_t ReadRegister(uint32_t addr);
   void WriteRegister(uint32_t addr, uint32_t value);
 
-  bool is_paused() const { return paused_; }
+  bool is_paused() const { return paused_.load(std::memory_order_relaxed); }
+
+  // Host time spent decoding all contexts since setup, for statistics.
+  uint64_t total_decode_time_us() const;
   void Pause();
   void Resume();
 
@@ -55,7 +61,13 @@ class XmaDecoder {
   int GetContextId(uint32_t guest_ptr);
 
  private:
-  void WorkerThreadMain();
+  void WorkerThreadMain(uint32_t worker_index);
+  // Atomically takes a context kicked since it was last decoded.
+  bool ClaimKickedContext(uint32_t& context_id_out);
+  // Wakes up an idle worker if there is one, otherwise the busy workers will
+  // take the kicked context once they're done with the current one.
+  void WakeIdleWorker();
+  void LogDecodeStatistics(XmaContext& context);
 
   static uint32_t MMIOReadRegisterThunk(void* ppc_context, XmaDecoder* as,
                                         uint32_t addr) {
@@ -71,19 +83,37 @@ class XmaDecoder {
   cpu::Processor* processor_ = nullptr;
 
   std::atomic<bool> worker_running_ = {false};
-  kernel::object_ref<kernel::XHostThread> worker_thread_;
-  std::unique_ptr<xe::threading::Event> work_event_ = nullptr;
-
-  bool paused_ = false;
-  xe::threading::Fence pause_fence_;   // Signaled when worker paused.
-  xe::threading::Fence resume_fence_;  // Signaled when resume requested.
+  kernel::ThreadAffinityPolicy* thread_affinity_policy_ = nullptr;
+  // Contexts are independent, so they're decoded by a pool of workers.
+  std::vector<kernel::object_ref<kernel::XHostThread>> worker_threads_;
+  // Auto-reset, one per worker, signaled to wake it up.
+  std::vector<std::unique_ptr<xe::threading::Event>> work_events_;
+  // Workers waiting for contexts to be kicked.
+  std::atomic<uint32_t> idle_worker_mask_ = {0};
+  std::atomic<uint64_t> total_decode_time_ticks_ = {0};
+
+  // Written under pause_mutex_, but also polled by the workers without it.
+  std::atomic<bool> paused_ = {false};
+  std::mutex pause_mutex_;
+  // Notified when a worker acknowledges a pause and on resume.
+  std::condition_variable pause_condition_;
+  // Incremented on every resume, so a worker waiting for a resume can't miss
+  // it even if the decoder is paused again before the worker wakes up.
+  uint64_t resume_generation_ = 0;
+  // Workers inside the paused region - none of them is decoding.
+  uint32_t paused_worker_count_ = 0;
 
   XmaRegisterFile register_file_;
 
   static const uint32_t kContextCount = 320;
+  static const uint32_t kMaxWorkerCount = 32;
   XmaContext contexts_[kContextCount];
   BitMap context_bitmap_;
 
+  // Bits of contexts kicked, but not taken by a worker yet.
+  static const uint32_t kKickedContextWordCount = (kContextCount + 63) / 64;
+  std::atomic<uint64_t> kicked_contexts_[kKickedContextWordCount] = {};
+
   uint32_t context_data_first_ptr_ = 0;
   uint32_t context_data_last_ptr_ = 0;
 };
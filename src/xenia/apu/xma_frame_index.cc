@@ -0,0 +1,127 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/apu/xma_frame_index.h"
+
+#include "xenia/apu/xma_helpers.h"
+#include "xenia/base/assert.h"
+
+namespace xe {
+namespace apu {
+
+namespace {
+// Reads up to 25 big-endian bits, all within the data.
+uint32_t ReadBits(const uint8_t* data, uint32_t bit_offset, uint32_t count) {
+  const uint8_t* bytes = data + (bit_offset >> 3);
+  uint32_t skip = bit_offset & 7;
+  uint32_t byte_count = (skip + count + 7) >> 3;
+  uint32_t value = 0;
+  for (uint32_t i = 0; i < byte_count; ++i) {
+    value = (value << 8) | bytes[i];
+  }
+  value >>= byte_count * 8 - (skip + count);
+  return value & ((uint32_t(1) << count) - 1);
+}
+}  // namespace
+
+void XmaFrameIndex::Reset() {
+  is_built_ = false;
+  buffer_ptr_ = 0;
+  packet_count_ = 0;
+  packets_.clear();
+  frames_.clear();
+}
+
+void XmaFrameIndex::Build(uint32_t buffer_ptr, const uint8_t* buffer,
+                          uint32_t packet_count) {
+  is_built_ = true;
+  buffer_ptr_ = buffer_ptr;
+  packet_count_ = packet_count;
+  packets_.resize(packet_count);
+  frames_.clear();
+  // Same walk as the per-packet frame counting in XmaContext, done once for
+  // the whole buffer.
+  for (uint32_t i = 0; i < packet_count; ++i) {
+    const uint8_t* packet_data = buffer + i * xma::kBytesPerPacket;
+    uint32_t packet_bit_offset = i * xma::kBitsPerPacket;
+    Packet& packet = packets_[i];
+    packet.first_frame = uint32_t(frames_.size());
+    packet.frame_count = 0;
+    packet.last_frame_split = false;
+    uint32_t offset = xma::GetPacketFrameOffset(packet_data);
+    if (offset > xma::kBitsPerPacket - (xma::kBitsPerPacketHeader + 1)) {
+      // The packet only continues a frame from the previous one.
+      continue;
+    }
+    while (true) {
+      ++packet.frame_count;
+      if (offset >= xma::kBitsPerPacket) {
+        // The previous frame ends exactly at the end of the packet, but claims
+        // more frames follow.
+        packet.last_frame_split = true;
+        break;
+      }
+      Frame frame;
+      frame.bit_offset = packet_bit_offset + offset;
+      frame.packet = uint16_t(i);
+      frame.index_in_packet = uint16_t(packet.frame_count - 1);
+      frame.next_bit_offset = 0;
+      uint32_t bits_remaining = xma::kBitsPerPacket - offset;
+      if (bits_remaining < 15) {
+        frame.bit_length = xma::kMaxFrameLength + 1;
+        frame.is_split = true;
+        frames_.push_back(frame);
+        packet.last_frame_split = true;
+        break;
+      }
+      uint32_t length = ReadBits(packet_data, offset, 15);
+      frame.bit_length = length;
+      if (length > bits_remaining || length == xma::kMaxFrameLength ||
+          length < 16) {
+        // Continues in the next packet, or invalid (and the last one in the
+        // packet).
+        frame.is_split = true;
+        frames_.push_back(frame);
+        packet.last_frame_split = true;
+        break;
+      }
+      frame.is_split = false;
+      // The trailing bit of the frame shows whether more frames follow.
+      bool more_frames = ReadBits(packet_data, offset + length - 1, 1) != 0;
+      offset += length;
+      if (more_frames && offset < xma::kBitsPerPacket) {
+        frame.next_bit_offset = packet_bit_offset + offset;
+      }
+      frames_.push_back(frame);
+      if (!more_frames) {
+        break;
+      }
+    }
+  }
+}
+
+const XmaFrameIndex::Frame* XmaFrameIndex::FindFrame(
+    uint32_t bit_offset) const {
+  assert_true(is_built_);
+  uint32_t packet = bit_offset / xma::kBitsPerPacket;
+  if (packet >= packet_count_) {
+    return nullptr;
+  }
+  // Only a few frames begin in a packet.
+  for (size_t i = packets_[packet].first_frame;
+       i < frames_.size() && frames_[i].packet == packet; ++i) {
+    if (frames_[i].bit_offset == bit_offset) {
+      return &frames_[i];
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace apu
+}  // namespace xe
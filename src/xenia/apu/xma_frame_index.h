@@ -0,0 +1,84 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_APU_XMA_FRAME_INDEX_H_
+#define XENIA_APU_XMA_FRAME_INDEX_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace xe {
+namespace apu {
+
+// Locations of the XMA frames in an input buffer, found by parsing the packet
+// headers and the frame length fields of the whole buffer once, rather than
+// walking the frames from the beginning of the packet for every frame decoded.
+// The input buffer contents are not expected to change while it's valid, so
+// the index is identified by the guest address and the size of the buffer, and
+// needs to be reset by the owner when the buffer is invalidated.
+class XmaFrameIndex {
+ public:
+  struct Frame {
+    // From the beginning of the buffer.
+    uint32_t bit_offset;
+    // From the length field (including it), or xma::kMaxFrameLength + 1 if the
+    // length field itself continues in the next packet.
+    uint32_t bit_length;
+    uint16_t packet;
+    uint16_t index_in_packet;
+    // Whether the frame continues in a later packet of the stream (or is
+    // invalid), so it can't be decoded from this packet alone.
+    bool is_split;
+    // Offset of the next frame in the same packet, or 0 if this is the last
+    // frame beginning in the packet.
+    uint32_t next_bit_offset;
+  };
+
+  void Reset();
+  bool IsBuiltFor(uint32_t buffer_ptr, uint32_t packet_count) const {
+    return is_built_ && buffer_ptr_ == buffer_ptr &&
+           packet_count_ == packet_count;
+  }
+  void Build(uint32_t buffer_ptr, const uint8_t* buffer,
+             uint32_t packet_count);
+
+  uint32_t packet_count() const { return packet_count_; }
+  const std::vector<Frame>& frames() const { return frames_; }
+
+  // Number of frames beginning in the packet, including the last one if it
+  // continues in the next packet.
+  uint32_t GetPacketFrameCount(uint32_t packet) const {
+    return packets_[packet].frame_count;
+  }
+  bool IsPacketLastFrameSplit(uint32_t packet) const {
+    return packets_[packet].last_frame_split;
+  }
+
+  // Returns the frame beginning exactly at the offset, or nullptr if there's
+  // no such frame.
+  const Frame* FindFrame(uint32_t bit_offset) const;
+
+ private:
+  struct Packet {
+    uint32_t first_frame;
+    uint16_t frame_count;
+    bool last_frame_split;
+  };
+
+  bool is_built_ = false;
+  uint32_t buffer_ptr_ = 0;
+  uint32_t packet_count_ = 0;
+  std::vector<Packet> packets_;
+  std::vector<Frame> frames_;
+};
+
+}  // namespace apu
+}  // namespace xe
+
+#endif  // XENIA_APU_XMA_FRAME_INDEX_H_
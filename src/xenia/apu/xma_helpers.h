@@ -19,14 +19,17 @@ namespace apu {
 namespace xma {
 
 static const uint32_t kMaxFrameLength = 0x7FFF;
+static const uint32_t kBytesPerPacket = 2048;
+static const uint32_t kBitsPerPacket = kBytesPerPacket * 8;
+static const uint32_t kBitsPerPacketHeader = 32;
 
 // Get number of frames that /begin/ in this packet.
-uint32_t GetPacketFrameCount(uint8_t* packet) {
+inline uint32_t GetPacketFrameCount(const uint8_t* packet) {
   return (uint8_t)(packet[0] >> 2);
 }
 
 // Get the first frame offset in bits
-uint32_t GetPacketFrameOffset(uint8_t* packet) {
+inline uint32_t GetPacketFrameOffset(const uint8_t* packet) {
   uint32_t val = (uint16_t)(((packet[0] & 0x3) << 13) | (packet[1] << 5) |
                             (packet[2] >> 3));
   // if (val > kBitsPerPacket - kBitsPerHeader) {
@@ -37,11 +40,13 @@ uint32_t GetPacketFrameOffset(uint8_t* packet) {
   // }
 }
 
-uint32_t GetPacketMetadata(uint8_t* packet) {
+inline uint32_t GetPacketMetadata(const uint8_t* packet) {
   return (uint8_t)(packet[2] & 0x7);
 }
 
-uint32_t GetPacketSkipCount(uint8_t* packet) { return (uint8_t)(packet[3]); }
+inline uint32_t GetPacketSkipCount(const uint8_t* packet) {
+  return (uint8_t)(packet[3]);
+}
 
 }  // namespace xma
 }  // namespace apu
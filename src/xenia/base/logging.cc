@@ -59,6 +59,10 @@ DEFINE_int32(
     log_level, 2,
     "Maximum level to be logged. (0=error, 1=warning, 2=info, 3=debug)",
     "Logging");
+DEFINE_bool(log_deferred_format, true,
+            "Format log lines on the logging writer thread rather than on the "
+            "thread logging them, when all of their arguments can be copied.",
+            "Logging");
 
 namespace dp = disruptorplus;
 using namespace xe::literals;
@@ -75,10 +79,17 @@ struct LogLine {
   uint16_t _pad_0;  // (2b) padding
   bool terminate;
   char prefix_char;
+  // If not null, the buffer contains the arguments to format on the writer
+  // thread rather than the text.
+  logging::internal::DeferredLogFormatFunction format_function;
+  const char* format;
 };
 
 thread_local char thread_log_buffer_[64_KiB];
 
+int32_t logging::internal::log_level_threshold = -1;
+bool logging::internal::deferred_format_enabled = false;
+
 FileLogSink::~FileLogSink() {
   if (file_) {
     fflush(file_);
@@ -264,12 +275,39 @@ class Logger {
 
   std::unique_ptr<xe::threading::Thread> write_thread_;
 
+  // Writer thread storage for formatting deferred lines.
+  std::vector<uint8_t> deferred_args_;
+  char deferred_text_[64_KiB];
+
   void Write(const char* buf, size_t size) {
     for (const auto& sink : sinks_) {
       sink->Write(buf, size);
     }
   }
 
+  void WritePrefix(const LogLine& line) {
+    if (!line.prefix_char) {
+      return;
+    }
+    char prefix[] = {
+        line.prefix_char,
+        '>',
+        ' ',
+        '?',  // Thread ID gets placed here (8 chars).
+        '?',
+        '?',
+        '?',
+        '?',
+        '?',
+        '?',
+        '?',
+        ' ',
+        0,
+    };
+    fmt::format_to_n(prefix + 3, sizeof(prefix) - 3, "{:08X}", line.thread_id);
+    Write(prefix, sizeof(prefix) - 1);
+  }
+
   void WriteThread() {
     RingBuffer rb(buffer_, kBufferSize);
 
@@ -309,28 +347,23 @@ class Logger {
           read_count += needed_count;
           i += needed_count;
 
-          if (line.prefix_char) {
-            char prefix[] = {
-                line.prefix_char,
-                '>',
-                ' ',
-                '?',  // Thread ID gets placed here (8 chars).
-                '?',
-                '?',
-                '?',
-                '?',
-                '?',
-                '?',
-                '?',
-                ' ',
-                0,
-            };
-            fmt::format_to_n(prefix + 3, sizeof(prefix) - 3, "{:08X}",
-                             line.thread_id);
-            Write(prefix, sizeof(prefix) - 1);
-          }
-
-          if (line.buffer_length) {
+          if (line.format_function) {
+            deferred_args_.resize(line.buffer_length);
+            rb.Read(deferred_args_.data(), line.buffer_length);
+            size_t text_length =
+                line.format_function(line.format, deferred_args_.data(),
+                                     deferred_text_, sizeof(deferred_text_));
+            // Like formatting on the calling thread, drop empty lines.
+            if (text_length) {
+              WritePrefix(line);
+              Write(deferred_text_, text_length);
+              if (deferred_text_[text_length - 1] != '\n') {
+                const char suffix[1] = {'\n'};
+                Write(suffix, 1);
+              }
+            }
+          } else if (line.buffer_length) {
+            WritePrefix(line);
             // Get access to the line data - which may be split in the ring
             // buffer - and write it out in parts.
             auto line_range = rb.BeginRead(line.buffer_length);
@@ -353,6 +386,7 @@ class Logger {
 
             rb.EndRead(std::move(line_range));
           } else {
+            WritePrefix(line);
             // Always ensure there is a newline.
             const char suffix[1] = {'\n'};
             Write(suffix, 1);
@@ -399,7 +433,10 @@ class Logger {
  public:
   void AppendLine(uint32_t thread_id, const char prefix_char,
                   const char* buffer_data, size_t buffer_length,
-                  bool terminate = false) {
+                  bool terminate = false,
+                  logging::internal::DeferredLogFormatFunction
+                      format_function = nullptr,
+                  const char* format = nullptr) {
     size_t count = BlockCount(sizeof(LogLine) + buffer_length);
 
     auto range = claim_strategy_.claim(count);
@@ -414,6 +451,8 @@ class Logger {
     line.thread_id = thread_id;
     line.prefix_char = prefix_char;
     line.terminate = terminate;
+    line.format_function = format_function;
+    line.format = format;
 
     rb.Write(&line, sizeof(LogLine));
     if (buffer_length) {
@@ -457,9 +496,21 @@ void InitializeLogging(const std::string_view app_name) {
     logger_->AddLogSink(std::make_unique<DebugPrintLogSink>());
   }
 #endif  // XE_PLATFORM_ANDROID
+
+  UpdateLoggingConfig();
+}
+
+void UpdateLoggingConfig() {
+  if (!logger_) {
+    // Stays disabled until InitializeLogging.
+    return;
+  }
+  logging::internal::deferred_format_enabled = cvars::log_deferred_format;
+  logging::internal::log_level_threshold = cvars::log_level;
 }
 
 void ShutdownLogging() {
+  logging::internal::log_level_threshold = -1;
   Logger* logger = logger_;
   logger_ = nullptr;
 
@@ -467,11 +518,6 @@ void ShutdownLogging() {
   memory::AlignedFree(logger);
 }
 
-bool logging::internal::ShouldLog(LogLevel log_level) {
-  return logger_ != nullptr &&
-         static_cast<int32_t>(log_level) <= cvars::log_level;
-}
-
 std::pair<char*, size_t> logging::internal::GetThreadBuffer() {
   return {thread_log_buffer_, sizeof(thread_log_buffer_)};
 }
@@ -485,6 +531,17 @@ void logging::internal::AppendLogLine(LogLevel log_level,
                       thread_log_buffer_, written);
 }
 
+void logging::internal::AppendDeferredLogLine(
+    LogLevel log_level, const char prefix_char, const char* format,
+    DeferredLogFormatFunction format_function, size_t args_size) {
+  if (!ShouldLog(log_level)) {
+    return;
+  }
+  logger_->AppendLine(xe::threading::current_thread_id(), prefix_char,
+                      thread_log_buffer_, args_size, false, format_function,
+                      format);
+}
+
 void logging::AppendLogLine(LogLevel log_level, const char prefix_char,
                             const std::string_view str) {
   if (!internal::ShouldLog(log_level) || !str.size()) {
@@ -10,9 +10,14 @@
 #ifndef XENIA_BASE_LOGGING_H_
 #define XENIA_BASE_LOGGING_H_
 
+#include <algorithm>
 #include <cstdarg>
 #include <cstdint>
+#include <cstring>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
 
 #include "third_party/fmt/include/fmt/format.h"
 #include "xenia/base/string.h"
@@ -68,18 +73,153 @@ class DebugPrintLogSink final : public LogSink {
 // Must be called on startup.
 void InitializeLogging(const std::string_view app_name);
 void ShutdownLogging();
+// Re-reads the logging cvars cached for the logging call sites, must be called
+// after they may have been changed, such as by loading a config file.
+void UpdateLoggingConfig();
 
 namespace logging {
 namespace internal {
 
-bool ShouldLog(LogLevel log_level);
+// Maximum level of the lines that are written, or -1 if logging is not
+// initialized, so the level check is a single comparison.
+extern int32_t log_level_threshold;
+// Whether lines are formatted on the writer thread when all of their arguments
+// can be captured by value (log_deferred_format).
+extern bool deferred_format_enabled;
+
+inline bool ShouldLog(LogLevel log_level) {
+  return static_cast<int32_t>(log_level) <= log_level_threshold;
+}
+
 std::pair<char*, size_t> GetThreadBuffer();
 
 void AppendLogLine(LogLevel log_level, const char prefix_char, size_t written);
 
+// Describes how an argument of type T is captured in the log ring buffer to be
+// formatted later on the writer thread. Types without a specialization (custom
+// formatters, for instance) make the line be formatted on the calling thread.
+template <typename T, typename Enable = void>
+struct DeferredLogArg {
+  static constexpr bool kDeferrable = false;
+};
+
+// Numbers, enums and non-string pointers are copied bytewise and formatted as
+// the same type.
+template <typename T>
+struct DeferredLogArg<
+    T, std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T> ||
+                        (std::is_pointer_v<T> &&
+                         !std::is_same_v<std::remove_cv_t<
+                                             std::remove_pointer_t<T>>,
+                                         char>)>> {
+  static constexpr bool kDeferrable = true;
+  using Decoded = T;
+  static size_t EncodedSize(const T&) { return sizeof(T); }
+  static uint8_t* Encode(uint8_t* out, const T& value) {
+    std::memcpy(out, &value, sizeof(T));
+    return out + sizeof(T);
+  }
+  static T Decode(const uint8_t*& in) {
+    T value;
+    std::memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+    return value;
+  }
+};
+
+// Strings are copied as a 32-bit length followed by the characters since the
+// caller may free or modify them before the writer thread gets to them.
+struct DeferredLogStringArg {
+  static constexpr bool kDeferrable = true;
+  using Decoded = std::string_view;
+  static std::string_view ToStringView(const char* value) {
+    return value ? std::string_view(value) : std::string_view();
+  }
+  static std::string_view ToStringView(std::string_view value) {
+    return value;
+  }
+  template <typename T>
+  static size_t EncodedSize(const T& value) {
+    return sizeof(uint32_t) + ToStringView(value).size();
+  }
+  template <typename T>
+  static uint8_t* Encode(uint8_t* out, const T& value) {
+    std::string_view view = ToStringView(value);
+    auto length = uint32_t(view.size());
+    std::memcpy(out, &length, sizeof(length));
+    out += sizeof(length);
+    std::memcpy(out, view.data(), length);
+    return out + length;
+  }
+  static std::string_view Decode(const uint8_t*& in) {
+    uint32_t length;
+    std::memcpy(&length, in, sizeof(length));
+    in += sizeof(length);
+    std::string_view value(reinterpret_cast<const char*>(in), length);
+    in += length;
+    return value;
+  }
+};
+template <>
+struct DeferredLogArg<char*> : DeferredLogStringArg {};
+template <>
+struct DeferredLogArg<const char*> : DeferredLogStringArg {};
+template <>
+struct DeferredLogArg<std::string> : DeferredLogStringArg {};
+template <>
+struct DeferredLogArg<std::string_view> : DeferredLogStringArg {};
+
+template <typename... Args>
+constexpr bool kLogArgsDeferrable =
+    (DeferredLogArg<std::decay_t<Args>>::kDeferrable && ...);
+
+// Captures the arguments into the buffer, returning the number of bytes used,
+// or SIZE_MAX if they don't fit.
+template <typename... Args>
+size_t EncodeDeferredLogArgs(uint8_t* out, size_t out_size,
+                             const Args&... args) {
+  size_t size = (size_t(0) + ... +
+                 DeferredLogArg<std::decay_t<Args>>::EncodedSize(args));
+  if (size > out_size) {
+    return SIZE_MAX;
+  }
+  ((out = DeferredLogArg<std::decay_t<Args>>::Encode(out, args)), ...);
+  return size;
+}
+
+using DeferredLogFormatFunction = size_t (*)(const char* format,
+                                             const uint8_t* args, char* out,
+                                             size_t out_size);
+
+// Formats the arguments captured by EncodeDeferredLogArgs<Args...>, returning
+// the number of characters written to out.
+template <typename... Args>
+size_t FormatDeferredLogLine(const char* format, const uint8_t* args,
+                             char* out, size_t out_size) {
+  // Braced initialization decodes the arguments in order.
+  std::tuple<typename DeferredLogArg<Args>::Decoded...> values{
+      DeferredLogArg<Args>::Decode(args)...};
+  (void)args;
+  size_t size = std::apply(
+      [&](const auto&... decoded) {
+        return fmt::format_to_n(out, out_size, format, decoded...).size;
+      },
+      values);
+  return std::min(size, out_size);
+}
+
+// The format string is referenced by the ring buffer entry, so it must have
+// static storage duration, like the string literals used for logging.
+void AppendDeferredLogLine(LogLevel log_level, const char prefix_char,
+                           const char* format,
+                           DeferredLogFormatFunction format_function,
+                           size_t args_size);
+
 }  // namespace internal
 
-// Appends a line to the log with {fmt}-style formatting.
+// Appends a line to the log with {fmt}-style formatting. If possible, only the
+// arguments are captured on the calling thread, and the line is formatted on
+// the writer thread.
 template <typename... Args>
 void AppendLogLineFormat(LogLevel log_level, const char prefix_char,
                          const char* format, const Args&... args) {
@@ -87,8 +227,22 @@ void AppendLogLineFormat(LogLevel log_level, const char prefix_char,
     return;
   }
   auto target = internal::GetThreadBuffer();
+  if constexpr (internal::kLogArgsDeferrable<Args...>) {
+    if (internal::deferred_format_enabled) {
+      size_t args_size = internal::EncodeDeferredLogArgs(
+          reinterpret_cast<uint8_t*>(target.first), target.second, args...);
+      if (args_size != SIZE_MAX) {
+        internal::AppendDeferredLogLine(
+            log_level, prefix_char, format,
+            internal::FormatDeferredLogLine<std::decay_t<Args>...>,
+            args_size);
+        return;
+      }
+    }
+  }
   auto result = fmt::format_to_n(target.first, target.second, format, args...);
-  internal::AppendLogLine(log_level, prefix_char, result.size);
+  internal::AppendLogLine(log_level, prefix_char,
+                          std::min(result.size, target.second));
 }
 
 // Appends a line to the log.
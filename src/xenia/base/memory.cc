@@ -11,7 +11,9 @@
 #include "xenia/base/cvar.h"
 #include "xenia/base/platform.h"
 
-#if XE_ARCH_ARM64
+#if XE_ARCH_AMD64
+#include "third_party/xbyak/xbyak/xbyak_util.h"
+#elif XE_ARCH_ARM64
 #include <arm_neon.h>
 #endif
 
@@ -33,7 +35,6 @@ bool IsWritableExecutableMemoryPreferred() {
 
 }  // namespace memory
 
-// TODO(benvanik): fancy AVX versions.
 // https://github.com/gnuradio/volk/blob/master/kernels/volk/volk_16u_byteswap.h
 // https://github.com/gnuradio/volk/blob/master/kernels/volk/volk_32u_byteswap.h
 // https://github.com/gnuradio/volk/blob/master/kernels/volk/volk_64u_byteswap.h
@@ -57,6 +58,153 @@ void copy_128_aligned(void* dest, const void* src, size_t count) {
 #else
 #define XE_WORKAROUND_CONSTANT_RETURN_IF(x)
 #endif
+
+// The AVX2 and AVX-512 versions are chosen at runtime, so the compiler needs
+// to be allowed to use the instructions in them while the rest of the code is
+// built for AVX.
+#if XE_COMPILER_CLANG || XE_COMPILER_GNUC
+#define XE_TARGET_AVX2 __attribute__((target("avx2")))
+#define XE_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#else
+#define XE_TARGET_AVX2
+#define XE_TARGET_AVX512
+#endif
+
+namespace {
+
+// _mm_shuffle_epi8 byte order within each 128-bit lane.
+alignas(16) const uint8_t kSwap16LaneShuffle[16] = {
+    1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14};
+alignas(16) const uint8_t kSwap32LaneShuffle[16] = {
+    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12};
+alignas(16) const uint8_t kSwap64LaneShuffle[16] = {
+    7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8};
+alignas(16) const uint8_t kSwap16In32LaneShuffle[16] = {
+    2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13};
+
+// Copies larger than this are unlikely to be read back from the cache soon
+// (they're mostly texture and buffer uploads), so they're written with
+// non-temporal stores to avoid evicting the working set.
+constexpr size_t kCopyAndSwapNonTemporalThreshold = size_t(2) << 20;
+
+// The wide versions process whole vectors and return the number of bytes
+// processed, leaving the rest to the 128-bit loops. With non-temporal stores,
+// the head before the first aligned destination vector is written with an
+// unaligned store after the first aligned source vector is loaded, so copying
+// in place is still possible.
+XE_TARGET_AVX2 size_t copy_and_swap_avx2(uint8_t* dest, const uint8_t* src,
+                                         size_t size, size_t element_size,
+                                         const uint8_t* lane_shuffle) {
+  const __m256i shuffle = _mm256_broadcastsi128_si256(
+      _mm_load_si128(reinterpret_cast<const __m128i*>(lane_shuffle)));
+  size_t head = (32 - (reinterpret_cast<uintptr_t>(dest) & 31)) & 31;
+  if (size >= kCopyAndSwapNonTemporalThreshold && head % element_size == 0) {
+    __m256i head_output = _mm256_shuffle_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)), shuffle);
+    __m256i input =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + head));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), head_output);
+    size_t i = head;
+    while (true) {
+      _mm256_stream_si256(reinterpret_cast<__m256i*>(dest + i),
+                          _mm256_shuffle_epi8(input, shuffle));
+      i += 32;
+      if (i + 32 > size) {
+        break;
+      }
+      input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    }
+    _mm_sfence();
+    return i;
+  }
+  size_t i;
+  for (i = 0; i + 64 <= size; i += 64) {
+    __m256i input0 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    __m256i input1 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 32));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i),
+                        _mm256_shuffle_epi8(input0, shuffle));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i + 32),
+                        _mm256_shuffle_epi8(input1, shuffle));
+  }
+  return i;
+}
+
+XE_TARGET_AVX512 size_t copy_and_swap_avx512(uint8_t* dest,
+                                             const uint8_t* src, size_t size,
+                                             size_t element_size,
+                                             const uint8_t* lane_shuffle) {
+  const __m512i shuffle = _mm512_broadcast_i32x4(
+      _mm_load_si128(reinterpret_cast<const __m128i*>(lane_shuffle)));
+  size_t head = (64 - (reinterpret_cast<uintptr_t>(dest) & 63)) & 63;
+  if (size >= kCopyAndSwapNonTemporalThreshold && head % element_size == 0) {
+    __m512i head_output =
+        _mm512_shuffle_epi8(_mm512_loadu_si512(src), shuffle);
+    __m512i input = _mm512_loadu_si512(src + head);
+    _mm512_storeu_si512(dest, head_output);
+    size_t i = head;
+    while (true) {
+      _mm512_stream_si512(reinterpret_cast<__m512i*>(dest + i),
+                          _mm512_shuffle_epi8(input, shuffle));
+      i += 64;
+      if (i + 64 > size) {
+        break;
+      }
+      input = _mm512_loadu_si512(src + i);
+    }
+    _mm_sfence();
+    return i;
+  }
+  size_t i;
+  for (i = 0; i + 128 <= size; i += 128) {
+    __m512i input0 = _mm512_loadu_si512(src + i);
+    __m512i input1 = _mm512_loadu_si512(src + i + 64);
+    _mm512_storeu_si512(dest + i, _mm512_shuffle_epi8(input0, shuffle));
+    _mm512_storeu_si512(dest + i + 64, _mm512_shuffle_epi8(input1, shuffle));
+  }
+  return i;
+}
+
+using CopyAndSwapWideFunction = size_t (*)(uint8_t* dest, const uint8_t* src,
+                                           size_t size, size_t element_size,
+                                           const uint8_t* lane_shuffle);
+// Constant-initialized, so copying during static initialization, before the
+// CPU features are checked, uses the 128-bit loops.
+CopyAndSwapWideFunction copy_and_swap_wide_function = nullptr;
+size_t copy_and_swap_wide_min_size = SIZE_MAX;
+
+// Chooses the widest version once at startup, with the same CPU feature
+// detection as the x64 JIT.
+struct CopyAndSwapWideInitializer {
+  CopyAndSwapWideInitializer() {
+    Xbyak::util::Cpu cpu;
+    if (cpu.has(Xbyak::util::Cpu::tAVX512F) &&
+        cpu.has(Xbyak::util::Cpu::tAVX512BW)) {
+      copy_and_swap_wide_function = copy_and_swap_avx512;
+      copy_and_swap_wide_min_size = 128;
+    } else if (cpu.has(Xbyak::util::Cpu::tAVX2)) {
+      copy_and_swap_wide_function = copy_and_swap_avx2;
+      copy_and_swap_wide_min_size = 64;
+    }
+  }
+} copy_and_swap_wide_initializer;
+
+// Returns the number of elements processed.
+template <typename T>
+size_t copy_and_swap_wide(T* dest, const T* src, size_t count,
+                          const uint8_t* lane_shuffle) {
+  size_t size = count * sizeof(T);
+  if (size < copy_and_swap_wide_min_size) {
+    return 0;
+  }
+  return copy_and_swap_wide_function(reinterpret_cast<uint8_t*>(dest),
+                                     reinterpret_cast<const uint8_t*>(src),
+                                     size, sizeof(T), lane_shuffle) /
+         sizeof(T);
+}
+
+}  // namespace
 void copy_and_swap_16_aligned(void* dest_ptr, const void* src_ptr,
                               size_t count) {
   assert_zero(reinterpret_cast<uintptr_t>(dest_ptr) & 0xF);
@@ -68,8 +216,8 @@ void copy_and_swap_16_aligned(void* dest_ptr, const void* src_ptr,
       _mm_set_epi8(0x0E, 0x0F, 0x0C, 0x0D, 0x0A, 0x0B, 0x08, 0x09, 0x06, 0x07,
                    0x04, 0x05, 0x02, 0x03, 0x00, 0x01);
 
-  size_t i = 0;
-  for (i = 0; i + 8 <= count; i += 8) {
+  size_t i = copy_and_swap_wide(dest, src, count, kSwap16LaneShuffle);
+  for (; i + 8 <= count; i += 8) {
     __m128i input = _mm_load_si128(reinterpret_cast<const __m128i*>(&src[i]));
     __m128i output = _mm_shuffle_epi8(input, shufmask);
     _mm_store_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
@@ -88,8 +236,8 @@ void copy_and_swap_16_unaligned(void* dest_ptr, const void* src_ptr,
       _mm_set_epi8(0x0E, 0x0F, 0x0C, 0x0D, 0x0A, 0x0B, 0x08, 0x09, 0x06, 0x07,
                    0x04, 0x05, 0x02, 0x03, 0x00, 0x01);
 
-  size_t i;
-  for (i = 0; i + 8 <= count; i += 8) {
+  size_t i = copy_and_swap_wide(dest, src, count, kSwap16LaneShuffle);
+  for (; i + 8 <= count; i += 8) {
     __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
     __m128i output = _mm_shuffle_epi8(input, shufmask);
     _mm_storeu_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
@@ -111,8 +259,8 @@ void copy_and_swap_32_aligned(void* dest_ptr, const void* src_ptr,
       _mm_set_epi8(0x0C, 0x0D, 0x0E, 0x0F, 0x08, 0x09, 0x0A, 0x0B, 0x04, 0x05,
                    0x06, 0x07, 0x00, 0x01, 0x02, 0x03);
 
-  size_t i;
-  for (i = 0; i + 4 <= count; i += 4) {
+  size_t i = copy_and_swap_wide(dest, src, count, kSwap32LaneShuffle);
+  for (; i + 4 <= count; i += 4) {
     __m128i input = _mm_load_si128(reinterpret_cast<const __m128i*>(&src[i]));
     __m128i output = _mm_shuffle_epi8(input, shufmask);
     _mm_store_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
@@ -131,8 +279,8 @@ void copy_and_swap_32_unaligned(void* dest_ptr, const void* src_ptr,
       _mm_set_epi8(0x0C, 0x0D, 0x0E, 0x0F, 0x08, 0x09, 0x0A, 0x0B, 0x04, 0x05,
                    0x06, 0x07, 0x00, 0x01, 0x02, 0x03);
 
-  size_t i;
-  for (i = 0; i + 4 <= count; i += 4) {
+  size_t i = copy_and_swap_wide(dest, src, count, kSwap32LaneShuffle);
+  for (; i + 4 <= count; i += 4) {
     __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
     __m128i output = _mm_shuffle_epi8(input, shufmask);
     _mm_storeu_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
@@ -154,8 +302,8 @@ void copy_and_swap_64_aligned(void* dest_ptr, const void* src_ptr,
       _mm_set_epi8(0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x00, 0x01,
                    0x02, 0x03, 0x04, 0x05, 0x06, 0x07);
 
-  size_t i;
-  for (i = 0; i + 2 <= count; i += 2) {
+  size_t i = copy_and_swap_wide(dest, src, count, kSwap64LaneShuffle);
+  for (; i + 2 <= count; i += 2) {
     __m128i input = _mm_load_si128(reinterpret_cast<const __m128i*>(&src[i]));
     __m128i output = _mm_shuffle_epi8(input, shufmask);
     _mm_store_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
@@ -174,8 +322,8 @@ void copy_and_swap_64_unaligned(void* dest_ptr, const void* src_ptr,
       _mm_set_epi8(0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x00, 0x01,
                    0x02, 0x03, 0x04, 0x05, 0x06, 0x07);
 
-  size_t i;
-  for (i = 0; i + 2 <= count; i += 2) {
+  size_t i = copy_and_swap_wide(dest, src, count, kSwap64LaneShuffle);
+  for (; i + 2 <= count; i += 2) {
     __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
     __m128i output = _mm_shuffle_epi8(input, shufmask);
     _mm_storeu_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
@@ -190,8 +338,8 @@ void copy_and_swap_16_in_32_aligned(void* dest_ptr, const void* src_ptr,
                                     size_t count) {
   auto dest = reinterpret_cast<uint32_t*>(dest_ptr);
   auto src = reinterpret_cast<const uint32_t*>(src_ptr);
-  size_t i;
-  for (i = 0; i + 4 <= count; i += 4) {
+  size_t i = copy_and_swap_wide(dest, src, count, kSwap16In32LaneShuffle);
+  for (; i + 4 <= count; i += 4) {
     __m128i input = _mm_load_si128(reinterpret_cast<const __m128i*>(&src[i]));
     __m128i output =
         _mm_or_si128(_mm_slli_epi32(input, 16), _mm_srli_epi32(input, 16));
@@ -207,8 +355,8 @@ void copy_and_swap_16_in_32_unaligned(void* dest_ptr, const void* src_ptr,
                                       size_t count) {
   auto dest = reinterpret_cast<uint32_t*>(dest_ptr);
   auto src = reinterpret_cast<const uint32_t*>(src_ptr);
-  size_t i;
-  for (i = 0; i + 4 <= count; i += 4) {
+  size_t i = copy_and_swap_wide(dest, src, count, kSwap16In32LaneShuffle);
+  for (; i + 4 <= count; i += 4) {
     __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
     __m128i output =
         _mm_or_si128(_mm_slli_epi32(input, 16), _mm_srli_epi32(input, 16));
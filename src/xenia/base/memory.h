@@ -16,6 +16,8 @@
 #include <functional>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #include "xenia/base/assert.h"
 #include "xenia/base/byte_order.h"
@@ -89,6 +91,24 @@ bool Protect(void* base_address, size_t length, PageAccess access,
 // the region.
 bool QueryProtect(void* base_address, size_t& length, PageAccess& access_out);
 
+// Whether the host can track writes to pages without raising access violations
+// in the writing thread - asynchronous userfaultfd write protection with the
+// PAGEMAP_SCAN ioctl on Linux 6.7+. Pages written to are collected in batches
+// with GetWrittenRanges instead.
+bool IsWriteWatchSupported();
+
+// Starts watching the given page-aligned block of memory for writes, marking
+// all pages in it as not written. Returns false if writes can't be watched in
+// the block (or at all), in which case protection must be used instead.
+bool WatchWrites(void* base_address, size_t length);
+
+// Appends <offset from base_address, length> pairs of the runs of pages in the
+// given page-aligned block that have been written to since WatchWrites was
+// last called for them or since the previous GetWrittenRanges. The reported
+// pages are atomically marked as not written again by the scan.
+bool GetWrittenRanges(void* base_address, size_t length,
+                      std::vector<std::pair<size_t, size_t>>& ranges_out);
+
 // Allocates a block of memory for a type with the given alignment.
 // The memory must be freed with AlignedFree.
 template <typename T>
@@ -27,6 +27,54 @@
 #include "xenia/base/main_android.h"
 #endif
 
+#if XE_PLATFORM_GNU_LINUX
+#include <linux/fs.h>
+#include <linux/userfaultfd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <mutex>
+
+// Definitions from the Linux 6.7 headers for building with older ones - the
+// availability is checked at runtime.
+#ifndef UFFD_USER_MODE_ONLY
+#define UFFD_USER_MODE_ONLY 1
+#endif
+#ifndef UFFD_FEATURE_WP_HUGETLBFS_SHMEM
+#define UFFD_FEATURE_WP_HUGETLBFS_SHMEM (1 << 12)
+#endif
+#ifndef UFFD_FEATURE_WP_UNPOPULATED
+#define UFFD_FEATURE_WP_UNPOPULATED (1 << 13)
+#endif
+#ifndef UFFD_FEATURE_WP_ASYNC
+#define UFFD_FEATURE_WP_ASYNC (1 << 15)
+#endif
+#ifndef PAGEMAP_SCAN
+#define PM_SCAN_WP_MATCHING (1 << 0)
+#define PM_SCAN_CHECK_WPASYNC (1 << 1)
+#define PAGE_IS_WRITTEN (1 << 1)
+struct page_region {
+  __u64 start;
+  __u64 end;
+  __u64 categories;
+};
+struct pm_scan_arg {
+  __u64 size;
+  __u64 flags;
+  __u64 start;
+  __u64 end;
+  __u64 walk_end;
+  __u64 vec;
+  __u64 vec_len;
+  __u64 max_pages;
+  __u64 category_inverted;
+  __u64 category_mask;
+  __u64 category_anyof_mask;
+  __u64 return_mask;
+};
+#define PAGEMAP_SCAN _IOWR('f', 16, struct pm_scan_arg)
+#endif  // PAGEMAP_SCAN
+#endif  // XE_PLATFORM_GNU_LINUX
+
 namespace xe {
 namespace memory {
 
@@ -112,6 +160,121 @@ bool QueryProtect(void* base_address, size_t& length, PageAccess& access_out) {
   return false;
 }
 
+#if XE_PLATFORM_GNU_LINUX
+static std::once_flag write_watch_initialize_once_;
+// With UFFD_FEATURE_WP_ASYNC, write faults on write-protected pages are
+// resolved by the kernel itself, just clearing the write protection, so the
+// userfaultfd is never read from - it only holds the registrations.
+static int write_watch_userfaultfd_ = -1;
+static int write_watch_pagemap_ = -1;
+
+static void InitializeWriteWatch() {
+  // UFFD_USER_MODE_ONLY (Linux 5.11+) allows using userfaultfd without
+  // privileges when vm.unprivileged_userfaultfd is 0.
+  int userfaultfd = int(
+      syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY));
+  if (userfaultfd < 0) {
+    return;
+  }
+  const uint64_t required_features = UFFD_FEATURE_WP_ASYNC |
+                                     UFFD_FEATURE_WP_UNPOPULATED |
+                                     UFFD_FEATURE_WP_HUGETLBFS_SHMEM;
+  uffdio_api api = {};
+  api.api = UFFD_API;
+  api.features = required_features;
+  if (ioctl(userfaultfd, UFFDIO_API, &api) < 0 ||
+      (api.features & required_features) != required_features) {
+    close(userfaultfd);
+    return;
+  }
+  int pagemap = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+  if (pagemap < 0) {
+    close(userfaultfd);
+    return;
+  }
+  write_watch_userfaultfd_ = userfaultfd;
+  write_watch_pagemap_ = pagemap;
+}
+
+bool IsWriteWatchSupported() {
+  std::call_once(write_watch_initialize_once_, InitializeWriteWatch);
+  return write_watch_userfaultfd_ >= 0;
+}
+
+bool WatchWrites(void* base_address, size_t length) {
+  if (!IsWriteWatchSupported()) {
+    return false;
+  }
+  // Mappings may be replaced (by AllocFixed, for instance), dropping the
+  // registration, so registering every time - registering an already
+  // registered range with the same userfaultfd does nothing.
+  uffdio_register register_arg = {};
+  register_arg.range.start = uint64_t(base_address);
+  register_arg.range.len = uint64_t(length);
+  register_arg.mode = UFFDIO_REGISTER_MODE_WP;
+  if (ioctl(write_watch_userfaultfd_, UFFDIO_REGISTER, &register_arg) < 0) {
+    return false;
+  }
+  uffdio_writeprotect writeprotect_arg = {};
+  writeprotect_arg.range = register_arg.range;
+  writeprotect_arg.mode = UFFDIO_WRITEPROTECT_MODE_WP;
+  return ioctl(write_watch_userfaultfd_, UFFDIO_WRITEPROTECT,
+               &writeprotect_arg) == 0;
+}
+
+bool GetWrittenRanges(void* base_address, size_t length,
+                      std::vector<std::pair<size_t, size_t>>& ranges_out) {
+  if (!IsWriteWatchSupported()) {
+    return false;
+  }
+  uint64_t base = uint64_t(base_address);
+  page_region regions[64];
+  pm_scan_arg scan_arg = {};
+  scan_arg.size = sizeof(scan_arg);
+  // Write-protect the reported pages in the same walk, so writes made between
+  // the scan and re-watching can't be lost.
+  scan_arg.flags = PM_SCAN_WP_MATCHING | PM_SCAN_CHECK_WPASYNC;
+  scan_arg.start = base;
+  scan_arg.end = base + length;
+  scan_arg.vec = uint64_t(regions);
+  scan_arg.vec_len = xe::countof(regions);
+  scan_arg.category_mask = PAGE_IS_WRITTEN;
+  scan_arg.return_mask = PAGE_IS_WRITTEN;
+  while (scan_arg.start < scan_arg.end) {
+    int region_count = ioctl(write_watch_pagemap_, PAGEMAP_SCAN, &scan_arg);
+    if (region_count < 0) {
+      return false;
+    }
+    for (int i = 0; i < region_count; ++i) {
+      const page_region& region = regions[i];
+      size_t region_offset = size_t(region.start - base);
+      size_t region_length = size_t(region.end - region.start);
+      // Runs may be split at the end of the output buffer.
+      if (!ranges_out.empty() &&
+          ranges_out.back().first + ranges_out.back().second == region_offset) {
+        ranges_out.back().second += region_length;
+      } else {
+        ranges_out.emplace_back(region_offset, region_length);
+      }
+    }
+    if (scan_arg.walk_end <= scan_arg.start) {
+      return false;
+    }
+    scan_arg.start = scan_arg.walk_end;
+  }
+  return true;
+}
+#else
+bool IsWriteWatchSupported() { return false; }
+
+bool WatchWrites(void* base_address, size_t length) { return false; }
+
+bool GetWrittenRanges(void* base_address, size_t length,
+                      std::vector<std::pair<size_t, size_t>>& ranges_out) {
+  return false;
+}
+#endif  // XE_PLATFORM_GNU_LINUX
+
 FileMappingHandle CreateFileMappingHandle(const std::filesystem::path& path,
                                           size_t length, PageAccess access,
                                           bool commit) {
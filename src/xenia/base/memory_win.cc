@@ -172,6 +172,19 @@ bool QueryProtect(void* base_address, size_t& length, PageAccess& access_out) {
   return true;
 }
 
+bool IsWriteWatchSupported() {
+  // MEM_WRITE_WATCH is only available for VirtualAlloc, not for file mapping
+  // views.
+  return false;
+}
+
+bool WatchWrites(void* base_address, size_t length) { return false; }
+
+bool GetWrittenRanges(void* base_address, size_t length,
+                      std::vector<std::pair<size_t, size_t>>& ranges_out) {
+  return false;
+}
+
 FileMappingHandle CreateFileMappingHandle(const std::filesystem::path& path,
                                           size_t length, PageAccess access,
                                           bool commit) {
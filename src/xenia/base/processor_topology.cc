@@ -0,0 +1,136 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/processor_topology.h"
+
+#include <algorithm>
+#include <tuple>
+#include <unordered_map>
+
+#include "xenia/base/logging.h"
+#include "xenia/base/threading.h"
+
+namespace xe {
+namespace threading {
+
+const ProcessorTopology& ProcessorTopology::Get() {
+  static const ProcessorTopology topology = []() {
+    ProcessorTopology result;
+    if (!Discover(result) || result.logical_processors.empty()) {
+      // Assume every logical processor is a separate core sharing one cache.
+      XELOGW("Failed to obtain the host processor topology");
+      result.logical_processors.clear();
+      uint32_t count = std::min(logical_processor_count(), uint32_t(64));
+      for (uint32_t i = 0; i < count; ++i) {
+        result.logical_processors.push_back({i, i, 0, 0});
+      }
+    }
+    result.Normalize();
+    XELOGI(
+        "Host processor topology: {} logical processors, {} cores, {} "
+        "last-level cache domains, {} NUMA nodes",
+        result.logical_processors.size(), result.core_count,
+        result.cache_domain_count, result.numa_node_count);
+    return result;
+  }();
+  return topology;
+}
+
+const ProcessorTopology::LogicalProcessor*
+ProcessorTopology::FindLogicalProcessor(uint32_t index) const {
+  for (const LogicalProcessor& logical_processor : logical_processors) {
+    if (logical_processor.index == index) {
+      return &logical_processor;
+    }
+  }
+  return nullptr;
+}
+
+uint64_t ProcessorTopology::core_mask(uint32_t core) const {
+  uint64_t mask = 0;
+  for (const LogicalProcessor& logical_processor : logical_processors) {
+    if (logical_processor.core == core) {
+      mask |= uint64_t(1) << logical_processor.index;
+    }
+  }
+  return mask;
+}
+
+uint64_t ProcessorTopology::cache_domain_mask(uint32_t cache_domain) const {
+  uint64_t mask = 0;
+  for (const LogicalProcessor& logical_processor : logical_processors) {
+    if (logical_processor.cache_domain == cache_domain) {
+      mask |= uint64_t(1) << logical_processor.index;
+    }
+  }
+  return mask;
+}
+
+void ProcessorTopology::Normalize() {
+  // Drop the processors that can't be addressed by affinity masks.
+  logical_processors.erase(
+      std::remove_if(logical_processors.begin(), logical_processors.end(),
+                     [](const LogicalProcessor& logical_processor) {
+                       return logical_processor.index >= 64;
+                     }),
+      logical_processors.end());
+  auto key = [](const LogicalProcessor& logical_processor) {
+    return std::make_tuple(logical_processor.numa_node,
+                           logical_processor.cache_domain,
+                           logical_processor.core, logical_processor.index);
+  };
+  std::sort(logical_processors.begin(), logical_processors.end(),
+            [&](const LogicalProcessor& a, const LogicalProcessor& b) {
+              return key(a) < key(b);
+            });
+  // A processor reported more than once belongs to the first of its groups.
+  uint64_t seen_processors = 0;
+  logical_processors.erase(
+      std::remove_if(logical_processors.begin(), logical_processors.end(),
+                     [&](const LogicalProcessor& logical_processor) {
+                       uint64_t processor_bit = uint64_t(1)
+                                                << logical_processor.index;
+                       if (seen_processors & processor_bit) {
+                         return true;
+                       }
+                       seen_processors |= processor_bit;
+                       return false;
+                     }),
+      logical_processors.end());
+  // Cores and cache domains are identified within their parent since the
+  // platform identifiers may be per package.
+  std::unordered_map<uint32_t, uint32_t> numa_nodes;
+  std::unordered_map<uint64_t, uint32_t> cache_domains;
+  std::unordered_map<uint64_t, uint32_t> cores;
+  for (LogicalProcessor& logical_processor : logical_processors) {
+    auto numa_node = numa_nodes
+                         .emplace(logical_processor.numa_node,
+                                  uint32_t(numa_nodes.size()))
+                         .first->second;
+    auto cache_domain =
+        cache_domains
+            .emplace(uint64_t(numa_node) << 32 | logical_processor.cache_domain,
+                     uint32_t(cache_domains.size()))
+            .first->second;
+    auto core = cores
+                    .emplace(uint64_t(cache_domain) << 32 |
+                                 logical_processor.core,
+                             uint32_t(cores.size()))
+                    .first->second;
+    logical_processor.numa_node = numa_node;
+    logical_processor.cache_domain = cache_domain;
+    logical_processor.core = core;
+  }
+  numa_node_count = uint32_t(numa_nodes.size());
+  cache_domain_count = uint32_t(cache_domains.size());
+  core_count = uint32_t(cores.size());
+}
+
+}  // namespace threading
+}  // namespace xe
@@ -0,0 +1,66 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_BASE_PROCESSOR_TOPOLOGY_H_
+#define XENIA_BASE_PROCESSOR_TOPOLOGY_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace xe {
+namespace threading {
+
+// Logical processors available to the process, grouped by the hardware they
+// share, for placing threads that communicate a lot close to each other.
+// Only the processors that can be addressed by the 64-bit affinity masks of
+// xe::threading::Thread are included.
+struct ProcessorTopology {
+  struct LogicalProcessor {
+    // Index of the bit in affinity masks.
+    uint32_t index;
+    // Physical core, shared by SMT siblings.
+    uint32_t core;
+    // Last-level cache domain, such as a CCX of an AMD Zen processor.
+    uint32_t cache_domain;
+    uint32_t numa_node;
+  };
+
+  // Sorted by NUMA node, cache domain, core and index. The core, cache domain
+  // and NUMA node numbers are dense, in the same order.
+  std::vector<LogicalProcessor> logical_processors;
+  uint32_t core_count = 0;
+  uint32_t cache_domain_count = 0;
+  uint32_t numa_node_count = 0;
+
+  // Returns the topology of the host, discovered on the first call.
+  static const ProcessorTopology& Get();
+
+  const LogicalProcessor* FindLogicalProcessor(uint32_t index) const;
+  uint64_t core_mask(uint32_t core) const;
+  uint64_t cache_domain_mask(uint32_t cache_domain) const;
+
+  // Sorts the processors and renumbers the cores, cache domains and NUMA nodes
+  // densely after the platform-specific discovery has filled them with
+  // arbitrary identifiers. Processors with indices not fitting in affinity
+  // masks and repeated processors are dropped.
+  void Normalize();
+
+ private:
+  // Platform-specific, returns false if the topology couldn't be obtained.
+  static bool Discover(ProcessorTopology& topology);
+};
+
+// Returns the logical processor the calling thread is currently running on,
+// or UINT32_MAX if unknown.
+uint32_t current_processor_number();
+
+}  // namespace threading
+}  // namespace xe
+
+#endif  // XENIA_BASE_PROCESSOR_TOPOLOGY_H_
@@ -0,0 +1,105 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/processor_topology.h"
+
+#include <sched.h>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "third_party/fmt/include/fmt/format.h"
+
+namespace xe {
+namespace threading {
+
+namespace {
+
+bool ReadSysfsString(const std::string& path, std::string& value_out) {
+  std::ifstream file(path);
+  if (!file || !std::getline(file, value_out)) {
+    return false;
+  }
+  return true;
+}
+
+uint32_t ReadSysfsUint(const std::string& path, uint32_t default_value) {
+  std::string value;
+  if (!ReadSysfsString(path, value) || value.empty()) {
+    return default_value;
+  }
+  return uint32_t(std::strtoul(value.c_str(), nullptr, 10));
+}
+
+}  // namespace
+
+bool ProcessorTopology::Discover(ProcessorTopology& topology) {
+  cpu_set_t cpu_set;
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+    return false;
+  }
+  for (uint32_t i = 0; i < std::min(CPU_SETSIZE, 64); ++i) {
+    if (!CPU_ISSET(i, &cpu_set)) {
+      continue;
+    }
+    std::string cpu_path = fmt::format("/sys/devices/system/cpu/cpu{}/", i);
+    LogicalProcessor logical_processor;
+    logical_processor.index = i;
+    uint32_t package =
+        ReadSysfsUint(cpu_path + "topology/physical_package_id", 0);
+    logical_processor.core =
+        package << 16 | ReadSysfsUint(cpu_path + "topology/core_id", i);
+    // The last-level cache is identified by the first logical processor
+    // sharing it.
+    logical_processor.cache_domain = UINT32_MAX - package;
+    uint32_t cache_level = 0;
+    for (uint32_t cache_index = 0;; ++cache_index) {
+      std::string cache_path =
+          fmt::format("{}cache/index{}/", cpu_path, cache_index);
+      uint32_t level = ReadSysfsUint(cache_path + "level", 0);
+      if (!level) {
+        break;
+      }
+      std::string type, shared;
+      if (level < cache_level || !ReadSysfsString(cache_path + "type", type) ||
+          type == "Instruction" ||
+          !ReadSysfsString(cache_path + "shared_cpu_list", shared) ||
+          shared.empty()) {
+        continue;
+      }
+      cache_level = level;
+      logical_processor.cache_domain =
+          uint32_t(std::strtoul(shared.c_str(), nullptr, 10));
+    }
+    logical_processor.numa_node = 0;
+    std::error_code error_code;
+    for (const auto& entry :
+         std::filesystem::directory_iterator(cpu_path, error_code)) {
+      std::string name = entry.path().filename().string();
+      if (name.size() > 4 && name.compare(0, 4, "node") == 0) {
+        logical_processor.numa_node =
+            uint32_t(std::strtoul(name.c_str() + 4, nullptr, 10));
+        break;
+      }
+    }
+    topology.logical_processors.push_back(logical_processor);
+  }
+  return true;
+}
+
+uint32_t current_processor_number() {
+  int cpu = sched_getcpu();
+  return cpu >= 0 ? uint32_t(cpu) : UINT32_MAX;
+}
+
+}  // namespace threading
+}  // namespace xe
@@ -0,0 +1,112 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/processor_topology.h"
+
+#include <climits>
+#include <vector>
+
+#include "xenia/base/platform_win.h"
+
+namespace xe {
+namespace threading {
+
+bool ProcessorTopology::Discover(ProcessorTopology& topology) {
+  DWORD length = 0;
+  if (GetLogicalProcessorInformationEx(RelationAll, nullptr, &length) ||
+      GetLastError() != ERROR_INSUFFICIENT_BUFFER) {
+    return false;
+  }
+  std::vector<uint8_t> buffer(length);
+  if (!GetLogicalProcessorInformationEx(
+          RelationAll,
+          reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(
+              buffer.data()),
+          &length)) {
+    return false;
+  }
+  DWORD_PTR process_affinity_mask, system_affinity_mask;
+  if (!GetProcessAffinityMask(GetCurrentProcess(), &process_affinity_mask,
+                              &system_affinity_mask)) {
+    return false;
+  }
+
+  // Thread affinity masks address only the processors of group 0.
+  uint32_t cores[64], cache_domains[64], numa_nodes[64];
+  BYTE cache_levels[64] = {};
+  for (uint32_t i = 0; i < 64; ++i) {
+    cores[i] = UINT32_MAX - i;
+    cache_domains[i] = 0;
+    numa_nodes[i] = 0;
+  }
+  uint32_t core_counter = 0, cache_counter = 0;
+  for (DWORD offset = 0; offset < length;) {
+    auto& info = *reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(
+        buffer.data() + offset);
+    offset += info.Size;
+    switch (info.Relationship) {
+      case RelationProcessorCore:
+        for (WORD i = 0; i < info.Processor.GroupCount; ++i) {
+          const GROUP_AFFINITY& group_mask = info.Processor.GroupMask[i];
+          if (group_mask.Group) {
+            continue;
+          }
+          for (uint32_t j = 0; j < 64; ++j) {
+            if (uint64_t(group_mask.Mask) & (uint64_t(1) << j)) {
+              cores[j] = core_counter;
+            }
+          }
+        }
+        ++core_counter;
+        break;
+      case RelationCache:
+        if (info.Cache.Type != CacheInstruction &&
+            !info.Cache.GroupMask.Group) {
+          for (uint32_t j = 0; j < 64; ++j) {
+            if ((uint64_t(info.Cache.GroupMask.Mask) & (uint64_t(1) << j)) &&
+                info.Cache.Level >= cache_levels[j]) {
+              cache_levels[j] = info.Cache.Level;
+              cache_domains[j] = cache_counter;
+            }
+          }
+        }
+        ++cache_counter;
+        break;
+      case RelationNumaNode:
+        if (!info.NumaNode.GroupMask.Group) {
+          for (uint32_t j = 0; j < 64; ++j) {
+            if (uint64_t(info.NumaNode.GroupMask.Mask) & (uint64_t(1) << j)) {
+              numa_nodes[j] = info.NumaNode.NodeNumber;
+            }
+          }
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  for (uint32_t i = 0; i < 64; ++i) {
+    if (uint64_t(process_affinity_mask) & (uint64_t(1) << i)) {
+      topology.logical_processors.push_back(
+          {i, cores[i], cache_domains[i], numa_nodes[i]});
+    }
+  }
+  return true;
+}
+
+uint32_t current_processor_number() {
+  PROCESSOR_NUMBER processor_number;
+  GetCurrentProcessorNumberEx(&processor_number);
+  return processor_number.Group ? UINT32_MAX
+                                : uint32_t(processor_number.Number);
+}
+
+}  // namespace threading
+}  // namespace xe
@@ -37,6 +37,7 @@
 #include "xenia/base/assert.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/profiling.h"
+#include "xenia/base/profiling_trace.h"
 #include "xenia/ui/ui_event.h"
 #include "xenia/ui/virtual_key.h"
 #include "xenia/ui/window.h"
@@ -100,6 +101,8 @@ void Profiler::Initialize() {
   MicroProfileSetEnableAllGroups(true);
   MicroProfileSetForceMetaCounters(false);
 #endif  // XE_OPTION_PROFILING_UI
+
+  profiling::TraceRecorder::Initialize();
 }
 
 void Profiler::Dump() {
@@ -114,6 +117,7 @@ void Profiler::Shutdown() {
   SetUserIO(0, nullptr, nullptr, nullptr);
   window_ = nullptr;
   MicroProfileShutdown();
+  profiling::TraceRecorder::Shutdown();
 }
 
 uint32_t Profiler::GetColor(const char* str) {
@@ -124,6 +128,7 @@ uint32_t Profiler::GetColor(const char* str) {
 
 void Profiler::ThreadEnter(const char* name) {
   MicroProfileOnThreadCreate(name);
+  profiling::TraceRecorder::SetThreadName(name);
 }
 
 void Profiler::ThreadExit() { MicroProfileOnThreadExit(); }
@@ -335,11 +340,13 @@ void Profiler::PostInputEvent() {
 
 bool Profiler::is_enabled() { return false; }
 bool Profiler::is_visible() { return false; }
-void Profiler::Initialize() {}
+void Profiler::Initialize() { profiling::TraceRecorder::Initialize(); }
 void Profiler::Dump() {}
-void Profiler::Shutdown() {}
+void Profiler::Shutdown() { profiling::TraceRecorder::Shutdown(); }
 uint32_t Profiler::GetColor(const char* str) { return 0; }
-void Profiler::ThreadEnter(const char* name) {}
+void Profiler::ThreadEnter(const char* name) {
+  profiling::TraceRecorder::SetThreadName(name);
+}
 void Profiler::ThreadExit() {}
 void Profiler::ToggleDisplay() {}
 void Profiler::TogglePause() {}
@@ -15,6 +15,7 @@
 #include <memory>
 
 #include "xenia/base/platform.h"
+#include "xenia/base/profiling_trace.h"
 #include "xenia/base/string.h"
 #include "xenia/ui/ui_drawer.h"
 #include "xenia/ui/virtual_key.h"
@@ -44,6 +45,15 @@ class Window;
 
 namespace xe {
 
+#define XE_PROFILING_CONCAT_(a, b) a##b
+#define XE_PROFILING_CONCAT(a, b) XE_PROFILING_CONCAT_(a, b)
+
+// Records a scope in the profiling trace (see TraceRecorder), active for the
+// duration of the containing block. Used by the SCOPE_profile_* macros.
+#define XE_PROFILING_TRACE_SCOPE(group_name, scope_name)   \
+  xe::profiling::TraceRecorder::Scope XE_PROFILING_CONCAT( \
+      xe_profiling_trace_scope_, __LINE__)(group_name, scope_name)
+
 #if XE_OPTION_PROFILING
 
 // Defines a profiling scope for CPU tasks.
@@ -70,15 +80,17 @@ namespace xe {
 
 // Enters a CPU profiling scope, active for the duration of the containing
 // block. No previous definition required.
-#define SCOPE_profile_cpu_i(group_name, scope_name) \
-  MICROPROFILE_SCOPEI(group_name, scope_name,       \
-                      xe::Profiler::GetColor(scope_name))
+#define SCOPE_profile_cpu_i(group_name, scope_name)        \
+  MICROPROFILE_SCOPEI(group_name, scope_name,              \
+                      xe::Profiler::GetColor(scope_name)); \
+  XE_PROFILING_TRACE_SCOPE(group_name, scope_name)
 
 // Enters a CPU profiling scope by function name, active for the duration of
 // the containing block. No previous definition required.
-#define SCOPE_profile_cpu_f(group_name)         \
-  MICROPROFILE_SCOPEI(group_name, __FUNCTION__, \
-                      xe::Profiler::GetColor(__FUNCTION__))
+#define SCOPE_profile_cpu_f(group_name)                      \
+  MICROPROFILE_SCOPEI(group_name, __FUNCTION__,              \
+                      xe::Profiler::GetColor(__FUNCTION__)); \
+  XE_PROFILING_TRACE_SCOPE(group_name, __FUNCTION__)
 
 // Enters a previously defined GPU profiling scope, active for the duration
 // of the containing block.
@@ -86,15 +98,17 @@ namespace xe {
 
 // Enters a GPU profiling scope, active for the duration of the containing
 // block. No previous definition required.
-#define SCOPE_profile_gpu_i(group_name, scope_name) \
-  MICROPROFILE_SCOPEGPUI(group_name, scope_name,    \
-                         xe::Profiler::GetColor(scope_name))
+#define SCOPE_profile_gpu_i(group_name, scope_name)           \
+  MICROPROFILE_SCOPEGPUI(group_name, scope_name,              \
+                         xe::Profiler::GetColor(scope_name)); \
+  XE_PROFILING_TRACE_SCOPE(group_name, scope_name)
 
 // Enters a GPU profiling scope by function name, active for the duration of
 // the containing block. No previous definition required.
-#define SCOPE_profile_gpu_f(group_name)            \
-  MICROPROFILE_SCOPEGPUI(group_name, __FUNCTION__, \
-                         xe::Profiler::GetColor(__FUNCTION__))
+#define SCOPE_profile_gpu_f(group_name)                         \
+  MICROPROFILE_SCOPEGPUI(group_name, __FUNCTION__,              \
+                         xe::Profiler::GetColor(__FUNCTION__)); \
+  XE_PROFILING_TRACE_SCOPE(group_name, __FUNCTION__)
 
 // Adds a number to a counter
 #define COUNT_profile_add(name, count) MICROPROFILE_COUNTER_ADD(name, count)
@@ -103,7 +117,11 @@ namespace xe {
 #define COUNT_profile_sub(name, count) MICROPROFILE_COUNTER_SUB(name, count)
 
 // Sets a counter's value
-#define COUNT_profile_set(name, count) MICROPROFILE_COUNTER_SET(name, count)
+#define COUNT_profile_set(name, count)                           \
+  do {                                                           \
+    MICROPROFILE_COUNTER_SET(name, count);                       \
+    xe::profiling::TraceRecorder::Counter(name, int64_t(count)); \
+  } while (false)
 
 // Tracks a CPU value counter.
 #define COUNT_profile_cpu(name, count) MICROPROFILE_META_CPU(name, count)
@@ -120,29 +138,26 @@ namespace xe {
 #define SCOPE_profile_cpu(name) \
   do {                          \
   } while (false)
-#define SCOPE_profile_cpu_f(name) \
-  do {                            \
-  } while (false)
+#define SCOPE_profile_cpu_f(group_name) \
+  XE_PROFILING_TRACE_SCOPE(group_name, __FUNCTION__)
 #define SCOPE_profile_cpu_i(group_name, scope_name) \
-  do {                                              \
-  } while (false)
+  XE_PROFILING_TRACE_SCOPE(group_name, scope_name)
 #define SCOPE_profile_gpu(name) \
   do {                          \
   } while (false)
-#define SCOPE_profile_gpu_f(name) \
-  do {                            \
-  } while (false)
+#define SCOPE_profile_gpu_f(group_name) \
+  XE_PROFILING_TRACE_SCOPE(group_name, __FUNCTION__)
 #define SCOPE_profile_gpu_i(group_name, scope_name) \
-  do {                                              \
-  } while (false)
+  XE_PROFILING_TRACE_SCOPE(group_name, scope_name)
 #define COUNT_profile_add(name, count) \
   do {                                 \
   } while (false)
 #define COUNT_profile_sub(name, count) \
   do {                                 \
   } while (false)
-#define COUNT_profile_set(name, count) \
-  do {                                 \
+#define COUNT_profile_set(name, count)                           \
+  do {                                                           \
+    xe::profiling::TraceRecorder::Counter(name, int64_t(count)); \
   } while (false)
 #define COUNT_profile_cpu(name, count) \
   do {                                 \
@@ -0,0 +1,336 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/profiling_trace.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/threading.h"
+
+DEFINE_path(profile_trace_path, "",
+            "Record profiling scopes, GPU submission markers and counters, "
+            "and write them as a Chrome trace (viewable in chrome://tracing "
+            "or ui.perfetto.dev) to the given file on exit.",
+            "Profiling");
+DEFINE_uint32(profile_trace_events_per_thread, 262144,
+              "Number of the latest profiling trace events kept for every "
+              "thread (40 bytes each).",
+              "Profiling");
+
+namespace xe {
+namespace profiling {
+
+namespace {
+
+// The fields are atomic because the oldest events may be overwritten by the
+// owning thread while they're being written to the file. All accesses are
+// relaxed, the consistency is checked via ThreadTrace::count like a seqlock.
+struct TraceEvent {
+  std::atomic<uint64_t> time;
+  // Duration for complete events, the value otherwise.
+  std::atomic<uint64_t> value;
+  std::atomic<const char*> group_name;
+  std::atomic<const char*> name;
+  std::atomic<TraceRecorder::EventType> type;
+};
+
+struct ThreadTrace {
+  uint32_t thread_id;
+  std::atomic<uint32_t> guest_thread_id{0};
+  // Protected by threads_mutex_.
+  std::string name;
+  // Ring of the latest events, written only by the owning thread. Replaced
+  // with a smaller one, under threads_mutex_, when the thread exits.
+  std::unique_ptr<TraceEvent[]> events;
+  size_t capacity;
+  // Number of events ever recorded, event i is stored in i % capacity.
+  std::atomic<uint64_t> count{0};
+};
+
+std::mutex threads_mutex_;
+// Not removed when threads exit so their events are still written. Never
+// released before exit since threads may still be recording after recording
+// has been stopped.
+std::vector<std::unique_ptr<ThreadTrace>> threads_;
+uint64_t start_time_ = 0;
+uint32_t write_count_ = 0;
+
+// Shrinks the ring of an exited thread to the events it contains, which for
+// most short-lived threads is much less than profile_trace_events_per_thread.
+void ReleaseUnusedThreadTraceEvents(ThreadTrace& thread_trace) {
+  std::lock_guard<std::mutex> lock(threads_mutex_);
+  uint64_t count = thread_trace.count.load(std::memory_order_relaxed);
+  size_t used_count = size_t(std::min(count, uint64_t(thread_trace.capacity)));
+  if (used_count == thread_trace.capacity) {
+    return;
+  }
+  size_t new_capacity = std::max(used_count, size_t(1));
+  auto new_events = std::make_unique<TraceEvent[]>(new_capacity);
+  // Not wrapped around, so events [0, count) are stored at their indices and
+  // also stay at them with the new capacity.
+  for (size_t i = 0; i < used_count; ++i) {
+    const TraceEvent& event = thread_trace.events[i];
+    TraceEvent& new_event = new_events[i];
+    new_event.time.store(event.time.load(std::memory_order_relaxed),
+                         std::memory_order_relaxed);
+    new_event.value.store(event.value.load(std::memory_order_relaxed),
+                          std::memory_order_relaxed);
+    new_event.group_name.store(
+        event.group_name.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+    new_event.name.store(event.name.load(std::memory_order_relaxed),
+                         std::memory_order_relaxed);
+    new_event.type.store(event.type.load(std::memory_order_relaxed),
+                         std::memory_order_relaxed);
+  }
+  thread_trace.events = std::move(new_events);
+  thread_trace.capacity = new_capacity;
+}
+
+struct CurrentThreadTrace {
+  ThreadTrace* thread_trace = nullptr;
+  ~CurrentThreadTrace() {
+    if (thread_trace) {
+      ReleaseUnusedThreadTraceEvents(*thread_trace);
+    }
+  }
+};
+thread_local CurrentThreadTrace current_thread_trace_;
+
+ThreadTrace* GetCurrentThreadTrace() {
+  ThreadTrace* thread_trace = current_thread_trace_.thread_trace;
+  if (thread_trace) {
+    return thread_trace;
+  }
+  auto new_thread_trace = std::make_unique<ThreadTrace>();
+  new_thread_trace->thread_id = threading::current_thread_id();
+  new_thread_trace->name =
+      fmt::format("Thread {:08X}", new_thread_trace->thread_id);
+  new_thread_trace->capacity =
+      std::max(cvars::profile_trace_events_per_thread, uint32_t(1));
+  new_thread_trace->events =
+      std::make_unique<TraceEvent[]>(new_thread_trace->capacity);
+  thread_trace = new_thread_trace.get();
+  {
+    std::lock_guard<std::mutex> lock(threads_mutex_);
+    threads_.push_back(std::move(new_thread_trace));
+  }
+  current_thread_trace_.thread_trace = thread_trace;
+  return thread_trace;
+}
+
+void AppendJsonString(fmt::memory_buffer& out, const char* str) {
+  out.push_back('"');
+  for (; *str; ++str) {
+    char c = *str;
+    if (c == '"' || c == '\\') {
+      out.push_back('\\');
+      out.push_back(c);
+    } else if (uint8_t(c) < 0x20) {
+      fmt::format_to(std::back_inserter(out), "\\u{:04x}", uint8_t(c));
+    } else {
+      out.push_back(c);
+    }
+  }
+  out.push_back('"');
+}
+
+}  // namespace
+
+std::atomic<bool> TraceRecorder::recording_ = false;
+
+void TraceRecorder::Initialize() {
+  if (cvars::profile_trace_path.empty()) {
+    return;
+  }
+  start_time_ = Clock::QueryHostTickCount();
+  recording_.store(true, std::memory_order_relaxed);
+}
+
+void TraceRecorder::Shutdown() {
+  if (!is_recording()) {
+    return;
+  }
+  recording_.store(false, std::memory_order_relaxed);
+  Write(cvars::profile_trace_path);
+}
+
+void TraceRecorder::SetThreadName(const char* name) {
+  if (!is_recording() || !name) {
+    return;
+  }
+  ThreadTrace* thread_trace = GetCurrentThreadTrace();
+  std::lock_guard<std::mutex> lock(threads_mutex_);
+  thread_trace->name = name;
+}
+
+void TraceRecorder::SetThreadGuestId(uint32_t guest_thread_id) {
+  if (!is_recording()) {
+    return;
+  }
+  GetCurrentThreadTrace()->guest_thread_id.store(guest_thread_id,
+                                                 std::memory_order_relaxed);
+}
+
+void TraceRecorder::Record(EventType type, const char* group_name,
+                           const char* name, uint64_t time, uint64_t value) {
+  ThreadTrace* thread_trace = GetCurrentThreadTrace();
+  uint64_t index = thread_trace->count.load(std::memory_order_relaxed);
+  TraceEvent& event = thread_trace->events[index % thread_trace->capacity];
+  // If Write sees any of the new fields of an overwritten event, it must also
+  // see the count that had reached the event being overwritten, so it drops it.
+  std::atomic_thread_fence(std::memory_order_release);
+  event.time.store(time, std::memory_order_relaxed);
+  event.value.store(value, std::memory_order_relaxed);
+  event.group_name.store(group_name, std::memory_order_relaxed);
+  event.name.store(name, std::memory_order_relaxed);
+  event.type.store(type, std::memory_order_relaxed);
+  thread_trace->count.store(index + 1, std::memory_order_release);
+}
+
+bool TraceRecorder::Write(std::filesystem::path path) {
+  if (path.empty()) {
+    if (cvars::profile_trace_path.empty()) {
+      XELOGE("Profiling trace recording is not enabled (profile_trace_path)");
+      return false;
+    }
+    path = cvars::profile_trace_path;
+    path.replace_filename(fmt::format(
+        "{}_{}{}", xe::path_to_utf8(path.stem()), ++write_count_,
+        xe::path_to_utf8(path.extension())));
+  }
+  xe::filesystem::CreateParentFolder(path);
+  FILE* file = xe::filesystem::OpenFile(path, "wb");
+  if (!file) {
+    XELOGE("Failed to open {} for writing the profiling trace",
+           xe::path_to_utf8(path));
+    return false;
+  }
+
+  // Microseconds, as expected by the trace viewers.
+  double time_scale = 1000000.0 / double(Clock::QueryHostTickFrequency());
+  auto timestamp = [&](uint64_t time) {
+    return double(int64_t(time - start_time_)) * time_scale;
+  };
+
+  fmt::memory_buffer out;
+  auto out_it = std::back_inserter(out);
+  fmt::format_to(out_it, "{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  bool first_event = true;
+  auto begin_event = [&]() {
+    if (!first_event) {
+      out.append(std::string_view(",\n"));
+    }
+    first_event = false;
+  };
+
+  uint64_t event_count = 0;
+  std::lock_guard<std::mutex> lock(threads_mutex_);
+  for (const auto& thread_trace : threads_) {
+    uint32_t tid = thread_trace->thread_id;
+    uint32_t guest_thread_id =
+        thread_trace->guest_thread_id.load(std::memory_order_relaxed);
+    begin_event();
+    fmt::format_to(out_it,
+                   "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                   "\"tid\":{},\"args\":{{\"name\":",
+                   tid);
+    std::string name = thread_trace->name;
+    if (guest_thread_id) {
+      name += fmt::format(" (guest {:08X})", guest_thread_id);
+    }
+    AppendJsonString(out, name.c_str());
+    out.append(std::string_view("}}"));
+    if (guest_thread_id) {
+      // Keep the guest threads together, below the host ones.
+      begin_event();
+      fmt::format_to(out_it,
+                     "{{\"name\":\"thread_sort_index\",\"ph\":\"M\","
+                     "\"pid\":1,\"tid\":{},\"args\":{{\"sort_index\":{}}}}}",
+                     tid, guest_thread_id);
+    }
+
+    // Only events published by the release of the count are read. The oldest
+    // events may be overwritten by the thread while they're being written, so
+    // skip a part of the ring when it has wrapped around, and drop the events
+    // that have been overwritten while they were being read.
+    uint64_t count = thread_trace->count.load(std::memory_order_acquire);
+    uint64_t first = 0;
+    if (count > thread_trace->capacity) {
+      first = count - thread_trace->capacity + thread_trace->capacity / 16;
+    }
+    for (uint64_t i = first; i < count; ++i) {
+      const TraceEvent& ring_event =
+          thread_trace->events[i % thread_trace->capacity];
+      uint64_t event_time = ring_event.time.load(std::memory_order_relaxed);
+      uint64_t event_value = ring_event.value.load(std::memory_order_relaxed);
+      const char* event_group_name =
+          ring_event.group_name.load(std::memory_order_relaxed);
+      const char* event_name = ring_event.name.load(std::memory_order_relaxed);
+      EventType event_type = ring_event.type.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (thread_trace->count.load(std::memory_order_relaxed) >=
+          i + thread_trace->capacity) {
+        // Being overwritten - all the older events are too.
+        continue;
+      }
+      begin_event();
+      out.append(std::string_view("{\"name\":"));
+      AppendJsonString(out, event_name);
+      switch (event_type) {
+        case EventType::kComplete:
+          out.append(std::string_view(",\"cat\":"));
+          AppendJsonString(out, event_group_name);
+          fmt::format_to(out_it,
+                         ",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},"
+                         "\"pid\":1,\"tid\":{}}}",
+                         timestamp(event_time),
+                         double(event_value) * time_scale, tid);
+          break;
+        case EventType::kInstant:
+          out.append(std::string_view(",\"cat\":"));
+          AppendJsonString(out, event_group_name);
+          fmt::format_to(out_it,
+                         ",\"ph\":\"i\",\"s\":\"t\",\"ts\":{:.3f},\"pid\":1,"
+                         "\"tid\":{},\"args\":{{\"value\":{}}}}}",
+                         timestamp(event_time), tid, event_value);
+          break;
+        case EventType::kCounter:
+          fmt::format_to(out_it,
+                         ",\"ph\":\"C\",\"ts\":{:.3f},\"pid\":1,\"tid\":{},"
+                         "\"args\":{{\"value\":{}}}}}",
+                         timestamp(event_time), tid, int64_t(event_value));
+          break;
+      }
+      ++event_count;
+      if (out.size() >= 1024 * 1024) {
+        fwrite(out.data(), 1, out.size(), file);
+        out.clear();
+      }
+    }
+  }
+  out.append(std::string_view("\n]}\n"));
+  fwrite(out.data(), 1, out.size(), file);
+  fclose(file);
+
+  XELOGI("Wrote {} profiling trace events to {}", event_count,
+         xe::path_to_utf8(path));
+  return true;
+}
+
+}  // namespace profiling
+}  // namespace xe
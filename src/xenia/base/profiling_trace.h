@@ -0,0 +1,111 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_BASE_PROFILING_TRACE_H_
+#define XENIA_BASE_PROFILING_TRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+
+#include "xenia/base/clock.h"
+
+namespace xe {
+namespace profiling {
+
+// Records the profiling scopes, markers and counters into per-thread buffers
+// independently of microprofile, so they can be examined offline on hosts
+// without the profiler UI. The buffers are written as a Chrome trace event
+// JSON file, which can be opened in chrome://tracing and ui.perfetto.dev.
+//
+// Recording is enabled by the profile_trace_path cvar. Every thread keeps the
+// latest profile_trace_events_per_thread events, so writing the trace right
+// after a spike captures what led to it.
+class TraceRecorder {
+ public:
+  enum class EventType : uint8_t {
+    kComplete,
+    kInstant,
+    kCounter,
+  };
+
+  // A scope recorded as a single event when it's exited.
+  class Scope {
+   public:
+    Scope(const char* group_name, const char* scope_name) {
+      if (is_recording()) {
+        group_name_ = group_name;
+        scope_name_ = scope_name;
+        start_ = Clock::QueryHostTickCount();
+      }
+    }
+    ~Scope() {
+      if (scope_name_) {
+        Record(EventType::kComplete, group_name_, scope_name_, start_,
+               Clock::QueryHostTickCount() - start_);
+      }
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    const char* group_name_ = nullptr;
+    const char* scope_name_ = nullptr;
+    uint64_t start_ = 0;
+  };
+
+  static bool is_recording() {
+    return recording_.load(std::memory_order_relaxed);
+  }
+
+  // Starts recording if requested by the cvars. Call at startup.
+  static void Initialize();
+  // Writes the trace if recording and stops recording. The buffers of the
+  // threads that are still running are kept since they may be in the middle of
+  // recording an event - the ones of exited threads are shrunk on exit.
+  static void Shutdown();
+
+  // Names the calling thread in the trace.
+  static void SetThreadName(const char* name);
+  // Associates the calling thread with a guest thread.
+  static void SetThreadGuestId(uint32_t guest_thread_id);
+
+  // Records a point in time, such as a GPU submission, with a value shown as
+  // its argument. The names must have static storage duration.
+  static void Instant(const char* group_name, const char* name,
+                      uint64_t value = 0) {
+    if (is_recording()) {
+      Record(EventType::kInstant, group_name, name,
+             Clock::QueryHostTickCount(), value);
+    }
+  }
+  // Records the new value of a counter. The name must have static storage
+  // duration.
+  static void Counter(const char* name, int64_t value) {
+    if (is_recording()) {
+      Record(EventType::kCounter, nullptr, name, Clock::QueryHostTickCount(),
+             uint64_t(value));
+    }
+  }
+
+  // Writes the events recorded so far, without stopping recording, to the
+  // given file or, if empty, to a new file next to profile_trace_path.
+  static bool Write(std::filesystem::path path = {});
+
+ private:
+  static void Record(EventType type, const char* group_name, const char* name,
+                     uint64_t time, uint64_t value);
+
+  static std::atomic<bool> recording_;
+};
+
+}  // namespace profiling
+}  // namespace xe
+
+#endif  // XENIA_BASE_PROFILING_TRACE_H_
@@ -0,0 +1,122 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/logging.h"
+
+#include <chrono>
+#include <string>
+#include <string_view>
+
+#include "third_party/catch/include/catch.hpp"
+#include "third_party/fmt/include/fmt/format.h"
+
+namespace xe {
+namespace base {
+namespace test {
+
+enum class TestLogEnum : uint32_t {
+  kValue = 0x5A,
+};
+
+template <typename... Args>
+std::string FormatDeferred(const char* format, const Args&... args) {
+  uint8_t args_buffer[1024];
+  size_t args_size = logging::internal::EncodeDeferredLogArgs(
+      args_buffer, sizeof(args_buffer), args...);
+  if (args_size == SIZE_MAX) {
+    return "<too large>";
+  }
+  char text[1024];
+  size_t text_length =
+      logging::internal::FormatDeferredLogLine<std::decay_t<Args>...>(
+          format, args_buffer, text, sizeof(text));
+  return std::string(text, text_length);
+}
+
+template <typename... Args>
+void TestDeferred(const char* format, const Args&... args) {
+  static_assert(logging::internal::kLogArgsDeferrable<Args...>);
+  REQUIRE(FormatDeferred(format, args...) == fmt::format(format, args...));
+}
+
+TEST_CASE("logging_deferred_format", "[logging]") {
+  TestDeferred("No arguments");
+  TestDeferred("{} {} {} {}", uint8_t(0xFF), int16_t(-2), uint32_t(3),
+               int64_t(-4));
+  TestDeferred("{:08X} {:.3f} {} {}", 0xDEADBEEFu, 1.5, 2.25f, true);
+  TestDeferred("{} {}", 'c', static_cast<uint32_t>(TestLogEnum::kValue));
+  TestDeferred("{}", reinterpret_cast<const void*>(uintptr_t(0x1234)));
+
+  const char* c_string = "c string";
+  char mutable_string[] = "mutable";
+  std::string string = "std::string";
+  std::string_view string_view = std::string_view("string_view_", 11);
+  TestDeferred("{} {} {} {} {}", c_string, mutable_string, string,
+               string_view, "literal");
+  TestDeferred("[{}]", std::string());
+}
+
+TEST_CASE("logging_deferred_format_copies_strings", "[logging]") {
+  std::string string = "before";
+  uint8_t args_buffer[64];
+  logging::internal::EncodeDeferredLogArgs(args_buffer, sizeof(args_buffer),
+                                           string, 7);
+  // The caller may modify the string after logging.
+  string = "after!";
+  char text[64];
+  size_t text_length =
+      logging::internal::FormatDeferredLogLine<std::string, int>(
+          "{} {}", args_buffer, text, sizeof(text));
+  REQUIRE(std::string_view(text, text_length) == "before 7");
+}
+
+TEST_CASE("logging_deferred_format_overflow", "[logging]") {
+  std::string string(100, 'x');
+  uint8_t args_buffer[64];
+  REQUIRE(logging::internal::EncodeDeferredLogArgs(
+              args_buffer, sizeof(args_buffer), string) == SIZE_MAX);
+  // Output longer than the buffer is truncated.
+  REQUIRE(FormatDeferred("{:0>2000}", 1).size() == 1024);
+}
+
+TEST_CASE("logging_deferred_format_caller_cost", "[.benchmark]") {
+  const size_t iterations = 1000000;
+  const char* format = "XThread{:08X} ({}) {}({:08X}, {:08X}, {}) = {:08X}";
+  const char* function_name = "NtWaitForSingleObjectEx";
+  char buffer[64 * 1024];
+  size_t sink = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    sink += fmt::format_to_n(buffer, sizeof(buffer), format, uint32_t(i),
+                             "Main XThread", function_name, uint32_t(i * 3),
+                             uint32_t(i * 5), true, uint32_t(0))
+                .size;
+  }
+  auto format_time = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    sink += logging::internal::EncodeDeferredLogArgs(
+        reinterpret_cast<uint8_t*>(buffer), sizeof(buffer), uint32_t(i),
+        "Main XThread", function_name, uint32_t(i * 3), uint32_t(i * 5), true,
+        uint32_t(0));
+  }
+  auto encode_time = std::chrono::steady_clock::now() - start;
+
+  using ns = std::chrono::duration<double, std::nano>;
+  fmt::print("format_to_n: {:.1f} ns/line, deferred capture: {:.1f} ns/line\n",
+             ns(format_time).count() / iterations,
+             ns(encode_time).count() / iterations);
+  REQUIRE(sink != 0);
+}
+
+}  // namespace test
+}  // namespace base
+}  // namespace xe
@@ -13,8 +13,13 @@
 #include "third_party/fmt/include/fmt/format.h"
 
 #include "xenia/base/clock.h"
+#include "xenia/base/exception_handler.h"
+#include "xenia/base/math.h"
 
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <vector>
 
 namespace xe {
 namespace base {
@@ -506,6 +511,106 @@ TEST_CASE("copy_and_swap_16_in_32_unaligned", "[copy_and_swap]") {
   }
 }
 
+// Covers the 256-bit and 512-bit paths (whichever the CPU supports), including
+// the non-temporal stores for large copies, with element offsets that leave
+// the destination unaligned to the vector size, and copying in place.
+template <typename T>
+static void TestCopyAndSwapSizes(void (*copy_and_swap_function)(void*,
+                                                                const void*,
+                                                                size_t),
+                                 T (*swap)(T)) {
+  const size_t large_count = (size_t(3) << 20) / sizeof(T) + 5;
+  std::vector<T> src(large_count + 8);
+  std::vector<T> dest(large_count + 8);
+  for (size_t i = 0; i < src.size(); ++i) {
+    src[i] = T(0x0123456789ABCDEFull * (i + 1));
+  }
+  std::vector<size_t> counts;
+  for (size_t count = 0; count <= 300; ++count) {
+    counts.push_back(count);
+  }
+  counts.push_back(large_count);
+  for (size_t offset = 0; offset < 4; ++offset) {
+    for (size_t count : counts) {
+      std::fill(dest.begin(), dest.end(), T(0));
+      copy_and_swap_function(dest.data() + offset, src.data() + (3 - offset),
+                             count);
+      for (size_t i = 0; i < count; ++i) {
+        REQUIRE(dest[offset + i] == swap(src[3 - offset + i]));
+      }
+      REQUIRE(dest[offset + count] == T(0));
+    }
+    std::vector<T> in_place(src.begin(), src.end());
+    copy_and_swap_function(in_place.data() + offset, in_place.data() + offset,
+                           large_count);
+    for (size_t i = 0; i < large_count; ++i) {
+      REQUIRE(in_place[offset + i] == swap(src[offset + i]));
+    }
+  }
+}
+
+TEST_CASE("copy_and_swap_sizes", "[copy_and_swap]") {
+  TestCopyAndSwapSizes<uint16_t>(
+      copy_and_swap_16_unaligned,
+      [](uint16_t value) { return xe::byte_swap(value); });
+  TestCopyAndSwapSizes<uint32_t>(
+      copy_and_swap_32_unaligned,
+      [](uint32_t value) { return xe::byte_swap(value); });
+  TestCopyAndSwapSizes<uint64_t>(
+      copy_and_swap_64_unaligned,
+      [](uint64_t value) { return xe::byte_swap(value); });
+  TestCopyAndSwapSizes<uint32_t>(
+      copy_and_swap_16_in_32_unaligned,
+      [](uint32_t value) { return (value >> 16) | (value << 16); });
+}
+
+// Throughput of copy_and_swap with aligned and unaligned buffers. Hidden, run
+// with the [benchmark] tag.
+TEST_CASE("copy_and_swap_throughput", "[.benchmark]") {
+  const size_t max_size = size_t(64) << 20;
+  // Slack for aligning to 64 bytes and for the unaligned offset.
+  std::vector<uint8_t> src_buffer(max_size + 128, 0x5A);
+  std::vector<uint8_t> dest_buffer(max_size + 128, 0);
+  auto src = reinterpret_cast<uint8_t*>(xe::align(
+      reinterpret_cast<uintptr_t>(src_buffer.data()), uintptr_t(64)));
+  auto dest = reinterpret_cast<uint8_t*>(xe::align(
+      reinterpret_cast<uintptr_t>(dest_buffer.data()), uintptr_t(64)));
+
+  struct Function {
+    const char* name;
+    size_t element_size;
+    void (*aligned)(void*, const void*, size_t);
+    void (*unaligned)(void*, const void*, size_t);
+  };
+  const Function functions[] = {
+      {"16", 2, copy_and_swap_16_aligned, copy_and_swap_16_unaligned},
+      {"32", 4, copy_and_swap_32_aligned, copy_and_swap_32_unaligned},
+      {"64", 8, copy_and_swap_64_aligned, copy_and_swap_64_unaligned},
+  };
+  for (const Function& function : functions) {
+    for (size_t size = 64; size <= max_size; size <<= 2) {
+      // About 256 MiB in total for each size.
+      size_t iterations = std::max((size_t(256) << 20) / size, size_t(4));
+      size_t count = size / function.element_size;
+      for (bool aligned : {true, false}) {
+        // Offset by one element so the destination is unaligned, but elements
+        // are still naturally aligned.
+        size_t offset = aligned ? 0 : function.element_size;
+        auto copy = aligned ? function.aligned : function.unaligned;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+          copy(dest + offset, src + offset, count);
+        }
+        std::chrono::duration<double> duration =
+            std::chrono::steady_clock::now() - start;
+        fmt::print("copy_and_swap_{} {} {} B: {:.2f} GB/s\n", function.name,
+                   aligned ? "aligned" : "unaligned", size,
+                   double(size) * double(iterations) / duration.count() / 1e9);
+      }
+    }
+  }
+}
+
 TEST_CASE("create_and_close_file_mapping", "Virtual Memory Mapping") {
   auto path = fmt::format("xenia_test_{}", Clock::QueryHostTickCount());
   auto memory = xe::memory::CreateFileMappingHandle(
@@ -558,6 +663,140 @@ TEST_CASE("read_write_view", "[virtual_memory_mapping]") {
   xe::memory::CloseFileMappingHandle(memory, path);
 }
 
+TEST_CASE("write_watch", "[virtual_memory_mapping]") {
+  if (!xe::memory::IsWriteWatchSupported()) {
+    WARN("Host write watching is not supported, skipping");
+    return;
+  }
+  const size_t page_size = xe::memory::page_size();
+  const size_t length = page_size * 16;
+  auto base = reinterpret_cast<uint8_t*>(xe::memory::AllocFixed(
+      nullptr, length, xe::memory::AllocationType::kReserveCommit,
+      xe::memory::PageAccess::kReadWrite));
+  REQUIRE(base);
+  // Touch a page before watching - it must not be reported.
+  base[page_size * 2] = 1;
+  REQUIRE(xe::memory::WatchWrites(base, length));
+
+  std::vector<std::pair<size_t, size_t>> ranges;
+  REQUIRE(xe::memory::GetWrittenRanges(base, length, ranges));
+  REQUIRE(ranges.empty());
+
+  base[page_size * 3 + 5] = 1;
+  base[page_size * 4] = 1;
+  base[page_size * 9 + page_size - 1] = 1;
+  ranges.clear();
+  REQUIRE(xe::memory::GetWrittenRanges(base, length, ranges));
+  REQUIRE(ranges.size() == 2);
+  REQUIRE(ranges[0].first == page_size * 3);
+  REQUIRE(ranges[0].second == page_size * 2);
+  REQUIRE(ranges[1].first == page_size * 9);
+  REQUIRE(ranges[1].second == page_size);
+
+  // Reported pages are protected again, with no writes in between the second
+  // scan must report nothing.
+  ranges.clear();
+  REQUIRE(xe::memory::GetWrittenRanges(base, length, ranges));
+  REQUIRE(ranges.empty());
+
+  // And writes after the scan are caught again.
+  base[page_size * 3] = 2;
+  REQUIRE(xe::memory::GetWrittenRanges(base, length, ranges));
+  REQUIRE(ranges.size() == 1);
+  REQUIRE(ranges[0].first == page_size * 3);
+  REQUIRE(ranges[0].second == page_size);
+
+  xe::memory::DeallocFixed(base, length,
+                           xe::memory::DeallocationType::kRelease);
+}
+
+struct WriteTrackingBenchmarkRegion {
+  uint8_t* base;
+  size_t length;
+};
+
+static bool WriteTrackingBenchmarkExceptionHandler(Exception* ex, void* data) {
+  if (ex->code() != Exception::Code::kAccessViolation) {
+    return false;
+  }
+  auto region = reinterpret_cast<const WriteTrackingBenchmarkRegion*>(data);
+  uintptr_t address = uintptr_t(ex->fault_address());
+  uintptr_t base = reinterpret_cast<uintptr_t>(region->base);
+  if (address < base || address - base >= region->length) {
+    return false;
+  }
+  xe::memory::Protect(
+      reinterpret_cast<void*>(address & ~(xe::memory::page_size() - 1)),
+      xe::memory::page_size(), xe::memory::PageAccess::kReadWrite, nullptr);
+  return true;
+}
+
+// Compares the cost of tracking CPU writes to GPU-cached memory with page
+// protection and access violations against host write watching. Hidden, run
+// with the [benchmark] tag.
+TEST_CASE("write_tracking_cost", "[.benchmark]") {
+  const size_t length = 64 * 1024 * 1024;
+  const uint32_t iterations = 8;
+  const size_t page_size = xe::memory::page_size();
+  WriteTrackingBenchmarkRegion region;
+  region.length = length;
+  region.base = reinterpret_cast<uint8_t*>(xe::memory::AllocFixed(
+      nullptr, length, xe::memory::AllocationType::kReserveCommit,
+      xe::memory::PageAccess::kReadWrite));
+  REQUIRE(region.base);
+  std::memset(region.base, 0, length);
+
+  auto report = [&](const char* name, std::chrono::nanoseconds duration) {
+    double us_per_mib = double(duration.count()) / 1000.0 /
+                        double(iterations) / double(length >> 20);
+    fmt::print("{}: {:.3f} us per MiB written\n", name, us_per_mib);
+  };
+  auto write_all_pages = [&](uint32_t iteration) {
+    for (size_t offset = 0; offset < length; offset += page_size) {
+      std::memset(region.base + offset, int(iteration), page_size);
+    }
+  };
+
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; ++i) {
+      write_all_pages(i);
+    }
+    report("untracked", std::chrono::steady_clock::now() - start);
+  }
+
+  {
+    ExceptionHandler::Install(WriteTrackingBenchmarkExceptionHandler, &region);
+    std::chrono::nanoseconds duration(0);
+    for (uint32_t i = 0; i < iterations; ++i) {
+      auto start = std::chrono::steady_clock::now();
+      xe::memory::Protect(region.base, length,
+                          xe::memory::PageAccess::kReadOnly, nullptr);
+      write_all_pages(i);
+      duration += std::chrono::steady_clock::now() - start;
+    }
+    ExceptionHandler::Uninstall(WriteTrackingBenchmarkExceptionHandler,
+                                &region);
+    report("protection", duration);
+  }
+
+  if (xe::memory::IsWriteWatchSupported() &&
+      xe::memory::WatchWrites(region.base, length)) {
+    std::vector<std::pair<size_t, size_t>> ranges;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; ++i) {
+      write_all_pages(i);
+      REQUIRE(xe::memory::GetWrittenRanges(region.base, length, ranges));
+    }
+    report("write watch", std::chrono::steady_clock::now() - start);
+  } else {
+    WARN("Host write watching is not supported");
+  }
+
+  xe::memory::DeallocFixed(region.base, length,
+                           xe::memory::DeallocationType::kRelease);
+}
+
 TEST_CASE("make_fourcc", "[fourcc]") {
   SECTION("'1234'") {
     const uint32_t fourcc_host = 0x31323334;
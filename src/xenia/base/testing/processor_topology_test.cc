@@ -0,0 +1,75 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/processor_topology.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe {
+namespace base {
+namespace test {
+
+using threading::ProcessorTopology;
+
+TEST_CASE("processor_topology_normalize", "[processor_topology]") {
+  ProcessorTopology topology;
+  // <index, core, cache domain, NUMA node> with arbitrary platform identifiers.
+  topology.logical_processors = {
+      {3, 10, 5, 1},
+      {1, 10, 5, 1},
+      {0, 2, 7, 0},
+      {2, 4, 7, 0},
+      // Not addressable by affinity masks.
+      {70, 2, 7, 0},
+      // Reported again in a different group.
+      {1, 99, 9, 2},
+  };
+  topology.Normalize();
+
+  REQUIRE(topology.logical_processors.size() == 4);
+  REQUIRE(topology.core_count == 3);
+  REQUIRE(topology.cache_domain_count == 2);
+  REQUIRE(topology.numa_node_count == 2);
+  const uint32_t expected[][4] = {
+      {0, 0, 0, 0},
+      {2, 1, 0, 0},
+      {1, 2, 1, 1},
+      {3, 2, 1, 1},
+  };
+  for (size_t i = 0; i < topology.logical_processors.size(); ++i) {
+    const auto& logical_processor = topology.logical_processors[i];
+    REQUIRE(logical_processor.index == expected[i][0]);
+    REQUIRE(logical_processor.core == expected[i][1]);
+    REQUIRE(logical_processor.cache_domain == expected[i][2]);
+    REQUIRE(logical_processor.numa_node == expected[i][3]);
+  }
+  REQUIRE(topology.core_mask(2) == 0b1010);
+  REQUIRE(topology.cache_domain_mask(0) == 0b0101);
+  REQUIRE(topology.FindLogicalProcessor(70) == nullptr);
+  REQUIRE(topology.FindLogicalProcessor(3)->core == 2);
+}
+
+TEST_CASE("processor_topology_normalize_empty", "[processor_topology]") {
+  ProcessorTopology topology;
+  topology.Normalize();
+  REQUIRE(topology.logical_processors.empty());
+  REQUIRE(topology.core_count == 0);
+  REQUIRE(topology.cache_domain_count == 0);
+  REQUIRE(topology.numa_node_count == 0);
+
+  // Only unaddressable processors.
+  topology.logical_processors = {{64, 0, 0, 0}, {100, 1, 0, 0}};
+  topology.Normalize();
+  REQUIRE(topology.logical_processors.empty());
+  REQUIRE(topology.core_count == 0);
+}
+
+}  // namespace test
+}  // namespace base
+}  // namespace xe
@@ -0,0 +1,127 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/profiling_trace.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+#include "third_party/catch/include/catch.hpp"
+#include "xenia/base/cvar.h"
+
+DECLARE_path(profile_trace_path);
+DECLARE_uint32(profile_trace_events_per_thread);
+
+namespace xe {
+namespace base {
+namespace test {
+
+using profiling::TraceRecorder;
+
+TEST_CASE("profiling_trace_write", "[profiling]") {
+  auto path =
+      std::filesystem::temp_directory_path() / "xenia_profiling_trace.json";
+  auto old_path = cvars::profile_trace_path;
+  cvars::profile_trace_path = path;
+  TraceRecorder::Initialize();
+  REQUIRE(TraceRecorder::is_recording());
+
+  TraceRecorder::SetThreadName("Test \"Main\"");
+  {
+    TraceRecorder::Scope scope("test", "MainScope");
+    TraceRecorder::Instant("gpu", "Submission", 7);
+    TraceRecorder::Counter("test/counter", -3);
+  }
+  std::thread([]() {
+    TraceRecorder::SetThreadName("Guest");
+    TraceRecorder::SetThreadGuestId(0xF8000010);
+    TraceRecorder::Scope scope("cpu", "GuestScope");
+  }).join();
+
+  TraceRecorder::Shutdown();
+  REQUIRE_FALSE(TraceRecorder::is_recording());
+  cvars::profile_trace_path = old_path;
+
+  std::string trace;
+  {
+    std::ifstream file(path);
+    trace.assign(std::istreambuf_iterator<char>(file),
+                 std::istreambuf_iterator<char>());
+  }
+  std::filesystem::remove(path);
+
+  REQUIRE(trace.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0) ==
+          0);
+  REQUIRE(trace.find("\"name\":\"Test \\\"Main\\\"\"") != std::string::npos);
+  REQUIRE(trace.find("\"name\":\"Guest (guest F8000010)\"") !=
+          std::string::npos);
+  REQUIRE(trace.find("{\"name\":\"MainScope\",\"cat\":\"test\",\"ph\":\"X\"") !=
+          std::string::npos);
+  REQUIRE(trace.find("{\"name\":\"GuestScope\",\"cat\":\"cpu\",\"ph\":\"X\"") !=
+          std::string::npos);
+  REQUIRE(trace.find("\"args\":{\"value\":7}") != std::string::npos);
+  REQUIRE(trace.find("{\"name\":\"test/counter\",\"ph\":\"C\"") !=
+          std::string::npos);
+  REQUIRE(trace.find("\"args\":{\"value\":-3}") != std::string::npos);
+  // Nothing is recorded after shutting down.
+  TraceRecorder::Instant("gpu", "Late");
+}
+
+TEST_CASE("profiling_trace_write_while_recording", "[profiling]") {
+  auto path =
+      std::filesystem::temp_directory_path() / "xenia_profiling_trace.json";
+  auto old_path = cvars::profile_trace_path;
+  auto old_events_per_thread = cvars::profile_trace_events_per_thread;
+  cvars::profile_trace_path = path;
+  // Small enough for the ring to be overwritten while it's being written.
+  cvars::profile_trace_events_per_thread = 64;
+  TraceRecorder::Initialize();
+  REQUIRE(TraceRecorder::is_recording());
+
+  // Counters have no group name, so a counter event torn by a scope event
+  // overwriting it must not be written.
+  std::atomic<bool> stop = {false};
+  std::thread recording_thread([&stop]() {
+    while (!stop.load(std::memory_order_relaxed)) {
+      TraceRecorder::Counter("test/counter", 1);
+      TraceRecorder::Scope scope("test", "Scope");
+    }
+  });
+  for (uint32_t i = 0; i < 64; ++i) {
+    REQUIRE(TraceRecorder::Write(path));
+  }
+  stop.store(true, std::memory_order_relaxed);
+  recording_thread.join();
+  // Written after the thread has exited and its ring has been shrunk.
+  REQUIRE(TraceRecorder::Write(path));
+
+  TraceRecorder::Shutdown();
+  cvars::profile_trace_path = old_path;
+  cvars::profile_trace_events_per_thread = old_events_per_thread;
+
+  std::string trace;
+  {
+    std::ifstream file(path);
+    trace.assign(std::istreambuf_iterator<char>(file),
+                 std::istreambuf_iterator<char>());
+  }
+  std::filesystem::remove(path);
+  REQUIRE(trace.find("{\"name\":\"Scope\",\"cat\":\"test\",\"ph\":\"X\"") !=
+          std::string::npos);
+  REQUIRE(trace.find("{\"name\":\"test/counter\",\"ph\":\"C\"") !=
+          std::string::npos);
+}
+
+}  // namespace test
+}  // namespace base
+}  // namespace xe
@@ -7,8 +7,13 @@
 ******************************************************************************
 */
 
+#include <algorithm>
 #include <array>
+#include <ctime>
+#include <vector>
 
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/cvar.h"
 #include "xenia/base/threading.h"
 
 #define CATCH_CONFIG_ENABLE_CHRONO_STRINGMAKER
@@ -16,6 +21,8 @@
 
 #include "third_party/disruptorplus/include/disruptorplus/spin_wait.hpp"
 
+DECLARE_uint32(timer_slack);
+
 namespace xe {
 namespace base {
 namespace test {
@@ -890,6 +897,115 @@ TEST_CASE("Create and Trigger Timer Callbacks", "[timer]") {
   REQUIRE(true);
 }
 
+TEST_CASE("Timer Queue Due Times", "[timer]") {
+  // Timers due beyond the first level of the timing wheel must be cascaded
+  // down and must not fire early.
+  using clock = TimerQueueWaitItem::clock;
+  const std::chrono::milliseconds delays[] = {0ms, 5ms, 40ms, 300ms, 1200ms};
+  constexpr size_t kDelayCount = std::size(delays);
+  std::array<std::atomic<int64_t>, kDelayCount> lateness_us{};
+  std::array<std::weak_ptr<TimerQueueWaitItem>, kDelayCount> wait_items;
+  std::atomic<uint32_t> fired(0);
+  auto start = clock::now();
+  for (size_t i = 0; i < kDelayCount; ++i) {
+    lateness_us[i] = INT64_MIN;
+    auto due = start + delays[i];
+    wait_items[i] = QueueTimerOnce(
+        [&, i, due](void*) {
+          auto lateness = clock::now() - due;
+          lateness_us[i] =
+              std::chrono::duration_cast<std::chrono::microseconds>(lateness)
+                  .count();
+          ++fired;
+        },
+        nullptr, due);
+  }
+  // A disarmed timer must not fire.
+  std::atomic<bool> disarmed_fired(false);
+  auto disarmed_item = QueueTimerOnce(
+      [&](void*) { disarmed_fired = true; }, nullptr, start + 100ms);
+  if (auto wait_item = disarmed_item.lock()) {
+    wait_item->Disarm();
+  }
+  // Disarmed items are released right away rather than at their due time.
+  REQUIRE(disarmed_item.expired());
+
+  REQUIRE(spin_wait_for(5s, [&] { return fired == kDelayCount; }));
+  for (size_t i = 0; i < kDelayCount; ++i) {
+    INFO(i);
+    REQUIRE(lateness_us[i] >= 0);
+    REQUIRE(lateness_us[i] < 100000);
+  }
+  Sleep(150ms);
+  REQUIRE_FALSE(disarmed_fired);
+}
+
+// Disabled by default since it takes several seconds. Run the tests filtered
+// with the [benchmark] tag.
+TEST_CASE("Timer Queue Jitter", "[.benchmark]") {
+  using clock = TimerQueueWaitItem::clock;
+  const auto duration = 2s;
+  struct BenchmarkTimer {
+    clock::time_point due;
+    clock::duration interval;
+    std::vector<int64_t>* lateness_ns;
+  };
+  for (size_t timer_count : {size_t(256), size_t(4096)}) {
+    for (uint32_t slack : {uint32_t(0), uint32_t(50), uint32_t(500)}) {
+      auto old_slack = cvars::timer_slack;
+      cvars::timer_slack = slack;
+      // Only written by the timer thread until all timers are disarmed.
+      std::vector<int64_t> lateness_ns;
+      lateness_ns.reserve(size_t(1) << 24);
+      std::vector<BenchmarkTimer> timers(timer_count);
+      std::vector<std::weak_ptr<TimerQueueWaitItem>> wait_items;
+      wait_items.reserve(timer_count);
+      auto start = clock::now();
+      std::clock_t cpu_start = std::clock();
+      for (size_t i = 0; i < timer_count; ++i) {
+        BenchmarkTimer& timer = timers[i];
+        // 1 to 16.5 milliseconds, like guest frame and audio timers.
+        timer.interval = std::chrono::microseconds(1000 + (i % 32) * 500);
+        timer.due = start + timer.interval;
+        timer.lateness_ns = &lateness_ns;
+        wait_items.push_back(QueueTimerRecurring(
+            [](void* userdata) {
+              auto& timer = *static_cast<BenchmarkTimer*>(userdata);
+              timer.lateness_ns->push_back(
+                  std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      clock::now() - timer.due)
+                      .count());
+              timer.due += timer.interval;
+            },
+            &timer, timer.due, timer.interval));
+      }
+      Sleep(duration);
+      for (auto& wait_item_weak : wait_items) {
+        if (auto wait_item = wait_item_weak.lock()) {
+          wait_item->Disarm();
+        }
+      }
+      // Mostly the timer thread since this thread is sleeping.
+      double cpu_percent = 100.0 * double(std::clock() - cpu_start) /
+                           CLOCKS_PER_SEC /
+                           std::chrono::duration<double>(duration).count();
+      cvars::timer_slack = old_slack;
+
+      REQUIRE(!lateness_ns.empty());
+      std::sort(lateness_ns.begin(), lateness_ns.end());
+      auto percentile_us = [&](size_t percent) {
+        return double(lateness_ns[(lateness_ns.size() - 1) * percent / 100]) /
+               1000.0;
+      };
+      fmt::print(
+          "{} timers, {} us slack: {} expirations, lateness p50 {:.1f} us, "
+          "p99 {:.1f} us, max {:.1f} us, process CPU {:.1f}%\n",
+          timer_count, slack, lateness_ns.size(), percentile_us(50),
+          percentile_us(99), percentile_us(100), cpu_percent);
+    }
+  }
+}
+
 TEST_CASE("Set and Test Current Thread ID", "[thread]") {
   // System ID
   auto system_id = current_thread_system_id();
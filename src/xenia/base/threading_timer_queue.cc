@@ -8,18 +8,33 @@
  */
 
 #include <algorithm>
-#include <forward_list>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
-#include "third_party/disruptorplus/include/disruptorplus/multi_threaded_claim_strategy.hpp"
-#include "third_party/disruptorplus/include/disruptorplus/ring_buffer.hpp"
-#include "third_party/disruptorplus/include/disruptorplus/sequence_barrier.hpp"
 #include "third_party/disruptorplus/include/disruptorplus/spin_wait.hpp"
-#include "third_party/disruptorplus/include/disruptorplus/spin_wait_strategy.hpp"
 
 #include "xenia/base/assert.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/math.h"
+#include "xenia/base/platform.h"
 #include "xenia/base/threading.h"
 #include "xenia/base/threading_timer_queue.h"
 
+#if XE_PLATFORM_LINUX
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+DEFINE_uint32(timer_slack, 50,
+              "Time in microseconds by which host timer expirations may be "
+              "deferred to coalesce them with later ones into a single wakeup "
+              "of the timer thread. 0 to wake up at the exact due time of "
+              "every timer.",
+              "CPU");
+
 namespace dp = disruptorplus;
 
 namespace xe {
@@ -33,97 +48,55 @@ class TimerQueue {
   static_assert(clock::is_steady);
 
  public:
-  TimerQueue()
-      : buffer_(kWaitCount),
-        wait_strategy_(),
-        claim_strategy_(kWaitCount, wait_strategy_),
-        consumed_(wait_strategy_),
-        shutdown_(false) {
-    claim_strategy_.add_claim_barrier(consumed_);
+  TimerQueue() : epoch_(clock::now()) {
+#if XE_PLATFORM_LINUX
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    assert_true(timer_fd_ != -1);
+#endif
     dispatch_thread_ = std::thread(&TimerQueue::TimerThreadMain, this);
   }
 
   ~TimerQueue() {
-    shutdown_.store(true, std::memory_order_release);
-
-    // Kick dispatch thread to check shutdown flag
-    auto wait_item = std::make_shared<WaitItem>(nullptr, nullptr, this,
-                                                clock::time_point::min(),
-                                                clock::duration::zero());
-    wait_item->Disarm();
-    QueueTimer(std::move(wait_item));
-
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      shutdown_ = true;
+      // Kick dispatch thread to check shutdown flag
+      SetWakeup(clock::time_point::min());
+    }
     dispatch_thread_.join();
+
+    // Break the references the wheel holds to the remaining items.
+    std::vector<std::shared_ptr<WaitItem>> remaining;
+    for (uint32_t slot = 0; slot < kLevelCount * kSlotCount; ++slot) {
+      while (slots_[slot]) {
+        remaining.push_back(Unlink(slots_[slot]));
+      }
+    }
+#if XE_PLATFORM_LINUX
+    close(timer_fd_);
+#endif
   }
 
   void TimerThreadMain() {
-    dp::sequence_t next_sequence = 0;
-    const auto comp = [](const std::shared_ptr<WaitItem>& left,
-                         const std::shared_ptr<WaitItem>& right) {
-      return left->due_ < right->due_;
-    };
-
     xe::threading::set_name("xe::threading::TimerQueue");
 
-    while (!shutdown_.load(std::memory_order_relaxed)) {
-      {
-        // Consume new wait items and add them to sorted wait queue
-        dp::sequence_t available = claim_strategy_.wait_until_published(
-            next_sequence, next_sequence - 1,
-            wait_queue_.empty() ? clock::time_point::max()
-                                : wait_queue_.front()->due_);
-
-        // Check for timeout
-        if (available != next_sequence - 1) {
-          std::forward_list<std::shared_ptr<WaitItem>> wait_items;
-          do {
-            wait_items.push_front(std::move(buffer_[next_sequence]));
-          } while (next_sequence++ != available);
-
-          consumed_.publish(available);
-
-          wait_items.sort(comp);
-          wait_queue_.merge(wait_items, comp);
-        }
-      }
-
-      {
-        // Check wait queue, invoke callbacks and reschedule
-        std::forward_list<std::shared_ptr<WaitItem>> wait_items;
-        while (!wait_queue_.empty() &&
-               wait_queue_.front()->due_ <= clock::now()) {
-          auto wait_item = std::move(wait_queue_.front());
-          wait_queue_.pop_front();
-
-          // Ensure that it isn't disarmed
-          auto state = WaitItem::State::kIdle;
-          if (wait_item->state_.compare_exchange_strong(
-                  state, WaitItem::State::kInCallback,
-                  std::memory_order_acq_rel)) {
-            // Possibility to dispatch to a thread pool here
-            assert_not_null(wait_item->callback_);
-            wait_item->callback_(wait_item->userdata_);
-
-            if (wait_item->interval_ != clock::duration::zero() &&
-                wait_item->state_.load(std::memory_order_acquire) !=
-                    WaitItem::State::kInCallbackSelfDisarmed) {
-              // Item is recurring and didn't self-disarm during callback:
-              wait_item->due_ += wait_item->interval_;
-              wait_item->state_.store(WaitItem::State::kIdle,
-                                      std::memory_order_release);
-              wait_items.push_front(std::move(wait_item));
-            } else {
-              wait_item->state_.store(WaitItem::State::kDisarmed,
-                                      std::memory_order_release);
-            }
-          } else {
-            // Specifically, kInCallback is illegal here
-            assert_true(WaitItem::State::kDisarmed == state);
-          }
-        }
-        wait_items.sort(comp);
-        wait_queue_.merge(wait_items, comp);
+    std::vector<std::shared_ptr<WaitItem>> expired;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!shutdown_) {
+      Advance(clock::now(), expired);
+      if (!expired.empty()) {
+        // Callbacks may take long, so start over with the new time afterwards
+        // instead of waiting. Arming timers in the meantime doesn't need to
+        // reprogram the wakeup.
+        wakeup_ = clock::time_point::min();
+        lock.unlock();
+        Dispatch(expired);
+        expired.clear();
+        lock.lock();
+        continue;
       }
+      SetWakeup(AddSlack(NextDeadline()));
+      Wait(lock);
     }
   }
 
@@ -133,28 +106,335 @@ class TimerQueue {
     // Mitigate callback flooding
     wait_item->due_ =
         std::max(clock::now() - wait_item->interval_, wait_item->due_);
+    clock::time_point due = wait_item->due_;
 
-    auto sequence = claim_strategy_.claim_one();
-    buffer_[sequence] = std::move(wait_item);
-    claim_strategy_.publish(sequence);
+    std::lock_guard<std::mutex> lock(mutex_);
+    Insert(std::move(wait_item));
+    clock::time_point wakeup = AddSlack(due);
+    if (wakeup < wakeup_) {
+      SetWakeup(wakeup);
+    }
 
     return wait_item_weak;
   }
 
+  // Unlinks a disarmed item so it doesn't stay referenced by the wheel until
+  // its due time.
+  std::shared_ptr<WaitItem> Remove(WaitItem* wait_item) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (wait_item->wheel_slot_ == WaitItem::kNotInWheel) {
+      return nullptr;
+    }
+    return Unlink(wait_item);
+  }
+
   const std::thread& dispatch_thread() const { return dispatch_thread_; }
 
  private:
-  // This ring buffer will be used to introduce timers queued by the public API
-  static constexpr size_t kWaitCount = 512;
-  dp::ring_buffer<std::shared_ptr<WaitItem>> buffer_;
-  dp::spin_wait_strategy wait_strategy_;
-  dp::multi_threaded_claim_strategy<dp::spin_wait_strategy> claim_strategy_;
-  dp::sequence_barrier<dp::spin_wait_strategy> consumed_;
-
-  // This is a _sorted_ (ascending due_) list of active timers managed by a
-  // dedicated thread
-  std::forward_list<std::shared_ptr<WaitItem>> wait_queue_;
-  std::atomic_bool shutdown_;
+  // Level 0 of the wheel has a slot for each tick of the next 256, and every
+  // next level has slots covering 256 times more ticks, which are cascaded
+  // into the lower levels when the current tick reaches them. Slots contain
+  // unsorted lists, so arming and disarming are O(1), and the exact due times
+  // are only checked when a level 0 slot is reached.
+  static constexpr uint32_t kTickShift = 16;  // ~65.5 microseconds
+  static constexpr uint32_t kSlotBits = 8;
+  static constexpr uint32_t kSlotCount = 1 << kSlotBits;
+  static constexpr uint32_t kSlotMask = kSlotCount - 1;
+  static constexpr uint32_t kLevelCount = 4;  // ~3.3 days
+  static constexpr uint32_t kOccupancyWords = kSlotCount / 64;
+
+  uint64_t ToTick(clock::time_point time) const {
+    if (time <= epoch_) {
+      return 0;
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time -
+                                                                   epoch_);
+    return uint64_t(ns.count()) >> kTickShift;
+  }
+
+  clock::time_point FromTick(uint64_t tick) const {
+    return epoch_ + std::chrono::duration_cast<clock::duration>(
+                        std::chrono::nanoseconds(tick << kTickShift));
+  }
+
+  void Link(std::shared_ptr<WaitItem> wait_item, uint32_t slot) {
+    WaitItem* item = wait_item.get();
+    WaitItem* head = slots_[slot];
+    item->wheel_slot_ = slot;
+    item->wheel_prev_ = nullptr;
+    item->wheel_next_ = head;
+    if (head) {
+      head->wheel_prev_ = item;
+    }
+    slots_[slot] = item;
+    occupied_[slot / 64] |= uint64_t(1) << (slot & 63);
+    item->wheel_self_ = std::move(wait_item);
+  }
+
+  std::shared_ptr<WaitItem> Unlink(WaitItem* wait_item) {
+    uint32_t slot = wait_item->wheel_slot_;
+    assert_true(slot != WaitItem::kNotInWheel);
+    if (wait_item->wheel_prev_) {
+      wait_item->wheel_prev_->wheel_next_ = wait_item->wheel_next_;
+    } else {
+      slots_[slot] = wait_item->wheel_next_;
+      if (!slots_[slot]) {
+        occupied_[slot / 64] &= ~(uint64_t(1) << (slot & 63));
+      }
+    }
+    if (wait_item->wheel_next_) {
+      wait_item->wheel_next_->wheel_prev_ = wait_item->wheel_prev_;
+    }
+    wait_item->wheel_slot_ = WaitItem::kNotInWheel;
+    wait_item->wheel_prev_ = nullptr;
+    wait_item->wheel_next_ = nullptr;
+    return std::move(wait_item->wheel_self_);
+  }
+
+  void Insert(std::shared_ptr<WaitItem> wait_item) {
+    uint64_t tick = std::max(ToTick(wait_item->due_), current_tick_);
+    uint64_t delta = tick - current_tick_;
+    uint32_t level = 0;
+    while (level + 1 < kLevelCount &&
+           delta >= (uint64_t(1) << (kSlotBits * (level + 1)))) {
+      ++level;
+    }
+    uint64_t max_delta = (uint64_t(1) << (kSlotBits * kLevelCount)) - 1;
+    if (delta > max_delta) {
+      // Placed at the end of the wheel and reinserted when reached.
+      tick = current_tick_ + max_delta;
+    }
+    Link(std::move(wait_item),
+         level * kSlotCount +
+             (uint32_t(tick >> (kSlotBits * level)) & kSlotMask));
+  }
+
+  // Returns the circular distance from the start slot to the first occupied
+  // slot of the level, or kSlotCount if the level is empty.
+  uint32_t FindOccupiedSlot(uint32_t level, uint32_t start) const {
+    const uint64_t* occupied = occupied_ + level * kOccupancyWords;
+    for (uint32_t i = 0; i <= kOccupancyWords; ++i) {
+      uint32_t word_index = ((start >> 6) + i) % kOccupancyWords;
+      uint64_t word = occupied[word_index];
+      if (!i) {
+        word &= ~uint64_t(0) << (start & 63);
+      } else if (i == kOccupancyWords) {
+        word &= (uint64_t(1) << (start & 63)) - 1;
+      }
+      if (word) {
+        return ((word_index << 6) + xe::tzcnt(word) - start) & kSlotMask;
+      }
+    }
+    return kSlotCount;
+  }
+
+  // Returns the tick at which a level 1+ slot needs to be cascaded, or
+  // UINT64_MAX if the level is empty. The slot of the current block has
+  // already been cascaded, so it's reached again only after a full turn.
+  uint64_t NextCascadeTick(uint32_t level) const {
+    uint32_t shift = kSlotBits * level;
+    uint64_t block = current_tick_ >> shift;
+    uint32_t distance =
+        FindOccupiedSlot(level, uint32_t(block + 1) & kSlotMask);
+    if (distance >= kSlotCount) {
+      return UINT64_MAX;
+    }
+    return (block + 1 + distance) << shift;
+  }
+
+  // Returns the next tick after the current one that has level 0 timers or
+  // needs cascading.
+  uint64_t NextEventTick() const {
+    uint64_t next_tick = UINT64_MAX;
+    uint32_t distance =
+        FindOccupiedSlot(0, uint32_t(current_tick_ + 1) & kSlotMask);
+    if (distance < kSlotCount) {
+      next_tick = current_tick_ + 1 + distance;
+    }
+    for (uint32_t level = 1; level < kLevelCount; ++level) {
+      next_tick = std::min(next_tick, NextCascadeTick(level));
+    }
+    return next_tick;
+  }
+
+  clock::time_point NextDeadline() const {
+    clock::time_point deadline = clock::time_point::max();
+    uint32_t distance =
+        FindOccupiedSlot(0, uint32_t(current_tick_) & kSlotMask);
+    if (distance < kSlotCount) {
+      uint32_t slot = (uint32_t(current_tick_) + distance) & kSlotMask;
+      for (WaitItem* wait_item = slots_[slot]; wait_item;
+           wait_item = wait_item->wheel_next_) {
+        deadline = std::min(deadline, wait_item->due_);
+      }
+    }
+    for (uint32_t level = 1; level < kLevelCount; ++level) {
+      uint64_t cascade_tick = NextCascadeTick(level);
+      if (cascade_tick != UINT64_MAX) {
+        deadline = std::min(deadline, FromTick(cascade_tick));
+      }
+    }
+    return deadline;
+  }
+
+  void Cascade() {
+    for (uint32_t level = kLevelCount - 1; level; --level) {
+      uint32_t shift = kSlotBits * level;
+      if (current_tick_ & ((uint64_t(1) << shift) - 1)) {
+        continue;
+      }
+      uint32_t slot =
+          level * kSlotCount + (uint32_t(current_tick_ >> shift) & kSlotMask);
+      while (slots_[slot]) {
+        Insert(Unlink(slots_[slot]));
+      }
+    }
+  }
+
+  void ExpireCurrentSlot(clock::time_point now,
+                         std::vector<std::shared_ptr<WaitItem>>& expired) {
+    uint32_t slot = uint32_t(current_tick_) & kSlotMask;
+    // Detach the list first since the items not due yet may be put back into
+    // the same slot.
+    WaitItem* wait_item = slots_[slot];
+    std::vector<std::shared_ptr<WaitItem>> pending;
+    while (wait_item) {
+      WaitItem* next = wait_item->wheel_next_;
+      if (wait_item->due_ <= now) {
+        expired.push_back(Unlink(wait_item));
+      } else {
+        pending.push_back(Unlink(wait_item));
+      }
+      wait_item = next;
+    }
+    for (auto& pending_item : pending) {
+      Insert(std::move(pending_item));
+    }
+  }
+
+  // Moves the wheel to the current time, collecting the expired items.
+  void Advance(clock::time_point now,
+               std::vector<std::shared_ptr<WaitItem>>& expired) {
+    uint64_t now_tick = ToTick(now);
+    while (true) {
+      ExpireCurrentSlot(now, expired);
+      if (current_tick_ >= now_tick) {
+        break;
+      }
+      // Skip the ticks without anything to do.
+      current_tick_ = std::min(NextEventTick(), now_tick);
+      Cascade();
+    }
+  }
+
+  void Dispatch(std::vector<std::shared_ptr<WaitItem>>& expired) {
+    // Items coalesced into one wakeup may come from different slots.
+    std::stable_sort(expired.begin(), expired.end(),
+                     [](const std::shared_ptr<WaitItem>& left,
+                        const std::shared_ptr<WaitItem>& right) {
+                       return left->due_ < right->due_;
+                     });
+    for (auto& wait_item : expired) {
+      // Ensure that it isn't disarmed
+      auto state = WaitItem::State::kIdle;
+      if (wait_item->state_.compare_exchange_strong(
+              state, WaitItem::State::kInCallback,
+              std::memory_order_acq_rel)) {
+        // Possibility to dispatch to a thread pool here
+        assert_not_null(wait_item->callback_);
+        wait_item->callback_(wait_item->userdata_);
+
+        if (wait_item->interval_ != clock::duration::zero() &&
+            wait_item->state_.load(std::memory_order_acquire) !=
+                WaitItem::State::kInCallbackSelfDisarmed) {
+          // Item is recurring and didn't self-disarm during callback. It's
+          // put back into the wheel before becoming idle, so a concurrent
+          // Disarm() finds and removes it.
+          wait_item->due_ += wait_item->interval_;
+          WaitItem* wait_item_ptr = wait_item.get();
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Insert(std::move(wait_item));
+          }
+          wait_item_ptr->state_.store(WaitItem::State::kIdle,
+                                      std::memory_order_release);
+        } else {
+          wait_item->state_.store(WaitItem::State::kDisarmed,
+                                  std::memory_order_release);
+        }
+      } else {
+        // Specifically, kInCallback is illegal here
+        assert_true(WaitItem::State::kDisarmed == state);
+      }
+    }
+  }
+
+  // The wakeup for a timer is delayed by the slack, so the ones expiring
+  // shortly after it are handled by the same wakeup.
+  static clock::time_point AddSlack(clock::time_point time) {
+    auto slack = std::chrono::microseconds(cvars::timer_slack);
+    if (time >= clock::time_point::max() - slack) {
+      return clock::time_point::max();
+    }
+    return time + slack;
+  }
+
+  // The wakeup is programmed while holding the lock, either by the dispatch
+  // thread or by threads arming timers due before the current wakeup.
+  void SetWakeup(clock::time_point wakeup) {
+    wakeup_ = wakeup;
+#if XE_PLATFORM_LINUX
+    itimerspec spec = {};
+    if (wakeup != clock::time_point::max()) {
+      int64_t ns = std::max(
+          int64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      wakeup.time_since_epoch())
+                      .count()),
+          int64_t(1));
+      spec.it_value.tv_sec = time_t(ns / 1000000000);
+      spec.it_value.tv_nsec = long(ns % 1000000000);
+    }
+    // Zero it_value disarms the timer when there's nothing to wait for.
+    timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+#else
+    wakeup_cv_.notify_one();
+#endif
+  }
+
+  void Wait(std::unique_lock<std::mutex>& lock) {
+#if XE_PLATFORM_LINUX
+    // The timerfd is the only wakeup source, reprogrammed directly when an
+    // earlier timer is armed or on shutdown.
+    lock.unlock();
+    uint64_t expirations;
+    while (read(timer_fd_, &expirations, sizeof(expirations)) < 0 &&
+           errno == EINTR) {
+    }
+    lock.lock();
+#else
+    if (wakeup_ == clock::time_point::max()) {
+      wakeup_cv_.wait(lock);
+    } else {
+      wakeup_cv_.wait_until(lock, wakeup_);
+    }
+#endif
+  }
+
+  const clock::time_point epoch_;
+
+  std::mutex mutex_;
+  // Protected by mutex_.
+  uint64_t current_tick_ = 0;
+  WaitItem* slots_[kLevelCount * kSlotCount] = {};
+  uint64_t occupied_[kLevelCount * kOccupancyWords] = {};
+  clock::time_point wakeup_ = clock::time_point::max();
+  bool shutdown_ = false;
+
+#if XE_PLATFORM_LINUX
+  int timer_fd_ = -1;
+#else
+  std::condition_variable wakeup_cv_;
+#endif
   std::thread dispatch_thread_;
 };
 
@@ -187,11 +467,14 @@ void TimerQueueWaitItem::Disarm() {
     if (state == State::kDisarmed) {
       // Do not break for kInCallbackSelfDisarmed and keep spinning in order to
       // meet guarantees
-      break;
+      return;
     }
     state = State::kIdle;
     spinner.spin_once();
   }
+  // Release the reference held by the wheel (after unlocking, as the item may
+  // be destroyed along with it).
+  parent_queue_->Remove(this);
 }
 
 std::weak_ptr<WaitItem> QueueTimerOnce(std::function<void(void*)> callback,
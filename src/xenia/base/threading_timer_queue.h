@@ -12,11 +12,17 @@
 
 #include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <functional>
 #include <memory>
 
 // This is a platform independent implementation of a timer queue similar to
 // Windows CreateTimerQueueTimer with WT_EXECUTEINTIMERTHREAD.
+//
+// Pending timers are kept in a hierarchical timing wheel, so arming and
+// disarming them doesn't depend on the number of timers. Expirations within
+// the timer_slack window are coalesced into a single wakeup of the dispatch
+// thread.
 
 namespace xe::threading {
 
@@ -61,6 +67,14 @@ struct TimerQueueWaitItem {
   clock::time_point due_;
   clock::duration interval_;  // zero if not recurring
   std::atomic<State> state_;
+
+  // Timing wheel slot links, protected by the parent queue's lock. While
+  // linked, the wheel holds a reference to the item through wheel_self_.
+  static constexpr uint32_t kNotInWheel = UINT32_MAX;
+  uint32_t wheel_slot_ = kNotInWheel;
+  TimerQueueWaitItem* wheel_prev_ = nullptr;
+  TimerQueueWaitItem* wheel_next_ = nullptr;
+  std::shared_ptr<TimerQueueWaitItem> wheel_self_;
 };
 
 std::weak_ptr<TimerQueueWaitItem> QueueTimerOnce(
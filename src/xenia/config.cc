@@ -86,6 +86,7 @@ void ReadConfig(const std::filesystem::path& file_path,
   if (update_if_no_version_stored || config_defaults_date) {
     cvar::IConfigVarUpdate::ApplyUpdates(config_defaults_date);
   }
+  xe::UpdateLoggingConfig();
   XELOGI("Loaded config: {}", xe::path_to_utf8(file_path));
 }
 
@@ -101,6 +102,7 @@ void ReadGameConfig(const std::filesystem::path& file_path) {
       config_var->LoadGameConfigValue(config->get_qualified(config_key));
     }
   }
+  xe::UpdateLoggingConfig();
   XELOGI("Loaded game config: {}", xe::path_to_utf8(file_path));
 }
 
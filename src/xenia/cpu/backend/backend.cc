@@ -11,6 +11,8 @@
 
 #include <cstring>
 
+#include "xenia/cpu/processor.h"
+
 namespace xe {
 namespace cpu {
 namespace backend {
@@ -27,6 +29,10 @@ void* Backend::AllocThreadData() { return nullptr; }
 
 void Backend::FreeThreadData(void* thread_data) {}
 
+bool Backend::RetranslateFunction(GuestFunction* function) {
+  return processor_->TranslateFunction(function);
+}
+
 }  // namespace backend
 }  // namespace cpu
 }  // namespace xe
@@ -11,6 +11,7 @@
 #define XENIA_CPU_BACKEND_BACKEND_H_
 
 #include <memory>
+#include <vector>
 
 #include "xenia/cpu/backend/machine_info.h"
 #include "xenia/cpu/thread_debug_info.h"
@@ -60,6 +61,17 @@ class Backend {
   virtual uint64_t CalculateNextHostInstruction(ThreadDebugInfo* thread_info,
                                                 uint64_t current_pc) = 0;
 
+  // Translates an already defined guest function again, such as when
+  // assumptions made while translating it no longer hold. Code already
+  // running in the old version keeps running until it returns.
+  virtual bool RetranslateFunction(GuestFunction* function);
+  // Makes code calling the functions resolve them again instead of entering
+  // their current translations, called before their guest code is translated
+  // again. If their guest code has been unloaded, the memory of the
+  // translations may be reused.
+  virtual void InvalidateFunctions(const std::vector<GuestFunction*>& functions,
+                                   bool unloaded) {}
+
   virtual void InstallBreakpoint(Breakpoint* breakpoint) {}
   virtual void InstallBreakpoint(Breakpoint* breakpoint, Function* fn) {}
   virtual void UninstallBreakpoint(Breakpoint* breakpoint) {}
@@ -10,6 +10,7 @@
 #include "xenia/cpu/backend/x64/x64_assembler.h"
 
 #include <climits>
+#include <vector>
 
 #include "third_party/capstone/include/capstone/capstone.h"
 #include "third_party/capstone/include/capstone/x86.h"
@@ -76,22 +77,25 @@ bool X64Assembler::Assemble(GuestFunction* function, HIRBuilder* builder,
   xe::make_reset_scope(this);
 
   // Lower HIR -> x64.
+  // When retranslating, the previous source map still describes the current
+  // machine code until the new code is set up.
   void* machine_code = nullptr;
   size_t code_size = 0;
+  std::vector<SourceMapEntry> source_map;
   if (!emitter_->Emit(function, builder, debug_info_flags, debug_info.get(),
-                      &machine_code, &code_size, &function->source_map())) {
+                      &machine_code, &code_size, &source_map)) {
     return false;
   }
 
   // Stash generated machine code.
   if (debug_info_flags & DebugInfoFlags::kDebugInfoDisasmMachineCode) {
-    DumpMachineCode(machine_code, code_size, function->source_map(),
-                    &string_buffer_);
+    DumpMachineCode(machine_code, code_size, source_map, &string_buffer_);
     debug_info->set_machine_code_disasm(xe_strdup(string_buffer_.buffer()));
     string_buffer_.Reset();
   }
 
   function->set_debug_info(std::move(debug_info));
+  function->source_map() = std::move(source_map);
   static_cast<X64Function*>(function)->Setup(
       reinterpret_cast<uint8_t*>(machine_code), code_size);
 
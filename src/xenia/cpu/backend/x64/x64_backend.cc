@@ -11,11 +11,17 @@
 
 #include <stddef.h>
 
+#include <algorithm>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
 #include "third_party/capstone/include/capstone/capstone.h"
 #include "third_party/capstone/include/capstone/x86.h"
 
 #include "xenia/base/exception_handler.h"
 #include "xenia/base/logging.h"
+#include "xenia/base/math.h"
 #include "xenia/cpu/backend/x64/x64_assembler.h"
 #include "xenia/cpu/backend/x64/x64_code_cache.h"
 #include "xenia/cpu/backend/x64/x64_emitter.h"
@@ -23,6 +29,8 @@
 #include "xenia/cpu/backend/x64/x64_sequences.h"
 #include "xenia/cpu/backend/x64/x64_stack_layout.h"
 #include "xenia/cpu/breakpoint.h"
+#include "xenia/cpu/mmio_handler.h"
+#include "xenia/cpu/ppc/ppc_frontend.h"
 #include "xenia/cpu/processor.h"
 #include "xenia/cpu/stack_walker.h"
 
@@ -45,6 +53,16 @@ DEFINE_int32(x64_extension_mask, -1,
              " 4096 = AVX512VBMI\n"
              "   -1 = Detect and utilize all possible processor features\n",
              "x64");
+DEFINE_uint32(mmio_recompile_fault_threshold, 64,
+              "Number of times a load or store in guest code may fault on an "
+              "MMIO range before its function is recompiled to call the MMIO "
+              "handlers directly at that instruction (0 to never recompile).",
+              "x64");
+DEFINE_uint32(indirect_branch_cache_size, 2,
+              "Number of the most frequent targets of each indirect call in "
+              "guest code compared against at the call site to call them "
+              "directly, up to 4 (0 to always use the indirection table).",
+              "x64");
 
 namespace xe {
 namespace cpu {
@@ -79,10 +97,22 @@ X64Backend::X64Backend() : Backend(), code_cache_(nullptr) {
 }
 
 X64Backend::~X64Backend() {
+  DumpIndirectBranchStatistics();
+  DumpCodeCacheStatistics();
+
   if (capstone_handle_) {
     cs_close(&capstone_handle_);
   }
 
+  if (auto mmio_handler = MMIOHandler::global_handler()) {
+    mmio_handler->SetAccessSiteCallback(nullptr, nullptr, 0);
+  }
+  if (mmio_access_site_thread_) {
+    mmio_access_site_shutdown_event_->Set();
+    xe::threading::Wait(mmio_access_site_thread_.get(), false);
+    mmio_access_site_thread_.reset();
+  }
+
   X64Emitter::FreeConstData(emitter_data_);
   ExceptionHandler::Uninstall(&ExceptionCallbackThunk, this);
 }
@@ -147,6 +177,27 @@ bool X64Backend::Initialize(Processor* processor) {
   // Setup exception callback
   ExceptionHandler::Install(&ExceptionCallbackThunk, this);
 
+  // Get guest code repeatedly accessing MMIO through the access violation
+  // handler recompiled.
+  if (auto mmio_handler = MMIOHandler::global_handler()) {
+    mmio_access_site_event_ = xe::threading::Event::CreateAutoResetEvent(false);
+    mmio_access_site_shutdown_event_ =
+        xe::threading::Event::CreateManualResetEvent(false);
+    if (!mmio_access_site_event_ || !mmio_access_site_shutdown_event_) {
+      return false;
+    }
+    xe::threading::Thread::CreationParameters thread_params;
+    thread_params.stack_size = 256 * 1024;
+    mmio_access_site_thread_ = xe::threading::Thread::Create(
+        thread_params, [this]() { MMIOAccessSiteThreadMain(); });
+    if (!mmio_access_site_thread_) {
+      return false;
+    }
+    mmio_access_site_thread_->set_name("MMIO Access Site Recompiler");
+    mmio_handler->SetAccessSiteCallback(MMIOAccessSiteCallbackThunk, this,
+                                        cvars::mmio_recompile_fault_threshold);
+  }
+
   return true;
 }
 
@@ -387,6 +438,337 @@ void X64Backend::UninstallBreakpoint(Breakpoint* breakpoint) {
   breakpoint->backend_data().clear();
 }
 
+const MMIORange* X64Backend::LookupMMIOAccessSite(uint32_t guest_address) {
+  std::lock_guard<std::mutex> lock(mmio_access_sites_mutex_);
+  auto it = mmio_access_sites_.find(guest_address);
+  return it != mmio_access_sites_.end() ? it->second : nullptr;
+}
+
+void X64Backend::MMIOAccessSiteCallbackThunk(void* context, uint64_t host_pc,
+                                             const MMIORange* range) {
+  reinterpret_cast<X64Backend*>(context)->OnMMIOAccessSiteFault(host_pc,
+                                                                range);
+}
+
+void X64Backend::OnMMIOAccessSiteFault(uint64_t host_pc,
+                                       const MMIORange* range) {
+  // Called from the exception handler while the faulting thread is stopped in
+  // the middle of guest code, and other threads may be running the function
+  // too - only queue the site, translating here isn't safe.
+  {
+    std::lock_guard<std::mutex> lock(mmio_access_sites_mutex_);
+    mmio_access_site_faults_.emplace_back(host_pc, range);
+  }
+  mmio_access_site_event_->Set();
+}
+
+void X64Backend::MMIOAccessSiteThreadMain() {
+  xe::threading::WaitHandle* wait_handles[] = {
+      mmio_access_site_event_.get(),
+      mmio_access_site_shutdown_event_.get(),
+  };
+  std::vector<std::pair<uint64_t, const MMIORange*>> faults;
+  while (true) {
+    auto result = xe::threading::WaitAny(wait_handles,
+                                         xe::countof(wait_handles), false);
+    if (result.first != xe::threading::WaitResult::kSuccess ||
+        result.second != 0) {
+      break;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mmio_access_sites_mutex_);
+      faults.swap(mmio_access_site_faults_);
+    }
+    for (const auto& fault : faults) {
+      RetranslateMMIOAccessSite(fault.first, fault.second);
+    }
+    faults.clear();
+  }
+}
+
+void X64Backend::RetranslateMMIOAccessSite(uint64_t host_pc,
+                                           const MMIORange* range) {
+  // The machine code and the source map of the function are replaced while
+  // retranslating, keep them from changing until it's done.
+  auto global_lock = global_critical_region_.Acquire();
+  GuestFunction* function = code_cache_->LookupFunction(host_pc);
+  if (!function) {
+    return;
+  }
+  uint8_t* old_machine_code = function->machine_code();
+  if (host_pc < uint64_t(old_machine_code) ||
+      host_pc >= uint64_t(old_machine_code) + function->machine_code_length()) {
+    // Code from before the function was recompiled, which may still be running
+    // in a loop, but won't be entered again.
+    return;
+  }
+  uint32_t guest_address = function->MapMachineCodeToGuestAddress(host_pc);
+  {
+    std::lock_guard<std::mutex> sites_lock(mmio_access_sites_mutex_);
+    if (!mmio_access_sites_.emplace(guest_address, range).second) {
+      return;
+    }
+  }
+
+  XELOGD("Recompiling {:08X} for MMIO access to {:08X} at {:08X}",
+         function->address(), range->address, guest_address);
+  if (!RetranslateFunction(function)) {
+    XELOGE("Failed to recompile {:08X} for MMIO access", function->address());
+  }
+}
+
+IndirectBranchSite* X64Backend::GetIndirectBranchSite(
+    GuestFunction* function, uint32_t guest_address,
+    GuestFunction** out_cached_targets, uint32_t* out_cached_target_count) {
+  *out_cached_target_count = 0;
+  if (!cvars::indirect_branch_cache_size) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(indirect_branch_sites_mutex_);
+  auto& site = indirect_branch_sites_[std::make_pair(
+      function, guest_address - function->address())];
+  if (!site) {
+    site = std::make_unique<IndirectBranchSite>();
+    site->backend = this;
+    site->function = function;
+    site->guest_address = guest_address;
+  }
+  std::copy_n(site->cached_targets, site->cached_target_count,
+              out_cached_targets);
+  *out_cached_target_count = site->cached_target_count;
+  return site.get();
+}
+
+void X64Backend::IndirectBranchMissThunk(void* raw_context, uint64_t site_ptr,
+                                         uint64_t target_address) {
+  auto site = reinterpret_cast<IndirectBranchSite*>(site_ptr);
+  site->backend->OnIndirectBranchMiss(site, uint32_t(target_address));
+}
+
+void X64Backend::OnIndirectBranchMiss(IndirectBranchSite* site,
+                                      uint32_t target_address) {
+  uint32_t target_addresses[IndirectBranchSite::kMaxCachedTargets];
+  uint32_t target_count = 0;
+  {
+    std::lock_guard<std::mutex> lock(indirect_branch_sites_mutex_);
+    if (site->recompile_count >= IndirectBranchSite::kMaxRecompiles) {
+      return;
+    }
+    uint32_t i = 0;
+    while (i < site->seen_target_count &&
+           site->seen_targets[i] != target_address) {
+      ++i;
+    }
+    if (i < site->seen_target_count) {
+      ++site->seen_counts[i];
+    } else if (i < IndirectBranchSite::kMaxSeenTargets) {
+      site->seen_targets[i] = target_address;
+      site->seen_counts[i] = 1;
+      ++site->seen_target_count;
+    }
+    if (++site->sample_count < IndirectBranchSite::kSamplesPerRecompile) {
+      return;
+    }
+
+    // Estimate the number of calls to each target, both cached and missed,
+    // and keep the most frequent ones.
+    std::vector<std::pair<uint64_t, uint32_t>> candidates;
+    for (i = 0; i < site->cached_target_count; ++i) {
+      candidates.emplace_back(site->hit_counts[i],
+                              site->cached_targets[i]->address());
+    }
+    for (i = 0; i < site->seen_target_count; ++i) {
+      candidates.emplace_back(
+          uint64_t(site->seen_counts[i]) *
+              IndirectBranchSite::kMissSampleInterval,
+          site->seen_targets[i]);
+    }
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const auto& a, const auto& b) {
+                       return a.first > b.first;
+                     });
+    uint32_t max_target_count =
+        std::min(uint32_t(cvars::indirect_branch_cache_size),
+                 IndirectBranchSite::kMaxCachedTargets);
+    bool targets_changed = false;
+    for (const auto& candidate : candidates) {
+      if (target_count >= max_target_count || !candidate.first) {
+        break;
+      }
+      target_addresses[target_count++] = candidate.second;
+      if (std::none_of(site->cached_targets,
+                       site->cached_targets + site->cached_target_count,
+                       [&candidate](const GuestFunction* target) {
+                         return target->address() == candidate.second;
+                       })) {
+        targets_changed = true;
+      }
+    }
+    if (target_count != site->cached_target_count) {
+      targets_changed = true;
+    }
+    site->sample_count = 0;
+    site->seen_target_count = 0;
+    if (!targets_changed) {
+      return;
+    }
+    ++site->recompile_count;
+  }
+
+  // Targets missed have been called, so resolving them doesn't translate
+  // anything in most cases.
+  GuestFunction* targets[IndirectBranchSite::kMaxCachedTargets];
+  uint32_t resolved_count = 0;
+  for (uint32_t i = 0; i < target_count; ++i) {
+    Function* target = processor()->ResolveFunction(target_addresses[i]);
+    if (target && target->is_guest()) {
+      targets[resolved_count++] = static_cast<GuestFunction*>(target);
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(indirect_branch_sites_mutex_);
+    for (uint32_t i = 0; i < site->cached_target_count; ++i) {
+      site->previous_hit_count += site->hit_counts[i];
+      site->hit_counts[i] = 0;
+    }
+    std::copy_n(targets, resolved_count, site->cached_targets);
+    site->cached_target_count = resolved_count;
+  }
+
+  XELOGD("Recompiling {:08X} to cache {} targets of the indirect call at "
+         "{:08X}",
+         site->function->address(), resolved_count, site->guest_address);
+  if (!RetranslateFunction(site->function)) {
+    XELOGE("Failed to recompile {:08X} for indirect call target caching",
+           site->function->address());
+  }
+}
+
+void X64Backend::DumpIndirectBranchStatistics() {
+  std::lock_guard<std::mutex> lock(indirect_branch_sites_mutex_);
+  struct SiteCounts {
+    const IndirectBranchSite* site;
+    uint64_t call_count;
+    uint64_t hit_count;
+  };
+  std::vector<SiteCounts> sites;
+  uint64_t total_call_count = 0;
+  uint64_t total_hit_count = 0;
+  for (const auto& it : indirect_branch_sites_) {
+    const IndirectBranchSite* site = it.second.get();
+    uint64_t hit_count = site->previous_hit_count;
+    for (uint32_t i = 0; i < site->cached_target_count; ++i) {
+      hit_count += site->hit_counts[i];
+    }
+    uint64_t call_count =
+        hit_count + site->miss_count.load(std::memory_order_relaxed);
+    if (!call_count) {
+      continue;
+    }
+    sites.push_back({site, call_count, hit_count});
+    total_call_count += call_count;
+    total_hit_count += hit_count;
+  }
+  if (!total_call_count) {
+    return;
+  }
+  XELOGI("Indirect calls: {} from {} sites, {:.2f}% hitting target caches",
+         total_call_count, sites.size(),
+         double(total_hit_count) * 100.0 / double(total_call_count));
+  size_t count = std::min(sites.size(), size_t(16));
+  std::partial_sort(sites.begin(), sites.begin() + count, sites.end(),
+                    [](const SiteCounts& a, const SiteCounts& b) {
+                      return a.call_count > b.call_count;
+                    });
+  for (size_t i = 0; i < count; ++i) {
+    const SiteCounts& site = sites[i];
+    XELOGI("  {:08X} {:>12} calls {:>6.2f}% hit {} targets cached",
+           site.site->guest_address, site.call_count,
+           double(site.hit_count) * 100.0 / double(site.call_count),
+           site.site->cached_target_count);
+  }
+}
+
+bool X64Backend::RetranslateFunction(GuestFunction* function) {
+  auto global_lock = global_critical_region_.Acquire();
+  uint8_t* old_machine_code = function->machine_code();
+  if (!Backend::RetranslateFunction(function)) {
+    return false;
+  }
+  // The new code is already in the indirection table, but direct calls made
+  // by already compiled code still go to the old one.
+  if (old_machine_code) {
+    code_cache_->RedirectGuestCode(old_machine_code, function->machine_code());
+    code_cache_->RetireCode(old_machine_code);
+  }
+  return true;
+}
+
+void X64Backend::InvalidateFunctions(
+    const std::vector<GuestFunction*>& functions, bool unloaded) {
+  auto global_lock = global_critical_region_.Acquire();
+  for (GuestFunction* function : functions) {
+    code_cache_->RemoveIndirection(function->address());
+    // Direct calls, cached indirect call targets and older translations
+    // redirected to this one all go through the indirection table now, which
+    // translates the function again, as its entry has been removed.
+    uint8_t* machine_code = function->machine_code();
+    if (machine_code &&
+        code_cache_->RedirectGuestCode(
+            machine_code,
+            code_cache_->PlaceIndirectionStub(function->address()))) {
+      code_cache_->RetireCode(machine_code);
+    }
+  }
+  if (unloaded) {
+    code_cache_->ReclaimRetiredCode(functions);
+  }
+
+  // Don't cache the functions at indirect calls anymore, and start sampling
+  // the indirect calls in them again, as they may call different targets.
+  // The sites are kept as old code may still refer to them.
+  std::unordered_set<GuestFunction*> function_set(functions.begin(),
+                                                  functions.end());
+  std::lock_guard<std::mutex> sites_lock(indirect_branch_sites_mutex_);
+  for (auto& it : indirect_branch_sites_) {
+    IndirectBranchSite* site = it.second.get();
+    bool site_invalidated = function_set.count(site->function) != 0;
+    if (!site_invalidated &&
+        std::none_of(site->cached_targets,
+                     site->cached_targets + site->cached_target_count,
+                     [&function_set](GuestFunction* target) {
+                       return function_set.count(target) != 0;
+                     })) {
+      continue;
+    }
+    uint32_t target_count = 0;
+    for (uint32_t i = 0; i < site->cached_target_count; ++i) {
+      site->previous_hit_count += site->hit_counts[i];
+      site->hit_counts[i] = 0;
+      if (!site_invalidated && !function_set.count(site->cached_targets[i])) {
+        site->cached_targets[target_count++] = site->cached_targets[i];
+      }
+    }
+    site->cached_target_count = target_count;
+    if (site_invalidated) {
+      site->sample_count = 0;
+      site->seen_target_count = 0;
+      site->recompile_count = 0;
+    }
+  }
+}
+
+void X64Backend::DumpCodeCacheStatistics() {
+  if (!code_cache_) {
+    return;
+  }
+  X64CodeCache::Statistics statistics = code_cache_->QueryStatistics();
+  XELOGI(
+      "Code cache: {} bytes of live code, {} of dead code, {} free, {} of data",
+      statistics.live_code_bytes, statistics.dead_code_bytes,
+      statistics.free_code_bytes, statistics.data_bytes);
+}
+
 bool X64Backend::ExceptionCallbackThunk(Exception* ex, void* data) {
   auto backend = reinterpret_cast<X64Backend*>(data);
   return backend->ExceptionCallback(ex);
@@ -10,16 +10,31 @@
 #ifndef XENIA_CPU_BACKEND_X64_X64_BACKEND_H_
 #define XENIA_CPU_BACKEND_X64_X64_BACKEND_H_
 
+#include <atomic>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "xenia/base/cvar.h"
+#include "xenia/base/mutex.h"
+#include "xenia/base/threading.h"
 #include "xenia/cpu/backend/backend.h"
 
 DECLARE_int32(x64_extension_mask);
+DECLARE_uint32(indirect_branch_cache_size);
 
 namespace xe {
 class Exception;
 }  // namespace xe
+namespace xe {
+namespace cpu {
+struct MMIORange;
+}  // namespace cpu
+}  // namespace xe
+
 namespace xe {
 namespace cpu {
 namespace backend {
@@ -31,6 +46,45 @@ typedef void* (*HostToGuestThunk)(void* target, void* arg0, void* arg1);
 typedef void* (*GuestToHostThunk)(void* target, void* arg0, void* arg1);
 typedef void (*ResolveFunctionThunk)();
 
+class X64Backend;
+
+// Indirect call in guest code, along with the targets it has been seen
+// calling. The most frequent ones are compared against inline at the call
+// site the next time its function is translated, calling their code directly
+// instead of going through the indirection table.
+struct IndirectBranchSite {
+  static constexpr uint32_t kMaxCachedTargets = 4;
+  static constexpr uint32_t kMaxSeenTargets = 8;
+  // The target is passed to the backend once every this many misses, must be
+  // a power of two.
+  static constexpr uint32_t kMissSampleInterval = 256;
+  static constexpr uint32_t kSamplesPerRecompile = 32;
+  static constexpr uint32_t kMaxRecompiles = 2;
+
+  X64Backend* backend;
+  GuestFunction* function;
+  uint32_t guest_address;
+
+  // Incremented by the generated code. The hits are counted for each cached
+  // target since the targets have last been chosen, without synchronization,
+  // as they're only estimates. The misses are counted atomically, as every
+  // kMissSampleInterval-th one, on any thread, is sampled.
+  uint64_t hit_counts[kMaxCachedTargets] = {};
+  std::atomic<uint64_t> miss_count = {0};
+
+  // Guarded by the mutex of the backend from here on.
+  uint32_t cached_target_count = 0;
+  GuestFunction* cached_targets[kMaxCachedTargets];
+  // Hits before the targets have last been chosen.
+  uint64_t previous_hit_count = 0;
+  // Sampled since the targets have last been chosen.
+  uint32_t sample_count = 0;
+  uint32_t seen_target_count = 0;
+  uint32_t seen_targets[kMaxSeenTargets];
+  uint32_t seen_counts[kMaxSeenTargets];
+  uint32_t recompile_count = 0;
+};
+
 class X64Backend : public Backend {
  public:
   static const uint32_t kForceReturnAddress = 0x9FFF0000u;
@@ -63,13 +117,44 @@ class X64Backend : public Backend {
                                         uint64_t current_pc) override;
 
   void InstallBreakpoint(Breakpoint* breakpoint) override;
+  bool RetranslateFunction(GuestFunction* function) override;
+  void InvalidateFunctions(const std::vector<GuestFunction*>& functions,
+                           bool unloaded) override;
+
   void InstallBreakpoint(Breakpoint* breakpoint, Function* fn) override;
   void UninstallBreakpoint(Breakpoint* breakpoint) override;
 
+  // Returns the range if the load or store at the guest address has been seen
+  // accessing MMIO through the access violation handler.
+  const MMIORange* LookupMMIOAccessSite(uint32_t guest_address);
+
+  // Returns the indirect call at the guest address in the function, creating
+  // it if needed, along with the targets to compare against at the call site,
+  // or null if indirect call target caching is disabled.
+  IndirectBranchSite* GetIndirectBranchSite(
+      GuestFunction* function, uint32_t guest_address,
+      GuestFunction** out_cached_targets, uint32_t* out_cached_target_count);
+  // Called by the generated code on a sampled miss.
+  static void IndirectBranchMissThunk(void* raw_context, uint64_t site_ptr,
+                                      uint64_t target_address);
+
  private:
   static bool ExceptionCallbackThunk(Exception* ex, void* data);
   bool ExceptionCallback(Exception* ex);
 
+  static void MMIOAccessSiteCallbackThunk(void* context, uint64_t host_pc,
+                                          const MMIORange* range);
+  void OnMMIOAccessSiteFault(uint64_t host_pc, const MMIORange* range);
+  // Retranslates the functions containing the access sites queued by
+  // OnMMIOAccessSiteFault, outside the exception handler.
+  void MMIOAccessSiteThreadMain();
+  void RetranslateMMIOAccessSite(uint64_t host_pc, const MMIORange* range);
+
+  void OnIndirectBranchMiss(IndirectBranchSite* site, uint32_t target_address);
+  // Logs how many indirect calls have hit the inline target caches.
+  void DumpIndirectBranchStatistics();
+  void DumpCodeCacheStatistics();
+
   uintptr_t capstone_handle_ = 0;
 
   std::unique_ptr<X64CodeCache> code_cache_;
@@ -78,6 +163,26 @@ class X64Backend : public Backend {
   HostToGuestThunk host_to_guest_thunk_;
   GuestToHostThunk guest_to_host_thunk_;
   ResolveFunctionThunk resolve_function_thunk_;
+
+  // Held while retranslating or invalidating functions. Memory protection
+  // changes invalidate functions with the global critical region already
+  // held, and translating takes it too, so no separate lock is used to avoid
+  // acquiring them in a different order.
+  xe::global_critical_region global_critical_region_;
+  std::mutex mmio_access_sites_mutex_;
+  std::unordered_map<uint32_t, const MMIORange*> mmio_access_sites_;
+  // Host code addresses that have been faulting on MMIO, queued by the
+  // exception handler, guarded by mmio_access_sites_mutex_.
+  std::vector<std::pair<uint64_t, const MMIORange*>> mmio_access_site_faults_;
+  std::unique_ptr<xe::threading::Event> mmio_access_site_event_;
+  std::unique_ptr<xe::threading::Event> mmio_access_site_shutdown_event_;
+  std::unique_ptr<xe::threading::Thread> mmio_access_site_thread_;
+  std::mutex indirect_branch_sites_mutex_;
+  // Keyed by the function and the offset of the call in it, as the same guest
+  // code may be in multiple functions, or in different ones over time.
+  std::map<std::pair<const GuestFunction*, uint32_t>,
+           std::unique_ptr<IndirectBranchSite>>
+      indirect_branch_sites_;
 };
 
 }  // namespace x64
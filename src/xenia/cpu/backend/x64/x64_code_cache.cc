@@ -9,8 +9,10 @@
 
 #include "xenia/cpu/backend/x64/x64_code_cache.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <iterator>
 
 #if ENABLE_VTUNE
 #include "third_party/vtune/include/jitprofiling.h"
@@ -19,11 +21,13 @@
 
 #include "third_party/fmt/include/fmt/format.h"
 #include "xenia/base/assert.h"
+#include "xenia/base/atomic.h"
 #include "xenia/base/clock.h"
 #include "xenia/base/literals.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/base/memory.h"
+#include "xenia/base/threading.h"
 #include "xenia/cpu/function.h"
 #include "xenia/cpu/module.h"
 
@@ -122,6 +126,7 @@ bool X64CodeCache::Initialize() {
 
   // Preallocate the function map to a large, reasonable size.
   generated_code_map_.reserve(kMaximumFunctionCount);
+  generated_code_map_entries_ = generated_code_map_.data();
 
   return true;
 }
@@ -141,6 +146,10 @@ void X64CodeCache::AddIndirection(uint32_t guest_address,
   *indirection_slot = host_address;
 }
 
+void X64CodeCache::RemoveIndirection(uint32_t guest_address) {
+  AddIndirection(guest_address, indirection_default_value_);
+}
+
 void X64CodeCache::CommitExecutableRange(uint32_t guest_low,
                                          uint32_t guest_high) {
   if (!indirection_table_base_) {
@@ -184,39 +193,78 @@ void X64CodeCache::PlaceGuestCode(uint32_t guest_address, void* machine_code,
   {
     auto global_lock = global_critical_region_.Acquire();
 
-    low_mark = generated_code_offset_;
-
     // Reserve code.
     // Always move the code to land on 16b alignment.
-    code_execute_address =
-        generated_code_execute_base_ + generated_code_offset_;
+    size_t code_size = xe::round_up(func_info.code_size.total, 16);
+    // Take the first reclaimed range the code fits in, if any.
+    auto free_range = std::find_if(
+        free_code_ranges_.begin(), free_code_ranges_.end(),
+        [code_size](const auto& range) { return range.second >= code_size; });
+    bool reused = free_range != free_code_ranges_.end();
+    size_t code_offset;
+    if (reused) {
+      code_offset = free_range->first;
+      size_t remaining_size = free_range->second - code_size;
+      free_code_ranges_.erase(free_range);
+      if (remaining_size) {
+        free_code_ranges_.emplace(code_offset + code_size, remaining_size);
+      }
+      free_code_bytes_ -= code_size;
+    } else {
+      code_offset = generated_code_offset_;
+      generated_code_offset_ += code_size;
+    }
+
+    low_mark = code_offset;
+
+    code_execute_address = generated_code_execute_base_ + code_offset;
     code_execute_address_out = code_execute_address;
-    uint8_t* code_write_address =
-        generated_code_write_base_ + generated_code_offset_;
+    uint8_t* code_write_address = generated_code_write_base_ + code_offset;
     code_write_address_out = code_write_address;
-    generated_code_offset_ += xe::round_up(func_info.code_size.total, 16);
 
-    auto tail_write_address =
-        generated_code_write_base_ + generated_code_offset_;
+    auto tail_write_address = code_write_address + code_size;
 
     // Reserve unwind info.
     // We go on the high size of the unwind info as we don't know how big we
     // need it, and a few extra bytes of padding isn't the worst thing.
-    unwind_reservation = RequestUnwindReservation(generated_code_write_base_ +
-                                                  generated_code_offset_);
-    generated_code_offset_ += xe::round_up(unwind_reservation.data_size, 16);
+    unwind_reservation = RequestUnwindReservation(tail_write_address);
+    size_t unwind_size = xe::round_up(unwind_reservation.data_size, 16, false);
+    // Only reused if there's no unwind information.
+    assert_false(reused && unwind_size);
+    if (!reused) {
+      generated_code_offset_ += unwind_size;
+    }
+    size_t end_offset = code_offset + code_size + unwind_size;
 
-    auto end_write_address =
-        generated_code_write_base_ + generated_code_offset_;
+    auto end_write_address = generated_code_write_base_ + end_offset;
 
     high_mark = generated_code_offset_;
-
-    // Store in map. It is maintained in sorted order of host PC dependent on
-    // us also being append-only.
-    generated_code_map_.emplace_back(
-        (uint64_t(code_execute_address - generated_code_execute_base_) << 32) |
-            generated_code_offset_,
-        function_info);
+    code_bytes_ += end_offset - code_offset;
+
+    // Store in map. It is maintained in sorted order of host PC, which
+    // appending keeps unless the code is placed in a reclaimed range.
+    BeginGeneratedCodeMapChange();
+    if (generated_code_map_.size() == generated_code_map_.capacity()) {
+      std::vector<std::pair<uint64_t, GuestFunction*>> grown_map;
+      grown_map.reserve(generated_code_map_.capacity() * 2);
+      grown_map.assign(generated_code_map_.begin(), generated_code_map_.end());
+      replaced_generated_code_maps_.push_back(std::move(generated_code_map_));
+      generated_code_map_ = std::move(grown_map);
+    }
+    std::pair<uint64_t, GuestFunction*> map_entry(
+        (uint64_t(code_offset) << 32) | end_offset, function_info);
+    if (reused) {
+      generated_code_map_.insert(
+          std::upper_bound(generated_code_map_.begin(),
+                           generated_code_map_.end(), map_entry,
+                           [](const auto& a, const auto& b) {
+                             return a.first < b.first;
+                           }),
+          map_entry);
+    } else {
+      generated_code_map_.push_back(map_entry);
+    }
+    EndGeneratedCodeMapChange();
 
     // TODO(DrChat): The following code doesn't really need to be under the
     // global lock except for PlaceCode (but it depends on the previous code
@@ -290,6 +338,128 @@ void X64CodeCache::PlaceGuestCode(uint32_t guest_address, void* machine_code,
   }
 }
 
+bool X64CodeCache::RedirectGuestCode(void* old_code_execute_address,
+                                     const void* new_code_execute_address) {
+  // Guest functions always begin with the 7-byte sub rsp, imm32 (see
+  // X64Emitter::Emit), which is replaced with a jmp rel32 in a single 8-byte
+  // store so threads entering the function concurrently see either the old or
+  // the new instruction, never a mix of both.
+  auto code_write_address = reinterpret_cast<volatile uint64_t*>(
+      generated_code_write_base_ +
+      (reinterpret_cast<uint8_t*>(old_code_execute_address) -
+       generated_code_execute_base_));
+  assert_zero(reinterpret_cast<uintptr_t>(code_write_address) & 7);
+  uint64_t old_code = *code_write_address;
+  if ((old_code & 0xFFFFFF) != 0xEC8148) {
+    // Not the expected prolog, or already redirected.
+    return false;
+  }
+  int64_t displacement =
+      reinterpret_cast<const uint8_t*>(new_code_execute_address) -
+      (reinterpret_cast<uint8_t*>(old_code_execute_address) + 5);
+  assert_true(displacement == int32_t(displacement));
+  uint64_t new_code = (old_code & 0xFFFFFF0000000000ull) |
+                      (uint64_t(uint32_t(int32_t(displacement))) << 8) | 0xE9;
+  return xe::atomic_cas(old_code, new_code, code_write_address);
+}
+
+void* X64CodeCache::PlaceIndirectionStub(uint32_t guest_address) {
+  auto global_lock = global_critical_region_.Acquire();
+  void*& stub = indirection_stubs_[guest_address];
+  if (stub) {
+    return stub;
+  }
+  // mov ebx, guest_address
+  // mov eax, dword[ebx]
+  // jmp rax
+  // Same as an indirect call, with the return address that the caller has
+  // passed in rcx kept.
+  uint8_t code[] = {0xBB, 0x00, 0x00, 0x00, 0x00, 0x67, 0x8B, 0x03, 0xFF, 0xE0};
+  std::memcpy(&code[1], &guest_address, sizeof(guest_address));
+  EmitFunctionInfo func_info = {};
+  func_info.code_size.body = sizeof(code);
+  func_info.code_size.total = sizeof(code);
+  void* code_execute_address;
+  void* code_write_address;
+  PlaceHostCode(0, code, func_info, code_execute_address, code_write_address);
+  stub = code_execute_address;
+  return stub;
+}
+
+void X64CodeCache::RetireCode(void* code_execute_address) {
+  auto global_lock = global_critical_region_.Acquire();
+  auto code_offset =
+      uint32_t(reinterpret_cast<uint8_t*>(code_execute_address) -
+               generated_code_execute_base_);
+  if (!retired_code_offsets_.insert(code_offset).second) {
+    return;
+  }
+  auto it = std::lower_bound(
+      generated_code_map_.begin(), generated_code_map_.end(),
+      uint64_t(code_offset) << 32,
+      [](const auto& entry, uint64_t key) { return entry.first < key; });
+  if (it != generated_code_map_.end() &&
+      uint32_t(it->first >> 32) == code_offset) {
+    dead_code_bytes_ += uint32_t(it->first) - code_offset;
+  }
+}
+
+void X64CodeCache::ReclaimRetiredCode(
+    const std::vector<GuestFunction*>& functions) {
+  if (!CanReuseCode()) {
+    return;
+  }
+  std::unordered_set<GuestFunction*> function_set(functions.begin(),
+                                                  functions.end());
+  auto global_lock = global_critical_region_.Acquire();
+  BeginGeneratedCodeMapChange();
+  for (auto& entry : generated_code_map_) {
+    if (!entry.second || !function_set.count(entry.second)) {
+      continue;
+    }
+    auto start_offset = uint32_t(entry.first >> 32);
+    auto end_offset = uint32_t(entry.first);
+    if (end_offset - start_offset <= kRetainedCodeSize ||
+        !retired_code_offsets_.count(start_offset)) {
+      continue;
+    }
+    size_t range_offset = start_offset + kRetainedCodeSize;
+    size_t range_size = end_offset - range_offset;
+    std::memset(generated_code_write_base_ + range_offset, 0xCC, range_size);
+    entry.first = (uint64_t(start_offset) << 32) | range_offset;
+    code_bytes_ -= range_size;
+    dead_code_bytes_ -= range_size;
+    free_code_bytes_ += range_size;
+
+    // Coalesce with the adjacent free ranges.
+    auto next = free_code_ranges_.lower_bound(range_offset);
+    if (next != free_code_ranges_.end() &&
+        range_offset + range_size == next->first) {
+      range_size += next->second;
+      next = free_code_ranges_.erase(next);
+    }
+    if (next != free_code_ranges_.begin()) {
+      auto prev = std::prev(next);
+      if (prev->first + prev->second == range_offset) {
+        prev->second += range_size;
+        continue;
+      }
+    }
+    free_code_ranges_.emplace_hint(next, range_offset, range_size);
+  }
+  EndGeneratedCodeMapChange();
+}
+
+X64CodeCache::Statistics X64CodeCache::QueryStatistics() {
+  auto global_lock = global_critical_region_.Acquire();
+  Statistics statistics;
+  statistics.live_code_bytes = code_bytes_ - dead_code_bytes_;
+  statistics.dead_code_bytes = dead_code_bytes_;
+  statistics.free_code_bytes = free_code_bytes_;
+  statistics.data_bytes = data_bytes_;
+  return statistics;
+}
+
 uint32_t X64CodeCache::PlaceData(const void* data, size_t length) {
   // Hold a lock while we bump the pointers up.
   size_t high_mark;
@@ -301,6 +471,7 @@ uint32_t X64CodeCache::PlaceData(const void* data, size_t length) {
     // Always move the code to land on 16b alignment.
     data_address = generated_code_write_base_ + generated_code_offset_;
     generated_code_offset_ += xe::round_up(length, 16);
+    data_bytes_ += xe::round_up(length, 16);
 
     high_mark = generated_code_offset_;
   }
@@ -335,30 +506,63 @@ uint32_t X64CodeCache::PlaceData(const void* data, size_t length) {
   return uint32_t(uintptr_t(data_address));
 }
 
+void X64CodeCache::BeginGeneratedCodeMapChange() {
+  generated_code_map_version_.store(generated_code_map_version_ + 1,
+                                    std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void X64CodeCache::EndGeneratedCodeMapChange() {
+  // The storage before the size, so a lookup that has seen the size will see
+  // storage at least as large.
+  generated_code_map_entries_.store(generated_code_map_.data(),
+                                    std::memory_order_relaxed);
+  generated_code_map_size_.store(generated_code_map_.size(),
+                                 std::memory_order_release);
+  generated_code_map_version_.store(generated_code_map_version_ + 1,
+                                    std::memory_order_release);
+}
+
 GuestFunction* X64CodeCache::LookupFunction(uint64_t host_pc) {
   uint32_t key = uint32_t(host_pc - kGeneratedCodeExecuteBase);
-  void* fn_entry = std::bsearch(
-      &key, generated_code_map_.data(), generated_code_map_.size() + 1,
-      sizeof(std::pair<uint32_t, Function*>),
-      [](const void* key_ptr, const void* element_ptr) {
-        auto key = *reinterpret_cast<const uint32_t*>(key_ptr);
-        auto element =
-            reinterpret_cast<const std::pair<uint64_t, GuestFunction*>*>(
-                element_ptr);
-        if (key < (element->first >> 32)) {
-          return -1;
-        } else if (key > uint32_t(element->first)) {
-          return 1;
-        } else {
-          return 0;
-        }
-      });
-  if (fn_entry) {
-    return reinterpret_cast<const std::pair<uint64_t, GuestFunction*>*>(
-               fn_entry)
-        ->second;
-  } else {
-    return nullptr;
+  // Used by exception handlers, so not waiting for the global lock, which
+  // another thread may be holding while waiting for this one.
+  while (true) {
+    uint32_t version =
+        generated_code_map_version_.load(std::memory_order_acquire);
+    if (version & 1) {
+      // Being changed, which only takes a moment.
+      xe::threading::MaybeYield();
+      continue;
+    }
+    size_t size = generated_code_map_size_.load(std::memory_order_acquire);
+    auto entries = generated_code_map_entries_.load(std::memory_order_relaxed);
+    void* fn_entry = std::bsearch(
+        &key, entries, size, sizeof(std::pair<uint64_t, GuestFunction*>),
+        [](const void* key_ptr, const void* element_ptr) {
+          auto key = *reinterpret_cast<const uint32_t*>(key_ptr);
+          auto element =
+              reinterpret_cast<const std::pair<uint64_t, GuestFunction*>*>(
+                  element_ptr);
+          if (key < (element->first >> 32)) {
+            return -1;
+          } else if (key > uint32_t(element->first)) {
+            return 1;
+          } else {
+            return 0;
+          }
+        });
+    GuestFunction* function =
+        fn_entry
+            ? reinterpret_cast<const std::pair<uint64_t, GuestFunction*>*>(
+                  fn_entry)
+                  ->second
+            : nullptr;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (generated_code_map_version_.load(std::memory_order_relaxed) ==
+        version) {
+      return function;
+    }
   }
 }
 
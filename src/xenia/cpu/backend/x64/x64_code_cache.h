@@ -13,8 +13,11 @@
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -41,6 +44,17 @@ struct EmitFunctionInfo {
 
 class X64CodeCache : public CodeCache {
  public:
+  struct Statistics {
+    // Code of translations that are entered when called.
+    size_t live_code_bytes;
+    // Code of translations that have been superseded or invalidated, which
+    // threads may still be executing.
+    size_t dead_code_bytes;
+    // Reclaimed from dead code, available for new code.
+    size_t free_code_bytes;
+    size_t data_bytes;
+  };
+
   ~X64CodeCache() override;
 
   static std::unique_ptr<X64CodeCache> Create();
@@ -60,6 +74,8 @@ class X64CodeCache : public CodeCache {
   bool has_indirection_table() { return indirection_table_base_ != nullptr; }
   void set_indirection_default(uint32_t default_value);
   void AddIndirection(uint32_t guest_address, uint32_t host_address);
+  // Makes calls through the indirection table resolve the function again.
+  void RemoveIndirection(uint32_t guest_address);
 
   void CommitExecutableRange(uint32_t guest_low, uint32_t guest_high);
 
@@ -73,7 +89,29 @@ class X64CodeCache : public CodeCache {
                       void*& code_execute_address_out,
                       void*& code_write_address_out);
   uint32_t PlaceData(const void* data, size_t length);
-
+  // Makes callers that have the old code address embedded jump to the new code
+  // of a recompiled guest function.
+  bool RedirectGuestCode(void* old_code_execute_address,
+                         const void* new_code_execute_address);
+  // Places code calling whatever the indirection table contains for the guest
+  // address, for redirecting invalidated guest code to. Placed once for each
+  // address and shared by all of its invalidated translations.
+  void* PlaceIndirectionStub(uint32_t guest_address);
+
+  // Marks the code placed at the address as dead after it has been redirected.
+  void RetireCode(void* code_execute_address);
+  // Reuses the dead code of the functions for new code, except for its
+  // beginning that's still needed for the redirection. The guest code of the
+  // functions must be gone, so no thread can be executing them anymore.
+  void ReclaimRetiredCode(const std::vector<GuestFunction*>& functions);
+
+  Statistics QueryStatistics();
+  // Whether new code can be placed in reclaimed ranges, which is only possible
+  // if there's no unwind information that must be kept sorted by address.
+  virtual bool CanReuseCode() const { return true; }
+
+  // Doesn't wait for other threads changing the code cache, so it can be used
+  // in exception handlers.
   GuestFunction* LookupFunction(uint64_t host_pc) override;
 
  protected:
@@ -94,6 +132,8 @@ class X64CodeCache : public CodeCache {
   // expect. If we hit issues with this it probably means some corner case
   // in analysis triggering.
   static const size_t kMaximumFunctionCount = 100000;
+  // Beginning of reclaimed code kept for the jump to the new code.
+  static const size_t kRetainedCodeSize = 16;
 
   struct UnwindReservation {
     size_t data_size = 0;
@@ -111,6 +151,10 @@ class X64CodeCache : public CodeCache {
                          void* code_execute_address,
                          UnwindReservation unwind_reservation) {}
 
+  // Around changes of generated_code_map_, with the global lock held.
+  void BeginGeneratedCodeMapChange();
+  void EndGeneratedCodeMapChange();
+
   std::filesystem::path file_name_;
   xe::memory::FileMappingHandle mapping_ =
       xe::memory::kFileMappingHandleInvalid;
@@ -141,6 +185,29 @@ class X64CodeCache : public CodeCache {
   // This can be used to bsearch on host PC to find the guest function.
   // The key is [start address | end address].
   std::vector<std::pair<uint64_t, GuestFunction*>> generated_code_map_;
+  // Lookups search the entries of generated_code_map_ published here without
+  // the global lock, and search again if the version has changed meanwhile.
+  // The version is odd while the map is being changed. Storage replaced when
+  // the map grows is kept, as lookups may still be searching it.
+  std::atomic<const std::pair<uint64_t, GuestFunction*>*>
+      generated_code_map_entries_ = {nullptr};
+  std::atomic<size_t> generated_code_map_size_ = {0};
+  std::atomic<uint32_t> generated_code_map_version_ = {0};
+  std::vector<std::vector<std::pair<uint64_t, GuestFunction*>>>
+      replaced_generated_code_maps_;
+
+  // Code placed by PlaceIndirectionStub by guest address.
+  std::unordered_map<uint32_t, void*> indirection_stubs_;
+
+  // Offsets of the code that has been redirected.
+  std::unordered_set<uint32_t> retired_code_offsets_;
+  // Reclaimed ranges of generated code by offset, coalesced.
+  std::map<size_t, size_t> free_code_ranges_;
+  // Generated code and unwind information, including dead code.
+  size_t code_bytes_ = 0;
+  size_t dead_code_bytes_ = 0;
+  size_t free_code_bytes_ = 0;
+  size_t data_bytes_ = 0;
 };
 
 }  // namespace x64
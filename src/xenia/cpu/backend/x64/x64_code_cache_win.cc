@@ -106,6 +106,9 @@ class Win32X64CodeCache : public X64CodeCache {
 
  private:
   UnwindReservation RequestUnwindReservation(uint8_t* entry_address) override;
+  // Growable function tables only allow appending entries, which must be
+  // sorted by address.
+  bool CanReuseCode() const override { return false; }
   void PlaceCode(uint32_t guest_address, void* machine_code,
                  const EmitFunctionInfo& func_info, void* code_execute_address,
                  UnwindReservation unwind_reservation) override;
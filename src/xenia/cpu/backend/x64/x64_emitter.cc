@@ -116,10 +116,14 @@ bool X64Emitter::Emit(GuestFunction* function, HIRBuilder* builder,
   debug_info_flags_ = debug_info_flags;
   trace_data_ = &function->trace_data();
   source_map_arena_.Reset();
+  current_function_ = function;
+  current_guest_address_ = function->address();
 
   // Fill the generator with code.
   EmitFunctionInfo func_info = {};
-  if (!Emit(builder, func_info)) {
+  bool emitted = Emit(builder, func_info);
+  current_function_ = nullptr;
+  if (!emitted) {
     return false;
   }
 
@@ -205,7 +209,13 @@ bool X64Emitter::Emit(HIRBuilder* builder, EmitFunctionInfo& func_info) {
   func_info.stack_size = stack_size;
   stack_size_ = stack_size;
 
-  sub(rsp, (uint32_t)stack_size);
+  // Always the 7-byte imm32 form (xbyak would pick imm8 for small frames) so
+  // the entry can be patched into a jump to a recompiled version of the
+  // function (see X64CodeCache::RedirectGuestCode).
+  db(0x48);
+  db(0x81);
+  db(0xEC);
+  dd(uint32_t(stack_size));
 
   code_offsets.prolog_stack_alloc = getSize();
   code_offsets.body = getSize();
@@ -312,6 +322,7 @@ void X64Emitter::MarkSourceOffset(const Instr* i) {
   entry->guest_address = static_cast<uint32_t>(i->src1.offset);
   entry->hir_offset = uint32_t(i->block->ordinal << 16) | i->ordinal;
   entry->code_offset = static_cast<uint32_t>(getSize());
+  current_guest_address_ = entry->guest_address;
 
   if (cvars::emit_source_annotations) {
     nop();
@@ -466,7 +477,55 @@ void X64Emitter::CallIndirect(const hir::Instr* instr,
     if (reg.cvt32() != ebx) {
       mov(ebx, reg.cvt32());
     }
-    mov(eax, dword[ebx]);
+    IndirectBranchSite* site = nullptr;
+    GuestFunction* cached_targets[IndirectBranchSite::kMaxCachedTargets];
+    uint32_t cached_target_count = 0;
+    if (current_function_) {
+      site = backend()->GetIndirectBranchSite(
+          current_function_, current_guest_address_, cached_targets,
+          &cached_target_count);
+    }
+    if (site) {
+      // Call the code of the most frequent targets directly, the same way as
+      // Call does, when the target is one of them.
+      Xbyak::Label resolved;
+      for (uint32_t i = 0; i < cached_target_count; ++i) {
+        auto target = static_cast<X64Function*>(cached_targets[i]);
+        if (!target->machine_code()) {
+          continue;
+        }
+        assert_zero(uint64_t(target->machine_code()) & 0xFFFFFFFF00000000);
+        Xbyak::Label next;
+        cmp(ebx, target->address());
+        jne(next, CodeGenerator::T_NEAR);
+        mov(rax, reinterpret_cast<uint64_t>(&site->hit_counts[i]));
+        inc(qword[rax]);
+        mov(eax, uint32_t(uint64_t(target->machine_code())));
+        jmp(resolved, CodeGenerator::T_NEAR);
+        L(next);
+      }
+      // Pass every few missed targets to the backend, which will recompile
+      // this function to cache them once it has seen enough. The counter is
+      // shared by all threads running the code, so it's incremented
+      // atomically for exactly one of them to take each sample. rbx is
+      // preserved by the call.
+      Xbyak::Label not_sampled;
+      mov(rax, reinterpret_cast<uint64_t>(&site->miss_count));
+      mov(ecx, 1);
+      lock();
+      xadd(qword[rax], rcx);
+      test(ecx, IndirectBranchSite::kMissSampleInterval - 1);
+      jnz(not_sampled, CodeGenerator::T_NEAR);
+      mov(GetNativeParam(0), reinterpret_cast<uint64_t>(site));
+      mov(GetNativeParam(1).cvt32(), ebx);
+      CallNativeSafe(
+          reinterpret_cast<void*>(&X64Backend::IndirectBranchMissThunk));
+      L(not_sampled);
+      mov(eax, dword[ebx]);
+      L(resolved);
+    } else {
+      mov(eax, dword[ebx]);
+    }
   } else {
     // Old-style resolve.
     // Not too important because indirection table is almost always available.
@@ -762,6 +821,23 @@ static const vec128_t xmm_consts[] = {
     /* XMMQNaN                */ vec128i(0x7FC00000u),
     /* XMMInt127              */ vec128i(0x7Fu),
     /* XMM2To32               */ vec128f(0x1.0p32f),
+    /* XMMShiftMaskPI8        */ vec128b(0x07),
+    /* XMMMaskEvenPI8         */ vec128s(0x00FF),
+    /* XMMMaskOddPI8          */ vec128s(0xFF00),
+    /* XMMShiftMaskPI16       */ vec128s(0x000F),
+    /* XMMMaskOddPI16         */ vec128i(0xFFFF0000u),
+    /* XMMShlMultipliersPI8   */
+    vec128i(0x08040201u, 0x80402010u, 0x08040201u, 0x80402010u),
+    /* XMMShrMultipliersPI8   */
+    vec128i(0x10204080u, 0x01020408u, 0x10204080u, 0x01020408u),
+    /* XMMDuplicateEvenPI8    */
+    vec128i(0x02020000u, 0x06060404u, 0x0A0A0808u, 0x0E0E0C0Cu),
+    /* XMMDuplicateOddPI8     */
+    vec128i(0x03030101u, 0x07070505u, 0x0B0B0909u, 0x0F0F0D0Du),
+    /* XMMDuplicateEvenPI16   */
+    vec128i(0x01000100u, 0x05040504u, 0x09080908u, 0x0D0C0D0Cu),
+    /* XMMDuplicateOddPI16    */
+    vec128i(0x03020302u, 0x07060706u, 0x0B0A0B0Au, 0x0F0E0F0Eu),
 };
 
 // First location to try and place constants.
@@ -116,6 +116,17 @@ enum XmmConst {
   XMMQNaN,
   XMMInt127,
   XMM2To32,
+  XMMShiftMaskPI8,
+  XMMMaskEvenPI8,
+  XMMMaskOddPI8,
+  XMMShiftMaskPI16,
+  XMMMaskOddPI16,
+  XMMShlMultipliersPI8,
+  XMMShrMultipliersPI8,
+  XMMDuplicateEvenPI8,
+  XMMDuplicateOddPI8,
+  XMMDuplicateEvenPI16,
+  XMMDuplicateOddPI16,
 };
 
 // Unfortunately due to the design of xbyak we have to pass this to the ctor.
@@ -195,6 +206,8 @@ class X64Emitter : public Xbyak::CodeGenerator {
   Xbyak::Label& epilog_label() { return *epilog_label_; }
 
   void MarkSourceOffset(const hir::Instr* i);
+  // Address of the guest instruction the code being emitted belongs to.
+  uint32_t current_guest_address() const { return current_guest_address_; }
 
   void DebugBreak();
   void Trap(uint16_t trap_type = 0);
@@ -264,6 +277,8 @@ class X64Emitter : public Xbyak::CodeGenerator {
   uint32_t debug_info_flags_ = 0;
   FunctionTraceData* trace_data_ = nullptr;
   Arena source_map_arena_;
+  GuestFunction* current_function_ = nullptr;
+  uint32_t current_guest_address_ = 0;
 
   size_t stack_size_ = 0;
 
@@ -10,6 +10,8 @@
 #ifndef XENIA_CPU_BACKEND_X64_X64_FUNCTION_H_
 #define XENIA_CPU_BACKEND_X64_X64_FUNCTION_H_
 
+#include <atomic>
+
 #include "xenia/cpu/function.h"
 #include "xenia/cpu/thread_state.h"
 
@@ -23,7 +25,9 @@ class X64Function : public GuestFunction {
   X64Function(Module* module, uint32_t address);
   ~X64Function() override;
 
-  uint8_t* machine_code() const override { return machine_code_; }
+  uint8_t* machine_code() const override {
+    return machine_code_.load(std::memory_order_acquire);
+  }
   size_t machine_code_length() const override { return machine_code_length_; }
 
   void Setup(uint8_t* machine_code, size_t machine_code_length);
@@ -32,7 +36,9 @@ class X64Function : public GuestFunction {
   bool CallImpl(ThreadState* thread_state, uint32_t return_address) override;
 
  private:
-  uint8_t* machine_code_ = nullptr;
+  // Replaced when the function is retranslated while other threads may be
+  // linking calls to it.
+  std::atomic<uint8_t*> machine_code_ = {nullptr};
   size_t machine_code_length_ = 0;
 };
 
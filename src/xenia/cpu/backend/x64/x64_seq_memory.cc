@@ -13,6 +13,7 @@
 #include <cstring>
 
 #include "xenia/base/memory.h"
+#include "xenia/cpu/backend/x64/x64_backend.h"
 #include "xenia/cpu/backend/x64/x64_op.h"
 #include "xenia/cpu/backend/x64/x64_tracers.h"
 
@@ -103,6 +104,37 @@ RegExp ComputeMemoryAddress(X64Emitter& e, const T& guest) {
   }
 }
 
+// Loads and stores that have been faulting on an MMIO range (see
+// X64Backend::OnMMIOAccessSiteFault) call the range handlers directly when the
+// address is within the range instead of going through the access violation
+// handler.
+const MMIORange* LookupMMIOAccessSite(X64Emitter& e, const I64Op& guest) {
+  const MMIORange* range =
+      e.backend()->LookupMMIOAccessSite(e.current_guest_address());
+  if (range && guest.is_constant &&
+      (uint32_t(guest.constant()) & range->mask) != range->address) {
+    return nullptr;
+  }
+  return range;
+}
+
+// Jumps to memory_access_label if the address is outside the range, otherwise
+// loads the handler arguments except for the stored value.
+void EmitMMIOAccessSiteCheck(X64Emitter& e, const I64Op& guest,
+                             const MMIORange* range,
+                             Xbyak::Label& memory_access_label) {
+  if (guest.is_constant) {
+    e.mov(e.GetNativeParam(1).cvt32(), uint32_t(guest.constant()));
+  } else {
+    e.mov(e.eax, guest.reg().cvt32());
+    e.and_(e.eax, range->mask);
+    e.cmp(e.eax, range->address);
+    e.jne(memory_access_label, CodeGenerator::T_NEAR);
+    e.mov(e.GetNativeParam(1).cvt32(), guest.reg().cvt32());
+  }
+  e.mov(e.GetNativeParam(0), uint64_t(range->callback_context));
+}
+
 // ============================================================================
 // OPCODE_ATOMIC_EXCHANGE
 // ============================================================================
@@ -168,24 +200,47 @@ EMITTER_OPCODE_TABLE(OPCODE_ATOMIC_EXCHANGE, ATOMIC_EXCHANGE_I8,
 // ============================================================================
 // OPCODE_ATOMIC_COMPARE_EXCHANGE
 // ============================================================================
+// Puts the offset of the guest address from the membase in ecx, as eax is
+// taken by the comparand.
+void ComputeAtomicCompareExchangeAddress(X64Emitter& e, const I64Op& guest) {
+  if (guest.is_constant) {
+    uint32_t address = static_cast<uint32_t>(guest.constant());
+    if (address >= 0xE0000000 &&
+        xe::memory::allocation_granularity() > 0x1000) {
+      e.mov(e.ecx, address + 0x1000);
+    } else {
+      e.mov(e.ecx, address);
+    }
+  } else if (xe::memory::allocation_granularity() > 0x1000) {
+    // Emulate the 4 KB physical address offset in 0xE0000000+ when can't do it
+    // via memory mapping.
+    e.cmp(guest.reg().cvt32(), 0xE0000000);
+    e.setae(e.cl);
+    e.movzx(e.ecx, e.cl);
+    e.shl(e.ecx, 12);
+    e.add(e.ecx, guest.reg().cvt32());
+  } else {
+    e.mov(e.ecx, guest.reg().cvt32());
+  }
+}
 struct ATOMIC_COMPARE_EXCHANGE_I32
     : Sequence<ATOMIC_COMPARE_EXCHANGE_I32,
                I<OPCODE_ATOMIC_COMPARE_EXCHANGE, I8Op, I64Op, I32Op, I32Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    e.mov(e.eax, i.src2);
-    if (xe::memory::allocation_granularity() > 0x1000) {
-      // Emulate the 4 KB physical address offset in 0xE0000000+ when can't do
-      // it via memory mapping.
-      e.cmp(i.src1.reg().cvt32(), 0xE0000000);
-      e.setae(e.cl);
-      e.movzx(e.ecx, e.cl);
-      e.shl(e.ecx, 12);
-      e.add(e.ecx, i.src1.reg().cvt32());
+    if (i.src2.is_constant) {
+      e.mov(e.eax, i.src2.constant());
     } else {
-      e.mov(e.ecx, i.src1.reg().cvt32());
+      e.mov(e.eax, i.src2);
+    }
+    ComputeAtomicCompareExchangeAddress(e, i.src1);
+    if (i.src3.is_constant) {
+      e.mov(e.edx, i.src3.constant());
+      e.lock();
+      e.cmpxchg(e.dword[e.GetMembaseReg() + e.rcx], e.edx);
+    } else {
+      e.lock();
+      e.cmpxchg(e.dword[e.GetMembaseReg() + e.rcx], i.src3);
     }
-    e.lock();
-    e.cmpxchg(e.dword[e.GetMembaseReg() + e.rcx], i.src3);
     e.sete(i.dest);
   }
 };
@@ -193,20 +248,20 @@ struct ATOMIC_COMPARE_EXCHANGE_I64
     : Sequence<ATOMIC_COMPARE_EXCHANGE_I64,
                I<OPCODE_ATOMIC_COMPARE_EXCHANGE, I8Op, I64Op, I64Op, I64Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    e.mov(e.rax, i.src2);
-    if (xe::memory::allocation_granularity() > 0x1000) {
-      // Emulate the 4 KB physical address offset in 0xE0000000+ when can't do
-      // it via memory mapping.
-      e.cmp(i.src1.reg().cvt32(), 0xE0000000);
-      e.setae(e.cl);
-      e.movzx(e.ecx, e.cl);
-      e.shl(e.ecx, 12);
-      e.add(e.ecx, i.src1.reg().cvt32());
+    if (i.src2.is_constant) {
+      e.mov(e.rax, i.src2.constant());
     } else {
-      e.mov(e.ecx, i.src1.reg().cvt32());
+      e.mov(e.rax, i.src2);
+    }
+    ComputeAtomicCompareExchangeAddress(e, i.src1);
+    if (i.src3.is_constant) {
+      e.mov(e.rdx, i.src3.constant());
+      e.lock();
+      e.cmpxchg(e.qword[e.GetMembaseReg() + e.rcx], e.rdx);
+    } else {
+      e.lock();
+      e.cmpxchg(e.qword[e.GetMembaseReg() + e.rcx], i.src3);
     }
-    e.lock();
-    e.cmpxchg(e.qword[e.GetMembaseReg() + e.rcx], i.src3);
     e.sete(i.dest);
   }
 };
@@ -787,6 +842,21 @@ struct LOAD_I16 : Sequence<LOAD_I16, I<OPCODE_LOAD, I16Op, I64Op>> {
 };
 struct LOAD_I32 : Sequence<LOAD_I32, I<OPCODE_LOAD, I32Op, I64Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
+    Xbyak::Label memory_access_label, end_label;
+    auto mmio_range = LookupMMIOAccessSite(e, i.src1);
+    if (mmio_range) {
+      EmitMMIOAccessSiteCheck(e, i.src1, mmio_range, memory_access_label);
+      e.CallNativeSafe(reinterpret_cast<void*>(mmio_range->read));
+      if (!(i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP)) {
+        e.bswap(e.eax);
+      }
+      e.mov(i.dest, e.eax);
+      if (i.src1.is_constant) {
+        return;
+      }
+      e.jmp(end_label, CodeGenerator::T_NEAR);
+      e.L(memory_access_label);
+    }
     auto addr = ComputeMemoryAddress(e, i.src1);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
       if (e.IsFeatureEnabled(kX64EmitMovbe)) {
@@ -803,6 +873,7 @@ struct LOAD_I32 : Sequence<LOAD_I32, I<OPCODE_LOAD, I32Op, I64Op>> {
       e.lea(e.GetNativeParam(0), e.ptr[addr]);
       e.CallNative(reinterpret_cast<void*>(TraceMemoryLoadI32));
     }
+    e.L(end_label);
   }
 };
 struct LOAD_I64 : Sequence<LOAD_I64, I<OPCODE_LOAD, I64Op, I64Op>> {
@@ -919,6 +990,29 @@ struct STORE_I16 : Sequence<STORE_I16, I<OPCODE_STORE, VoidOp, I64Op, I16Op>> {
 };
 struct STORE_I32 : Sequence<STORE_I32, I<OPCODE_STORE, VoidOp, I64Op, I32Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
+    Xbyak::Label memory_access_label, end_label;
+    auto mmio_range = LookupMMIOAccessSite(e, i.src1);
+    if (mmio_range) {
+      EmitMMIOAccessSiteCheck(e, i.src1, mmio_range, memory_access_label);
+      // The handlers take the value in host byte order.
+      bool byte_swap = i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP;
+      if (i.src2.is_constant) {
+        uint32_t value = uint32_t(i.src2.constant());
+        e.mov(e.GetNativeParam(2).cvt32(),
+              byte_swap ? value : xe::byte_swap(value));
+      } else {
+        e.mov(e.GetNativeParam(2).cvt32(), i.src2);
+        if (!byte_swap) {
+          e.bswap(e.GetNativeParam(2).cvt32());
+        }
+      }
+      e.CallNativeSafe(reinterpret_cast<void*>(mmio_range->write));
+      if (i.src1.is_constant) {
+        return;
+      }
+      e.jmp(end_label, CodeGenerator::T_NEAR);
+      e.L(memory_access_label);
+    }
     auto addr = ComputeMemoryAddress(e, i.src1);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
       assert_false(i.src2.is_constant);
@@ -940,6 +1034,7 @@ struct STORE_I32 : Sequence<STORE_I32, I<OPCODE_STORE, VoidOp, I64Op, I32Op>> {
       e.lea(e.GetNativeParam(0), e.ptr[addr]);
       e.CallNative(reinterpret_cast<void*>(TraceMemoryStoreI32));
     }
+    e.L(end_label);
   }
 };
 struct STORE_I64 : Sequence<STORE_I64, I<OPCODE_STORE, VoidOp, I64Op, I64Op>> {
@@ -753,6 +753,91 @@ struct VECTOR_SUB
 };
 EMITTER_OPCODE_TABLE(OPCODE_VECTOR_SUB, VECTOR_SUB);
 
+// ============================================================================
+// Variable 8-bit and 16-bit shifts
+// ============================================================================
+// x86 has no per-element shifts of bytes, and shifts of words only since
+// AVX-512BW. Byte shifts are done as multiplications of words by powers of
+// two, separately for the even and the odd bytes, and word shifts as AVX2
+// shifts of dwords, separately for the even and the odd words.
+
+// Loads 1 << (count & 7) for every byte into xmm0.
+template <typename Op>
+static void LoadShlMultipliersInt8(X64Emitter& e, const Op& src2) {
+  if (src2.is_constant) {
+    vec128_t multipliers;
+    for (size_t n = 0; n < 16; ++n) {
+      multipliers.u8[n] = uint8_t(1 << (src2.constant().u8[n] & 0b111));
+    }
+    e.LoadConstantXmm(e.xmm0, multipliers);
+  } else {
+    e.vpand(e.xmm0, src2, e.GetXmmConstPtr(XMMShiftMaskPI8));
+    e.vmovdqa(e.xmm1, e.GetXmmConstPtr(XMMShlMultipliersPI8));
+    e.vpshufb(e.xmm0, e.xmm1, e.xmm0);
+  }
+}
+
+// Loads 0x100 >> (count & 7) for the odd bytes into the words of xmm0, and
+// for the even bytes into the words of xmm1. The high half of the product of
+// a word and such a multiplier is the high byte shifted right, without any
+// bits of the low byte leaking into it.
+template <typename Op>
+static void LoadShrMultipliersInt8(X64Emitter& e, const Op& src2) {
+  if (src2.is_constant) {
+    const auto& shamt = src2.constant();
+    vec128_t multipliers_odd, multipliers_even;
+    for (size_t n = 0; n < 8; ++n) {
+      multipliers_odd.u16[n] = uint16_t(0x100 >> (shamt.u8[n * 2 + 1] & 0b111));
+      multipliers_even.u16[n] = uint16_t(0x100 >> (shamt.u8[n * 2] & 0b111));
+    }
+    e.LoadConstantXmm(e.xmm0, multipliers_odd);
+    e.LoadConstantXmm(e.xmm1, multipliers_even);
+  } else {
+    // The table has 0x80 >> count, which fits in a byte.
+    e.vpand(e.xmm0, src2, e.GetXmmConstPtr(XMMShiftMaskPI8));
+    e.vmovdqa(e.xmm1, e.GetXmmConstPtr(XMMShrMultipliersPI8));
+    e.vpshufb(e.xmm0, e.xmm1, e.xmm0);
+    e.vpand(e.xmm1, e.xmm0, e.GetXmmConstPtr(XMMMaskEvenPI8));
+    e.vpsllw(e.xmm1, e.xmm1, 1);
+    e.vpsrlw(e.xmm0, e.xmm0, 8);
+    e.vpsllw(e.xmm0, e.xmm0, 1);
+  }
+}
+
+// Loads count & 0xF for every word into xmm0, for AVX-512BW word shifts.
+template <typename Op>
+static void LoadShiftCountsInt16(X64Emitter& e, const Op& src2) {
+  if (src2.is_constant) {
+    vec128_t counts = src2.constant();
+    for (size_t n = 0; n < 8; ++n) {
+      counts.u16[n] &= 0xF;
+    }
+    e.LoadConstantXmm(e.xmm0, counts);
+  } else {
+    e.vpand(e.xmm0, src2, e.GetXmmConstPtr(XMMShiftMaskPI16));
+  }
+}
+
+// Loads count & 0xF of the even words into the dwords of xmm0, and of the odd
+// words into the dwords of xmm1, for AVX2 dword shifts.
+template <typename Op>
+static void LoadShiftCountsInt16Split(X64Emitter& e, const Op& src2) {
+  if (src2.is_constant) {
+    const auto& shamt = src2.constant();
+    vec128_t counts_even, counts_odd;
+    for (size_t n = 0; n < 4; ++n) {
+      counts_even.u32[n] = shamt.u16[n * 2] & 0xF;
+      counts_odd.u32[n] = shamt.u16[n * 2 + 1] & 0xF;
+    }
+    e.LoadConstantXmm(e.xmm0, counts_even);
+    e.LoadConstantXmm(e.xmm1, counts_odd);
+  } else {
+    e.vpand(e.xmm0, src2, e.GetXmmConstPtr(XMMShiftMaskEvenPI16));
+    e.vpsrld(e.xmm1, src2, 16);
+    e.vpand(e.xmm1, e.xmm1, e.GetXmmConstPtr(XMMShiftMaskEvenPI16));
+  }
+}
+
 // ============================================================================
 // OPCODE_VECTOR_SHL
 // ============================================================================
@@ -793,7 +878,6 @@ struct VECTOR_SHL_V128
   }
 
   static void EmitInt8(X64Emitter& e, const EmitArgType& i) {
-    // TODO(benvanik): native version (with shift magic).
     if (i.src2.is_constant) {
       if (e.IsFeatureEnabled(kX64EmitGFNI)) {
         const auto& shamt = i.src2.constant();
@@ -814,13 +898,26 @@ struct VECTOR_SHL_V128
           return;
         }
       }
-      e.lea(e.GetNativeParam(1), e.StashConstantXmm(1, i.src2.constant()));
+    }
+
+    Xmm src1;
+    if (i.src1.is_constant) {
+      src1 = e.xmm2;
+      e.LoadConstantXmm(src1, i.src1.constant());
     } else {
-      e.lea(e.GetNativeParam(1), e.StashXmm(1, i.src2));
+      src1 = i.src1;
     }
-    e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-    e.CallNativeSafe(reinterpret_cast<void*>(EmulateVectorShl<uint8_t>));
-    e.vmovaps(i.dest, e.xmm0);
+
+    // Multiply the even and the odd bytes by 1 << count. vpmaddubsw treats the
+    // multiplier 0x80 as -128, but that doesn't change the low byte.
+    LoadShlMultipliersInt8(e, i.src2);
+    e.vpand(e.xmm1, e.xmm0, e.GetXmmConstPtr(XMMMaskEvenPI8));
+    e.vpmaddubsw(e.xmm1, src1, e.xmm1);
+    e.vpand(e.xmm1, e.xmm1, e.GetXmmConstPtr(XMMMaskEvenPI8));
+    e.vpand(e.xmm0, e.xmm0, e.GetXmmConstPtr(XMMMaskOddPI8));
+    e.vpmaddubsw(e.xmm0, src1, e.xmm0);
+    e.vpsllw(e.xmm0, e.xmm0, 8);
+    e.vpor(i.dest, e.xmm0, e.xmm1);
   }
 
   static void EmitInt16(X64Emitter& e, const EmitArgType& i) {
@@ -848,6 +945,22 @@ struct VECTOR_SHL_V128
       }
     }
 
+    if (e.IsFeatureEnabled(kX64EmitAVX512Ortho | kX64EmitAVX512BW)) {
+      LoadShiftCountsInt16(e, i.src2);
+      e.vpsllvw(i.dest, src1, e.xmm0);
+      return;
+    }
+    if (e.IsFeatureEnabled(kX64EmitAVX2)) {
+      // Shift the even words in the low halves of the dwords, and the odd
+      // words with the even ones cleared.
+      LoadShiftCountsInt16Split(e, i.src2);
+      e.vpsllvd(e.xmm3, src1, e.xmm0);
+      e.vpand(e.xmm0, src1, e.GetXmmConstPtr(XMMMaskOddPI16));
+      e.vpsllvd(e.xmm0, e.xmm0, e.xmm1);
+      e.vpblendw(i.dest, e.xmm3, e.xmm0, 0b10101010);
+      return;
+    }
+
     // Shift 8 words in src1 by amount specified in src2.
     Xbyak::Label emu, end;
 
@@ -1001,7 +1114,6 @@ struct VECTOR_SHR_V128
   }
 
   static void EmitInt8(X64Emitter& e, const EmitArgType& i) {
-    // TODO(benvanik): native version (with shift magic).
     if (i.src2.is_constant) {
       if (e.IsFeatureEnabled(kX64EmitGFNI)) {
         const auto& shamt = i.src2.constant();
@@ -1022,13 +1134,16 @@ struct VECTOR_SHR_V128
           return;
         }
       }
-      e.lea(e.GetNativeParam(1), e.StashConstantXmm(1, i.src2.constant()));
-    } else {
-      e.lea(e.GetNativeParam(1), e.StashXmm(1, i.src2));
     }
-    e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-    e.CallNativeSafe(reinterpret_cast<void*>(EmulateVectorShr<uint8_t>));
-    e.vmovaps(i.dest, e.xmm0);
+
+    // Take the high halves of the products of the odd bytes and of the even
+    // bytes moved to the high halves of the words by 0x100 >> count.
+    LoadShrMultipliersInt8(e, i.src2);
+    e.vpsllw(e.xmm3, i.src1, 8);
+    e.vpmulhuw(e.xmm1, e.xmm3, e.xmm1);
+    e.vpmulhuw(e.xmm0, e.xmm0, i.src1);
+    e.vpsllw(e.xmm0, e.xmm0, 8);
+    e.vpor(i.dest, e.xmm0, e.xmm1);
   }
 
   static void EmitInt16(X64Emitter& e, const EmitArgType& i) {
@@ -1048,6 +1163,22 @@ struct VECTOR_SHR_V128
       }
     }
 
+    if (e.IsFeatureEnabled(kX64EmitAVX512Ortho | kX64EmitAVX512BW)) {
+      LoadShiftCountsInt16(e, i.src2);
+      e.vpsrlvw(i.dest, i.src1, e.xmm0);
+      return;
+    }
+    if (e.IsFeatureEnabled(kX64EmitAVX2)) {
+      // Shift the odd words in the high halves of the dwords, and the even
+      // words with the odd ones cleared.
+      LoadShiftCountsInt16Split(e, i.src2);
+      e.vpsrlvd(e.xmm3, i.src1, e.xmm1);
+      e.vpand(e.xmm1, i.src1, e.GetXmmConstPtr(XMMMaskEvenPI16));
+      e.vpsrlvd(e.xmm1, e.xmm1, e.xmm0);
+      e.vpblendw(i.dest, e.xmm1, e.xmm3, 0b10101010);
+      return;
+    }
+
     // Shift 8 words in src1 by amount specified in src2.
     Xbyak::Label emu, end;
 
@@ -1184,7 +1315,6 @@ struct VECTOR_SHA_V128
   }
 
   static void EmitInt8(X64Emitter& e, const EmitArgType& i) {
-    // TODO(benvanik): native version (with shift magic).
     if (i.src2.is_constant) {
       if (e.IsFeatureEnabled(kX64EmitGFNI)) {
         const auto& shamt = i.src2.constant();
@@ -1207,13 +1337,17 @@ struct VECTOR_SHA_V128
           return;
         }
       }
-      e.lea(e.GetNativeParam(1), e.StashConstantXmm(1, i.src2.constant()));
-    } else {
-      e.lea(e.GetNativeParam(1), e.StashXmm(1, i.src2));
     }
-    e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-    e.CallNativeSafe(reinterpret_cast<void*>(EmulateVectorShr<int8_t>));
-    e.vmovaps(i.dest, e.xmm0);
+
+    // Take the high halves of the products of the odd bytes and of the even
+    // bytes moved to the high halves of the words by 0x100 >> count.
+    LoadShrMultipliersInt8(e, i.src2);
+    e.vpsllw(e.xmm3, i.src1, 8);
+    e.vpmulhw(e.xmm1, e.xmm3, e.xmm1);
+    e.vpand(e.xmm1, e.xmm1, e.GetXmmConstPtr(XMMMaskEvenPI8));
+    e.vpmulhw(e.xmm0, e.xmm0, i.src1);
+    e.vpsllw(e.xmm0, e.xmm0, 8);
+    e.vpor(i.dest, e.xmm0, e.xmm1);
   }
 
   static void EmitInt16(X64Emitter& e, const EmitArgType& i) {
@@ -1233,6 +1367,23 @@ struct VECTOR_SHA_V128
       }
     }
 
+    if (e.IsFeatureEnabled(kX64EmitAVX512Ortho | kX64EmitAVX512BW)) {
+      LoadShiftCountsInt16(e, i.src2);
+      e.vpsravw(i.dest, i.src1, e.xmm0);
+      return;
+    }
+    if (e.IsFeatureEnabled(kX64EmitAVX2)) {
+      // Shift the odd words in the high halves of the dwords, and the even
+      // words moved to the high halves.
+      LoadShiftCountsInt16Split(e, i.src2);
+      e.vpsravd(e.xmm3, i.src1, e.xmm1);
+      e.vpslld(e.xmm1, i.src1, 16);
+      e.vpsravd(e.xmm1, e.xmm1, e.xmm0);
+      e.vpsrld(e.xmm1, e.xmm1, 16);
+      e.vpblendw(i.dest, e.xmm1, e.xmm3, 0b10101010);
+      return;
+    }
+
     // Shift 8 words in src1 by amount specified in src2.
     Xbyak::Label emu, end;
 
@@ -1357,19 +1508,32 @@ struct VECTOR_ROTATE_LEFT_V128
   static void Emit(X64Emitter& e, const EmitArgType& i) {
     switch (i.instr->flags) {
       case INT8_TYPE:
-        // TODO(benvanik): native version (with shift magic).
-        if (i.src2.is_constant) {
-          e.lea(e.GetNativeParam(1), e.StashConstantXmm(1, i.src2.constant()));
-        } else {
-          e.lea(e.GetNativeParam(1), e.StashXmm(1, i.src2));
-        }
-        e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-        e.CallNativeSafe(
-            reinterpret_cast<void*>(EmulateVectorRotateLeft<uint8_t>));
-        e.vmovaps(i.dest, e.xmm0);
+        EmitInt8(e, i);
         break;
       case INT16_TYPE:
-        // TODO(benvanik): native version (with shift magic).
+        if (e.IsFeatureEnabled(kX64EmitAVX512Ortho | kX64EmitAVX512BW)) {
+          // Shift right by 16 - count as by 1 and then by count ^ 15, which
+          // needs no constant.
+          LoadShiftCountsInt16(e, i.src2);
+          e.vpsllvw(e.xmm1, i.src1, e.xmm0);
+          e.vpxor(e.xmm0, e.xmm0, e.GetXmmConstPtr(XMMShiftMaskPI16));
+          e.vpsrlw(e.xmm3, i.src1, 1);
+          e.vpsrlvw(e.xmm0, e.xmm3, e.xmm0);
+          e.vpor(i.dest, e.xmm0, e.xmm1);
+          break;
+        }
+        if (e.IsFeatureEnabled(kX64EmitAVX2)) {
+          // Shifting a word duplicated in both halves of a dword left leaves
+          // it rotated in the high half.
+          LoadShiftCountsInt16Split(e, i.src2);
+          e.vpshufb(e.xmm3, i.src1, e.GetXmmConstPtr(XMMDuplicateEvenPI16));
+          e.vpsllvd(e.xmm3, e.xmm3, e.xmm0);
+          e.vpsrld(e.xmm3, e.xmm3, 16);
+          e.vpshufb(e.xmm0, i.src1, e.GetXmmConstPtr(XMMDuplicateOddPI16));
+          e.vpsllvd(e.xmm0, e.xmm0, e.xmm1);
+          e.vpblendw(i.dest, e.xmm3, e.xmm0, 0b10101010);
+          break;
+        }
         if (i.src2.is_constant) {
           e.lea(e.GetNativeParam(1), e.StashConstantXmm(1, i.src2.constant()));
         } else {
@@ -1422,31 +1586,27 @@ struct VECTOR_ROTATE_LEFT_V128
         break;
     }
   }
+
+  static void EmitInt8(X64Emitter& e, const EmitArgType& i) {
+    // Multiplying a byte duplicated in both halves of a word by 1 << count
+    // leaves it rotated in the high half.
+    LoadShlMultipliersInt8(e, i.src2);
+    e.vpshufb(e.xmm1, i.src1, e.GetXmmConstPtr(XMMDuplicateEvenPI8));
+    e.vpand(e.xmm3, e.xmm0, e.GetXmmConstPtr(XMMMaskEvenPI8));
+    e.vpmullw(e.xmm1, e.xmm1, e.xmm3);
+    e.vpsrlw(e.xmm1, e.xmm1, 8);
+    e.vpshufb(e.xmm3, i.src1, e.GetXmmConstPtr(XMMDuplicateOddPI8));
+    e.vpsrlw(e.xmm0, e.xmm0, 8);
+    e.vpmullw(e.xmm0, e.xmm0, e.xmm3);
+    e.vpand(e.xmm0, e.xmm0, e.GetXmmConstPtr(XMMMaskOddPI8));
+    e.vpor(i.dest, e.xmm0, e.xmm1);
+  }
 };
 EMITTER_OPCODE_TABLE(OPCODE_VECTOR_ROTATE_LEFT, VECTOR_ROTATE_LEFT_V128);
 
 // ============================================================================
 // OPCODE_VECTOR_AVERAGE
 // ============================================================================
-template <typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
-static __m128i EmulateVectorAverage(void*, __m128i src1, __m128i src2) {
-  alignas(16) T src1v[16 / sizeof(T)];
-  alignas(16) T src2v[16 / sizeof(T)];
-  alignas(16) T value[16 / sizeof(T)];
-
-  // Load SSE registers into a C array.
-  _mm_store_si128(reinterpret_cast<__m128i*>(src1v), src1);
-  _mm_store_si128(reinterpret_cast<__m128i*>(src2v), src2);
-
-  for (size_t i = 0; i < (16 / sizeof(T)); ++i) {
-    auto t = (uint64_t(src1v[i]) + uint64_t(src2v[i]) + 1) / 2;
-    value[i] = T(t);
-  }
-
-  // Store result and return it.
-  return _mm_load_si128(reinterpret_cast<__m128i*>(value));
-}
-
 struct VECTOR_AVERAGE
     : Sequence<VECTOR_AVERAGE,
                I<OPCODE_VECTOR_AVERAGE, V128Op, V128Op, V128Op>> {
@@ -1474,30 +1634,16 @@ struct VECTOR_AVERAGE
               }
               break;
             case INT32_TYPE:
-              // No 32bit averages in AVX.
+              // No 32bit averages in AVX, but (a + b + 1) >> 1 is
+              // (a | b) - ((a ^ b) >> 1) without overflowing.
+              e.vpxor(e.xmm1, src1, src2);
               if (is_unsigned) {
-                if (i.src2.is_constant) {
-                  e.lea(e.GetNativeParam(1),
-                        e.StashConstantXmm(1, i.src2.constant()));
-                } else {
-                  e.lea(e.GetNativeParam(1), e.StashXmm(1, i.src2));
-                }
-                e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-                e.CallNativeSafe(
-                    reinterpret_cast<void*>(EmulateVectorAverage<uint32_t>));
-                e.vmovaps(i.dest, e.xmm0);
+                e.vpsrld(e.xmm1, e.xmm1, 1);
               } else {
-                if (i.src2.is_constant) {
-                  e.lea(e.GetNativeParam(1),
-                        e.StashConstantXmm(1, i.src2.constant()));
-                } else {
-                  e.lea(e.GetNativeParam(1), e.StashXmm(1, i.src2));
-                }
-                e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-                e.CallNativeSafe(
-                    reinterpret_cast<void*>(EmulateVectorAverage<int32_t>));
-                e.vmovaps(i.dest, e.xmm0);
+                e.vpsrad(e.xmm1, e.xmm1, 1);
               }
+              e.vpor(e.xmm2, src1, src2);
+              e.vpsubd(dest, e.xmm2, e.xmm1);
               break;
             default:
               assert_unhandled_case(part_type);
@@ -2252,54 +2398,28 @@ struct PACK : Sequence<PACK, I<OPCODE_PACK, V128Op, V128Op, V128Op>> {
     // Merge XZ and YW.
     e.vorps(i.dest, e.xmm0);
   }
-  static __m128i EmulatePack8_IN_16_UN_UN_SAT(void*, __m128i src1,
-                                              __m128i src2) {
-    alignas(16) uint16_t a[8];
-    alignas(16) uint16_t b[8];
-    alignas(16) uint8_t c[16];
-    _mm_store_si128(reinterpret_cast<__m128i*>(a), src1);
-    _mm_store_si128(reinterpret_cast<__m128i*>(b), src2);
-    for (int i = 0; i < 8; ++i) {
-      c[i] = uint8_t(std::max(uint16_t(0), std::min(uint16_t(255), a[i])));
-      c[i + 8] = uint8_t(std::max(uint16_t(0), std::min(uint16_t(255), b[i])));
-    }
-    return _mm_load_si128(reinterpret_cast<__m128i*>(c));
-  }
-  static __m128i EmulatePack8_IN_16_UN_UN(void*, __m128i src1, __m128i src2) {
-    alignas(16) uint8_t a[16];
-    alignas(16) uint8_t b[16];
-    alignas(16) uint8_t c[16];
-    _mm_store_si128(reinterpret_cast<__m128i*>(a), src1);
-    _mm_store_si128(reinterpret_cast<__m128i*>(b), src2);
-    for (int i = 0; i < 8; ++i) {
-      c[i] = a[i * 2];
-      c[i + 8] = b[i * 2];
-    }
-    return _mm_load_si128(reinterpret_cast<__m128i*>(c));
-  }
   static void Emit8_IN_16(X64Emitter& e, const EmitArgType& i, uint32_t flags) {
     // TODO(benvanik): handle src2 (or src1) being constant zero
     if (IsPackInUnsigned(flags)) {
       if (IsPackOutUnsigned(flags)) {
         if (IsPackOutSaturate(flags)) {
           // unsigned -> unsigned + saturate
+          // Clamp to 0xFF so PACKUSWB doesn't see the words as negative.
           if (i.src2.is_constant) {
-            e.lea(e.GetNativeParam(1),
-                  e.StashConstantXmm(1, i.src2.constant()));
+            e.LoadConstantXmm(e.xmm1, i.src2.constant());
+            e.vpminuw(e.xmm1, e.xmm1, e.GetXmmConstPtr(XMMMaskEvenPI8));
           } else {
-            e.lea(e.GetNativeParam(1), e.StashXmm(1, i.src2));
+            e.vpminuw(e.xmm1, i.src2, e.GetXmmConstPtr(XMMMaskEvenPI8));
           }
-          e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-          e.CallNativeSafe(
-              reinterpret_cast<void*>(EmulatePack8_IN_16_UN_UN_SAT));
-          e.vmovaps(i.dest, e.xmm0);
+          e.vpminuw(e.xmm0, i.src1, e.GetXmmConstPtr(XMMMaskEvenPI8));
+          e.vpackuswb(i.dest, e.xmm0, e.xmm1);
           e.vpshufb(i.dest, i.dest, e.GetXmmConstPtr(XMMByteOrderMask));
         } else {
           // unsigned -> unsigned
-          e.lea(e.GetNativeParam(1), e.StashXmm(1, i.src2));
-          e.lea(e.GetNativeParam(0), e.StashXmm(0, i.src1));
-          e.CallNativeSafe(reinterpret_cast<void*>(EmulatePack8_IN_16_UN_UN));
-          e.vmovaps(i.dest, e.xmm0);
+          // Truncate to the low bytes, which PACKUSWB then leaves unchanged.
+          e.vpand(e.xmm1, i.src2, e.GetXmmConstPtr(XMMMaskEvenPI8));
+          e.vpand(e.xmm0, i.src1, e.GetXmmConstPtr(XMMMaskEvenPI8));
+          e.vpackuswb(i.dest, e.xmm0, e.xmm1);
           e.vpshufb(i.dest, i.dest, e.GetXmmConstPtr(XMMByteOrderMask));
         }
       } else {
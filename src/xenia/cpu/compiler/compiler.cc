@@ -9,8 +9,10 @@
 
 #include "xenia/cpu/compiler/compiler.h"
 
+#include "xenia/base/clock.h"
 #include "xenia/base/profiling.h"
 #include "xenia/cpu/compiler/compiler_pass.h"
+#include "xenia/cpu/translation_statistics.h"
 
 namespace xe {
 namespace cpu {
@@ -25,7 +27,12 @@ void Compiler::AddPass(std::unique_ptr<CompilerPass> pass) {
   passes_.push_back(std::move(pass));
 }
 
-void Compiler::Reset() {}
+void Compiler::AddConstantMemoryDependency(uint32_t address,
+                                           uint32_t length) {
+  constant_memory_dependencies_.emplace_back(address, length);
+}
+
+void Compiler::Reset() { constant_memory_dependencies_.clear(); }
 
 bool Compiler::Compile(xe::cpu::hir::HIRBuilder* builder) {
   // TODO(benvanik): sophisticated stuff. Run passes in parallel, run until they
@@ -33,7 +40,8 @@ bool Compiler::Compile(xe::cpu::hir::HIRBuilder* builder) {
   for (size_t i = 0; i < passes_.size(); ++i) {
     auto& pass = passes_[i];
     scratch_arena_.Reset();
-    if (!pass->Run(builder)) {
+    if (!RunPass(builder, pass->name(),
+                 [&]() { return pass->Run(builder); })) {
       return false;
     }
   }
@@ -41,6 +49,24 @@ bool Compiler::Compile(xe::cpu::hir::HIRBuilder* builder) {
   return true;
 }
 
+bool Compiler::RunPassWithStatistics(hir::HIRBuilder* builder,
+                                     const std::string_view name,
+                                     const std::function<bool()>& run) {
+  uint64_t measure_start_ticks = Clock::QueryHostTickCount();
+  auto size_before = TranslationStatistics::HIRSize::Measure(builder);
+  uint64_t start_ticks = Clock::QueryHostTickCount();
+  statistics_ticks_ += start_ticks - measure_start_ticks;
+  uint64_t nested_statistics_ticks = statistics_ticks_;
+  bool result = run();
+  uint64_t end_ticks = Clock::QueryHostTickCount();
+  nested_statistics_ticks = statistics_ticks_ - nested_statistics_ticks;
+  statistics_->RecordPhase(
+      name, end_ticks - start_ticks - nested_statistics_ticks, size_before,
+      TranslationStatistics::HIRSize::Measure(builder));
+  statistics_ticks_ += Clock::QueryHostTickCount() - end_ticks;
+  return result;
+}
+
 }  // namespace compiler
 }  // namespace cpu
 }  // namespace xe
@@ -10,7 +10,10 @@
 #ifndef XENIA_CPU_COMPILER_COMPILER_H_
 #define XENIA_CPU_COMPILER_COMPILER_H_
 
+#include <functional>
 #include <memory>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "xenia/base/arena.h"
@@ -19,6 +22,7 @@
 namespace xe {
 namespace cpu {
 class Processor;
+class TranslationStatistics;
 }  // namespace cpu
 }  // namespace xe
 
@@ -36,15 +40,51 @@ class Compiler {
   Processor* processor() const { return processor_; }
   Arena* scratch_arena() { return &scratch_arena_; }
 
+  // Statistics the time and HIR size of each pass are recorded to, or null.
+  TranslationStatistics* statistics() const { return statistics_; }
+  void set_statistics(TranslationStatistics* statistics) {
+    statistics_ = statistics;
+  }
+
   void AddPass(std::unique_ptr<CompilerPass> pass);
 
+  // Guest memory that has been read at translation time because it's
+  // read-only, with the function needing to be retranslated if it becomes
+  // writable. Cleared by Reset.
+  void AddConstantMemoryDependency(uint32_t address, uint32_t length);
+  const std::vector<std::pair<uint32_t, uint32_t>>&
+  constant_memory_dependencies() const {
+    return constant_memory_dependencies_;
+  }
+
   void Reset();
 
   bool Compile(hir::HIRBuilder* builder);
 
+  // Runs a pass, recording it to the statistics under the given name if
+  // they're being collected.
+  template <typename F>
+  bool RunPass(hir::HIRBuilder* builder, const std::string_view name,
+               F&& run) {
+    if (!statistics_) {
+      return run();
+    }
+    return RunPassWithStatistics(builder, name, std::forward<F>(run));
+  }
+
  private:
+  bool RunPassWithStatistics(hir::HIRBuilder* builder,
+                             const std::string_view name,
+                             const std::function<bool()>& run);
+
   Processor* processor_;
   Arena scratch_arena_;
+  TranslationStatistics* statistics_ = nullptr;
+  // Spent measuring and recording passes, excluded from the time of the passes
+  // they're nested in.
+  uint64_t statistics_ticks_ = 0;
+  // Address and length.
+  std::vector<std::pair<uint32_t, uint32_t>> constant_memory_dependencies_;
 
   std::vector<std::unique_ptr<CompilerPass>> passes_;
 };
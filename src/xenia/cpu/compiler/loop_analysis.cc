@@ -0,0 +1,242 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compiler/loop_analysis.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "xenia/base/assert.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace xe::cpu::hir;
+
+using xe::cpu::hir::Block;
+using xe::cpu::hir::HIRBuilder;
+using xe::cpu::hir::Instr;
+
+void LoopAnalysis::GatherSuccessors(Block* block,
+                                    std::vector<uint32_t>& successors) {
+  successors.clear();
+  for (Instr* instr = block->instr_tail;
+       instr && (instr->opcode->flags & OPCODE_FLAG_BRANCH);
+       instr = instr->prev) {
+    if (instr->opcode == &OPCODE_BRANCH_info) {
+      successors.push_back(instr->src1.label->block->ordinal);
+    } else if (instr->opcode == &OPCODE_BRANCH_TRUE_info ||
+               instr->opcode == &OPCODE_BRANCH_FALSE_info) {
+      successors.push_back(instr->src2.label->block->ordinal);
+    }
+  }
+  Instr* tail = block->instr_tail;
+  bool falls_through =
+      !tail || !(tail->opcode == &OPCODE_BRANCH_info ||
+                 tail->opcode == &OPCODE_RETURN_info ||
+                 ((tail->opcode == &OPCODE_CALL_info ||
+                   tail->opcode == &OPCODE_CALL_INDIRECT_info) &&
+                  (tail->flags & CALL_TAIL)));
+  if (falls_through && block->next) {
+    successors.push_back(block->next->ordinal);
+  }
+  std::sort(successors.begin(), successors.end());
+  successors.erase(std::unique(successors.begin(), successors.end()),
+                   successors.end());
+}
+
+bool LoopAnalysis::Analyze(HIRBuilder* builder) {
+  blocks_.clear();
+  loops_.clear();
+  for (Block* block = builder->first_block(); block; block = block->next) {
+    // Ordinals are 16-bit.
+    if (blocks_.size() > UINT16_MAX) {
+      return false;
+    }
+    block->ordinal = uint16_t(blocks_.size());
+    blocks_.push_back(block);
+  }
+  uint32_t block_count = uint32_t(blocks_.size());
+  if (!block_count) {
+    return true;
+  }
+
+  successors_.resize(block_count);
+  predecessors_.resize(block_count);
+  for (uint32_t i = 0; i < block_count; ++i) {
+    predecessors_[i].clear();
+  }
+  for (uint32_t i = 0; i < block_count; ++i) {
+    GatherSuccessors(blocks_[i], successors_[i]);
+    for (uint32_t successor : successors_[i]) {
+      predecessors_[successor].push_back(i);
+    }
+  }
+
+  // Reverse postorder of the blocks reachable from the entry.
+  std::vector<uint32_t> postorder;
+  postorder.reserve(block_count);
+  std::vector<bool> visited(block_count, false);
+  // Block and index of the next successor to visit.
+  std::vector<std::pair<uint32_t, size_t>> stack;
+  stack.emplace_back(0, 0);
+  visited[0] = true;
+  while (!stack.empty()) {
+    auto& top = stack.back();
+    const std::vector<uint32_t>& successors = successors_[top.first];
+    if (top.second < successors.size()) {
+      uint32_t successor = successors[top.second++];
+      if (!visited[successor]) {
+        visited[successor] = true;
+        stack.emplace_back(successor, 0);
+      }
+    } else {
+      postorder.push_back(top.first);
+      stack.pop_back();
+    }
+  }
+  rpo_numbers_.assign(block_count, kInvalidIndex);
+  for (size_t i = 0; i < postorder.size(); ++i) {
+    rpo_numbers_[postorder[i]] = uint32_t(postorder.size() - 1 - i);
+  }
+
+  // Iterative dominators, from "A Simple, Fast Dominance Algorithm" by Cooper,
+  // Harvey and Kennedy.
+  idoms_.assign(block_count, kInvalidIndex);
+  idoms_[0] = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto it = postorder.rbegin(); it != postorder.rend(); ++it) {
+      uint32_t block_index = *it;
+      if (!block_index) {
+        continue;
+      }
+      uint32_t new_idom = kInvalidIndex;
+      for (uint32_t predecessor : predecessors_[block_index]) {
+        if (idoms_[predecessor] == kInvalidIndex) {
+          continue;
+        }
+        if (new_idom == kInvalidIndex) {
+          new_idom = predecessor;
+          continue;
+        }
+        uint32_t a = predecessor, b = new_idom;
+        while (a != b) {
+          while (rpo_numbers_[a] > rpo_numbers_[b]) {
+            a = idoms_[a];
+          }
+          while (rpo_numbers_[b] > rpo_numbers_[a]) {
+            b = idoms_[b];
+          }
+        }
+        new_idom = a;
+      }
+      if (idoms_[block_index] != new_idom) {
+        idoms_[block_index] = new_idom;
+        changed = true;
+      }
+    }
+  }
+
+  // Natural loops of the back edges, with the loops sharing a header merged.
+  std::vector<uint32_t> header_loops(block_count, kInvalidIndex);
+  std::vector<uint32_t> worklist;
+  for (uint32_t tail_index : postorder) {
+    for (uint32_t header_index : successors_[tail_index]) {
+      if (!Dominates(blocks_[header_index], blocks_[tail_index])) {
+        continue;
+      }
+      if (header_loops[header_index] == kInvalidIndex) {
+        header_loops[header_index] = uint32_t(loops_.size());
+        loops_.emplace_back();
+        Loop& new_loop = loops_.back();
+        new_loop.header = blocks_[header_index];
+        new_loop.preheader = nullptr;
+        new_loop.contains.resize(block_count, false);
+        new_loop.contains[header_index] = true;
+        new_loop.blocks.push_back(new_loop.header);
+      }
+      Loop& loop = loops_[header_loops[header_index]];
+      worklist.clear();
+      worklist.push_back(tail_index);
+      while (!worklist.empty()) {
+        uint32_t block_index = worklist.back();
+        worklist.pop_back();
+        if (loop.contains[block_index]) {
+          continue;
+        }
+        loop.contains[block_index] = true;
+        loop.blocks.push_back(blocks_[block_index]);
+        for (uint32_t predecessor : predecessors_[block_index]) {
+          if (rpo_numbers_[predecessor] != kInvalidIndex) {
+            worklist.push_back(predecessor);
+          }
+        }
+      }
+    }
+  }
+
+  for (Loop& loop : loops_) {
+    uint32_t outside_predecessor = kInvalidIndex;
+    for (uint32_t predecessor : predecessors_[loop.header->ordinal]) {
+      if (loop.contains[predecessor] ||
+          rpo_numbers_[predecessor] == kInvalidIndex) {
+        continue;
+      }
+      if (outside_predecessor != kInvalidIndex) {
+        outside_predecessor = kInvalidIndex;
+        break;
+      }
+      outside_predecessor = predecessor;
+    }
+    if (outside_predecessor != kInvalidIndex &&
+        successors_[outside_predecessor].size() == 1) {
+      assert_true(successors_[outside_predecessor][0] ==
+                  loop.header->ordinal);
+      loop.preheader = blocks_[outside_predecessor];
+    }
+  }
+
+  // A loop nested in another has fewer blocks.
+  std::stable_sort(loops_.begin(), loops_.end(),
+                   [](const Loop& a, const Loop& b) {
+                     return a.blocks.size() < b.blocks.size();
+                   });
+  return true;
+}
+
+Block* LoopAnalysis::immediate_dominator(const Block* block) const {
+  uint32_t idom = idoms_[block->ordinal];
+  if (!block->ordinal || idom == kInvalidIndex) {
+    return nullptr;
+  }
+  return blocks_[idom];
+}
+
+bool LoopAnalysis::Dominates(const Block* dominator, const Block* block) const {
+  uint32_t dominator_index = dominator->ordinal;
+  uint32_t block_index = block->ordinal;
+  if (rpo_numbers_[block_index] == kInvalidIndex) {
+    return false;
+  }
+  while (block_index != dominator_index) {
+    if (!block_index) {
+      return false;
+    }
+    block_index = idoms_[block_index];
+  }
+  return true;
+}
+
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,74 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_COMPILER_LOOP_ANALYSIS_H_
+#define XENIA_CPU_COMPILER_LOOP_ANALYSIS_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "xenia/cpu/hir/hir_builder.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+
+// Dominator tree and natural loops of the HIR control flow graph.
+// Successors are taken from the branches at the end of each block (and the
+// fallthrough, if any), so this doesn't depend on the edges of
+// ControlFlowAnalysisPass being up to date.
+// Renumbers the block ordinals.
+class LoopAnalysis {
+ public:
+  struct Loop {
+    hir::Block* header;
+    // The only predecessor of the header outside of the loop if it branches
+    // nowhere else, or null. Code placed before its branches runs once
+    // before the loop is entered.
+    hir::Block* preheader;
+    // Including the header, in no particular order.
+    std::vector<hir::Block*> blocks;
+    // Indexed by block ordinal.
+    std::vector<bool> contains;
+
+    bool Contains(const hir::Block* block) const {
+      return contains[block->ordinal];
+    }
+  };
+
+  // Returns false if the function is too large to be analyzed.
+  bool Analyze(hir::HIRBuilder* builder);
+
+  // Innermost loops first, so code hoisted out of an inner loop can be
+  // hoisted further by the enclosing one.
+  const std::vector<Loop>& loops() const { return loops_; }
+
+  // Null for the entry block and unreachable blocks.
+  hir::Block* immediate_dominator(const hir::Block* block) const;
+  bool Dominates(const hir::Block* dominator, const hir::Block* block) const;
+
+ private:
+  static constexpr uint32_t kInvalidIndex = UINT32_MAX;
+
+  void GatherSuccessors(hir::Block* block, std::vector<uint32_t>& successors);
+
+  std::vector<hir::Block*> blocks_;
+  std::vector<std::vector<uint32_t>> successors_;
+  std::vector<std::vector<uint32_t>> predecessors_;
+  // Position of each block in the reverse postorder, invalid if unreachable.
+  std::vector<uint32_t> rpo_numbers_;
+  std::vector<uint32_t> idoms_;
+  std::vector<Loop> loops_;
+};
+
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_COMPILER_LOOP_ANALYSIS_H_
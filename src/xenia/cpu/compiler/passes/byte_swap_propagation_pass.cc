@@ -0,0 +1,218 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compiler/passes/byte_swap_propagation_pass.h"
+
+#include "xenia/base/profiling.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace xe::cpu::hir;
+
+using xe::cpu::hir::HIRBuilder;
+using xe::cpu::hir::Instr;
+using xe::cpu::hir::Value;
+
+ByteSwapPropagationPass::ByteSwapPropagationPass() : CompilerPass() {}
+
+ByteSwapPropagationPass::~ByteSwapPropagationPass() = default;
+
+bool ByteSwapPropagationPass::Run(HIRBuilder* builder) {
+  // Guest data is big-endian, so values are often swapped after loading,
+  // combined and swapped back before storing:
+  //   v1.i32 = load v0
+  //   v2.i32 = byte_swap v1.i32
+  //   v3.i32 = and v2.i32, 0xFF000000
+  //   v4.i32 = byte_swap v3.i32
+  //   store v0, v4.i32
+  // The swaps are moved past the operations that work the same in either
+  // byte order, with constants swapped instead:
+  //   v1.i32 = load v0
+  //   v5.i32 = and v1.i32, 0x000000FF
+  //   v3.i32 = byte_swap v5.i32
+  //   v4.i32 = byte_swap v3.i32
+  //   store v0, v4.i32
+  // where the pair of swaps cancels out:
+  //   v1.i32 = load v0
+  //   v5.i32 = and v1.i32, 0x000000FF
+  //   v3.i32 = byte_swap v5.i32 (may be dead code removed later)
+  //   v4.i32 = v5.i32
+  //   store v0, v4.i32
+  // Equality comparisons don't need the swap at all.
+  //
+  // Values don't live across blocks, so this is done in one forward walk of
+  // each block, with the swaps created for the results of rewritten
+  // instructions propagating further down.
+  bool result = false;
+  auto block = builder->first_block();
+  while (block) {
+    builder->set_current_block(block);
+    auto i = block->instr_head;
+    while (i) {
+      auto next = i->next;
+      switch (i->opcode->num) {
+        case OPCODE_AND:
+        case OPCODE_AND_NOT:
+        case OPCODE_OR:
+        case OPCODE_XOR:
+        case OPCODE_NOT:
+        case OPCODE_PERMUTE:
+        case OPCODE_SWIZZLE:
+          result |= PropagateThroughBitwise(builder, i);
+          break;
+        case OPCODE_BYTE_SWAP:
+          if (!i->src1.value->IsConstant() && HasUnswapped(i->src1.value)) {
+            // Done here rather than left to SimplificationPass, so the swaps
+            // aren't folded into stores by MemorySequenceCombinationPass.
+            Value* value = GetUnswapped(builder, i->src1.value);
+            i->Replace(&OPCODE_ASSIGN_info, 0);
+            i->set_src1(value);
+            result = true;
+          }
+          break;
+        case OPCODE_COMPARE_EQ:
+        case OPCODE_COMPARE_NE:
+          result |= PropagateThroughCompare(builder, i);
+          break;
+        default:
+          break;
+      }
+      i = next;
+    }
+    block = block->next;
+  }
+  builder->set_current_block(nullptr);
+  return result;
+}
+
+bool ByteSwapPropagationPass::HasUnswapped(Value* value) {
+  if (value->type == INT8_TYPE || value->type == FLOAT32_TYPE ||
+      value->type == FLOAT64_TYPE) {
+    return false;
+  }
+  if (value->IsConstant()) {
+    return true;
+  }
+  auto def = value->def;
+  while (def && def->opcode == &OPCODE_ASSIGN_info) {
+    // Skip asignments.
+    def = def->src1.value->def;
+  }
+  return def && def->opcode == &OPCODE_BYTE_SWAP_info &&
+         def->src1.value->type == value->type;
+}
+
+Value* ByteSwapPropagationPass::GetUnswapped(HIRBuilder* builder,
+                                             Value* value) {
+  if (value->IsConstant()) {
+    Value* swapped = builder->CloneValue(value);
+    swapped->ByteSwap();
+    return swapped;
+  }
+  auto def = value->def;
+  while (def->opcode == &OPCODE_ASSIGN_info) {
+    def = def->src1.value->def;
+  }
+  return def->src1.value;
+}
+
+bool ByteSwapPropagationPass::PropagateThroughBitwise(HIRBuilder* builder,
+                                                      Instr* i) {
+  // Vector swaps reverse the bytes of each 32-bit element, so they can only
+  // be moved past permutes of whole 32-bit elements.
+  Value* sources[3] = {};
+  if (i->opcode == &OPCODE_PERMUTE_info) {
+    if (i->flags != INT32_TYPE) {
+      return false;
+    }
+    sources[1] = i->src2.value;
+    sources[2] = i->src3.value;
+  } else if (i->opcode == &OPCODE_SWIZZLE_info) {
+    if (i->flags != INT32_TYPE && i->flags != FLOAT32_TYPE) {
+      return false;
+    }
+    sources[0] = i->src1.value;
+  } else if (i->opcode == &OPCODE_NOT_info) {
+    sources[0] = i->src1.value;
+  } else {
+    sources[0] = i->src1.value;
+    sources[1] = i->src2.value;
+  }
+
+  // Only when at least one of the swaps would become dead, otherwise the
+  // swap of the result would be an additional instruction.
+  bool removes_swap = false;
+  for (Value* source : sources) {
+    if (!source || source->IsConstant()) {
+      continue;
+    }
+    bool used_only_here = true;
+    for (auto use = source->use_head; use; use = use->next) {
+      if (use->instr != i) {
+        used_only_here = false;
+        break;
+      }
+    }
+    if (used_only_here) {
+      removes_swap = true;
+      break;
+    }
+  }
+  if (!removes_swap) {
+    return false;
+  }
+
+  for (Value* source : sources) {
+    if (source && !HasUnswapped(source)) {
+      return false;
+    }
+  }
+
+  Value* unswapped[3] = {};
+  for (size_t n = 0; n < 3; ++n) {
+    if (sources[n]) {
+      unswapped[n] = GetUnswapped(builder, sources[n]);
+    }
+  }
+  // The permute control isn't swapped.
+  if (i->opcode == &OPCODE_PERMUTE_info) {
+    unswapped[0] = i->src1.value;
+  }
+  Value* value =
+      builder->CloneInstr(i, unswapped[0], unswapped[1], unswapped[2]);
+  value->def->MoveBefore(i);
+  i->Replace(&OPCODE_BYTE_SWAP_info, 0);
+  i->set_src1(value);
+  i->src2.value = i->src3.value = NULL;
+  return true;
+}
+
+bool ByteSwapPropagationPass::PropagateThroughCompare(HIRBuilder* builder,
+                                                      Instr* i) {
+  Value* src1 = i->src1.value;
+  Value* src2 = i->src2.value;
+  if (src1->IsConstant() && src2->IsConstant()) {
+    return false;
+  }
+  if (!HasUnswapped(src1) || !HasUnswapped(src2)) {
+    return false;
+  }
+  i->set_src1(GetUnswapped(builder, src1));
+  i->set_src2(GetUnswapped(builder, src2));
+  return true;
+}
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
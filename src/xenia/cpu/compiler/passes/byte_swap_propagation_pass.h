@@ -0,0 +1,45 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_COMPILER_PASSES_BYTE_SWAP_PROPAGATION_PASS_H_
+#define XENIA_CPU_COMPILER_PASSES_BYTE_SWAP_PROPAGATION_PASS_H_
+
+#include "xenia/cpu/compiler/compiler_pass.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// Moves byte swaps past the operations that don't depend on the byte order,
+// so swaps cancel each other out or end up next to loads and stores where
+// MemorySequenceCombinationPass can fold them.
+class ByteSwapPropagationPass : public CompilerPass {
+ public:
+  ByteSwapPropagationPass();
+  ~ByteSwapPropagationPass() override;
+
+  const char* name() const override { return "ByteSwapPropagationPass"; }
+
+  bool Run(hir::HIRBuilder* builder) override;
+
+ private:
+  bool PropagateThroughBitwise(hir::HIRBuilder* builder, hir::Instr* i);
+  bool PropagateThroughCompare(hir::HIRBuilder* builder, hir::Instr* i);
+  // Whether the value is a constant or the result of a byte swap.
+  bool HasUnswapped(hir::Value* value);
+  hir::Value* GetUnswapped(hir::HIRBuilder* builder, hir::Value* value);
+};
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_COMPILER_PASSES_BYTE_SWAP_PROPAGATION_PASS_H_
@@ -57,12 +57,15 @@ bool ConditionalGroupPass::Run(HIRBuilder* builder) {
       auto& pass = passes_[i];
       auto subpass = dynamic_cast<ConditionalGroupSubpass*>(pass.get());
       if (!subpass) {
-        if (!pass->Run(builder)) {
+        if (!compiler_->RunPass(builder, pass_names_[i],
+                                [&]() { return pass->Run(builder); })) {
           return false;
         }
       } else {
         bool result = false;
-        if (!subpass->Run(builder, result)) {
+        if (!compiler_->RunPass(builder, pass_names_[i], [&]() {
+              return subpass->Run(builder, result);
+            })) {
           return false;
         }
         dirty |= result;
@@ -74,6 +77,7 @@ bool ConditionalGroupPass::Run(HIRBuilder* builder) {
 }
 
 void ConditionalGroupPass::AddPass(std::unique_ptr<CompilerPass> pass) {
+  pass_names_.push_back(std::string(name()) + "/" + pass->name());
   passes_.push_back(std::move(pass));
 }
 
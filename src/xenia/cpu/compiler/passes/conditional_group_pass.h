@@ -11,6 +11,7 @@
 #define XENIA_CPU_COMPILER_PASSES_CONDITIONAL_GROUP_PASS_H_
 
 #include <cmath>
+#include <string>
 #include <vector>
 
 #include "xenia/base/platform.h"
@@ -27,6 +28,8 @@ class ConditionalGroupPass : public CompilerPass {
   ConditionalGroupPass();
   virtual ~ConditionalGroupPass() override;
 
+  const char* name() const override { return "ConditionalGroupPass"; }
+
   bool Initialize(Compiler* compiler) override;
 
   bool Run(hir::HIRBuilder* builder) override;
@@ -35,6 +38,8 @@ class ConditionalGroupPass : public CompilerPass {
 
  private:
   std::vector<std::unique_ptr<CompilerPass>> passes_;
+  // Names of the passes in translation statistics, nested under the group.
+  std::vector<std::string> pass_names_;
 };
 
 }  // namespace passes
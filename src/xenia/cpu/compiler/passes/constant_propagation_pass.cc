@@ -14,6 +14,7 @@
 #include "xenia/base/assert.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/profiling.h"
+#include "xenia/cpu/compiler/compiler.h"
 #include "xenia/cpu/function.h"
 #include "xenia/cpu/processor.h"
 
@@ -212,7 +213,9 @@ bool ConstantPropagationPass::Run(HIRBuilder* builder, bool& result) {
 
         case OPCODE_LOAD:
         case OPCODE_LOAD_OFFSET:
-          if (i->src1.value->IsConstant()) {
+          if (i->src1.value->IsConstant() &&
+              (i->opcode->num != OPCODE_LOAD_OFFSET ||
+               i->src2.value->IsConstant())) {
             assert_false(i->flags & LOAD_STORE_BYTE_SWAP);
             auto memory = processor_->memory();
             auto address = i->src1.value->constant.i32;
@@ -228,46 +231,56 @@ bool ConstantPropagationPass::Run(HIRBuilder* builder, bool& result) {
               i->src2.offset = address;
               result = true;
             } else {
+              // Memory is readonly, such as the read-only data sections of
+              // executables (vtables, pointer tables, float constants) - can
+              // just return the value. The value may span two pages.
               auto heap = memory->LookupHeap(address);
-              uint32_t protect;
+              uint32_t size = uint32_t(GetTypeSize(v->type));
+              uint32_t protect, last_protect;
               if (heap && heap->QueryProtect(address, &protect) &&
                   !(protect & kMemoryProtectWrite) &&
-                  (protect & kMemoryProtectRead)) {
-                // Memory is readonly - can just return the value.
+                  (protect & kMemoryProtectRead) &&
+                  heap->QueryProtect(address + size - 1, &last_protect) &&
+                  !(last_protect & kMemoryProtectWrite) &&
+                  (last_protect & kMemoryProtectRead)) {
                 auto host_addr = memory->TranslateVirtual(address);
+                bool folded = true;
                 switch (v->type) {
                   case INT8_TYPE:
                     v->set_constant(xe::load<uint8_t>(host_addr));
-                    i->Remove();
-                    result = true;
                     break;
                   case INT16_TYPE:
                     v->set_constant(xe::load<uint16_t>(host_addr));
-                    i->Remove();
-                    result = true;
                     break;
                   case INT32_TYPE:
                     v->set_constant(xe::load<uint32_t>(host_addr));
-                    i->Remove();
-                    result = true;
                     break;
                   case INT64_TYPE:
                     v->set_constant(xe::load<uint64_t>(host_addr));
-                    i->Remove();
-                    result = true;
+                    break;
+                  case FLOAT32_TYPE:
+                    v->set_constant(xe::load<float>(host_addr));
+                    break;
+                  case FLOAT64_TYPE:
+                    v->set_constant(xe::load<double>(host_addr));
                     break;
                   case VEC128_TYPE:
                     vec128_t val;
                     val.low = xe::load<uint64_t>(host_addr);
                     val.high = xe::load<uint64_t>(host_addr + 8);
                     v->set_constant(val);
-                    i->Remove();
-                    result = true;
                     break;
                   default:
                     assert_unhandled_case(v->type);
+                    folded = false;
                     break;
                 }
+                if (folded) {
+                  // Retranslated if the memory is made writable later.
+                  compiler_->AddConstantMemoryDependency(address, size);
+                  i->Remove();
+                  result = true;
+                }
               }
             }
           }
@@ -22,6 +22,8 @@ class ControlFlowAnalysisPass : public CompilerPass {
   ControlFlowAnalysisPass();
   ~ControlFlowAnalysisPass() override;
 
+  const char* name() const override { return "ControlFlowAnalysisPass"; }
+
   bool Run(hir::HIRBuilder* builder) override;
 
  private:
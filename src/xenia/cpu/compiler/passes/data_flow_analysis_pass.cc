@@ -70,10 +70,7 @@ void DataFlowAnalysisPass::AnalyzeFlow(HIRBuilder* builder,
   uint32_t max_value_estimate =
       builder->max_value_ordinal() + 1 + block_count * 4;
 
-  // Stash for value map. We may want to maintain this during building.
   auto arena = builder->arena();
-  auto value_map = reinterpret_cast<Value**>(
-      arena->Alloc(sizeof(Value*) * max_value_estimate, alignof(Value)));
 
   // Allocate incoming bitvectors for use by blocks. We don't need outgoing
   // because they are only used during the block iteration.
@@ -101,7 +98,7 @@ void DataFlowAnalysisPass::AnalyzeFlow(HIRBuilder* builder,
     incoming_values.set(v->ordinal);            \
   }                                             \
   assert_true(v->ordinal < max_value_estimate); \
-  value_map[v->ordinal] = v;
+  assert_true(builder->value_at(v->ordinal) == v);
       if (GET_OPCODE_SIG_TYPE_SRC1(signature) == OPCODE_SIG_TYPE_V) {
         SET_INCOMING_VALUE(instr->src1.value);
       }
@@ -130,7 +127,7 @@ void DataFlowAnalysisPass::AnalyzeFlow(HIRBuilder* builder,
     // Add stores for all outgoing values.
     auto outgoing_ordinal = outgoing_values.find_first();
     while (outgoing_ordinal != -1) {
-      Value* src_value = value_map[outgoing_ordinal];
+      Value* src_value = builder->value_at(uint32_t(outgoing_ordinal));
       assert_not_null(src_value);
       if (!src_value->local_slot) {
         src_value->local_slot = builder->AllocLocal(src_value->type);
@@ -166,7 +163,7 @@ void DataFlowAnalysisPass::AnalyzeFlow(HIRBuilder* builder,
     // Add loads for all incoming values and rename them in the block.
     auto incoming_ordinal = incoming_values.find_first();
     while (incoming_ordinal != -1) {
-      Value* src_value = value_map[incoming_ordinal];
+      Value* src_value = builder->value_at(uint32_t(incoming_ordinal));
       assert_not_null(src_value);
       if (!src_value->local_slot) {
         src_value->local_slot = builder->AllocLocal(src_value->type);
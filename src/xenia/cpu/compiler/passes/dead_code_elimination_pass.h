@@ -22,6 +22,8 @@ class DeadCodeEliminationPass : public CompilerPass {
   DeadCodeEliminationPass();
   ~DeadCodeEliminationPass() override;
 
+  const char* name() const override { return "DeadCodeEliminationPass"; }
+
   bool Run(hir::HIRBuilder* builder) override;
 
  private:
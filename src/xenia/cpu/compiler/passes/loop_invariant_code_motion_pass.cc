@@ -0,0 +1,317 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compiler/passes/loop_invariant_code_motion_pass.h"
+
+#include <utility>
+
+#include "xenia/base/math.h"
+#include "xenia/base/profiling.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace xe::cpu::hir;
+
+using xe::cpu::hir::Block;
+using xe::cpu::hir::HIRBuilder;
+using xe::cpu::hir::Instr;
+using xe::cpu::hir::Value;
+
+LoopInvariantCodeMotionPass::LoopInvariantCodeMotionPass() : CompilerPass() {}
+
+LoopInvariantCodeMotionPass::~LoopInvariantCodeMotionPass() {}
+
+bool LoopInvariantCodeMotionPass::Run(HIRBuilder* builder) {
+  if (!loop_analysis_.Analyze(builder)) {
+    return true;
+  }
+  // Inner loops come first, so their hoisted code, now in the preheader, may
+  // be hoisted again out of the enclosing loop.
+  for (const LoopAnalysis::Loop& loop : loop_analysis_.loops()) {
+    if (loop.preheader) {
+      HoistInvariants(builder, loop);
+    }
+    ReduceStrength(builder, loop);
+  }
+  return true;
+}
+
+bool LoopInvariantCodeMotionPass::HoistInvariants(
+    HIRBuilder* builder, const LoopAnalysis::Loop& loop) {
+  stored_context_ranges_.clear();
+  invariant_instrs_.clear();
+  preheader_clones_.clear();
+
+  // Anything that may modify the context in ways not visible in the HIR,
+  // like calls, prevents context loads from being hoisted.
+  bool has_barrier = false;
+  for (Block* block : loop.blocks) {
+    for (Instr* i = block->instr_head; i; i = i->next) {
+      if (i->opcode == &OPCODE_STORE_CONTEXT_info) {
+        size_t offset = size_t(i->src1.offset);
+        stored_context_ranges_.emplace_back(
+            offset, offset + GetTypeSize(i->src2.value->type));
+      } else if (i->opcode == &OPCODE_CONTEXT_BARRIER_info) {
+        has_barrier = true;
+      } else if ((i->opcode->flags & OPCODE_FLAG_VOLATILE) &&
+                 i->opcode != &OPCODE_BRANCH_TRUE_info &&
+                 i->opcode != &OPCODE_BRANCH_FALSE_info &&
+                 i->opcode != &OPCODE_RETURN_info &&
+                 i->opcode != &OPCODE_RETURN_TRUE_info) {
+        has_barrier = true;
+      }
+    }
+  }
+
+  // Values are local to their block, so the definitions of the sources of an
+  // instruction have always been visited before it.
+  std::vector<Instr*> roots;
+  for (Block* block : loop.blocks) {
+    for (Instr* i = block->instr_head; i; i = i->next) {
+      if (i->dest && IsInvariant(i, has_barrier)) {
+        invariant_instrs_.insert(i);
+      }
+    }
+  }
+  if (invariant_instrs_.empty()) {
+    return false;
+  }
+
+  // Only hoist the final results of invariant expressions that are used by
+  // the rest of the loop. Hoisting a lone load or conversion would just
+  // replace it with a load of a local.
+  for (Block* block : loop.blocks) {
+    for (Instr* i = block->instr_head; i; i = i->next) {
+      if (!invariant_instrs_.count(i)) {
+        continue;
+      }
+      switch (i->opcode->num) {
+        case OPCODE_LOAD_CONTEXT:
+        case OPCODE_ASSIGN:
+        case OPCODE_CAST:
+        case OPCODE_ZERO_EXTEND:
+        case OPCODE_SIGN_EXTEND:
+        case OPCODE_TRUNCATE:
+          continue;
+        default:
+          break;
+      }
+      bool is_used_by_variant = false;
+      for (auto use = i->dest->use_head; use; use = use->next) {
+        if (!invariant_instrs_.count(use->instr)) {
+          is_used_by_variant = true;
+          break;
+        }
+      }
+      if (is_used_by_variant) {
+        roots.push_back(i);
+      }
+    }
+  }
+  if (roots.empty()) {
+    return false;
+  }
+
+  // Insert before the branch to the header, if there's one.
+  Block* preheader = loop.preheader;
+  Instr* preheader_tail = preheader->instr_tail;
+  Instr* insert_point = nullptr;
+  for (Instr* i = preheader_tail; i && (i->opcode->flags & OPCODE_FLAG_BRANCH);
+       i = i->prev) {
+    insert_point = i;
+  }
+
+  builder->set_current_block(preheader);
+  for (Instr* root : roots) {
+    Value* slot = builder->AllocLocal(root->dest->type);
+    builder->StoreLocal(slot, CloneInvariant(builder, root->dest));
+    root->Replace(&OPCODE_LOAD_LOCAL_info, 0);
+    root->set_src1(slot);
+    root->src2.value = root->src3.value = NULL;
+  }
+  builder->set_current_block(nullptr);
+
+  if (insert_point) {
+    Instr* i = preheader_tail->next;
+    while (i) {
+      Instr* next = i->next;
+      i->MoveBefore(insert_point);
+      i = next;
+    }
+  }
+
+  // The instructions that only fed the roots are left for dead code
+  // elimination.
+  return true;
+}
+
+bool LoopInvariantCodeMotionPass::IsInvariant(const Instr* i,
+                                              bool has_barrier) const {
+  switch (i->opcode->num) {
+    case OPCODE_LOAD_CONTEXT: {
+      if (has_barrier) {
+        return false;
+      }
+      size_t offset = size_t(i->src1.offset);
+      size_t end = offset + GetTypeSize(i->dest->type);
+      for (const auto& range : stored_context_ranges_) {
+        if (offset < range.second && range.first < end) {
+          return false;
+        }
+      }
+      return true;
+    }
+    // Floating-point results depend on the rounding mode, and integer
+    // division may fault, so they're kept where they are.
+    case OPCODE_ADD:
+    case OPCODE_SUB:
+    case OPCODE_MUL:
+    case OPCODE_MUL_HI:
+    case OPCODE_NEG:
+      if (i->dest->type > INT64_TYPE) {
+        return false;
+      }
+      break;
+    case OPCODE_ASSIGN:
+    case OPCODE_CAST:
+    case OPCODE_ZERO_EXTEND:
+    case OPCODE_SIGN_EXTEND:
+    case OPCODE_TRUNCATE:
+    case OPCODE_LOAD_VECTOR_SHL:
+    case OPCODE_LOAD_VECTOR_SHR:
+    case OPCODE_SELECT:
+    case OPCODE_IS_TRUE:
+    case OPCODE_IS_FALSE:
+    case OPCODE_COMPARE_EQ:
+    case OPCODE_COMPARE_NE:
+    case OPCODE_COMPARE_SLT:
+    case OPCODE_COMPARE_SLE:
+    case OPCODE_COMPARE_SGT:
+    case OPCODE_COMPARE_SGE:
+    case OPCODE_COMPARE_ULT:
+    case OPCODE_COMPARE_ULE:
+    case OPCODE_COMPARE_UGT:
+    case OPCODE_COMPARE_UGE:
+    case OPCODE_AND:
+    case OPCODE_AND_NOT:
+    case OPCODE_OR:
+    case OPCODE_XOR:
+    case OPCODE_NOT:
+    case OPCODE_SHL:
+    case OPCODE_VECTOR_SHL:
+    case OPCODE_SHR:
+    case OPCODE_VECTOR_SHR:
+    case OPCODE_SHA:
+    case OPCODE_VECTOR_SHA:
+    case OPCODE_ROTATE_LEFT:
+    case OPCODE_VECTOR_ROTATE_LEFT:
+    case OPCODE_BYTE_SWAP:
+    case OPCODE_CNTLZ:
+    case OPCODE_INSERT:
+    case OPCODE_EXTRACT:
+    case OPCODE_SPLAT:
+    case OPCODE_PERMUTE:
+    case OPCODE_SWIZZLE:
+      break;
+    default:
+      return false;
+  }
+  uint32_t signature = i->opcode->signature;
+  const Value* sources[] = {
+      GET_OPCODE_SIG_TYPE_SRC1(signature) == OPCODE_SIG_TYPE_V
+          ? i->src1.value
+          : nullptr,
+      GET_OPCODE_SIG_TYPE_SRC2(signature) == OPCODE_SIG_TYPE_V
+          ? i->src2.value
+          : nullptr,
+      GET_OPCODE_SIG_TYPE_SRC3(signature) == OPCODE_SIG_TYPE_V
+          ? i->src3.value
+          : nullptr,
+  };
+  bool has_variable_source = false;
+  for (const Value* source : sources) {
+    if (!source || source->IsConstant()) {
+      continue;
+    }
+    if (!source->def || !invariant_instrs_.count(source->def)) {
+      return false;
+    }
+    has_variable_source = true;
+  }
+  // Constant expressions are left to constant propagation.
+  return has_variable_source;
+}
+
+Value* LoopInvariantCodeMotionPass::CloneInvariant(HIRBuilder* builder,
+                                                   Value* value) {
+  if (value->IsConstant()) {
+    return builder->CloneValue(value);
+  }
+  auto it = preheader_clones_.find(value);
+  if (it != preheader_clones_.end()) {
+    return it->second;
+  }
+  Instr* def = value->def;
+  uint32_t signature = def->opcode->signature;
+  Value* src1 = GET_OPCODE_SIG_TYPE_SRC1(signature) == OPCODE_SIG_TYPE_V
+                    ? CloneInvariant(builder, def->src1.value)
+                    : nullptr;
+  Value* src2 = GET_OPCODE_SIG_TYPE_SRC2(signature) == OPCODE_SIG_TYPE_V
+                    ? CloneInvariant(builder, def->src2.value)
+                    : nullptr;
+  Value* src3 = GET_OPCODE_SIG_TYPE_SRC3(signature) == OPCODE_SIG_TYPE_V
+                    ? CloneInvariant(builder, def->src3.value)
+                    : nullptr;
+  Value* clone = builder->CloneInstr(def, src1, src2, src3);
+  preheader_clones_.emplace(value, clone);
+  return clone;
+}
+
+bool LoopInvariantCodeMotionPass::ReduceStrength(
+    HIRBuilder* builder, const LoopAnalysis::Loop& loop) {
+  bool any_reduced = false;
+  for (Block* block : loop.blocks) {
+    for (Instr* i = block->instr_head; i; i = i->next) {
+      if (i->opcode != &OPCODE_MUL_info || i->dest->type > INT64_TYPE) {
+        continue;
+      }
+      Value* value = i->src1.value;
+      Value* multiplier = i->src2.value;
+      if (value->IsConstant()) {
+        std::swap(value, multiplier);
+      }
+      if (value->IsConstant() || !multiplier->IsConstant()) {
+        continue;
+      }
+      uint64_t factor = multiplier->constant.u64;
+      if (multiplier->type != INT64_TYPE) {
+        factor &= (uint64_t(1) << (GetTypeSize(multiplier->type) * 8)) - 1;
+      }
+      if (factor <= 1 || (factor & (factor - 1))) {
+        continue;
+      }
+      // The low bits of the product don't depend on the signedness.
+      Value* shift = builder->LoadConstantInt8(int8_t(xe::tzcnt(factor)));
+      i->Replace(&OPCODE_SHL_info, 0);
+      i->set_src1(value);
+      i->set_src2(shift);
+      any_reduced = true;
+    }
+  }
+  return any_reduced;
+}
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,60 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_COMPILER_PASSES_LOOP_INVARIANT_CODE_MOTION_PASS_H_
+#define XENIA_CPU_COMPILER_PASSES_LOOP_INVARIANT_CODE_MOTION_PASS_H_
+
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "xenia/cpu/compiler/compiler_pass.h"
+#include "xenia/cpu/compiler/loop_analysis.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// Computes the expressions that don't change across the iterations of a loop
+// once in its preheader. As values are local to their block, the result is
+// passed into the loop through a local.
+// Also replaces integer multiplications by powers of two in loops with
+// shifts.
+class LoopInvariantCodeMotionPass : public CompilerPass {
+ public:
+  LoopInvariantCodeMotionPass();
+  ~LoopInvariantCodeMotionPass() override;
+
+  const char* name() const override { return "LoopInvariantCodeMotionPass"; }
+
+  bool Run(hir::HIRBuilder* builder) override;
+
+ private:
+  bool HoistInvariants(hir::HIRBuilder* builder,
+                       const LoopAnalysis::Loop& loop);
+  bool IsInvariant(const hir::Instr* i, bool has_barrier) const;
+  hir::Value* CloneInvariant(hir::HIRBuilder* builder, hir::Value* value);
+  bool ReduceStrength(hir::HIRBuilder* builder,
+                      const LoopAnalysis::Loop& loop);
+
+  LoopAnalysis loop_analysis_;
+  // Per loop, cleared between them.
+  std::vector<std::pair<size_t, size_t>> stored_context_ranges_;
+  std::unordered_set<const hir::Instr*> invariant_instrs_;
+  std::unordered_map<hir::Value*, hir::Value*> preheader_clones_;
+};
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_COMPILER_PASSES_LOOP_INVARIANT_CODE_MOTION_PASS_H_
@@ -70,15 +70,29 @@ void MemorySequenceCombinationPass::CombineLoadSequence(Instr* i) {
 
   // Ensure all uses of the load result are BYTE_SWAP - if it's mixed we
   // shouldn't transform as we'd have to introduce new swaps!
+  // Integer stores of the loaded value (like in a copy) can be swapped too,
+  // as long as there's a swap removed along with them:
+  //   v1.i32 = load v0
+  //   v2.i32 = byte_swap v1.i32
+  //   store v3, v1.i32
+  // becomes:
+  //   v1.i32 = load v0, [swap]
+  //   v2.i32 = v1.i32
+  //   store v3, v1.i32, [swap]
+  bool has_swap_use = false;
   auto use = i->dest->use_head;
   while (use) {
-    if (use->instr->opcode != &OPCODE_BYTE_SWAP_info) {
+    if (use->instr->opcode == &OPCODE_BYTE_SWAP_info) {
+      has_swap_use = true;
+    } else if (!IsSwappableStoreOfValue(use->instr, i->dest)) {
       // Not a swap.
       return;
     }
-    // TODO(benvanik): allow uses by STORE (we can make that swap).
     use = use->next;
   }
+  if (!has_swap_use) {
+    return;
+  }
 
   // Merge byte swap into load.
   // Note that we may have already been a swapped operation - this inverts that.
@@ -86,17 +100,40 @@ void MemorySequenceCombinationPass::CombineLoadSequence(Instr* i) {
 
   // Replace use of byte swap value with loaded value.
   // It's byte_swap vN -> assign vN, so not much to do.
+  // Stores of the value now need to swap it back.
   use = i->dest->use_head;
   while (use) {
     auto next_use = use->next;
-    use->instr->opcode = &OPCODE_ASSIGN_info;
-    use->instr->flags = 0;
+    if (use->instr->opcode == &OPCODE_BYTE_SWAP_info) {
+      use->instr->opcode = &OPCODE_ASSIGN_info;
+      use->instr->flags = 0;
+    } else {
+      use->instr->flags ^= LoadStoreFlags::LOAD_STORE_BYTE_SWAP;
+    }
     use = next_use;
   }
 
   // TODO(benvanik): merge in extend/truncate.
 }
 
+bool MemorySequenceCombinationPass::IsSwappableStoreOfValue(Instr* i,
+                                                            Value* value) {
+  // Swapping stores are only available for integers, and the value must not
+  // be used as the address as well.
+  if (value->type != INT16_TYPE && value->type != INT32_TYPE &&
+      value->type != INT64_TYPE) {
+    return false;
+  }
+  if (i->opcode == &OPCODE_STORE_info) {
+    return i->src2.value == value && i->src1.value != value;
+  }
+  if (i->opcode == &OPCODE_STORE_OFFSET_info) {
+    return i->src3.value == value && i->src1.value != value &&
+           i->src2.value != value;
+  }
+  return false;
+}
+
 void MemorySequenceCombinationPass::CombineStoreSequence(Instr* i) {
   // Store with swap:
   //   v1.i32 = ...
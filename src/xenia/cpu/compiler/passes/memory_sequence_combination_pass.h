@@ -22,12 +22,15 @@ class MemorySequenceCombinationPass : public CompilerPass {
   MemorySequenceCombinationPass();
   ~MemorySequenceCombinationPass() override;
 
+  const char* name() const override { return "MemorySequenceCombinationPass"; }
+
   bool Run(hir::HIRBuilder* builder) override;
 
  private:
   void CombineMemorySequences(hir::HIRBuilder* builder);
   void CombineLoadSequence(hir::Instr* i);
   void CombineStoreSequence(hir::Instr* i);
+  bool IsSwappableStoreOfValue(hir::Instr* i, hir::Value* value);
 };
 
 }  // namespace passes
@@ -61,6 +61,7 @@ void ValueReductionPass::ComputeLastUse(Value* value) {
 
 bool ValueReductionPass::Run(HIRBuilder* builder) {
   // Walk each block and reuse variable ordinals as much as possible.
+  builder->MarkValueOrdinalsReused();
 
   llvm::BitVector ordinals(builder->max_value_ordinal());
 
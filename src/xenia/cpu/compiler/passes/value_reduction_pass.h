@@ -17,11 +17,15 @@ namespace cpu {
 namespace compiler {
 namespace passes {
 
+// Reuses the ordinals of values that are dead, so they are no longer unique,
+// and HIRBuilder::value_at can't be used anymore until the builder is reset.
 class ValueReductionPass : public CompilerPass {
  public:
   ValueReductionPass();
   ~ValueReductionPass() override;
 
+  const char* name() const override { return "ValueReductionPass"; }
+
   bool Run(hir::HIRBuilder* builder) override;
 
  private:
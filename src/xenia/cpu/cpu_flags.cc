@@ -38,6 +38,24 @@ DEFINE_bool(
 DEFINE_bool(validate_hir, false,
             "Perform validation checks on the HIR during compilation.", "CPU");
 
+DEFINE_bool(translation_statistics, false,
+            "Collect the time spent in every phase and compiler pass of guest "
+            "function translation and the HIR size around them, logged on "
+            "shutdown.",
+            "CPU");
+
+DEFINE_bool(inline_export_fast_paths, true,
+            "Emit the inline fast paths of frequently called kernel exports at "
+            "their call sites, only calling into the kernel when they can't "
+            "complete inline.",
+            "CPU");
+
+DEFINE_bool(loop_optimizations, false,
+            "Hoist loop-invariant computations out of guest loops and replace "
+            "multiplications by powers of two in them with shifts. Increases "
+            "translation time.",
+            "CPU");
+
 DEFINE_uint64(
     pvr, 0x710700,
     "Processor version and revision number.\nBits 0 to 15 are the version "
@@ -26,6 +26,11 @@ DECLARE_bool(disable_global_lock);
 
 DECLARE_bool(validate_hir);
 
+DECLARE_bool(translation_statistics);
+
+DECLARE_bool(inline_export_fast_paths);
+DECLARE_bool(loop_optimizations);
+
 DECLARE_uint64(pvr);
 
 // Breakpoints:
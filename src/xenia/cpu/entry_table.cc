@@ -9,6 +9,8 @@
 
 #include "xenia/cpu/entry_table.h"
 
+#include <algorithm>
+
 #include "xenia/base/profiling.h"
 #include "xenia/base/threading.h"
 
@@ -23,6 +25,9 @@ EntryTable::~EntryTable() {
     Entry* entry = it.second;
     delete entry;
   }
+  for (Entry* entry : removed_entries_) {
+    delete entry;
+  }
 }
 
 Entry* EntryTable::Get(uint32_t address) {
@@ -87,5 +92,32 @@ std::vector<Function*> EntryTable::FindWithAddress(uint32_t address) {
   return fns;
 }
 
+std::vector<Function*> EntryTable::FindInRange(uint32_t low_address,
+                                               uint32_t high_address) {
+  auto global_lock = global_critical_region_.Acquire();
+  std::vector<Function*> fns;
+  for (auto& it : map_) {
+    Entry* entry = it.second;
+    // The end may be unknown, in which case only the address is covered.
+    if (entry->address <= high_address &&
+        std::max(entry->address, entry->end_address) >= low_address) {
+      if (entry->status == Entry::STATUS_READY) {
+        fns.push_back(entry->function);
+      }
+    }
+  }
+  return fns;
+}
+
+void EntryTable::Remove(uint32_t address) {
+  auto global_lock = global_critical_region_.Acquire();
+  auto it = map_.find(address);
+  if (it == map_.end()) {
+    return;
+  }
+  removed_entries_.push_back(it->second);
+  map_.erase(it);
+}
+
 }  // namespace cpu
 }  // namespace xe
@@ -43,11 +43,18 @@ class EntryTable {
   Entry::Status GetOrCreate(uint32_t address, Entry** out_entry);
 
   std::vector<Function*> FindWithAddress(uint32_t address);
+  // Functions of the ready entries overlapping the inclusive range.
+  std::vector<Function*> FindInRange(uint32_t low_address,
+                                     uint32_t high_address);
+  // Removes the entry so the address is resolved again.
+  void Remove(uint32_t address);
 
  private:
   xe::global_critical_region global_critical_region_;
   // TODO(benvanik): replace with a better data structure.
   std::unordered_map<uint32_t, Entry*> map_;
+  // Removed entries, which callers of GetOrCreate may still be using.
+  std::vector<Entry*> removed_entries_;
 };
 
 }  // namespace cpu
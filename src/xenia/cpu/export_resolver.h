@@ -16,6 +16,17 @@
 #include "xenia/base/math.h"
 #include "xenia/cpu/ppc/ppc_context.h"
 
+namespace xe {
+namespace cpu {
+namespace hir {
+class Label;
+}  // namespace hir
+namespace ppc {
+class PPCHIRBuilder;
+}  // namespace ppc
+}  // namespace cpu
+}  // namespace xe
+
 namespace xe {
 namespace cpu {
 
@@ -70,6 +81,13 @@ typedef void (*xe_kernel_export_shim_fn)(void*, void*);
 
 typedef void (*ExportTrampoline)(ppc::PPCContext* ppc_context);
 
+// Emits what the export does inline at a call site, storing the result like
+// the export would. Branches to slow_path_label, without having modified
+// anything, when the export has to be called after all. Returns false if
+// nothing has been emitted.
+typedef bool (*ExportFastPath)(ppc::PPCHIRBuilder& f,
+                               hir::Label* slow_path_label);
+
 class Export {
  public:
   enum class Type {
@@ -82,7 +100,7 @@ class Export {
       : ordinal(ordinal),
         type(type),
         tags(tags),
-        function_data({nullptr, nullptr, 0}) {
+        function_data({nullptr, nullptr, 0, nullptr}) {
     std::strncpy(this->name, name, xe::countof(this->name));
   }
 
@@ -108,7 +126,11 @@ class Export {
       // Trampoline that is called from the guest-to-host thunk.
       // Expects only PPC context as first arg.
       ExportTrampoline trampoline;
+      // Calls through the fast path are not counted.
       uint64_t call_count;
+
+      // Optional, for exports tagged kHighFrequency.
+      ExportFastPath fast_path;
     } function_data;
   };
 };
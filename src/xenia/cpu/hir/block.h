@@ -46,7 +46,8 @@ class Edge {
 
 class Block {
  public:
-  Arena* arena;
+  // Arena the use list entries of instruction sources are allocated from.
+  Arena* use_arena;
 
   Block* next;
   Block* prev;
@@ -14,6 +14,7 @@
 #include <cstring>
 
 #include "xenia/base/assert.h"
+#include "xenia/base/logging.h"
 #include "xenia/base/profiling.h"
 #include "xenia/cpu/function.h"
 #include "xenia/cpu/hir/block.h"
@@ -49,11 +50,13 @@ namespace hir {
 
 HIRBuilder::HIRBuilder() {
   arena_ = new Arena();
+  use_arena_ = new Arena(kUseArenaChunkSize);
   Reset();
 }
 
 HIRBuilder::~HIRBuilder() {
   Reset();
+  delete use_arena_;
   delete arena_;
 }
 
@@ -61,13 +64,21 @@ void HIRBuilder::Reset() {
   attributes_ = 0;
   next_label_id_ = 0;
   next_value_ordinal_ = 0;
+  value_ordinals_reused_ = false;
   locals_.clear();
   block_head_ = block_tail_ = NULL;
   current_block_ = NULL;
 #if SCRIBBLE_ARENA_ON_RESET
   arena_->DebugFill();
+  instrs_.DebugFill();
+  values_.DebugFill();
+  use_arena_->DebugFill();
 #endif
+  // Chunks are kept for the next function.
   arena_->Reset();
+  instrs_.Reset();
+  values_.Reset();
+  use_arena_->Reset();
 }
 
 bool HIRBuilder::Finalize() {
@@ -388,7 +399,7 @@ void HIRBuilder::InsertLabel(Label* label, Instr* prev_instr) {
   Block* new_block = arena_->Alloc<Block>();
   new_block->ordinal = UINT16_MAX;
   new_block->incoming_values = nullptr;
-  new_block->arena = arena_;
+  new_block->use_arena = use_arena_;
   new_block->prev = prev_block;
   new_block->next = next_block;
   if (prev_block) {
@@ -633,7 +644,7 @@ Block* HIRBuilder::AppendBlock() {
   Block* block = arena_->Alloc<Block>();
   block->ordinal = UINT16_MAX;
   block->incoming_values = nullptr;
-  block->arena = arena_;
+  block->use_arena = use_arena_;
   block->next = NULL;
   block->prev = block_tail_;
   if (block_tail_) {
@@ -678,7 +689,7 @@ Instr* HIRBuilder::AppendInstr(const OpcodeInfo& opcode_info, uint16_t flags,
   }
   Block* block = current_block_;
 
-  Instr* instr = arena_->Alloc<Instr>();
+  Instr* instr = instrs_.Alloc();
   instr->next = NULL;
   instr->prev = block->instr_tail;
   if (block->instr_tail) {
@@ -704,7 +715,7 @@ Instr* HIRBuilder::AppendInstr(const OpcodeInfo& opcode_info, uint16_t flags,
 }
 
 Value* HIRBuilder::AllocValue(TypeName type) {
-  Value* value = arena_->Alloc<Value>();
+  Value* value = values_.Alloc();
   value->ordinal = next_value_ordinal_++;
   value->type = type;
   value->flags = 0;
@@ -719,7 +730,7 @@ Value* HIRBuilder::AllocValue(TypeName type) {
 }
 
 Value* HIRBuilder::CloneValue(Value* source) {
-  Value* value = arena_->Alloc<Value>();
+  Value* value = values_.Alloc();
   value->ordinal = next_value_ordinal_++;
   value->type = source->type;
   value->flags = source->flags;
@@ -734,6 +745,35 @@ Value* HIRBuilder::CloneValue(Value* source) {
   return value;
 }
 
+void HIRBuilder::ValueOrdinalsReusedError() const {
+  xe::FatalError(
+      "HIRBuilder::value_at called after ValueReductionPass reused the value "
+      "ordinals");
+}
+
+Value* HIRBuilder::CloneInstr(const Instr* source, Value* src1, Value* src2,
+                              Value* src3) {
+  Instr* i = AppendInstr(*source->opcode, source->flags,
+                         source->dest ? AllocValue(source->dest->type) : NULL);
+  uint32_t signature = source->opcode->signature;
+  i->src1 = source->src1;
+  i->src2 = source->src2;
+  i->src3 = source->src3;
+  if (GET_OPCODE_SIG_TYPE_SRC1(signature) == OPCODE_SIG_TYPE_V) {
+    i->src1.value = NULL;
+    i->set_src1(src1);
+  }
+  if (GET_OPCODE_SIG_TYPE_SRC2(signature) == OPCODE_SIG_TYPE_V) {
+    i->src2.value = NULL;
+    i->set_src2(src2);
+  }
+  if (GET_OPCODE_SIG_TYPE_SRC3(signature) == OPCODE_SIG_TYPE_V) {
+    i->src3.value = NULL;
+    i->set_src3(src3);
+  }
+  return i->dest;
+}
+
 void HIRBuilder::Comment(std::string_view value) {
   if (value.empty()) {
     return;
@@ -18,6 +18,7 @@
 #include "xenia/cpu/hir/block.h"
 #include "xenia/cpu/hir/instr.h"
 #include "xenia/cpu/hir/label.h"
+#include "xenia/cpu/hir/node_pool.h"
 #include "xenia/cpu/hir/opcodes.h"
 #include "xenia/cpu/hir/value.h"
 #include "xenia/cpu/mmio_handler.h"
@@ -49,10 +50,25 @@ class HIRBuilder {
   std::vector<Value*>& locals() { return locals_; }
 
   uint32_t max_value_ordinal() const { return next_value_ordinal_; }
+  // Values are stored in the order they have been allocated, indexed by the
+  // ordinal given to them on allocation. Once ValueReductionPass has reused
+  // the ordinals, they don't identify the values anymore, and calling this is
+  // a fatal error.
+  Value* value_at(uint32_t ordinal) const {
+    if (value_ordinals_reused_) {
+      ValueOrdinalsReusedError();
+    }
+    return &values_[ordinal];
+  }
+  // For passes renumbering the values, until the next Reset.
+  void MarkValueOrdinalsReused() { value_ordinals_reused_ = true; }
 
   Block* first_block() const { return block_head_; }
   Block* last_block() const { return block_tail_; }
   Block* current_block() const;
+  // Instructions are appended to the given block, for passes inserting code
+  // into existing blocks.
+  void set_current_block(Block* block) { current_block_ = block; }
   Instr* last_instr() const;
 
   Label* NewLabel();
@@ -110,6 +126,10 @@ class HIRBuilder {
 
   Value* AllocValue(TypeName type = INT64_TYPE);
   Value* CloneValue(Value* source);
+  // Appends a copy of the instruction with a new dest and the given value
+  // sources. Operands other than values are copied as is.
+  Value* CloneInstr(const Instr* source, Value* src1, Value* src2,
+                    Value* src3);
 
   // phi type_name, Block* b1, Value* v1, Block* b2, Value* v2, etc
   Value* Assign(Value* value);
@@ -277,14 +297,24 @@ class HIRBuilder {
   Value* CompareXX(const OpcodeInfo& opcode, Value* value1, Value* value2);
   Value* VectorCompareXX(const OpcodeInfo& opcode, Value* value1, Value* value2,
                          TypeName part_type);
+  void ValueOrdinalsReusedError() const;
 
  protected:
+  // Instructions, values and use list entries make up most of the HIR and are
+  // what passes walk over, so each is packed in its own dense storage rather
+  // than interleaved with blocks, labels, edges and comments.
+  static constexpr size_t kUseArenaChunkSize = 1_MiB;
+
   Arena* arena_;
+  NodePool<Instr> instrs_;
+  NodePool<Value> values_;
+  Arena* use_arena_;
 
   uint32_t attributes_;
 
   uint32_t next_label_id_;
   uint32_t next_value_ordinal_;
+  bool value_ordinals_reused_;
 
   std::vector<Value*> locals_;
 
@@ -0,0 +1,75 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_HIR_NODE_POOL_H_
+#define XENIA_CPU_HIR_NODE_POOL_H_
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "xenia/base/assert.h"
+
+namespace xe {
+namespace cpu {
+namespace hir {
+
+// Dense storage of HIR nodes of one type, addressed by 32-bit indices in the
+// order they have been allocated. Nodes are kept in fixed-size chunks, so
+// pointers to them stay valid while more are allocated, and the chunks are
+// reused for the next function after a reset. Like arena allocations, nodes
+// are not constructed.
+template <typename T>
+class NodePool {
+ public:
+  static constexpr uint32_t kChunkShift = 12;
+  static constexpr uint32_t kChunkSize = uint32_t(1) << kChunkShift;
+
+  uint32_t size() const { return size_; }
+
+  T* Alloc() {
+    if ((size_ >> kChunkShift) >= chunks_.size()) {
+      chunks_.emplace_back(new Storage[kChunkSize]);
+    }
+    return &At(size_++);
+  }
+
+  T& operator[](uint32_t index) const {
+    assert_true(index < size_);
+    return At(index);
+  }
+
+  void Reset() { size_ = 0; }
+
+  void DebugFill() {
+    for (auto& chunk : chunks_) {
+      std::memset(chunk.get(), 0xCD, sizeof(Storage) * kChunkSize);
+    }
+  }
+
+ private:
+  struct alignas(T) Storage {
+    uint8_t bytes[sizeof(T)];
+  };
+
+  T& At(uint32_t index) const {
+    return *reinterpret_cast<T*>(
+        &chunks_[index >> kChunkShift][index & (kChunkSize - 1)]);
+  }
+
+  std::vector<std::unique_ptr<Storage[]>> chunks_;
+  uint32_t size_ = 0;
+};
+
+}  // namespace hir
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_HIR_NODE_POOL_H_
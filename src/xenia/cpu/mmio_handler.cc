@@ -12,6 +12,7 @@
 #include <algorithm>
 #include <cstring>
 #include <utility>
+#include <vector>
 
 #include "xenia/base/assert.h"
 #include "xenia/base/byte_order.h"
@@ -66,6 +67,17 @@ MMIOHandler::MMIOHandler(uint8_t* virtual_membase, uint8_t* physical_membase,
 MMIOHandler::~MMIOHandler() {
   ExceptionHandler::Uninstall(ExceptionCallbackThunk, this);
 
+  if (!access_site_faults_.empty()) {
+    std::vector<std::pair<uint64_t, uint32_t>> sites(
+        access_site_faults_.begin(), access_site_faults_.end());
+    std::sort(sites.begin(), sites.end(),
+              [](const auto& a, const auto& b) { return a.second > b.second; });
+    XELOGI("MMIO accesses faulted at {} host code sites", sites.size());
+    for (size_t i = 0; i < std::min(sites.size(), size_t(8)); ++i) {
+      XELOGI("  {:016X}: {} faults", sites[i].first, sites[i].second);
+    }
+  }
+
   assert_true(global_handler_ == this);
   global_handler_ = nullptr;
 }
@@ -85,6 +97,15 @@ bool MMIOHandler::RegisterRange(uint32_t virtual_address, uint32_t mask,
   return true;
 }
 
+void MMIOHandler::SetAccessSiteCallback(AccessSiteCallback callback,
+                                        void* context,
+                                        uint32_t fault_threshold) {
+  std::lock_guard<std::mutex> lock(access_sites_mutex_);
+  access_site_callback_ = callback;
+  access_site_callback_context_ = context;
+  access_site_fault_threshold_ = fault_threshold;
+}
+
 MMIORange* MMIOHandler::LookupRange(uint32_t virtual_address) {
   for (auto& range : mapped_ranges_) {
     if ((virtual_address & range.mask) == range.address) {
@@ -564,8 +585,27 @@ bool MMIOHandler::ExceptionCallback(Exception* ex) {
   // Advance RIP to the next instruction so that we resume properly.
   ex->set_resume_pc(rip + decoded_load_store.length);
 
+  RecordAccessSiteFault(rip, range);
+
   return true;
 }
 
+void MMIOHandler::RecordAccessSiteFault(uint64_t host_pc,
+                                        const MMIORange* range) {
+  AccessSiteCallback callback;
+  void* callback_context;
+  {
+    std::lock_guard<std::mutex> lock(access_sites_mutex_);
+    uint32_t fault_count = ++access_site_faults_[host_pc];
+    if (!access_site_callback_ ||
+        fault_count != access_site_fault_threshold_) {
+      return;
+    }
+    callback = access_site_callback_;
+    callback_context = access_site_callback_context_;
+  }
+  callback(callback_context, host_pc, range);
+}
+
 }  // namespace cpu
 }  // namespace xe
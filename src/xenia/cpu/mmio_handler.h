@@ -12,6 +12,7 @@
 
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include "xenia/base/mutex.h"
@@ -49,6 +50,12 @@ class MMIOHandler {
   typedef bool (*AccessViolationCallback)(
       std::unique_lock<std::recursive_mutex> global_lock_locked_once,
       void* context, void* host_address, bool is_write);
+  // Called on the faulting thread, without any locks held, once a load or
+  // store instruction has faulted on an MMIO range the threshold number of
+  // times, so that the code containing it can call the range handlers
+  // directly instead.
+  typedef void (*AccessSiteCallback)(void* context, uint64_t host_pc,
+                                     const MMIORange* range);
 
   // access_violation_callback is called with global_critical_region locked once
   // on the thread, so if multiple threads trigger an access violation in the
@@ -66,6 +73,10 @@ class MMIOHandler {
                      MMIOWriteCallback write_callback);
   MMIORange* LookupRange(uint32_t virtual_address);
 
+  // A fault_threshold of 0 disables the callback.
+  void SetAccessSiteCallback(AccessSiteCallback callback, void* context,
+                             uint32_t fault_threshold);
+
   bool CheckLoad(uint32_t virtual_address, uint32_t* out_value);
   bool CheckStore(uint32_t virtual_address, uint32_t value);
 
@@ -78,6 +89,7 @@ class MMIOHandler {
 
   static bool ExceptionCallbackThunk(Exception* ex, void* data);
   bool ExceptionCallback(Exception* ex);
+  void RecordAccessSiteFault(uint64_t host_pc, const MMIORange* range);
 
   uint8_t* virtual_membase_;
   uint8_t* physical_membase_;
@@ -95,6 +107,13 @@ class MMIOHandler {
 
   xe::global_critical_region global_critical_region_;
 
+  std::mutex access_sites_mutex_;
+  // Number of MMIO faults by the host address of the faulting instruction.
+  std::unordered_map<uint64_t, uint32_t> access_site_faults_;
+  AccessSiteCallback access_site_callback_ = nullptr;
+  void* access_site_callback_context_ = nullptr;
+  uint32_t access_site_fault_threshold_ = 0;
+
  private:
   struct DecodedLoadStore {
     // Matches the Xn/Wn register number for 0 reads and ignored writes in many
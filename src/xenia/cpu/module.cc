@@ -16,6 +16,7 @@
 
 #include "xenia/base/profiling.h"
 #include "xenia/base/threading.h"
+#include "xenia/cpu/ppc/ppc_frontend.h"
 #include "xenia/cpu/processor.h"
 
 namespace xe {
@@ -147,6 +148,11 @@ Symbol::Status Module::DefineVariable(Symbol* symbol) {
   return DefineSymbol(symbol);
 }
 
+bool Module::TranslateFunction(GuestFunction* function,
+                               uint32_t debug_info_flags) {
+  return processor_->frontend()->DefineFunction(function, debug_info_flags);
+}
+
 void Module::ForEachFunction(std::function<void(Function*)> callback) {
   auto global_lock = global_critical_region_.Acquire();
   for (auto& symbol : list_) {
@@ -46,6 +46,12 @@ class Module {
   Symbol::Status DefineFunction(Function* symbol);
   Symbol::Status DefineVariable(Symbol* symbol);
 
+  // Translates a defined guest function of the module, or translates it
+  // again, replacing its machine code. Done by the frontend from the guest code
+  // in memory unless overridden.
+  virtual bool TranslateFunction(GuestFunction* function,
+                                 uint32_t debug_info_flags);
+
   void ForEachFunction(std::function<void(Function*)> callback);
   void ForEachSymbol(size_t start_index, size_t end_index,
                      std::function<void(Symbol*)> callback);
@@ -11,6 +11,8 @@
 
 #include "xenia/base/assert.h"
 #include "xenia/cpu/cpu_flags.h"
+#include "xenia/cpu/export_resolver.h"
+#include "xenia/cpu/function.h"
 #include "xenia/cpu/ppc/ppc_context.h"
 #include "xenia/cpu/ppc/ppc_frontend.h"
 #include "xenia/cpu/ppc/ppc_hir_builder.h"
@@ -27,6 +29,31 @@ using namespace xe::cpu::hir;
 using xe::cpu::hir::Label;
 using xe::cpu::hir::Value;
 
+// Calls to frequently used kernel exports may be done inline, only calling the
+// export if its fast path can't complete.
+bool EmitExportFastPathCall(PPCHIRBuilder& f, Function* function,
+                            uint32_t call_flags) {
+  if (!cvars::inline_export_fast_paths || !function ||
+      function->behavior() != Function::Behavior::kExtern) {
+    return false;
+  }
+  Export* export_data = static_cast<GuestFunction*>(function)->export_data();
+  if (!export_data || export_data->type != Export::Type::kFunction ||
+      !export_data->function_data.fast_path) {
+    return false;
+  }
+  Label* slow_path_label = f.NewLabel();
+  if (!export_data->function_data.fast_path(f, slow_path_label)) {
+    return false;
+  }
+  Label* end_label = f.NewLabel();
+  f.Branch(end_label);
+  f.MarkLabel(slow_path_label);
+  f.Call(function, call_flags);
+  f.MarkLabel(end_label);
+  return true;
+}
+
 int InstrEmit_branch(PPCHIRBuilder& f, const char* src, uint64_t cia,
                      Value* nia, bool lk, Value* cond = NULL,
                      bool expect_true = true, bool nia_is_lr = false) {
@@ -81,7 +108,7 @@ int InstrEmit_branch(PPCHIRBuilder& f, const char* src, uint64_t cia,
           cond = f.IsFalse(cond);
         }
         f.CallTrue(cond, function, call_flags);
-      } else {
+      } else if (!lk || !EmitExportFastPathCall(f, function, call_flags)) {
         f.Call(function, call_flags);
       }
     }
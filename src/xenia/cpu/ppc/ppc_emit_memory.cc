@@ -12,6 +12,7 @@
 #include <stddef.h>
 #include "xenia/base/assert.h"
 #include "xenia/cpu/ppc/ppc_context.h"
+#include "xenia/cpu/ppc/ppc_frontend.h"
 #include "xenia/cpu/ppc/ppc_hir_builder.h"
 
 namespace xe {
@@ -1130,8 +1131,12 @@ int InstrEmit_dcbz128(PPCHIRBuilder& f, const InstrData& i) {
 }
 
 int InstrEmit_icbi(PPCHIRBuilder& f, const InstrData& i) {
-  // XEINSTRNOTIMPLEMENTED();
-  f.Nop();
+  // EA <- (RA) + (RB)
+  // Code in the block may have been modified, so its translations can't be
+  // used anymore.
+  Value* ea = CalculateEA_0(f, i.X.RA, i.X.RB);
+  f.StoreContext(offsetof(PPCContext, scratch), ea);
+  f.CallExtern(f.builtins()->invalidate_instruction_cache);
   return 0;
 }
 
@@ -9,8 +9,11 @@
 
 #include "xenia/cpu/ppc/ppc_frontend.h"
 
+#include <algorithm>
+
 #include "xenia/base/atomic.h"
 #include "xenia/base/logging.h"
+#include "xenia/cpu/backend/backend.h"
 #include "xenia/cpu/ppc/ppc_context.h"
 #include "xenia/cpu/ppc/ppc_emit.h"
 #include "xenia/cpu/ppc/ppc_opcode_info.h"
@@ -47,8 +50,17 @@ PPCFrontend::PPCFrontend(Processor* processor) : processor_(processor) {
 }
 
 PPCFrontend::~PPCFrontend() {
+  if (writable_protection_callback_handle_) {
+    memory()->UnregisterWritableProtectionCallback(
+        writable_protection_callback_handle_);
+  }
+
   // Force cleanup now before we deinit.
   translator_pool_.Reset();
+
+  if (!translation_statistics_.empty()) {
+    translation_statistics_.Dump(32);
+  }
 }
 
 Memory* PPCFrontend::memory() const { return processor_->memory(); }
@@ -90,6 +102,15 @@ void SyscallHandler(PPCContext* ppc_context, void* arg0, void* arg1) {
   }
 }
 
+// Discards the translations of the guest code in the instruction cache block
+// containing the address in scratch, for icbi.
+void InvalidateInstructionCache(PPCContext* ppc_context, void* arg0,
+                                void* arg1) {
+  auto processor = reinterpret_cast<Processor*>(arg0);
+  uint32_t address = uint32_t(ppc_context->scratch) & ~uint32_t(127);
+  processor->InvalidateGuestCode(address, 128, false);
+}
+
 bool PPCFrontend::Initialize() {
   void* arg0 = reinterpret_cast<void*>(&xe::global_critical_region::mutex());
   void* arg1 = reinterpret_cast<void*>(&builtins_.global_lock_count);
@@ -101,6 +122,12 @@ bool PPCFrontend::Initialize() {
       processor_->DefineBuiltin("LeaveGlobalLock", LeaveGlobalLock, arg0, arg1);
   builtins_.syscall_handler = processor_->DefineBuiltin(
       "SyscallHandler", SyscallHandler, nullptr, nullptr);
+  builtins_.invalidate_instruction_cache = processor_->DefineBuiltin(
+      "InvalidateInstructionCache", InvalidateInstructionCache, processor_,
+      nullptr);
+  writable_protection_callback_handle_ =
+      memory()->RegisterWritableProtectionCallback(
+          WritableProtectionCallbackThunk, this);
   return true;
 }
 
@@ -121,6 +148,108 @@ bool PPCFrontend::DefineFunction(GuestFunction* function,
   return result;
 }
 
+bool PPCFrontend::AddConstantMemoryDependencies(
+    GuestFunction* function,
+    const std::vector<std::pair<uint32_t, uint32_t>>& ranges) {
+  if (ranges.empty()) {
+    return true;
+  }
+  {
+    std::lock_guard<std::mutex> lock(constant_memory_mutex_);
+    for (const auto& range : ranges) {
+      for (uint32_t page = range.first >> 12;
+           page <= (range.first + range.second - 1) >> 12; ++page) {
+        auto& dependents = constant_memory_dependents_[page];
+        if (std::find(dependents.begin(), dependents.end(), function) ==
+            dependents.end()) {
+          dependents.push_back(function);
+        }
+      }
+    }
+  }
+  // Made writable after being read, but possibly before the dependency was
+  // added, so the callback may have missed the function. Checked without the
+  // lock held, as the callback takes it with the global critical region held.
+  for (const auto& range : ranges) {
+    auto heap = memory()->LookupHeap(range.first);
+    uint32_t protect;
+    if (!heap || !heap->QueryProtect(range.first, &protect) ||
+        (protect & kMemoryProtectWrite) ||
+        !heap->QueryProtect(range.first + range.second - 1, &protect) ||
+        (protect & kMemoryProtectWrite)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void PPCFrontend::RemoveConstantMemoryDependencies(
+    const std::vector<GuestFunction*>& functions) {
+  std::lock_guard<std::mutex> lock(constant_memory_mutex_);
+  for (auto it = constant_memory_dependents_.begin();
+       it != constant_memory_dependents_.end();) {
+    auto& dependents = it->second;
+    dependents.erase(std::remove_if(dependents.begin(), dependents.end(),
+                                    [&functions](GuestFunction* function) {
+                                      return std::find(functions.begin(),
+                                                       functions.end(),
+                                                       function) !=
+                                             functions.end();
+                                    }),
+                     dependents.end());
+    if (dependents.empty()) {
+      it = constant_memory_dependents_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void PPCFrontend::WritableProtectionCallbackThunk(void* context_ptr,
+                                                  uint32_t virtual_address,
+                                                  uint32_t length) {
+  reinterpret_cast<PPCFrontend*>(context_ptr)
+      ->OnMemoryMadeWritable(virtual_address, length);
+}
+
+void PPCFrontend::OnMemoryMadeWritable(uint32_t virtual_address,
+                                       uint32_t length) {
+  // Code pages are read-only unless the guest is going to modify the code, in
+  // which case its translations must not be used anymore.
+  processor_->InvalidateGuestCode(virtual_address, length, false);
+
+  std::vector<GuestFunction*> functions;
+  {
+    std::lock_guard<std::mutex> lock(constant_memory_mutex_);
+    if (constant_memory_dependents_.empty()) {
+      return;
+    }
+    for (uint32_t page = virtual_address >> 12;
+         page <= (virtual_address + length - 1) >> 12; ++page) {
+      auto it = constant_memory_dependents_.find(page);
+      if (it == constant_memory_dependents_.end()) {
+        continue;
+      }
+      for (GuestFunction* function : it->second) {
+        if (std::find(functions.begin(), functions.end(), function) ==
+            functions.end()) {
+          functions.push_back(function);
+        }
+      }
+      constant_memory_dependents_.erase(it);
+    }
+  }
+  // Translated again when called next, without reading the memory anymore
+  // as it's writable. Not retranslated right away, as the global critical
+  // region is held.
+  if (!functions.empty()) {
+    XELOGD("Invalidating {} functions as memory they have read as constant "
+           "at {:08X} has been made writable",
+           functions.size(), virtual_address);
+    processor_->InvalidateFunctions(functions, false);
+  }
+}
+
 }  // namespace ppc
 }  // namespace cpu
 }  // namespace xe
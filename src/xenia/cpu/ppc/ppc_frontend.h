@@ -11,9 +11,14 @@
 #define XENIA_CPU_PPC_PPC_FRONTEND_H_
 
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "xenia/base/type_pool.h"
 #include "xenia/cpu/function.h"
+#include "xenia/cpu/translation_statistics.h"
 #include "xenia/memory.h"
 
 namespace xe {
@@ -34,6 +39,7 @@ struct PPCBuiltins {
   Function* enter_global_lock;
   Function* leave_global_lock;
   Function* syscall_handler;
+  Function* invalidate_instruction_cache;
 };
 
 class PPCFrontend {
@@ -50,10 +56,39 @@ class PPCFrontend {
   bool DeclareFunction(GuestFunction* function);
   bool DefineFunction(GuestFunction* function, uint32_t debug_info_flags);
 
+  TranslationStatistics* translation_statistics() {
+    return &translation_statistics_;
+  }
+
+  // Makes the function be invalidated, to be translated again when called
+  // next, when any of the ranges of read-only memory (address and length) its
+  // translation has read becomes writable.
+  // Returns false if any of them already is, in which case the caller must
+  // retranslate it.
+  bool AddConstantMemoryDependencies(
+      GuestFunction* function,
+      const std::vector<std::pair<uint32_t, uint32_t>>& ranges);
+  // Stops invalidating the functions, which have been invalidated already, when
+  // memory they depended on becomes writable.
+  void RemoveConstantMemoryDependencies(
+      const std::vector<GuestFunction*>& functions);
+
  private:
+  static void WritableProtectionCallbackThunk(void* context_ptr,
+                                              uint32_t virtual_address,
+                                              uint32_t length);
+  void OnMemoryMadeWritable(uint32_t virtual_address, uint32_t length);
+
   Processor* processor_;
   PPCBuiltins builtins_ = {0};
   TypePool<PPCTranslator, PPCFrontend*> translator_pool_;
+  TranslationStatistics translation_statistics_;
+
+  void* writable_protection_callback_handle_ = nullptr;
+  std::mutex constant_memory_mutex_;
+  // Functions depending on the contents of each 4 KB page.
+  std::unordered_map<uint32_t, std::vector<GuestFunction*>>
+      constant_memory_dependents_;
 };
 
 }  // namespace ppc
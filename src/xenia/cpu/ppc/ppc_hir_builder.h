@@ -105,7 +105,7 @@ class PPCHIRBuilder : public hir::HIRBuilder {
       uint8_t reg;
       Value* value;
     } dests[4];
-  } trace_info_;
+  } trace_info_ = {};
 };
 
 }  // namespace ppc
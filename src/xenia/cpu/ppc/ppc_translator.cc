@@ -11,6 +11,7 @@
 
 #include "xenia/base/assert.h"
 #include "xenia/base/byte_order.h"
+#include "xenia/base/clock.h"
 #include "xenia/base/memory.h"
 #include "xenia/base/profiling.h"
 #include "xenia/base/reset_scope.h"
@@ -22,6 +23,7 @@
 #include "xenia/cpu/ppc/ppc_opcode_info.h"
 #include "xenia/cpu/ppc/ppc_scanner.h"
 #include "xenia/cpu/processor.h"
+#include "xenia/cpu/translation_statistics.h"
 
 namespace xe {
 namespace cpu {
@@ -39,6 +41,9 @@ PPCTranslator::PPCTranslator(PPCFrontend* frontend) : frontend_(frontend) {
   compiler_.reset(new Compiler(frontend->processor()));
   assembler_ = backend->CreateAssembler();
   assembler_->Initialize();
+  if (TranslationStatistics::is_enabled()) {
+    compiler_->set_statistics(frontend->translation_statistics());
+  }
 
   bool validate = cvars::validate_hir;
 
@@ -62,6 +67,10 @@ PPCTranslator::PPCTranslator(PPCFrontend* frontend) : frontend_(frontend) {
   if (validate) sap->AddPass(std::make_unique<passes::ValidationPass>());
   compiler_->AddPass(std::move(sap));
 
+  // Before folding the remaining swaps into loads and stores.
+  compiler_->AddPass(std::make_unique<passes::ByteSwapPropagationPass>());
+  if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+
   if (backend->machine_info()->supports_extended_load_store) {
     // Backend supports the advanced LOAD/STORE instructions.
     // These will save us a lot of HIR opcodes.
@@ -70,6 +79,12 @@ PPCTranslator::PPCTranslator(PPCFrontend* frontend) : frontend_(frontend) {
     if (validate)
       compiler_->AddPass(std::make_unique<passes::ValidationPass>());
   }
+  if (cvars::loop_optimizations) {
+    // Once the loop bodies are as small as simplification can make them.
+    compiler_->AddPass(std::make_unique<passes::LoopInvariantCodeMotionPass>());
+    if (validate)
+      compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+  }
   compiler_->AddPass(std::make_unique<passes::SimplificationPass>());
   if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
   // compiler_->AddPass(std::make_unique<passes::DeadStoreEliminationPass>());
@@ -99,6 +114,7 @@ PPCTranslator::~PPCTranslator() = default;
 bool PPCTranslator::Translate(GuestFunction* function,
                               uint32_t debug_info_flags) {
   SCOPE_profile_cpu_f("cpu");
+  uint64_t start_ticks = Clock::QueryHostTickCount();
 
   // Reset() all caching when we leave.
   xe::make_reset_scope(builder_);
@@ -128,7 +144,9 @@ bool PPCTranslator::Translate(GuestFunction* function,
   }
 
   // Scan the function to find its extents and gather debug data.
-  if (!scanner_->Scan(function, debug_info.get())) {
+  if (!compiler_->RunPass(builder_.get(), "PPCScanner", [&]() {
+        return scanner_->Scan(function, debug_info.get());
+      })) {
     return false;
   }
 
@@ -165,7 +183,9 @@ bool PPCTranslator::Translate(GuestFunction* function,
   if (debug_info) {
     emit_flags |= PPCHIRBuilder::EMIT_DEBUG_COMMENTS;
   }
-  if (!builder_->Emit(function, emit_flags)) {
+  if (!compiler_->RunPass(builder_.get(), "PPCHIRBuilder", [&]() {
+        return builder_->Emit(function, emit_flags);
+      })) {
     return false;
   }
 
@@ -189,11 +209,26 @@ bool PPCTranslator::Translate(GuestFunction* function,
   }
 
   // Assemble to backend machine code.
-  if (!assembler_->Assemble(function, builder_.get(), debug_info_flags,
-                            std::move(debug_info))) {
+  if (!compiler_->RunPass(builder_.get(), "Assembler", [&]() {
+        return assembler_->Assemble(function, builder_.get(),
+                                    debug_info_flags, std::move(debug_info));
+      })) {
     return false;
   }
 
+  if (!frontend_->AddConstantMemoryDependencies(
+          function, compiler_->constant_memory_dependencies())) {
+    // Memory read as constant has been made writable meanwhile.
+    frontend_->processor()->backend()->RetranslateFunction(function);
+  }
+
+  if (compiler_->statistics()) {
+    compiler_->statistics()->RecordFunction(
+        function->address(),
+        (function->end_address() - function->address()) / 4 + 1,
+        Clock::QueryHostTickCount() - start_ticks);
+  }
+
   return true;
 }
 
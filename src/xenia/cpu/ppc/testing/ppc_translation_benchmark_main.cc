@@ -0,0 +1,151 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "xenia/base/clock.h"
+#include "xenia/base/console_app_main.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/memory.h"
+#include "xenia/cpu/cpu_flags.h"
+#include "xenia/cpu/ppc/ppc_frontend.h"
+#include "xenia/cpu/processor.h"
+#include "xenia/cpu/xex_module.h"
+#include "xenia/emulator.h"
+#include "xenia/gpu/null/null_graphics_system.h"
+#include "xenia/kernel/kernel_state.h"
+#include "xenia/kernel/user_module.h"
+#include "xenia/vfs/devices/host_path_device.h"
+
+DEFINE_transient_path(target_xex, "",
+                      "XEX file whose functions are translated.", "General");
+DEFINE_uint32(slowest_function_count, 32,
+              "Number of the slowest functions to translate to print.",
+              "Other");
+
+namespace xe {
+namespace cpu {
+namespace test {
+
+// Gathers the entry point and the targets of all relative bl instructions in
+// the code sections, which covers nearly every function of an executable.
+std::vector<uint32_t> DiscoverFunctions(Memory* memory, XexModule* module,
+                                        uint32_t entry_point) {
+  std::vector<uint32_t> addresses;
+  if (entry_point) {
+    addresses.push_back(entry_point);
+  }
+  auto is_code = [module](uint32_t address) {
+    for (const PESection& section : module->pe_sections()) {
+      if ((section.flags & kXEPESectionContainsCode) &&
+          address >= section.address &&
+          address - section.address < section.size) {
+        return true;
+      }
+    }
+    return false;
+  };
+  for (const PESection& section : module->pe_sections()) {
+    if (!(section.flags & kXEPESectionContainsCode)) {
+      continue;
+    }
+    for (uint32_t offset = 0; offset + 4 <= section.size; offset += 4) {
+      uint32_t address = section.address + offset;
+      uint32_t code =
+          xe::load_and_swap<uint32_t>(memory->TranslateVirtual(address));
+      // bl: opcode 18 with LK set and AA clear.
+      if ((code & 0xFC000003) != 0x48000001) {
+        continue;
+      }
+      uint32_t target = address + ((int32_t(code << 6) >> 6) & ~int32_t(3));
+      if (is_code(target)) {
+        addresses.push_back(target);
+      }
+    }
+  }
+  std::sort(addresses.begin(), addresses.end());
+  addresses.erase(std::unique(addresses.begin(), addresses.end()),
+                  addresses.end());
+  return addresses;
+}
+
+int TranslationBenchmarkMain(const std::vector<std::string>& args) {
+  std::filesystem::path path = cvars::target_xex;
+  if (path.empty()) {
+    XELOGE("No XEX file specified");
+    return 1;
+  }
+  path = std::filesystem::absolute(path);
+
+  // Statistics are only recorded by translators created after this.
+  cvars::translation_statistics = true;
+
+  auto emulator = std::make_unique<Emulator>("", "", "", "");
+  X_STATUS result = emulator->Setup(
+      nullptr, nullptr, true, nullptr,
+      []() { return std::make_unique<gpu::null::NullGraphicsSystem>(); },
+      nullptr);
+  if (XFAILED(result)) {
+    XELOGE("Failed to setup emulator: {:08X}", result);
+    return 1;
+  }
+
+  // Mount the directory of the XEX the same way as when launching it.
+  auto mount_path = "\\Device\\Harddisk0\\Partition1";
+  auto device = std::make_unique<vfs::HostPathDevice>(
+      mount_path, path.parent_path(), true);
+  if (!device->Initialize() ||
+      !emulator->file_system()->RegisterDevice(std::move(device))) {
+    XELOGE("Unable to mount {}", xe::path_to_utf8(path.parent_path()));
+    return 1;
+  }
+  emulator->file_system()->RegisterSymbolicLink("game:", mount_path);
+
+  // Only load the module without running anything.
+  auto module = emulator->kernel_state()->LoadUserModule(
+      "game:\\" + xe::path_to_utf8(path.filename()), false);
+  if (!module || !module->xex_module()) {
+    XELOGE("Unable to load {}", xe::path_to_utf8(path));
+    return 1;
+  }
+
+  Processor* processor = emulator->processor();
+  auto addresses = DiscoverFunctions(processor->memory(), module->xex_module(),
+                                     module->entry_point());
+  XELOGI("Translating {} discovered functions...", addresses.size());
+
+  size_t failed_count = 0;
+  uint64_t start_ticks = Clock::QueryHostTickCount();
+  for (uint32_t address : addresses) {
+    if (!processor->ResolveFunction(address)) {
+      ++failed_count;
+    }
+  }
+  double duration_ms = double(Clock::QueryHostTickCount() - start_ticks) *
+                       1000.0 / double(Clock::QueryHostTickFrequency());
+  XELOGI("Resolved {} functions ({} failed) in {:.3f} ms",
+         addresses.size() - failed_count, failed_count, duration_ms);
+
+  // Dump here rather than on shutdown along with the rest of the log.
+  TranslationStatistics* statistics =
+      processor->frontend()->translation_statistics();
+  statistics->Dump(cvars::slowest_function_count);
+  statistics->Reset();
+  return 0;
+}
+
+}  // namespace test
+}  // namespace cpu
+}  // namespace xe
+
+XE_DEFINE_CONSOLE_APP("xenia-cpu-ppc-translation-benchmark",
+                      xe::cpu::test::TranslationBenchmarkMain, "some.xex",
+                      "target_xex");
@@ -37,6 +37,44 @@ project("xenia-cpu-ppc-tests")
     -- xenia-base needs this
     links({"xenia-ui"})
 
+project("xenia-cpu-ppc-translation-benchmark")
+  uuid("6b0e8d5c-3f2a-4c71-9e4d-1a7f2c9b5e30")
+  kind("ConsoleApp")
+  language("C++")
+  links({
+    "xenia-apu",
+    "xenia-base",
+    "xenia-core",
+    "xenia-cpu",
+    "xenia-gpu",
+    "xenia-gpu-null",
+    "xenia-hid",
+    "xenia-kernel",
+    "xenia-ui",
+    "xenia-vfs",
+  })
+  links({
+    "aes_128",
+    "capstone",
+    "fmt",
+    "imgui",
+    "libavcodec",
+    "libavutil",
+    "mspack",
+    "snappy",
+    "xxhash",
+  })
+  files({
+    "ppc_translation_benchmark_main.cc",
+    "../../../base/console_app_main_"..platform_suffix..".cc",
+  })
+  filter("architecture:x86_64")
+    links({
+      "xenia-cpu-backend-x64",
+    })
+  filter("platforms:Windows")
+    debugdir(project_root)
+
 if ARCH == "ppc64" or ARCH == "powerpc64" then
 
 project("xenia-cpu-ppc-nativetests")
@@ -9,6 +9,8 @@
 
 #include "xenia/cpu/processor.h"
 
+#include <algorithm>
+
 #include "xenia/base/assert.h"
 #include "xenia/base/atomic.h"
 #include "xenia/base/byte_order.h"
@@ -83,7 +85,9 @@ class BuiltinModule : public Module {
 };
 
 Processor::Processor(xe::Memory* memory, ExportResolver* export_resolver)
-    : memory_(memory), export_resolver_(export_resolver) {}
+    : memory_(memory), export_resolver_(export_resolver) {
+  translated_code_pages_.resize((uint64_t(1) << (32 - 12)) / 64);
+}
 
 Processor::~Processor() {
   {
@@ -243,7 +247,16 @@ Function* Processor::ResolveFunction(uint32_t address) {
     }
     entry->function = function;
     entry->end_address = function->end_address();
-    status = entry->status = Entry::STATUS_READY;
+    {
+      // Ready along with the pages being marked, so invalidation marking the
+      // pages of the remaining functions again doesn't miss this one.
+      auto global_lock = global_critical_region_.Acquire();
+      for (uint32_t page = address >> 12;
+           page <= std::max(address, entry->end_address) >> 12; ++page) {
+        translated_code_pages_[page >> 6] |= uint64_t(1) << (page & 63);
+      }
+      status = entry->status = Entry::STATUS_READY;
+    }
   }
   if (status == Entry::STATUS_READY) {
     // Ready to use.
@@ -254,6 +267,71 @@ Function* Processor::ResolveFunction(uint32_t address) {
   }
 }
 
+void Processor::InvalidateGuestCode(uint32_t address, uint32_t length,
+                                    bool unloaded) {
+  if (!length) {
+    return;
+  }
+  uint32_t last_address = address + std::min(length - 1, ~address);
+  auto global_lock = global_critical_region_.Acquire();
+  bool translated = false;
+  for (uint32_t page = address >> 12; page <= last_address >> 12; ++page) {
+    if (translated_code_pages_[page >> 6] & (uint64_t(1) << (page & 63))) {
+      translated = true;
+      break;
+    }
+  }
+  if (!translated) {
+    return;
+  }
+
+  std::vector<GuestFunction*> functions;
+  for (Function* function : entry_table_.FindInRange(address, last_address)) {
+    if (function->is_guest()) {
+      functions.push_back(static_cast<GuestFunction*>(function));
+    }
+  }
+  if (!functions.empty()) {
+    XELOGD("Invalidating {} functions in {:08X}-{:08X}", functions.size(),
+           address, last_address);
+    InvalidateFunctions(functions, unloaded);
+  }
+
+  // Unmark the pages, except for those still having translated functions
+  // that only partially overlap the range.
+  uint32_t first_page = address >> 12;
+  uint32_t last_page = last_address >> 12;
+  for (uint32_t page = first_page; page <= last_page; ++page) {
+    translated_code_pages_[page >> 6] &= ~(uint64_t(1) << (page & 63));
+  }
+  for (Function* function :
+       entry_table_.FindInRange(first_page << 12, (last_page << 12) | 0xFFF)) {
+    uint32_t function_last_address =
+        std::max(function->address(), function->end_address());
+    for (uint32_t page = std::max(function->address() >> 12, first_page);
+         page <= std::min(function_last_address >> 12, last_page); ++page) {
+      translated_code_pages_[page >> 6] |= uint64_t(1) << (page & 63);
+    }
+  }
+}
+
+void Processor::InvalidateFunctions(
+    const std::vector<GuestFunction*>& functions, bool unloaded) {
+  auto global_lock = global_critical_region_.Acquire();
+  // Removed first, so callers of the functions going through the indirection
+  // table from now on translate them again instead of resolving them to the
+  // current translations, which will only lead back to the table.
+  for (GuestFunction* function : functions) {
+    entry_table_.Remove(function->address());
+    // Unless it's already being translated again.
+    if (function->status() != Symbol::Status::kDefining) {
+      function->set_status(Symbol::Status::kDeclared);
+    }
+  }
+  frontend_->RemoveConstantMemoryDependencies(functions);
+  backend_->InvalidateFunctions(functions, unloaded);
+}
+
 Function* Processor::LookupFunction(uint32_t address) {
   // TODO(benvanik): fast reject invalid addresses/log errors.
 
@@ -303,8 +381,8 @@ bool Processor::DemandFunction(Function* function) {
   if (symbol_status == Symbol::Status::kNew) {
     // Symbol is undefined, so define now.
     assert_true(function->is_guest());
-    if (!frontend_->DefineFunction(static_cast<GuestFunction*>(function),
-                                   debug_info_flags_)) {
+    if (!module->TranslateFunction(static_cast<GuestFunction*>(function),
+                                  debug_info_flags_)) {
       function->set_status(Symbol::Status::kFailed);
       return false;
     }
@@ -324,6 +402,10 @@ bool Processor::DemandFunction(Function* function) {
   return true;
 }
 
+bool Processor::TranslateFunction(GuestFunction* function) {
+  return function->module()->TranslateFunction(function, debug_info_flags_);
+}
+
 bool Processor::Execute(ThreadState* thread_state, uint32_t address) {
   SCOPE_profile_cpu_f("cpu");
 
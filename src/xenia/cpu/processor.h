@@ -96,6 +96,7 @@ class Processor {
     debug_listener_handler_ = std::move(handler);
   }
 
+  uint32_t debug_info_flags() const { return debug_info_flags_; }
   void set_debug_info_flags(uint32_t debug_info_flags) {
     debug_info_flags_ = debug_info_flags;
   }
@@ -115,6 +116,18 @@ class Processor {
   Function* LookupFunction(uint32_t address);
   Function* LookupFunction(Module* module, uint32_t address);
   Function* ResolveFunction(uint32_t address);
+  // Discards the translations of the guest functions overlapping the range,
+  // so they are translated again from the current guest code when called
+  // next. If the code has been unloaded, no thread may be executing it
+  // anymore, and the memory of the translations may be reused.
+  void InvalidateGuestCode(uint32_t address, uint32_t length, bool unloaded);
+  // Like InvalidateGuestCode, for specific guest functions. Doesn't wait for
+  // other threads, so it may be called with the global critical region held.
+  void InvalidateFunctions(const std::vector<GuestFunction*>& functions,
+                           bool unloaded);
+  // Translates a defined guest function again through its module, replacing
+  // its machine code, for backends changing the assumptions made in it.
+  bool TranslateFunction(GuestFunction* function);
 
   bool Execute(ThreadState* thread_state, uint32_t address);
   bool ExecuteRaw(ThreadState* thread_state, uint32_t address);
@@ -256,6 +269,10 @@ class Processor {
 
   EntryTable entry_table_;
   xe::global_critical_region global_critical_region_;
+  // Bit for each 4 KB page of the guest address space that has translated
+  // code, to quickly skip invalidating code that hasn't been translated. Must
+  // be guarded with the global lock.
+  std::vector<uint64_t> translated_code_pages_;
   ExecutionState execution_state_ = ExecutionState::kPaused;
   std::vector<std::unique_ptr<Module>> modules_;
   Module* builtin_module_ = nullptr;
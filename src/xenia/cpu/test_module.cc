@@ -14,6 +14,7 @@
 #include "xenia/base/reset_scope.h"
 #include "xenia/base/string.h"
 #include "xenia/cpu/compiler/compiler_passes.h"
+#include "xenia/cpu/ppc/ppc_hir_builder.h"
 #include "xenia/cpu/processor.h"
 
 namespace xe {
@@ -27,11 +28,21 @@ namespace passes = xe::cpu::compiler::passes;
 TestModule::TestModule(Processor* processor, const std::string_view name,
                        std::function<bool(uint32_t)> contains_address,
                        std::function<bool(hir::HIRBuilder&)> generate)
+    : TestModule(processor, name, contains_address,
+                 [generate](hir::HIRBuilder& b, uint32_t address) {
+                   return generate(b);
+                 }) {}
+
+TestModule::TestModule(Processor* processor, const std::string_view name,
+                       std::function<bool(uint32_t)> contains_address,
+                       std::function<bool(hir::HIRBuilder&, uint32_t)> generate)
     : Module(processor),
       name_(name),
       contains_address_(contains_address),
       generate_(generate) {
-  builder_.reset(new HIRBuilder());
+  // Frontend helpers emitting guest code, such as export fast paths, may be
+  // tested too.
+  builder_.reset(new ppc::PPCHIRBuilder(processor->frontend()));
   compiler_.reset(new Compiler(processor));
   assembler_ = processor->backend()->CreateAssembler();
   assembler_->Initialize();
@@ -81,27 +92,45 @@ Symbol::Status TestModule::DeclareFunction(uint32_t address,
   Symbol::Status status = Module::DeclareFunction(address, out_function);
   if (status == Symbol::Status::kNew) {
     auto function = static_cast<GuestFunction*>(*out_function);
-
-    // Reset() all caching when we leave.
-    xe::make_reset_scope(compiler_);
-    xe::make_reset_scope(assembler_);
-
-    if (!generate_(*builder_.get())) {
+    if (!TranslateFunction(function, 0)) {
       function->set_status(Symbol::Status::kFailed);
       return Symbol::Status::kFailed;
     }
-
-    // Run optimization passes.
-    compiler_->Compile(builder_.get());
-
-    // Assemble the function.
-    assembler_->Assemble(function, builder_.get(), 0, nullptr);
-
     status = Symbol::Status::kDefined;
     function->set_status(status);
   }
   return status;
 }
 
+bool TestModule::TranslateFunction(GuestFunction* function,
+                                   uint32_t debug_info_flags) {
+  auto global_lock = global_critical_region_.Acquire();
+
+  // Reset() all caching when we leave.
+  xe::make_reset_scope(builder_);
+  xe::make_reset_scope(compiler_);
+  xe::make_reset_scope(assembler_);
+
+  if (!generate_(*builder_.get(), function->address())) {
+    return false;
+  }
+
+  // Run optimization passes.
+  compiler_->Compile(builder_.get());
+
+  // Assemble the function.
+  if (!assembler_->Assemble(function, builder_.get(), debug_info_flags,
+                            nullptr)) {
+    return false;
+  }
+
+  // Like PPCTranslator, for testing loads from read-only memory.
+  if (!processor_->frontend()->AddConstantMemoryDependencies(
+          function, compiler_->constant_memory_dependencies())) {
+    return processor_->backend()->RetranslateFunction(function);
+  }
+  return true;
+}
+
 }  // namespace cpu
 }  // namespace xe
@@ -14,6 +14,7 @@
 #include <memory>
 #include <string>
 
+#include "xenia/base/mutex.h"
 #include "xenia/cpu/backend/assembler.h"
 #include "xenia/cpu/compiler/compiler.h"
 #include "xenia/cpu/hir/hir_builder.h"
@@ -27,6 +28,10 @@ class TestModule : public Module {
   TestModule(Processor* processor, const std::string_view name,
              std::function<bool(uint32_t)> contains_address,
              std::function<bool(hir::HIRBuilder&)> generate);
+  // For modules with multiple functions, generated depending on the address.
+  TestModule(Processor* processor, const std::string_view name,
+             std::function<bool(uint32_t)> contains_address,
+             std::function<bool(hir::HIRBuilder&, uint32_t)> generate);
   ~TestModule() override;
 
   const std::string& name() const override { return name_; }
@@ -36,6 +41,10 @@ class TestModule : public Module {
 
   Symbol::Status DeclareFunction(uint32_t address,
                                  Function** out_symbol) override;
+  // Generates the HIR again, so the function can be invalidated and
+  // retranslated.
+  bool TranslateFunction(GuestFunction* function,
+                         uint32_t debug_info_flags) override;
 
  protected:
   std::unique_ptr<Function> CreateFunction(uint32_t address) override;
@@ -43,8 +52,10 @@ class TestModule : public Module {
  private:
   std::string name_;
   std::function<bool(uint32_t)> contains_address_;
-  std::function<bool(hir::HIRBuilder&)> generate_;
+  std::function<bool(hir::HIRBuilder&, uint32_t)> generate_;
 
+  // Held while translating, as retranslation may happen on any thread.
+  xe::global_critical_region global_critical_region_;
   std::unique_ptr<hir::HIRBuilder> builder_;
   std::unique_ptr<compiler::Compiler> compiler_;
   std::unique_ptr<backend::Assembler> assembler_;
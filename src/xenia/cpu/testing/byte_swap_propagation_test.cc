@@ -0,0 +1,336 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compiler/passes/byte_swap_propagation_pass.h"
+#include "xenia/cpu/compiler/passes/memory_sequence_combination_pass.h"
+#include "xenia/cpu/testing/util.h"
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::hir;
+using namespace xe::cpu::testing;
+using xe::cpu::compiler::passes::ByteSwapPropagationPass;
+using xe::cpu::compiler::passes::MemorySequenceCombinationPass;
+
+namespace {
+
+Instr* FindInstr(const Block* block, const OpcodeInfo& opcode) {
+  for (auto i = block->instr_head; i; i = i->next) {
+    if (i->opcode == &opcode) {
+      return i;
+    }
+  }
+  return nullptr;
+}
+
+uint32_t CountOpcode(const Block* block, const OpcodeInfo& opcode) {
+  uint32_t count = 0;
+  for (auto i = block->instr_head; i; i = i->next) {
+    if (i->opcode == &opcode) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+// The instruction computing the value, skipping assignments.
+const OpcodeInfo* DefOpcode(const Value* value) {
+  auto def = value->def;
+  while (def && def->opcode == &OPCODE_ASSIGN_info) {
+    def = def->src1.value->def;
+  }
+  return def ? def->opcode : nullptr;
+}
+
+Value* LoadGPR32(HIRBuilder& b, int reg) {
+  return b.LoadContext(offsetof(PPCContext, r) + reg * 8, INT32_TYPE);
+}
+void StoreGPR32(HIRBuilder& b, int reg, Value* value) {
+  b.StoreContext(offsetof(PPCContext, r) + reg * 8, value);
+}
+
+}  // namespace
+
+TEST_CASE("byte_swap_bitwise_constant", "[compiler]") {
+  struct BitwiseOp {
+    Value* (HIRBuilder::*emit)(Value*, Value*);
+    const OpcodeInfo& opcode;
+  };
+  const BitwiseOp ops[] = {
+      {&HIRBuilder::And, OPCODE_AND_info},
+      {&HIRBuilder::Or, OPCODE_OR_info},
+      {&HIRBuilder::Xor, OPCODE_XOR_info},
+  };
+  for (const BitwiseOp& op : ops) {
+    // r4 = byte_swap(byte_swap(r3) op 0xFF000000)
+    HIRBuilder b;
+    auto swapped = b.ByteSwap(LoadGPR32(b, 3));
+    auto result = (b.*op.emit)(swapped, b.LoadConstantUint32(0xFF000000));
+    StoreGPR32(b, 4, b.ByteSwap(result));
+    b.Return();
+
+    ByteSwapPropagationPass pass;
+    REQUIRE(pass.Run(&b));
+
+    // Applied to the loaded value with the constant swapped instead, and the
+    // swap of the result cancels out with the one before the store.
+    auto block = b.first_block();
+    auto i = FindInstr(block, op.opcode);
+    REQUIRE(i);
+    REQUIRE(i->src1.value->def->opcode == &OPCODE_LOAD_CONTEXT_info);
+    REQUIRE(i->src2.value->IsConstant());
+    REQUIRE(i->src2.value->constant.i32 == 0x000000FF);
+    auto store = FindInstr(block, OPCODE_STORE_CONTEXT_info);
+    REQUIRE(store->src2.value->def->opcode == &OPCODE_ASSIGN_info);
+    REQUIRE(store->src2.value->def->src1.value == i->dest);
+  }
+}
+
+TEST_CASE("byte_swap_not", "[compiler]") {
+  HIRBuilder b;
+  StoreGPR32(b, 4, b.ByteSwap(b.Not(b.ByteSwap(LoadGPR32(b, 3)))));
+  b.Return();
+
+  ByteSwapPropagationPass pass;
+  REQUIRE(pass.Run(&b));
+  auto block = b.first_block();
+  auto i = FindInstr(block, OPCODE_NOT_info);
+  REQUIRE(i);
+  REQUIRE(i->src1.value->def->opcode == &OPCODE_LOAD_CONTEXT_info);
+  auto store = FindInstr(block, OPCODE_STORE_CONTEXT_info);
+  REQUIRE(DefOpcode(store->src2.value) == &OPCODE_NOT_info);
+}
+
+TEST_CASE("byte_swap_permute", "[compiler]") {
+  // Vector swaps reverse the bytes in each 32-bit element, so only permutes
+  // of whole 32-bit elements can be done on the unswapped values.
+  const TypeName part_types[] = {INT8_TYPE, INT16_TYPE, INT32_TYPE};
+  for (TypeName part_type : part_types) {
+    HIRBuilder b;
+    auto control = LoadVR(b, 3);
+    auto permuted = b.Permute(control, b.ByteSwap(LoadVR(b, 4)),
+                              b.ByteSwap(LoadVR(b, 5)), part_type);
+    StoreVR(b, 6, b.ByteSwap(permuted));
+    b.Return();
+
+    ByteSwapPropagationPass pass;
+    bool propagated = part_type == INT32_TYPE;
+    REQUIRE(pass.Run(&b) == propagated);
+    auto block = b.first_block();
+    auto i = FindInstr(block, OPCODE_PERMUTE_info);
+    REQUIRE(i);
+    REQUIRE(i->src1.value == control);
+    if (propagated) {
+      REQUIRE(i->src2.value->def->opcode == &OPCODE_LOAD_CONTEXT_info);
+      REQUIRE(i->src3.value->def->opcode == &OPCODE_LOAD_CONTEXT_info);
+      REQUIRE(CountOpcode(block, OPCODE_ASSIGN_info) == 1);
+    } else {
+      REQUIRE(i->src2.value->def->opcode == &OPCODE_BYTE_SWAP_info);
+      REQUIRE(i->src3.value->def->opcode == &OPCODE_BYTE_SWAP_info);
+      REQUIRE(CountOpcode(block, OPCODE_BYTE_SWAP_info) == 3);
+    }
+  }
+}
+
+TEST_CASE("byte_swap_swizzle", "[compiler]") {
+  const TypeName part_types[] = {INT32_TYPE, FLOAT32_TYPE};
+  for (TypeName part_type : part_types) {
+    HIRBuilder b;
+    auto swizzled = b.Swizzle(b.ByteSwap(LoadVR(b, 3)), part_type,
+                              SWIZZLE_XYZW_TO_WXYZ);
+    StoreVR(b, 4, b.ByteSwap(swizzled));
+    b.Return();
+
+    ByteSwapPropagationPass pass;
+    REQUIRE(pass.Run(&b));
+    auto block = b.first_block();
+    auto i = FindInstr(block, OPCODE_SWIZZLE_info);
+    REQUIRE(i);
+    REQUIRE(i->flags == part_type);
+    REQUIRE(i->src2.offset == SWIZZLE_XYZW_TO_WXYZ);
+    REQUIRE(i->src1.value->def->opcode == &OPCODE_LOAD_CONTEXT_info);
+    auto store = FindInstr(block, OPCODE_STORE_CONTEXT_info);
+    REQUIRE(store->src2.value->def->opcode == &OPCODE_ASSIGN_info);
+  }
+}
+
+TEST_CASE("byte_swap_compare", "[compiler]") {
+  const OpcodeInfo* opcodes[] = {&OPCODE_COMPARE_EQ_info,
+                                 &OPCODE_COMPARE_NE_info};
+  for (const OpcodeInfo* opcode : opcodes) {
+    HIRBuilder b;
+    auto x = b.ByteSwap(LoadGPR32(b, 3));
+    auto y = b.ByteSwap(LoadGPR32(b, 4));
+    auto constant = b.LoadConstantUint32(0x12345678);
+    bool eq = opcode == &OPCODE_COMPARE_EQ_info;
+    b.StoreContext(offsetof(PPCContext, r) + 5 * 8,
+                   eq ? b.CompareEQ(x, y) : b.CompareNE(x, y));
+    b.StoreContext(offsetof(PPCContext, r) + 6 * 8,
+                   eq ? b.CompareEQ(x, constant) : b.CompareNE(x, constant));
+    b.Return();
+
+    ByteSwapPropagationPass pass;
+    REQUIRE(pass.Run(&b));
+
+    // Equality doesn't depend on the byte order, so the swaps aren't needed.
+    uint32_t compare_count = 0;
+    for (auto i = b.first_block()->instr_head; i; i = i->next) {
+      if (i->opcode != opcode) {
+        continue;
+      }
+      ++compare_count;
+      REQUIRE(i->src1.value->def->opcode == &OPCODE_LOAD_CONTEXT_info);
+      if (i->src2.value->IsConstant()) {
+        REQUIRE(i->src2.value->constant.i32 == 0x78563412);
+      } else {
+        REQUIRE(i->src2.value->def->opcode == &OPCODE_LOAD_CONTEXT_info);
+      }
+    }
+    REQUIRE(compare_count == 2);
+  }
+}
+
+TEST_CASE("byte_swap_pair_cancellation", "[compiler]") {
+  HIRBuilder b;
+  auto value = LoadGPR32(b, 3);
+  StoreGPR32(b, 4, b.ByteSwap(b.ByteSwap(value)));
+  b.Return();
+
+  ByteSwapPropagationPass pass;
+  REQUIRE(pass.Run(&b));
+  auto block = b.first_block();
+  REQUIRE(CountOpcode(block, OPCODE_BYTE_SWAP_info) == 1);
+  auto store = FindInstr(block, OPCODE_STORE_CONTEXT_info);
+  REQUIRE(store->src2.value->def->opcode == &OPCODE_ASSIGN_info);
+  REQUIRE(store->src2.value->def->src1.value == value);
+}
+
+TEST_CASE("byte_swap_unswappable_types", "[compiler]") {
+  SECTION("int8") {
+    // 8-bit values have no byte order, so their constants aren't swapped.
+    HIRBuilder b;
+    auto value = b.LoadContext(offsetof(PPCContext, r) + 3 * 8, INT8_TYPE);
+    auto result = b.And(b.ByteSwap(value), b.LoadConstantInt8(0x0F));
+    b.StoreContext(offsetof(PPCContext, r) + 4 * 8, b.ByteSwap(result));
+    b.Return();
+
+    ByteSwapPropagationPass pass;
+    REQUIRE_FALSE(pass.Run(&b));
+    auto i = FindInstr(b.first_block(), OPCODE_AND_info);
+    REQUIRE(i->src1.value == value);
+    REQUIRE(i->src2.value->constant.i8 == 0x0F);
+  }
+  SECTION("float") {
+    // Swapped floats may be NaNs that compare differently.
+    HIRBuilder b;
+    auto x = b.ByteSwap(LoadFPR(b, 1));
+    auto y = b.ByteSwap(LoadFPR(b, 2));
+    b.StoreContext(offsetof(PPCContext, r) + 3 * 8, b.CompareEQ(x, y));
+    b.Return();
+
+    ByteSwapPropagationPass pass;
+    REQUIRE_FALSE(pass.Run(&b));
+    auto i = FindInstr(b.first_block(), OPCODE_COMPARE_EQ_info);
+    REQUIRE(i->src1.value == x);
+    REQUIRE(i->src2.value == y);
+  }
+}
+
+TEST_CASE("memory_sequence_swapped_copy", "[compiler]") {
+  // r3 = byte_swap(load r4), and the loaded value copied to r5.
+  HIRBuilder b;
+  auto value = b.Load(LoadGPR(b, 4), INT32_TYPE);
+  StoreGPR32(b, 3, b.ByteSwap(value));
+  b.Store(LoadGPR(b, 5), value);
+  b.StoreOffset(LoadGPR(b, 6), b.LoadConstantUint64(4), value);
+  b.Return();
+
+  MemorySequenceCombinationPass pass;
+  REQUIRE(pass.Run(&b));
+  auto block = b.first_block();
+  auto load = FindInstr(block, OPCODE_LOAD_info);
+  REQUIRE(load->flags & LOAD_STORE_BYTE_SWAP);
+  REQUIRE(CountOpcode(block, OPCODE_BYTE_SWAP_info) == 0);
+  auto store = FindInstr(block, OPCODE_STORE_info);
+  REQUIRE(store->src2.value == value);
+  REQUIRE(store->flags & LOAD_STORE_BYTE_SWAP);
+  auto store_offset = FindInstr(block, OPCODE_STORE_OFFSET_info);
+  REQUIRE(store_offset->src3.value == value);
+  REQUIRE(store_offset->flags & LOAD_STORE_BYTE_SWAP);
+}
+
+TEST_CASE("memory_sequence_unswappable_copy", "[compiler]") {
+  // The load stays unswapped if any use of the loaded value can't be changed
+  // to take the swapped value.
+  SECTION("float") {
+    HIRBuilder b;
+    auto value = b.Load(LoadGPR(b, 4), FLOAT32_TYPE);
+    b.StoreContext(offsetof(PPCContext, f) + 1 * 8, b.ByteSwap(value));
+    b.Store(LoadGPR(b, 5), value);
+    b.Return();
+
+    MemorySequenceCombinationPass pass;
+    pass.Run(&b);
+    auto block = b.first_block();
+    REQUIRE_FALSE(FindInstr(block, OPCODE_LOAD_info)->flags &
+                  LOAD_STORE_BYTE_SWAP);
+    REQUIRE_FALSE(FindInstr(block, OPCODE_STORE_info)->flags &
+                  LOAD_STORE_BYTE_SWAP);
+    REQUIRE(CountOpcode(block, OPCODE_BYTE_SWAP_info) == 1);
+  }
+  SECTION("int8") {
+    // Byte swaps of 8-bit values aren't emitted at all, so the copy is
+    // never swapped.
+    HIRBuilder b;
+    auto value = b.Load(LoadGPR(b, 4), INT8_TYPE);
+    b.StoreContext(offsetof(PPCContext, r) + 3 * 8, b.ByteSwap(value));
+    b.Store(LoadGPR(b, 5), value);
+    b.Return();
+
+    MemorySequenceCombinationPass pass;
+    pass.Run(&b);
+    auto block = b.first_block();
+    REQUIRE_FALSE(FindInstr(block, OPCODE_LOAD_info)->flags &
+                  LOAD_STORE_BYTE_SWAP);
+    REQUIRE_FALSE(FindInstr(block, OPCODE_STORE_info)->flags &
+                  LOAD_STORE_BYTE_SWAP);
+  }
+  SECTION("address") {
+    HIRBuilder b;
+    auto value = b.Load(LoadGPR(b, 4), INT64_TYPE);
+    StoreGPR(b, 3, b.ByteSwap(value));
+    b.Store(value, value);
+    b.Return();
+
+    MemorySequenceCombinationPass pass;
+    pass.Run(&b);
+    auto block = b.first_block();
+    REQUIRE_FALSE(FindInstr(block, OPCODE_LOAD_info)->flags &
+                  LOAD_STORE_BYTE_SWAP);
+    REQUIRE_FALSE(FindInstr(block, OPCODE_STORE_info)->flags &
+                  LOAD_STORE_BYTE_SWAP);
+    REQUIRE(CountOpcode(block, OPCODE_BYTE_SWAP_info) == 1);
+  }
+  SECTION("offset") {
+    HIRBuilder b;
+    auto value = b.Load(LoadGPR(b, 4), INT64_TYPE);
+    StoreGPR(b, 3, b.ByteSwap(value));
+    b.StoreOffset(LoadGPR(b, 5), value, value);
+    b.Return();
+
+    MemorySequenceCombinationPass pass;
+    pass.Run(&b);
+    auto block = b.first_block();
+    REQUIRE_FALSE(FindInstr(block, OPCODE_LOAD_info)->flags &
+                  LOAD_STORE_BYTE_SWAP);
+    REQUIRE_FALSE(FindInstr(block, OPCODE_STORE_OFFSET_info)->flags &
+                  LOAD_STORE_BYTE_SWAP);
+    REQUIRE(CountOpcode(block, OPCODE_BYTE_SWAP_info) == 1);
+  }
+}
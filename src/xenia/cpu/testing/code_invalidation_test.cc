@@ -0,0 +1,123 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/backend/x64/x64_code_cache.h"
+#include "xenia/cpu/testing/util.h"
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::hir;
+using namespace xe::cpu::testing;
+using xe::cpu::backend::x64::X64Backend;
+using xe::cpu::ppc::PPCContext;
+
+TEST_CASE("guest_code_invalidation", "[backend]") {
+  // Stands for the guest code, which changes between translations.
+  uint64_t value = 0;
+  TestFunction test([&value](HIRBuilder& b) {
+    StoreGPR(b, 3, b.LoadConstantUint64(value));
+    b.Return();
+  });
+
+  auto run = [&test]() {
+    uint64_t result = 0;
+    test.Run([](PPCContext* ctx) { ctx->r[3] = 0; },
+             [&result](PPCContext* ctx) { result = ctx->r[3]; });
+    return result;
+  };
+
+  for (auto& processor : test.processors) {
+    auto code_cache =
+        static_cast<X64Backend*>(processor->backend())->code_cache();
+    value = 1;
+    REQUIRE(run() == 1);
+    auto function =
+        static_cast<GuestFunction*>(processor->ResolveFunction(0x80000000));
+    REQUIRE(function);
+    uint8_t* old_machine_code = function->machine_code();
+
+    // Other code being modified doesn't affect the function.
+    value = 2;
+    processor->InvalidateGuestCode(0x80008000, 4, false);
+    REQUIRE(run() == 1);
+    REQUIRE(function->machine_code() == old_machine_code);
+
+    // Like icbi, translated again from the modified code when called.
+    processor->InvalidateGuestCode(0x80000000, 4, false);
+    REQUIRE(run() == 2);
+    REQUIRE(function->machine_code() != old_machine_code);
+
+    // The page is marked again by the new translation, and the old code
+    // already redirected keeps using the same indirection stub.
+    value = 3;
+    auto statistics = code_cache->QueryStatistics();
+    processor->InvalidateGuestCode(0x80000000, 4, false);
+    auto invalidated_statistics = code_cache->QueryStatistics();
+    REQUIRE(invalidated_statistics.live_code_bytes +
+                invalidated_statistics.dead_code_bytes ==
+            statistics.live_code_bytes + statistics.dead_code_bytes);
+    REQUIRE(run() == 3);
+  }
+}
+
+TEST_CASE("retired_code_reclaimed", "[backend]") {
+  // Translated with less code after being unloaded, so the new translation
+  // fits in the reclaimed code of the old one.
+  uint32_t multiply_count = 0;
+  TestFunction test([&multiply_count](HIRBuilder& b) {
+    auto value = LoadGPR(b, 4);
+    for (uint32_t i = 0; i < multiply_count; ++i) {
+      value = b.Mul(value, LoadGPR(b, 5));
+    }
+    StoreGPR(b, 3, value);
+    b.Return();
+  });
+
+  auto run = [&test]() {
+    uint64_t result = 0;
+    test.Run(
+        [](PPCContext* ctx) {
+          ctx->r[4] = 3;
+          ctx->r[5] = 1;
+        },
+        [&result](PPCContext* ctx) { result = ctx->r[3]; });
+    return result;
+  };
+
+  for (auto& processor : test.processors) {
+    auto code_cache =
+        static_cast<X64Backend*>(processor->backend())->code_cache();
+    multiply_count = 64;
+    REQUIRE(run() == 3);
+    if (!code_cache->CanReuseCode()) {
+      continue;
+    }
+    auto function =
+        static_cast<GuestFunction*>(processor->ResolveFunction(0x80000000));
+    REQUIRE(function);
+    uint8_t* old_machine_code = function->machine_code();
+    size_t old_machine_code_length = function->machine_code_length();
+    size_t free_code_bytes = code_cache->QueryStatistics().free_code_bytes;
+
+    // Like the module being unloaded, after which no thread can be executing
+    // the code anymore.
+    multiply_count = 1;
+    processor->InvalidateGuestCode(0x80000000, 4, true);
+    auto reclaimed_statistics = code_cache->QueryStatistics();
+    REQUIRE(reclaimed_statistics.free_code_bytes > free_code_bytes);
+
+    // Placed after the jump kept at the beginning of the old code.
+    REQUIRE(run() == 3);
+    REQUIRE(function->machine_code() > old_machine_code);
+    REQUIRE(function->machine_code() <
+            old_machine_code + old_machine_code_length);
+    REQUIRE(code_cache->QueryStatistics().free_code_bytes <
+            reclaimed_statistics.free_code_bytes);
+  }
+}
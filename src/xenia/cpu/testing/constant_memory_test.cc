@@ -0,0 +1,75 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/memory.h"
+#include "xenia/cpu/testing/util.h"
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::hir;
+using namespace xe::cpu::testing;
+using xe::cpu::ppc::PPCContext;
+
+namespace {
+
+// In a heap with 4 KB pages, like the host ones.
+const uint32_t kConstantAddress = 0x90010000;
+
+}  // namespace
+
+TEST_CASE("constant_memory_retranslation", "[backend]") {
+  TestFunction test([](HIRBuilder& b) {
+    StoreGPR(b, 3,
+             b.ZeroExtend(b.Load(b.LoadConstantUint64(kConstantAddress),
+                                 INT32_TYPE),
+                          INT64_TYPE));
+    b.Return();
+  });
+  auto heap = test.memory->LookupHeap(kConstantAddress);
+  REQUIRE(heap);
+  REQUIRE(heap->AllocFixed(kConstantAddress, 4096, 4096,
+                           kMemoryAllocationReserve | kMemoryAllocationCommit,
+                           kMemoryProtectRead | kMemoryProtectWrite));
+  auto host_address = test.memory->TranslateVirtual(kConstantAddress);
+  xe::store<uint32_t>(host_address, 0x1234);
+  REQUIRE(heap->Protect(kConstantAddress, 4096, kMemoryProtectRead));
+
+  auto run = [&test]() {
+    uint64_t value = 0;
+    test.Run([](PPCContext* ctx) { ctx->r[3] = 0; },
+             [&value](PPCContext* ctx) { value = ctx->r[3]; });
+    return value;
+  };
+
+  for (auto& processor : test.processors) {
+    REQUIRE(run() == 0x1234);
+    auto function =
+        static_cast<GuestFunction*>(processor->ResolveFunction(0x80000000));
+    REQUIRE(function);
+    uint8_t* folded_machine_code = function->machine_code();
+
+    // Modified without the guest knowing, the value read while translating is
+    // still used.
+    REQUIRE(xe::memory::Protect(host_address, 4096,
+                                xe::memory::PageAccess::kReadWrite));
+    xe::store<uint32_t>(host_address, 0x5678);
+    REQUIRE(run() == 0x1234);
+    REQUIRE(xe::memory::Protect(host_address, 4096,
+                                xe::memory::PageAccess::kReadOnly));
+
+    // Made writable by the guest, so translated again when called, loading
+    // the value from memory.
+    REQUIRE(heap->Protect(kConstantAddress, 4096,
+                          kMemoryProtectRead | kMemoryProtectWrite));
+    REQUIRE(run() == 0x5678);
+    REQUIRE(function->machine_code() != folded_machine_code);
+    xe::store<uint32_t>(host_address, 0x9ABC);
+    REQUIRE(run() == 0x9ABC);
+  }
+}
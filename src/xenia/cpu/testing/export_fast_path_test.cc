@@ -0,0 +1,254 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <chrono>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/cpu/ppc/ppc_hir_builder.h"
+#include "xenia/cpu/testing/util.h"
+#include "xenia/kernel/xboxkrnl/xboxkrnl_rtl.h"
+#include "xenia/kernel/xboxkrnl/xboxkrnl_threading.h"
+#include "xenia/kernel/xthread.h"
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::hir;
+using namespace xe::cpu::testing;
+using xe::cpu::ppc::PPCContext;
+using xe::cpu::ppc::PPCHIRBuilder;
+
+namespace {
+
+const uint64_t kExportCallIterations = 10000000;
+
+uint64_t export_handler_call_count_ = 0;
+
+// Stand-in for a trivial kernel export, such as KeTlsGetValue, reached
+// through a host call.
+void ExportHandler(PPCContext* ppc_context, void* arg0, void* arg1) {
+  ppc_context->r[3] += 1;
+  ++export_handler_call_count_;
+}
+
+void EmitExportCallLoop(HIRBuilder& b,
+                        std::function<void(HIRBuilder& b)> emit_call) {
+  auto loop_label = b.NewLabel();
+  b.MarkLabel(loop_label);
+  emit_call(b);
+  auto counter = b.Sub(LoadGPR(b, 4), b.LoadConstantUint64(1));
+  StoreGPR(b, 4, counter);
+  b.BranchTrue(counter, loop_label);
+  b.Return();
+}
+
+void RunExportCallLoop(TestFunction& test, const char* name) {
+  std::chrono::steady_clock::time_point start;
+  uint64_t start_call_count = export_handler_call_count_;
+  test.Run(
+      [&](PPCContext* ctx) {
+        ctx->r[3] = 0;
+        ctx->r[4] = kExportCallIterations;
+        start = std::chrono::steady_clock::now();
+      },
+      [&](PPCContext* ctx) {
+        std::chrono::duration<double> duration =
+            std::chrono::steady_clock::now() - start;
+        REQUIRE(ctx->r[3] == kExportCallIterations);
+        fmt::print("{}: {:.2f} M calls/s, {} host calls\n", name,
+                   double(kExportCallIterations) / duration.count() / 1e6,
+                   export_handler_call_count_ - start_call_count);
+      });
+}
+
+// Written to r4 depending on whether the fast path has completed or has
+// branched to the slow path label.
+const uint64_t kFastPathCompleted = 1;
+const uint64_t kSlowPathTaken = 2;
+
+void EmitFastPath(
+    HIRBuilder& b,
+    std::function<bool(PPCHIRBuilder& f, Label* slow_path_label)> fast_path) {
+  // Test modules build with the PPC frontend builder.
+  auto& f = static_cast<PPCHIRBuilder&>(b);
+  auto slow_path_label = f.NewLabel();
+  auto end_label = f.NewLabel();
+  REQUIRE(fast_path(f, slow_path_label));
+  StoreGPR(b, 4, b.LoadConstantUint64(kFastPathCompleted));
+  b.Branch(end_label);
+  b.MarkLabel(slow_path_label);
+  StoreGPR(b, 4, b.LoadConstantUint64(kSlowPathTaken));
+  b.MarkLabel(end_label);
+  b.Return();
+}
+
+}  // namespace
+
+TEST_CASE("export_fast_path_rtl_enter_critical_section", "[export]") {
+  TestFunction test([](HIRBuilder& b) {
+    EmitFastPath(b, xe::kernel::xboxkrnl::RtlEnterCriticalSection_fast_path);
+  });
+  const uint32_t thread = 0x12340000;
+  const uint32_t other_thread = 0x56780000;
+  uint32_t kpcr_address =
+      test.memory->SystemHeapAlloc(sizeof(xe::kernel::X_KPCR));
+  test.memory->TranslateVirtual<xe::kernel::X_KPCR*>(kpcr_address)
+      ->current_thread = thread;
+  // X_RTL_CRITICAL_SECTION.
+  uint32_t cs_address = test.memory->SystemHeapAlloc(28);
+  auto lock_count = test.memory->TranslateVirtual<int32_t*>(cs_address + 0x10);
+  auto recursion_count =
+      test.memory->TranslateVirtual<xe::be<int32_t>*>(cs_address + 0x14);
+  auto owning_thread =
+      test.memory->TranslateVirtual<xe::be<uint32_t>*>(cs_address + 0x18);
+  auto run = [&](uint64_t expected_path) {
+    test.Run(
+        [&](PPCContext* ctx) {
+          ctx->r[3] = cs_address;
+          ctx->r[13] = kpcr_address;
+        },
+        [&](PPCContext* ctx) { REQUIRE(ctx->r[4] == expected_path); });
+  };
+
+  SECTION("acquire") {
+    *lock_count = -1;
+    run(kFastPathCompleted);
+    REQUIRE(*lock_count == 0);
+    REQUIRE(*recursion_count == 1);
+    REQUIRE(*owning_thread == thread);
+  }
+
+  SECTION("recursive acquire") {
+    *lock_count = -1;
+    run(kFastPathCompleted);
+    // Recursion is counted by the export.
+    run(kSlowPathTaken);
+    REQUIRE(*lock_count == 0);
+    REQUIRE(*recursion_count == 1);
+    REQUIRE(*owning_thread == thread);
+  }
+
+  SECTION("contended") {
+    *lock_count = 0;
+    *recursion_count = 1;
+    *owning_thread = other_thread;
+    run(kSlowPathTaken);
+    REQUIRE(*lock_count == 0);
+    REQUIRE(*recursion_count == 1);
+    REQUIRE(*owning_thread == other_thread);
+  }
+}
+
+TEST_CASE("export_fast_path_ke_tls_get_value", "[export]") {
+  const uint32_t tls_static_size = 0x100;
+  const uint32_t tls_total_size = 0x1000;
+  TestFunction test([&](HIRBuilder& b) {
+    EmitFastPath(b, [&](PPCHIRBuilder& f, Label* slow_path_label) {
+      xe::kernel::xboxkrnl::EmitTlsGetValue(f, slow_path_label,
+                                            tls_static_size, tls_total_size);
+      return true;
+    });
+  });
+  uint32_t kpcr_address =
+      test.memory->SystemHeapAlloc(sizeof(xe::kernel::X_KPCR));
+  uint32_t tls_address =
+      test.memory->SystemHeapAlloc(tls_static_size + tls_total_size);
+  test.memory->TranslateVirtual<xe::kernel::X_KPCR*>(kpcr_address)->tls_ptr =
+      tls_address;
+  const uint32_t slot = 5;
+  const uint32_t value = 0xCAFEF00D;
+  *test.memory->TranslateVirtual<xe::be<uint32_t>*>(
+      tls_address + tls_static_size + slot * 4) = value;
+
+  SECTION("in range") {
+    test.Run(
+        [&](PPCContext* ctx) {
+          ctx->r[3] = slot;
+          ctx->r[13] = kpcr_address;
+        },
+        [&](PPCContext* ctx) {
+          REQUIRE(ctx->r[4] == kFastPathCompleted);
+          REQUIRE(ctx->r[3] == value);
+        });
+  }
+
+  SECTION("out of range") {
+    const uint32_t out_of_range_slot = tls_total_size / 4 + 1;
+    test.Run(
+        [&](PPCContext* ctx) {
+          ctx->r[3] = out_of_range_slot;
+          ctx->r[13] = kpcr_address;
+        },
+        [&](PPCContext* ctx) {
+          REQUIRE(ctx->r[4] == kSlowPathTaken);
+          REQUIRE(ctx->r[3] == out_of_range_slot);
+        });
+  }
+}
+
+TEST_CASE("export_fast_path_acquire_spin_lock", "[export]") {
+  TestFunction test([](HIRBuilder& b) {
+    EmitFastPath(
+        b, xe::kernel::xboxkrnl::KeAcquireSpinLockAtRaisedIrql_fast_path);
+  });
+  // The lock word is in host byte order.
+  uint32_t lock_address = test.memory->SystemHeapAlloc(4);
+  auto lock = test.memory->TranslateVirtual<uint32_t*>(lock_address);
+  auto run = [&](uint64_t expected_path) {
+    test.Run([&](PPCContext* ctx) { ctx->r[3] = lock_address; },
+             [&](PPCContext* ctx) { REQUIRE(ctx->r[4] == expected_path); });
+  };
+  run(kFastPathCompleted);
+  REQUIRE(*lock == 1);
+  // Spinning is done by the export.
+  run(kSlowPathTaken);
+  REQUIRE(*lock == 1);
+}
+
+TEST_CASE("export_fast_path_try_to_acquire_spin_lock", "[export]") {
+  TestFunction test([](HIRBuilder& b) {
+    EmitFastPath(
+        b, xe::kernel::xboxkrnl::KeTryToAcquireSpinLockAtRaisedIrql_fast_path);
+  });
+  uint32_t lock_address = test.memory->SystemHeapAlloc(4);
+  auto lock = test.memory->TranslateVirtual<uint32_t*>(lock_address);
+  auto run = [&](uint64_t expected_result) {
+    test.Run([&](PPCContext* ctx) { ctx->r[3] = lock_address; },
+             [&](PPCContext* ctx) {
+               REQUIRE(ctx->r[4] == kFastPathCompleted);
+               REQUIRE(ctx->r[3] == expected_result);
+             });
+  };
+  run(1);
+  REQUIRE(*lock == 1);
+  run(0);
+  REQUIRE(*lock == 1);
+}
+
+// Cost of calling an export through the host compared to an inlined fast
+// path doing the same work. Hidden, run with the [benchmark] tag.
+TEST_CASE("export_fast_path_call_cost", "[.benchmark]") {
+  Function* builtin = nullptr;
+  // The function is generated lazily when it's resolved, after the builtin
+  // has been defined.
+  TestFunction host_call_test([&builtin](HIRBuilder& b) {
+    EmitExportCallLoop(b, [&builtin](HIRBuilder& b) { b.CallExtern(builtin); });
+  });
+  for (auto& processor : host_call_test.processors) {
+    builtin = processor->DefineBuiltin("ExportHandler", ExportHandler,
+                                       nullptr, nullptr);
+  }
+  RunExportCallLoop(host_call_test, "host call");
+
+  TestFunction fast_path_test([](HIRBuilder& b) {
+    EmitExportCallLoop(b, [](HIRBuilder& b) {
+      StoreGPR(b, 3, b.Add(LoadGPR(b, 3), b.LoadConstantUint64(1)));
+    });
+  });
+  RunExportCallLoop(fast_path_test, "inline fast path");
+}
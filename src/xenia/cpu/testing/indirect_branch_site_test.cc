@@ -0,0 +1,97 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/testing/util.h"
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::hir;
+using namespace xe::cpu::testing;
+using xe::cpu::backend::x64::IndirectBranchSite;
+using xe::cpu::backend::x64::X64Backend;
+using xe::cpu::ppc::PPCContext;
+
+namespace {
+
+const uint32_t kCallerAddress = 0x80000000;
+const uint32_t kHotTargetAddress = 0x80001000;
+const uint32_t kColdTargetAddress = 0x80002000;
+
+// The caller calls the function at r4 r5 times. The targets return their
+// address in r3.
+void GenerateFunction(HIRBuilder& b, uint32_t address) {
+  if (address != kCallerAddress) {
+    StoreGPR(b, 3, b.LoadConstantUint64(address));
+    b.Return();
+    return;
+  }
+  auto loop_label = b.NewLabel();
+  b.MarkLabel(loop_label);
+  b.SetReturnAddress(b.LoadConstantUint64(kCallerAddress + 4));
+  b.CallIndirect(LoadGPR(b, 4));
+  auto count = b.Sub(LoadGPR(b, 5), b.LoadConstantUint64(1));
+  StoreGPR(b, 5, count);
+  b.BranchTrue(b.CompareNE(count, b.LoadZeroInt64()), loop_label);
+  b.Return();
+}
+
+}  // namespace
+
+TEST_CASE("indirect_branch_target_caching", "[backend]") {
+  TestFunction test(
+      [](uint32_t address) {
+        return address == kCallerAddress || address == kHotTargetAddress ||
+               address == kColdTargetAddress;
+      },
+      GenerateFunction);
+
+  auto run = [&test](uint32_t target_address, uint32_t call_count) {
+    uint64_t value = 0;
+    test.Run(
+        [target_address, call_count](PPCContext* ctx) {
+          ctx->r[4] = target_address;
+          ctx->r[5] = call_count;
+        },
+        [&value](PPCContext* ctx) { value = ctx->r[3]; });
+    return value;
+  };
+
+  for (auto& processor : test.processors) {
+    auto backend = static_cast<X64Backend*>(processor->backend());
+    auto caller =
+        static_cast<GuestFunction*>(processor->ResolveFunction(kCallerAddress));
+    REQUIRE(caller);
+    uint8_t* sampling_machine_code = caller->machine_code();
+
+    // Sampled enough times to be cached, recompiling the caller.
+    REQUIRE(run(kHotTargetAddress,
+                IndirectBranchSite::kMissSampleInterval *
+                    IndirectBranchSite::kSamplesPerRecompile) ==
+            kHotTargetAddress);
+    REQUIRE(caller->machine_code() != sampling_machine_code);
+    GuestFunction* cached_targets[IndirectBranchSite::kMaxCachedTargets];
+    uint32_t cached_target_count = 0;
+    auto site = backend->GetIndirectBranchSite(
+        caller, kCallerAddress, cached_targets, &cached_target_count);
+    REQUIRE(site);
+    REQUIRE(cached_target_count == 1);
+    REQUIRE(cached_targets[0]->address() == kHotTargetAddress);
+    uint64_t miss_count = site->miss_count.load();
+
+    // Called directly from the inline comparison.
+    REQUIRE(run(kHotTargetAddress, 1) == kHotTargetAddress);
+    REQUIRE(site->hit_counts[0] == 1);
+    REQUIRE(site->miss_count.load() == miss_count);
+
+    // A target that isn't cached falls back to the indirection table.
+    REQUIRE(run(kColdTargetAddress, 1) == kColdTargetAddress);
+    REQUIRE(site->hit_counts[0] == 1);
+    REQUIRE(site->miss_count.load() == miss_count + 1);
+  }
+}
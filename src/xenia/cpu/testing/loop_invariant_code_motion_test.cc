@@ -0,0 +1,208 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compiler/loop_analysis.h"
+#include "xenia/cpu/compiler/passes/loop_invariant_code_motion_pass.h"
+#include "xenia/cpu/hir/label.h"
+#include "xenia/cpu/testing/util.h"
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::hir;
+using namespace xe::cpu::testing;
+using xe::cpu::compiler::LoopAnalysis;
+using xe::cpu::compiler::passes::LoopInvariantCodeMotionPass;
+
+namespace {
+
+// entry:  r5 = 0
+// loop:   r4 = r3 + r7
+//         [r7 = r4, if store_to_source]
+//         r6 = r6 - 1
+//         branch_true r6 != 0, loop
+// exit:   return
+void EmitCountedLoop(HIRBuilder& b, bool store_to_source) {
+  auto loop_label = b.NewLabel();
+  StoreGPR(b, 5, b.LoadZeroInt64());
+  b.Branch(loop_label);
+  b.MarkLabel(loop_label);
+  auto sum = b.Add(LoadGPR(b, 3), LoadGPR(b, 7));
+  StoreGPR(b, 4, sum);
+  if (store_to_source) {
+    StoreGPR(b, 7, sum);
+  }
+  auto counter = b.Sub(LoadGPR(b, 6), b.LoadConstantUint64(1));
+  StoreGPR(b, 6, counter);
+  b.BranchTrue(b.CompareNE(counter, b.LoadZeroInt64()), loop_label);
+  b.Return();
+}
+
+uint32_t CountOpcode(const Block* block, const OpcodeInfo& opcode) {
+  uint32_t count = 0;
+  for (auto i = block->instr_head; i; i = i->next) {
+    if (i->opcode == &opcode) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+}  // namespace
+
+TEST_CASE("loop_analysis_counted_loop", "[compiler]") {
+  HIRBuilder b;
+  EmitCountedLoop(b, false);
+  LoopAnalysis analysis;
+  REQUIRE(analysis.Analyze(&b));
+
+  auto entry = b.first_block();
+  REQUIRE(entry->next);
+  auto body = entry->next;
+  REQUIRE(body->next);
+  auto exit = body->next;
+  REQUIRE(!exit->next);
+
+  REQUIRE(analysis.immediate_dominator(entry) == nullptr);
+  REQUIRE(analysis.immediate_dominator(body) == entry);
+  REQUIRE(analysis.immediate_dominator(exit) == body);
+  REQUIRE(analysis.Dominates(entry, exit));
+  REQUIRE(analysis.Dominates(body, body));
+  REQUIRE_FALSE(analysis.Dominates(exit, body));
+
+  REQUIRE(analysis.loops().size() == 1);
+  auto& loop = analysis.loops()[0];
+  REQUIRE(loop.header == body);
+  REQUIRE(loop.preheader == entry);
+  REQUIRE(loop.blocks.size() == 1);
+  REQUIRE(loop.Contains(body));
+  REQUIRE_FALSE(loop.Contains(entry));
+  REQUIRE_FALSE(loop.Contains(exit));
+}
+
+TEST_CASE("loop_analysis_nested_loops", "[compiler]") {
+  // entry:  branch outer
+  // outer:  r3 = r3 + 1
+  // inner:  r4 = r4 - 1
+  //         branch_true r4 != 0, inner
+  // latch:  branch_true r3 != r5, outer
+  // exit:   return
+  HIRBuilder b;
+  auto outer_label = b.NewLabel();
+  auto inner_label = b.NewLabel();
+  b.Branch(outer_label);
+  b.MarkLabel(outer_label);
+  StoreGPR(b, 3, b.Add(LoadGPR(b, 3), b.LoadConstantUint64(1)));
+  b.MarkLabel(inner_label);
+  auto counter = b.Sub(LoadGPR(b, 4), b.LoadConstantUint64(1));
+  StoreGPR(b, 4, counter);
+  b.BranchTrue(b.CompareNE(counter, b.LoadZeroInt64()), inner_label);
+  b.BranchTrue(b.CompareNE(LoadGPR(b, 3), LoadGPR(b, 5)), outer_label);
+  b.Return();
+
+  LoopAnalysis analysis;
+  REQUIRE(analysis.Analyze(&b));
+  auto entry = b.first_block();
+  auto outer = entry->next;
+  auto inner = outer->next;
+  auto latch = inner->next;
+  auto exit = latch->next;
+  REQUIRE(exit);
+
+  REQUIRE(analysis.immediate_dominator(inner) == outer);
+  REQUIRE(analysis.immediate_dominator(latch) == inner);
+  REQUIRE(analysis.Dominates(outer, latch));
+  REQUIRE_FALSE(analysis.Dominates(latch, inner));
+
+  // The inner loop comes first.
+  REQUIRE(analysis.loops().size() == 2);
+  auto& inner_loop = analysis.loops()[0];
+  REQUIRE(inner_loop.header == inner);
+  REQUIRE(inner_loop.preheader == outer);
+  REQUIRE(inner_loop.blocks.size() == 1);
+  auto& outer_loop = analysis.loops()[1];
+  REQUIRE(outer_loop.header == outer);
+  REQUIRE(outer_loop.preheader == entry);
+  REQUIRE(outer_loop.blocks.size() == 3);
+  REQUIRE(outer_loop.Contains(inner));
+  REQUIRE(outer_loop.Contains(latch));
+  REQUIRE_FALSE(outer_loop.Contains(exit));
+}
+
+TEST_CASE("loop_analysis_no_preheader", "[compiler]") {
+  // The loop is entered both from the entry block and from the block after
+  // it, so there's no single place to put code that runs once before it.
+  HIRBuilder b;
+  auto loop_label = b.NewLabel();
+  b.BranchTrue(b.IsTrue(LoadGPR(b, 5)), loop_label);
+  StoreGPR(b, 5, b.LoadZeroInt64());
+  b.MarkLabel(loop_label);
+  StoreGPR(b, 4, b.Add(LoadGPR(b, 3), LoadGPR(b, 7)));
+  b.BranchTrue(b.IsTrue(LoadGPR(b, 6)), loop_label);
+  b.Return();
+
+  LoopAnalysis analysis;
+  REQUIRE(analysis.Analyze(&b));
+  REQUIRE(analysis.loops().size() == 1);
+  auto& loop = analysis.loops()[0];
+  REQUIRE(loop.header == b.first_block()->next->next);
+  REQUIRE(loop.preheader == nullptr);
+
+  // Nothing can be hoisted.
+  LoopInvariantCodeMotionPass pass;
+  REQUIRE(pass.Run(&b));
+  REQUIRE(CountOpcode(loop.header, OPCODE_ADD_info) == 1);
+  REQUIRE(CountOpcode(loop.header, OPCODE_LOAD_LOCAL_info) == 0);
+}
+
+TEST_CASE("licm_hoists_invariant_expression", "[compiler]") {
+  HIRBuilder b;
+  EmitCountedLoop(b, false);
+  LoopInvariantCodeMotionPass pass;
+  REQUIRE(pass.Run(&b));
+
+  auto preheader = b.first_block();
+  auto body = preheader->next;
+
+  // The sum is computed in the preheader, before its branch to the loop, and
+  // passed to the loop through a local.
+  REQUIRE(CountOpcode(preheader, OPCODE_ADD_info) == 1);
+  REQUIRE(CountOpcode(preheader, OPCODE_LOAD_CONTEXT_info) == 2);
+  auto branch = preheader->instr_tail;
+  REQUIRE(branch->opcode == &OPCODE_BRANCH_info);
+  auto store = branch->prev;
+  REQUIRE(store->opcode == &OPCODE_STORE_LOCAL_info);
+  REQUIRE(store->src2.value->def->opcode == &OPCODE_ADD_info);
+  REQUIRE(store->src2.value->def->block == preheader);
+
+  REQUIRE(CountOpcode(body, OPCODE_ADD_info) == 0);
+  REQUIRE(CountOpcode(body, OPCODE_LOAD_LOCAL_info) == 1);
+  for (auto i = body->instr_head; i; i = i->next) {
+    if (i->opcode == &OPCODE_LOAD_LOCAL_info) {
+      REQUIRE(i->src1.value == store->src1.value);
+    }
+  }
+  // The counter changes every iteration.
+  REQUIRE(CountOpcode(body, OPCODE_SUB_info) == 1);
+}
+
+TEST_CASE("licm_store_blocks_load_hoisting", "[compiler]") {
+  HIRBuilder b;
+  EmitCountedLoop(b, true);
+  LoopInvariantCodeMotionPass pass;
+  REQUIRE(pass.Run(&b));
+
+  auto preheader = b.first_block();
+  auto body = preheader->next;
+
+  // r7 is written in the loop, so the sum can't be hoisted.
+  REQUIRE(CountOpcode(preheader, OPCODE_ADD_info) == 0);
+  REQUIRE(CountOpcode(preheader, OPCODE_STORE_LOCAL_info) == 0);
+  REQUIRE(CountOpcode(body, OPCODE_ADD_info) == 1);
+  REQUIRE(CountOpcode(body, OPCODE_LOAD_LOCAL_info) == 0);
+}
@@ -0,0 +1,98 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <chrono>
+#include <thread>
+
+#include "xenia/base/cvar.h"
+#include "xenia/cpu/testing/util.h"
+
+DECLARE_uint32(mmio_recompile_fault_threshold);
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::hir;
+using namespace xe::cpu::testing;
+using xe::cpu::ppc::PPCContext;
+
+namespace {
+
+const uint32_t kMMIOAddress = 0x7FC80000;
+
+struct MMIOAccesses {
+  // Faulting accesses are passed no context, calls from the retranslated code
+  // are.
+  uint32_t faulted_count = 0;
+  uint32_t called_count = 0;
+};
+
+uint32_t ReadMMIO(void* ppc_context, void* callback_context, uint32_t addr) {
+  auto accesses = reinterpret_cast<MMIOAccesses*>(callback_context);
+  if (ppc_context) {
+    ++accesses->called_count;
+  } else {
+    ++accesses->faulted_count;
+  }
+  return addr & 0xFFFF;
+}
+
+void WriteMMIO(void* ppc_context, void* callback_context, uint32_t addr,
+               uint32_t value) {}
+
+}  // namespace
+
+TEST_CASE("mmio_access_site_retranslation", "[backend]") {
+  const uint32_t fault_threshold = 4;
+  cvars::mmio_recompile_fault_threshold = fault_threshold;
+  TestFunction test([](HIRBuilder& b) {
+    StoreGPR(b, 3,
+             b.ZeroExtend(b.Load(LoadGPR(b, 4), INT32_TYPE), INT64_TYPE));
+    b.Return();
+  });
+  MMIOAccesses accesses;
+  REQUIRE(test.memory->AddVirtualMappedRange(
+      kMMIOAddress, 0xFFFF0000, 0xFFFF, &accesses, ReadMMIO, WriteMMIO));
+
+  auto run = [&test](uint64_t* out_value) {
+    test.Run([](PPCContext* ctx) { ctx->r[4] = kMMIOAddress + 0x10; },
+             [out_value](PPCContext* ctx) { *out_value = ctx->r[3]; });
+  };
+
+  for (auto& processor : test.processors) {
+    auto function =
+        static_cast<GuestFunction*>(processor->ResolveFunction(0x80000000));
+    REQUIRE(function);
+    uint8_t* old_machine_code = function->machine_code();
+
+    uint64_t faulted_value = 0;
+    for (uint32_t i = 0; i < fault_threshold; ++i) {
+      run(&faulted_value);
+    }
+    REQUIRE(accesses.faulted_count == fault_threshold);
+    REQUIRE(accesses.called_count == 0);
+
+    // Retranslated outside the exception handler, asynchronously.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (function->machine_code() == old_machine_code &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    REQUIRE(function->machine_code() != old_machine_code);
+    auto backend =
+        static_cast<backend::x64::X64Backend*>(processor->backend());
+    REQUIRE(backend->LookupMMIOAccessSite(0x80000000) != nullptr);
+
+    // The new code calls the handler directly instead of faulting.
+    uint64_t called_value = 0;
+    run(&called_value);
+    REQUIRE(accesses.faulted_count == fault_threshold);
+    REQUIRE(accesses.called_count == 1);
+    REQUIRE(called_value == faulted_value);
+  }
+}
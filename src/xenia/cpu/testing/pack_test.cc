@@ -16,98 +16,156 @@ using namespace xe::cpu::testing;
 using xe::cpu::ppc::PPCContext;
 
 TEST_CASE("PACK_D3DCOLOR", "[instr]") {
-  TestFunction test([](HIRBuilder& b) {
-    StoreVR(b, 3, b.Pack(LoadVR(b, 4), PACK_TYPE_D3DCOLOR));
-    b.Return();
+  RunWithExtensionMasks([]() {
+    TestFunction test([](HIRBuilder& b) {
+      StoreVR(b, 3, b.Pack(LoadVR(b, 4), PACK_TYPE_D3DCOLOR));
+      b.Return();
+    });
+    test.Run([](PPCContext* ctx) { ctx->v[4] = vec128f(1.0f); },
+             [](PPCContext* ctx) {
+               auto result = ctx->v[3];
+               REQUIRE(result == vec128i(0));
+             });
+    test.Run(
+        [](PPCContext* ctx) {
+          ctx->v[4] = vec128i(0x40400050, 0x40400060, 0x40400070, 0x40400080);
+        },
+        [](PPCContext* ctx) {
+          auto result = ctx->v[3];
+          REQUIRE(result == vec128i(0, 0, 0, 0x80506070));
+        });
   });
-  test.Run([](PPCContext* ctx) { ctx->v[4] = vec128f(1.0f); },
-           [](PPCContext* ctx) {
-             auto result = ctx->v[3];
-             REQUIRE(result == vec128i(0));
-           });
-  test.Run(
-      [](PPCContext* ctx) {
-        ctx->v[4] = vec128i(0x40400050, 0x40400060, 0x40400070, 0x40400080);
-      },
-      [](PPCContext* ctx) {
-        auto result = ctx->v[3];
-        REQUIRE(result == vec128i(0, 0, 0, 0x80506070));
-      });
 }
 
 TEST_CASE("PACK_FLOAT16_2", "[instr]") {
-  TestFunction test([](HIRBuilder& b) {
-    StoreVR(b, 3, b.Pack(LoadVR(b, 4), PACK_TYPE_FLOAT16_2));
-    b.Return();
+  RunWithExtensionMasks([]() {
+    TestFunction test([](HIRBuilder& b) {
+      StoreVR(b, 3, b.Pack(LoadVR(b, 4), PACK_TYPE_FLOAT16_2));
+      b.Return();
+    });
+    test.Run([](PPCContext* ctx) { ctx->v[4] = vec128i(0, 0, 0, 0x3F800000); },
+             [](PPCContext* ctx) {
+               auto result = ctx->v[3];
+               REQUIRE(result == vec128i(0));
+             });
+    test.Run(
+        [](PPCContext* ctx) {
+          ctx->v[4] = vec128i(0x47FFE000, 0xC7FFE000, 0x00000000, 0x3F800000);
+        },
+        [](PPCContext* ctx) {
+          auto result = ctx->v[3];
+          REQUIRE(result == vec128i(0, 0, 0, 0x7FFFFFFF));
+        });
+    test.Run(
+        [](PPCContext* ctx) {
+          ctx->v[4] = vec128i(0x42AAA000, 0x44CCC000, 0x00000000, 0x3F800000);
+        },
+        [](PPCContext* ctx) {
+          auto result = ctx->v[3];
+          REQUIRE(result == vec128i(0, 0, 0, 0x55556666));
+        });
   });
-  test.Run([](PPCContext* ctx) { ctx->v[4] = vec128i(0, 0, 0, 0x3F800000); },
-           [](PPCContext* ctx) {
-             auto result = ctx->v[3];
-             REQUIRE(result == vec128i(0));
-           });
-  test.Run(
-      [](PPCContext* ctx) {
-        ctx->v[4] = vec128i(0x47FFE000, 0xC7FFE000, 0x00000000, 0x3F800000);
-      },
-      [](PPCContext* ctx) {
-        auto result = ctx->v[3];
-        REQUIRE(result == vec128i(0, 0, 0, 0x7FFFFFFF));
-      });
-  test.Run(
-      [](PPCContext* ctx) {
-        ctx->v[4] = vec128i(0x42AAA000, 0x44CCC000, 0x00000000, 0x3F800000);
-      },
-      [](PPCContext* ctx) {
-        auto result = ctx->v[3];
-        REQUIRE(result == vec128i(0, 0, 0, 0x55556666));
-      });
 }
 
 TEST_CASE("PACK_FLOAT16_4", "[instr]") {
-  TestFunction test([](HIRBuilder& b) {
-    StoreVR(b, 3, b.Pack(LoadVR(b, 4), PACK_TYPE_FLOAT16_4));
-    b.Return();
+  RunWithExtensionMasks([]() {
+    TestFunction test([](HIRBuilder& b) {
+      StoreVR(b, 3, b.Pack(LoadVR(b, 4), PACK_TYPE_FLOAT16_4));
+      b.Return();
+    });
+    test.Run([](PPCContext* ctx) { ctx->v[4] = vec128i(0, 0, 0, 0); },
+             [](PPCContext* ctx) {
+               auto result = ctx->v[3];
+               REQUIRE(result == vec128i(0));
+             });
+    test.Run(
+        [](PPCContext* ctx) {
+          ctx->v[4] = vec128i(0x449A4000, 0x45B17000, 0x41103261, 0x40922B6B);
+        },
+        [](PPCContext* ctx) {
+          auto result = ctx->v[3];
+          REQUIRE(result ==
+                  vec128i(0x00000000, 0x00000000, 0x64D26D8C, 0x48824491));
+        });
   });
-  test.Run([](PPCContext* ctx) { ctx->v[4] = vec128i(0, 0, 0, 0); },
-           [](PPCContext* ctx) {
-             auto result = ctx->v[3];
-             REQUIRE(result == vec128i(0));
-           });
-  test.Run(
-      [](PPCContext* ctx) {
-        ctx->v[4] = vec128i(0x449A4000, 0x45B17000, 0x41103261, 0x40922B6B);
-      },
-      [](PPCContext* ctx) {
-        auto result = ctx->v[3];
-        REQUIRE(result ==
-                vec128i(0x00000000, 0x00000000, 0x64D26D8C, 0x48824491));
-      });
 }
 
 TEST_CASE("PACK_SHORT_2", "[instr]") {
-  TestFunction test([](HIRBuilder& b) {
-    StoreVR(b, 3, b.Pack(LoadVR(b, 4), PACK_TYPE_SHORT_2));
-    b.Return();
+  RunWithExtensionMasks([]() {
+    TestFunction test([](HIRBuilder& b) {
+      StoreVR(b, 3, b.Pack(LoadVR(b, 4), PACK_TYPE_SHORT_2));
+      b.Return();
+    });
+    test.Run([](PPCContext* ctx) { ctx->v[4] = vec128i(0); },
+             [](PPCContext* ctx) {
+               auto result = ctx->v[3];
+               REQUIRE(result == vec128i(0));
+             });
+    test.Run(
+        [](PPCContext* ctx) {
+          ctx->v[4] = vec128i(0x43817E00, 0xC37CFC00, 0, 0);
+        },
+        [](PPCContext* ctx) {
+          auto result = ctx->v[3];
+          REQUIRE(result == vec128i(0, 0, 0, 0x7FFF8001));
+        });
+    test.Run(
+        [](PPCContext* ctx) {
+          ctx->v[4] = vec128i(0xC0D47D97, 0xC2256E9D, 0, 0);
+        },
+        [](PPCContext* ctx) {
+          auto result = ctx->v[3];
+          REQUIRE(result == vec128i(0, 0, 0, 0x80018001));
+        });
+  });
+}
+
+TEST_CASE("PACK_8_IN_16_UN_UN", "[instr]") {
+  RunWithExtensionMasks([]() {
+    TestFunction test([](HIRBuilder& b) {
+      StoreVR(b, 3,
+              b.Pack(LoadVR(b, 4), LoadVR(b, 5),
+                     PACK_TYPE_8_IN_16 | PACK_TYPE_IN_UNSIGNED |
+                         PACK_TYPE_OUT_UNSIGNED | PACK_TYPE_OUT_UNSATURATE));
+      b.Return();
+    });
+    test.Run(
+        [](PPCContext* ctx) {
+          ctx->v[4] = vec128s(0x0102, 0x0304, 0xFF05, 0x8006, 0x0007, 0x1208,
+                              0x00FF, 0xFF00);
+          ctx->v[5] = vec128s(0x0010, 0x0111, 0x0212, 0x0313, 0x8014, 0xFF15,
+                              0x0016, 0x0017);
+        },
+        [](PPCContext* ctx) {
+          auto result = ctx->v[3];
+          REQUIRE(result == vec128b(0x02, 0x04, 0x05, 0x06, 0x07, 0x08, 0xFF,
+                                    0x00, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+                                    0x16, 0x17));
+        });
+  });
+}
+
+TEST_CASE("PACK_8_IN_16_UN_UN_SAT", "[instr]") {
+  RunWithExtensionMasks([]() {
+    TestFunction test([](HIRBuilder& b) {
+      StoreVR(b, 3,
+              b.Pack(LoadVR(b, 4), LoadVR(b, 5),
+                     PACK_TYPE_8_IN_16 | PACK_TYPE_IN_UNSIGNED |
+                         PACK_TYPE_OUT_UNSIGNED | PACK_TYPE_OUT_SATURATE));
+      b.Return();
+    });
+    test.Run(
+        [](PPCContext* ctx) {
+          ctx->v[4] = vec128s(0x0102, 0x0304, 0xFF05, 0x8006, 0x0007, 0x1208,
+                              0x00FF, 0xFF00);
+          ctx->v[5] = vec128s(0x0010, 0x0111, 0x0212, 0x0313, 0x8014, 0xFF15,
+                              0x0016, 0x0017);
+        },
+        [](PPCContext* ctx) {
+          auto result = ctx->v[3];
+          REQUIRE(result == vec128b(0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0xFF, 0xFF,
+                                    0xFF, 0x10, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                    0x16, 0x17));
+        });
   });
-  test.Run([](PPCContext* ctx) { ctx->v[4] = vec128i(0); },
-           [](PPCContext* ctx) {
-             auto result = ctx->v[3];
-             REQUIRE(result == vec128i(0));
-           });
-  test.Run(
-      [](PPCContext* ctx) {
-        ctx->v[4] = vec128i(0x43817E00, 0xC37CFC00, 0, 0);
-      },
-      [](PPCContext* ctx) {
-        auto result = ctx->v[3];
-        REQUIRE(result == vec128i(0, 0, 0, 0x7FFF8001));
-      });
-  test.Run(
-      [](PPCContext* ctx) {
-        ctx->v[4] = vec128i(0xC0D47D97, 0xC2256E9D, 0, 0);
-      },
-      [](PPCContext* ctx) {
-        auto result = ctx->v[3];
-        REQUIRE(result == vec128i(0, 0, 0, 0x80018001));
-      });
 }
@@ -14,6 +14,7 @@
 
 #include "xenia/base/platform.h"
 #include "xenia/cpu/backend/x64/x64_backend.h"
+#include "xenia/cpu/backend/x64/x64_emitter.h"
 #include "xenia/cpu/hir/hir_builder.h"
 #include "xenia/cpu/ppc/ppc_context.h"
 #include "xenia/cpu/ppc/ppc_frontend.h"
@@ -30,7 +31,17 @@ using xe::cpu::ppc::PPCContext;
 
 class TestFunction {
  public:
-  TestFunction(std::function<void(hir::HIRBuilder& b)> generator) {
+  TestFunction(std::function<void(hir::HIRBuilder& b)> generator)
+      : TestFunction([](uint32_t address) { return address == 0x80000000; },
+                     [generator](hir::HIRBuilder& b, uint32_t address) {
+                       generator(b);
+                     }) {}
+
+  // Multiple functions, generated depending on the address, with the one at
+  // 0x80000000 being run.
+  TestFunction(
+      std::function<bool(uint32_t)> contains_address,
+      std::function<void(hir::HIRBuilder& b, uint32_t address)> generator) {
     memory_size = 16 * 1024 * 1024;
     memory.reset(new Memory());
     memory->Initialize();
@@ -49,10 +60,9 @@ class TestFunction {
 
     for (auto& processor : processors) {
       auto module = std::make_unique<xe::cpu::TestModule>(
-          processor.get(), "Test",
-          [](uint64_t address) { return address == 0x80000000; },
-          [generator](hir::HIRBuilder& b) {
-            generator(b);
+          processor.get(), "Test", contains_address,
+          [generator](hir::HIRBuilder& b, uint32_t address) {
+            generator(b, address);
             return true;
           });
       processor->AddModule(std::move(module));
@@ -91,6 +101,39 @@ class TestFunction {
   std::vector<std::unique_ptr<Processor>> processors;
 };
 
+// Runs test once for each set of x64 instruction set extensions the sequences
+// have separate paths for, so the fallbacks for older CPUs are covered and not
+// only the path this CPU takes. Extensions this CPU doesn't support are
+// disabled in all of them. The extensions are chosen when the backend is set
+// up, so the TestFunctions must be created by test.
+inline void RunWithExtensionMasks(std::function<void()> test) {
+#if XE_ARCH_AMD64
+  using namespace xe::cpu::backend::x64;
+  static const int32_t kExtensionMasks[] = {
+      // Everything this CPU supports.
+      -1,
+      // AVX-512BW without VBMI.
+      ~int32_t(kX64EmitAVX512VBMI),
+      // AVX2, F16C and GFNI without AVX-512.
+      ~int32_t(kX64EmitAVX512Ortho64 | kX64EmitAVX512BW | kX64EmitAVX512VBMI),
+      // Only AVX, with the emulated fallbacks.
+      0,
+  };
+  // Restored even if the test fails.
+  struct ExtensionMaskRestorer {
+    int32_t mask;
+    ~ExtensionMaskRestorer() { cvars::x64_extension_mask = mask; }
+  } restorer{cvars::x64_extension_mask};
+  for (int32_t mask : kExtensionMasks) {
+    cvars::x64_extension_mask = mask;
+    INFO("x64_extension_mask " << mask);
+    test();
+  }
+#else
+  test();
+#endif  // XE_ARCH
+}
+
 inline hir::Value* LoadGPR(hir::HIRBuilder& b, int reg) {
   return b.LoadContext(offsetof(PPCContext, r) + reg * 8, hir::INT64_TYPE);
 }
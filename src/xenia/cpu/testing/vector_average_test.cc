@@ -0,0 +1,56 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/testing/util.h"
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::hir;
+using namespace xe::cpu::testing;
+using xe::cpu::ppc::PPCContext;
+
+TEST_CASE("VECTOR_AVERAGE_I32_UNSIGNED", "[instr]") {
+  RunWithExtensionMasks([]() {
+    TestFunction test([](HIRBuilder& b) {
+      StoreVR(b, 3,
+              b.VectorAverage(LoadVR(b, 4), LoadVR(b, 5), INT32_TYPE,
+                              ARITHMETIC_UNSIGNED));
+      b.Return();
+    });
+    test.Run(
+        [](PPCContext* ctx) {
+          ctx->v[4] = vec128i(0x00000000, 0x00000001, 0xFFFFFFFF, 0x80000000);
+          ctx->v[5] = vec128i(0x00000000, 0x00000002, 0xFFFFFFFF, 0x7FFFFFFF);
+        },
+        [](PPCContext* ctx) {
+          auto result = ctx->v[3];
+          REQUIRE(result ==
+                  vec128i(0x00000000, 0x00000002, 0xFFFFFFFF, 0x80000000));
+        });
+  });
+}
+
+TEST_CASE("VECTOR_AVERAGE_I32_SIGNED", "[instr]") {
+  RunWithExtensionMasks([]() {
+    TestFunction test([](HIRBuilder& b) {
+      StoreVR(b, 3, b.VectorAverage(LoadVR(b, 4), LoadVR(b, 5), INT32_TYPE, 0));
+      b.Return();
+    });
+    test.Run(
+        [](PPCContext* ctx) {
+          ctx->v[4] = vec128i(0xFFFFFFFF, 0xFFFFFFFE, 0x7FFFFFFF, 0x80000000);
+          ctx->v[5] = vec128i(0xFFFFFFFE, 0x00000001, 0x7FFFFFFF, 0x80000000);
+        },
+        [](PPCContext* ctx) {
+          auto result = ctx->v[3];
+          REQUIRE(result ==
+                  vec128i(0xFFFFFFFF, 0x00000000, 0x7FFFFFFF, 0x80000000));
+        });
+  });
+}
@@ -16,57 +16,111 @@ using namespace xe::cpu::testing;
 using xe::cpu::ppc::PPCContext;
 
 TEST_CASE("VECTOR_ROTATE_LEFT_I8", "[instr]") {
-  TestFunction test([](HIRBuilder& b) {
-    StoreVR(b, 3, b.VectorRotateLeft(LoadVR(b, 4), LoadVR(b, 5), INT8_TYPE));
-    b.Return();
+  RunWithExtensionMasks([]() {
+    TestFunction test([](HIRBuilder& b) {
+      StoreVR(b, 3, b.VectorRotateLeft(LoadVR(b, 4), LoadVR(b, 5), INT8_TYPE));
+      b.Return();
+    });
+    test.Run(
+        [](PPCContext* ctx) {
+          ctx->v[4] = vec128b(0b00000001);
+          ctx->v[5] =
+              vec128b(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        },
+        [](PPCContext* ctx) {
+          auto result = ctx->v[3];
+          REQUIRE(result ==
+                  vec128b(0b00000001, 0b00000010, 0b00000100, 0b00001000,
+                          0b00010000, 0b00100000, 0b01000000, 0b10000000,
+                          0b00000001, 0b00000010, 0b00000100, 0b00001000,
+                          0b00010000, 0b00100000, 0b01000000, 0b10000000));
+        });
+  });
+}
+
+TEST_CASE("VECTOR_ROTATE_LEFT_I8_CONSTANT", "[instr]") {
+  RunWithExtensionMasks([]() {
+    TestFunction test([](HIRBuilder& b) {
+      StoreVR(b, 3,
+              b.VectorRotateLeft(
+                  LoadVR(b, 4),
+                  b.LoadConstantVec128(vec128b(0, 1, 7, 8, 3, 4, 5, 9, 1, 2, 3,
+                                               4, 5, 6, 7, 15)),
+                  INT8_TYPE));
+      b.Return();
+    });
+    test.Run(
+        [](PPCContext* ctx) {
+          ctx->v[4] = vec128b(0x81, 0x81, 0x81, 0x81, 0x12, 0x12, 0x12, 0x12,
+                              0xF0, 0xF0, 0xF0, 0xF0, 0x00, 0xFF, 0x5A, 0xA5);
+        },
+        [](PPCContext* ctx) {
+          auto result = ctx->v[3];
+          REQUIRE(result == vec128b(0x81, 0x03, 0xC0, 0x81, 0x90, 0x21, 0x42,
+                                    0x24, 0xE1, 0xC3, 0x87, 0x0F, 0x00, 0xFF,
+                                    0x2D, 0xD2));
+        });
   });
-  test.Run(
-      [](PPCContext* ctx) {
-        ctx->v[4] = vec128b(0b00000001);
-        ctx->v[5] =
-            vec128b(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
-      },
-      [](PPCContext* ctx) {
-        auto result = ctx->v[3];
-        REQUIRE(result ==
-                vec128b(0b00000001, 0b00000010, 0b00000100, 0b00001000,
-                        0b00010000, 0b00100000, 0b01000000, 0b10000000,
-                        0b00000001, 0b00000010, 0b00000100, 0b00001000,
-                        0b00010000, 0b00100000, 0b01000000, 0b10000000));
-      });
 }
 
 TEST_CASE("VECTOR_ROTATE_LEFT_I16", "[instr]") {
-  TestFunction test([](HIRBuilder& b) {
-    StoreVR(b, 3, b.VectorRotateLeft(LoadVR(b, 4), LoadVR(b, 5), INT16_TYPE));
-    b.Return();
+  RunWithExtensionMasks([]() {
+    TestFunction test([](HIRBuilder& b) {
+      StoreVR(b, 3, b.VectorRotateLeft(LoadVR(b, 4), LoadVR(b, 5), INT16_TYPE));
+      b.Return();
+    });
+    test.Run(
+        [](PPCContext* ctx) {
+          ctx->v[4] = vec128s(0x0001, 0x0001, 0x0001, 0x0001, 0x1000, 0x1000,
+                              0x1000, 0x1000);
+          ctx->v[5] = vec128s(0, 1, 2, 3, 14, 15, 16, 17);
+        },
+        [](PPCContext* ctx) {
+          auto result = ctx->v[3];
+          REQUIRE(result == vec128s(0x0001, 0x0002, 0x0004, 0x0008, 0x0400,
+                                    0x0800, 0x1000, 0x2000));
+        });
+  });
+}
+
+TEST_CASE("VECTOR_ROTATE_LEFT_I16_CONSTANT", "[instr]") {
+  RunWithExtensionMasks([]() {
+    TestFunction test([](HIRBuilder& b) {
+      StoreVR(b, 3,
+              b.VectorRotateLeft(
+                  LoadVR(b, 4),
+                  b.LoadConstantVec128(vec128s(1, 15, 4, 8, 12, 16, 3, 17)),
+                  INT16_TYPE));
+      b.Return();
+    });
+    test.Run(
+        [](PPCContext* ctx) {
+          ctx->v[4] = vec128s(0x8001, 0x8001, 0x1234, 0x1234, 0x1234, 0xF00F,
+                              0xF00F, 0xABCD);
+        },
+        [](PPCContext* ctx) {
+          auto result = ctx->v[3];
+          REQUIRE(result == vec128s(0x0003, 0xC000, 0x2341, 0x3412, 0x4123,
+                                    0xF00F, 0x807F, 0x579B));
+        });
   });
-  test.Run(
-      [](PPCContext* ctx) {
-        ctx->v[4] = vec128s(0x0001, 0x0001, 0x0001, 0x0001, 0x1000, 0x1000,
-                            0x1000, 0x1000);
-        ctx->v[5] = vec128s(0, 1, 2, 3, 14, 15, 16, 17);
-      },
-      [](PPCContext* ctx) {
-        auto result = ctx->v[3];
-        REQUIRE(result == vec128s(0x0001, 0x0002, 0x0004, 0x0008, 0x0400,
-                                  0x0800, 0x1000, 0x2000));
-      });
 }
 
 TEST_CASE("VECTOR_ROTATE_LEFT_I32", "[instr]") {
-  TestFunction test([](HIRBuilder& b) {
-    StoreVR(b, 3, b.VectorRotateLeft(LoadVR(b, 4), LoadVR(b, 5), INT32_TYPE));
-    b.Return();
+  RunWithExtensionMasks([]() {
+    TestFunction test([](HIRBuilder& b) {
+      StoreVR(b, 3, b.VectorRotateLeft(LoadVR(b, 4), LoadVR(b, 5), INT32_TYPE));
+      b.Return();
+    });
+    test.Run(
+        [](PPCContext* ctx) {
+          ctx->v[4] = vec128i(0x00000001, 0x00000001, 0x80000000, 0x80000000);
+          ctx->v[5] = vec128i(0, 1, 33, 2);
+        },
+        [](PPCContext* ctx) {
+          auto result = ctx->v[3];
+          REQUIRE(result ==
+                  vec128i(0x00000001, 0x00000002, 0x00000001, 0x00000002));
+        });
   });
-  test.Run(
-      [](PPCContext* ctx) {
-        ctx->v[4] = vec128i(0x00000001, 0x00000001, 0x80000000, 0x80000000);
-        ctx->v[5] = vec128i(0, 1, 33, 2);
-      },
-      [](PPCContext* ctx) {
-        auto result = ctx->v[3];
-        REQUIRE(result ==
-                vec128i(0x00000001, 0x00000002, 0x00000001, 0x00000002));
-      });
 }
@@ -0,0 +1,127 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/translation_statistics.h"
+
+#include <algorithm>
+
+#include "xenia/base/clock.h"
+#include "xenia/base/logging.h"
+#include "xenia/cpu/cpu_flags.h"
+#include "xenia/cpu/hir/hir_builder.h"
+
+namespace xe {
+namespace cpu {
+
+TranslationStatistics::HIRSize TranslationStatistics::HIRSize::Measure(
+    const hir::HIRBuilder* builder) {
+  HIRSize size;
+  for (auto block = builder->first_block(); block; block = block->next) {
+    ++size.blocks;
+    for (auto instr = block->instr_head; instr; instr = instr->next) {
+      ++size.instrs;
+      if (instr->dest) {
+        ++size.values;
+      }
+    }
+  }
+  return size;
+}
+
+bool TranslationStatistics::is_enabled() {
+  return cvars::translation_statistics;
+}
+
+void TranslationStatistics::RecordPhase(const std::string_view name,
+                                        uint64_t ticks,
+                                        const HIRSize& size_before,
+                                        const HIRSize& size_after) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = phase_indices_.find(name);
+  if (it == phase_indices_.end()) {
+    it = phase_indices_.emplace(std::string(name), phases_.size()).first;
+    phases_.emplace_back(std::string(name), Phase());
+  }
+  Phase& phase = phases_[it->second].second;
+  ++phase.run_count;
+  phase.ticks += ticks;
+  phase.size_before.blocks += size_before.blocks;
+  phase.size_before.instrs += size_before.instrs;
+  phase.size_before.values += size_before.values;
+  phase.size_after.blocks += size_after.blocks;
+  phase.size_after.instrs += size_after.instrs;
+  phase.size_after.values += size_after.values;
+}
+
+void TranslationStatistics::RecordFunction(uint32_t address,
+                                           uint32_t guest_instr_count,
+                                           uint64_t ticks) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  functions_.push_back({address, guest_instr_count, ticks});
+}
+
+bool TranslationStatistics::empty() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return functions_.empty();
+}
+
+void TranslationStatistics::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  phases_.clear();
+  phase_indices_.clear();
+  functions_.clear();
+}
+
+void TranslationStatistics::Dump(size_t slowest_function_count) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  double ms_per_tick = 1000.0 / double(Clock::QueryHostTickFrequency());
+
+  uint64_t total_ticks = 0;
+  uint64_t total_guest_instr_count = 0;
+  for (const FunctionEntry& function : functions_) {
+    total_ticks += function.ticks;
+    total_guest_instr_count += function.guest_instr_count;
+  }
+  XELOGI("Translated {} functions ({} guest instructions) in {:.3f} ms",
+         functions_.size(), total_guest_instr_count,
+         double(total_ticks) * ms_per_tick);
+  if (functions_.empty()) {
+    return;
+  }
+
+  // HIR sizes are totals over all runs of the phase.
+  XELOGI("{:<48} {:>8} {:>12} {:>6} {:>21} {:>21}", "Phase", "Runs", "Time ms",
+         "%", "Instrs before/after", "Values before/after");
+  for (const auto& it : phases_) {
+    const Phase& phase = it.second;
+    XELOGI("{:<48} {:>8} {:>12.3f} {:>6.2f} {:>10}/{:<10} {:>10}/{:<10}",
+           it.first, phase.run_count, double(phase.ticks) * ms_per_tick,
+           total_ticks ? double(phase.ticks) * 100.0 / double(total_ticks)
+                       : 0.0,
+           phase.size_before.instrs, phase.size_after.instrs,
+           phase.size_before.values, phase.size_after.values);
+  }
+
+  std::vector<FunctionEntry> slowest_functions(functions_);
+  size_t count = std::min(slowest_function_count, slowest_functions.size());
+  std::partial_sort(slowest_functions.begin(),
+                    slowest_functions.begin() + count, slowest_functions.end(),
+                    [](const FunctionEntry& a, const FunctionEntry& b) {
+                      return a.ticks > b.ticks;
+                    });
+  XELOGI("Slowest {} functions:", count);
+  for (size_t i = 0; i < count; ++i) {
+    const FunctionEntry& function = slowest_functions[i];
+    XELOGI("  {:08X} {:>8} guest instructions {:>12.3f} ms", function.address,
+           function.guest_instr_count, double(function.ticks) * ms_per_tick);
+  }
+}
+
+}  // namespace cpu
+}  // namespace xe
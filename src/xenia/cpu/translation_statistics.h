@@ -0,0 +1,87 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_TRANSLATION_STATISTICS_H_
+#define XENIA_CPU_TRANSLATION_STATISTICS_H_
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace xe {
+namespace cpu {
+namespace hir {
+class HIRBuilder;
+}  // namespace hir
+}  // namespace cpu
+}  // namespace xe
+
+namespace xe {
+namespace cpu {
+
+// Time spent in every phase of guest function translation (scanning, HIR
+// emission, each compiler pass and assembly), along with the HIR size before
+// and after each of them. Only collected when the translation_statistics cvar
+// is set, as measuring the HIR walks the whole function.
+class TranslationStatistics {
+ public:
+  struct HIRSize {
+    uint64_t blocks = 0;
+    uint64_t instrs = 0;
+    // Instructions defining a value.
+    uint64_t values = 0;
+
+    static HIRSize Measure(const hir::HIRBuilder* builder);
+  };
+
+  struct Phase {
+    // Number of times the phase has run, more than once per function for
+    // passes repeated by a ConditionalGroupPass.
+    uint64_t run_count = 0;
+    uint64_t ticks = 0;
+    HIRSize size_before;
+    HIRSize size_after;
+  };
+
+  struct FunctionEntry {
+    uint32_t address;
+    uint32_t guest_instr_count;
+    uint64_t ticks;
+  };
+
+  TranslationStatistics() = default;
+
+  static bool is_enabled();
+
+  void RecordPhase(const std::string_view name, uint64_t ticks,
+                   const HIRSize& size_before, const HIRSize& size_after);
+  void RecordFunction(uint32_t address, uint32_t guest_instr_count,
+                      uint64_t ticks);
+
+  bool empty() const;
+  void Reset();
+
+  // Logs the totals of every phase and the slowest functions.
+  void Dump(size_t slowest_function_count) const;
+
+ private:
+  mutable std::mutex mutex_;
+  // Phases in the order they have first run.
+  std::vector<std::pair<std::string, Phase>> phases_;
+  std::map<std::string, size_t, std::less<>> phase_indices_;
+  std::vector<FunctionEntry> functions_;
+};
+
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_TRANSLATION_STATISTICS_H_
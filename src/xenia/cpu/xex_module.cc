@@ -1095,6 +1095,11 @@ bool XexModule::Unload() {
   if (!is_patch()) {
     assert_not_zero(base_address_);
 
+    // Another module may be loaded at the same address later.
+    if (high_address_ > low_address_) {
+      processor_->InvalidateGuestCode(low_address_,
+                                      high_address_ - low_address_, true);
+    }
     memory()->LookupHeap(base_address_)->Release(base_address_);
   }
 
@@ -18,6 +18,7 @@
 #include "xenia/base/byte_stream.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
+#include "xenia/base/memory.h"
 #include "xenia/base/profiling.h"
 #include "xenia/base/ring_buffer.h"
 #include "xenia/gpu/gpu_flags.h"
@@ -75,6 +76,8 @@ bool CommandProcessor::Initialize() {
         return 0;
       }));
   worker_thread_->set_name("GPU Commands");
+  worker_thread_->set_affinity_role(
+      kernel::ThreadAffinityRole::kGpuCommandProcessor);
   worker_thread_->Create();
 
   return true;
@@ -228,6 +231,7 @@ void CommandProcessor::WorkerThreadMain() {
                (write_ptr_index == 0xBAADF00D ||
                 read_ptr_index_ == write_ptr_index));
       ReturnFromWait();
+      kernel_state_->thread_affinity_policy()->SampleCurrentProcessor();
       if (!worker_running_ || !pending_fns_.empty()) {
         continue;
       }
@@ -467,6 +471,63 @@ void CommandProcessor::WriteRegister(uint32_t index, uint32_t value) {
   }
 }
 
+void CommandProcessor::WriteRegistersFromMem(uint32_t start_index,
+                                             const uint32_t* base,
+                                             uint32_t num_registers) {
+  if (!num_registers) {
+    return;
+  }
+  if (start_index >= RegisterFile::kRegisterCount) {
+    XELOGW(
+        "CommandProcessor::WriteRegistersFromMem index out of bounds: {}",
+        start_index);
+    return;
+  }
+  if (RegisterFile::kRegisterCount - start_index < num_registers) {
+    XELOGW(
+        "CommandProcessor::WriteRegistersFromMem range out of bounds (0x{:X} "
+        "registers starting with 0x{:X})",
+        num_registers, start_index);
+    num_registers = uint32_t(RegisterFile::kRegisterCount) - start_index;
+  }
+  RegisterFile& regs = *register_file_;
+  uint32_t end_index = start_index + num_registers;
+  uint32_t index = start_index;
+  while (index < end_index) {
+    uint32_t special_index =
+        RegisterFile::FindNextSpecialRegister(index, end_index);
+    if (special_index > index) {
+      xe::copy_and_swap_32_unaligned(&regs.values[index],
+                                     base + (index - start_index),
+                                     special_index - index);
+      index = special_index;
+    }
+    if (index < end_index) {
+      WriteRegister(index, xe::load_and_swap<uint32_t>(
+                               base + (index - start_index)));
+      ++index;
+    }
+  }
+  OnRegisterRangeWritten(start_index, num_registers);
+}
+
+void CommandProcessor::WriteRegisterRangeFromRing(RingBuffer* ring,
+                                                  uint32_t start_index,
+                                                  uint32_t num_registers) {
+  RingBuffer::ReadRange range =
+      ring->BeginRead(num_registers * sizeof(uint32_t));
+  uint32_t first_count = uint32_t(range.first_length / sizeof(uint32_t));
+  WriteRegistersFromMem(start_index,
+                        reinterpret_cast<const uint32_t*>(range.first),
+                        first_count);
+  if (range.second_length) {
+    WriteRegistersFromMem(start_index + first_count,
+                          reinterpret_cast<const uint32_t*>(range.second),
+                          uint32_t(range.second_length / sizeof(uint32_t)));
+  }
+  ring->EndRead(range);
+}
+
 void CommandProcessor::MakeCoherent() {
   SCOPE_profile_cpu_f("gpu");
 
@@ -533,6 +594,10 @@ uint32_t CommandProcessor::ExecutePrimaryBuffer(uint32_t read_index,
 
   trace_writer_.WritePrimaryBufferStart(start_ptr, write_index - read_index);
 
+  // With host write watching, CPU writes to memory cached by the GPU are not
+  // reported as they happen - collect them before the commands use the caches.
+  memory_->TriggerWrittenPhysicalMemoryCallbacks();
+
   // Execute commands!
   RingBuffer reader(memory_->TranslatePhysical(primary_buffer_ptr_),
                     primary_buffer_size_);
@@ -632,10 +697,14 @@ bool CommandProcessor::ExecutePacketType0(RingBuffer* reader, uint32_t packet) {
 
   uint32_t base_index = (packet & 0x7FFF);
   uint32_t write_one_reg = (packet >> 15) & 0x1;
-  for (uint32_t m = 0; m < count; m++) {
-    uint32_t reg_data = reader->ReadAndSwap<uint32_t>();
-    uint32_t target_index = write_one_reg ? base_index : base_index + m;
-    WriteRegister(target_index, reg_data);
+  if (write_one_reg) {
+    // All the values go to the same register - each write must be handled
+    // individually for its side effects.
+    for (uint32_t m = 0; m < count; m++) {
+      WriteRegister(base_index, reader->ReadAndSwap<uint32_t>());
+    }
+  } else {
+    WriteRegisterRangeFromRing(reader, base_index, count);
   }
 
   trace_writer_.WritePacketEnd();
@@ -902,6 +971,7 @@ bool CommandProcessor::ExecutePacketType3_XE_SWAP(RingBuffer* reader,
   XELOGI("XE_SWAP");
 
   Profiler::Flip();
+  profiling::TraceRecorder::Instant("gpu", "Swap", counter_);
 
   // Xenia-specific VdSwap hook.
   // VdSwap will post this to tell us we need to swap the screen/fire an
@@ -1432,10 +1502,7 @@ bool CommandProcessor::ExecutePacketType3_SET_CONSTANT(RingBuffer* reader,
       reader->AdvanceRead((count - 1) * sizeof(uint32_t));
       return true;
   }
-  for (uint32_t n = 0; n < count - 1; n++, index++) {
-    uint32_t data = reader->ReadAndSwap<uint32_t>();
-    WriteRegister(index, data);
-  }
+  WriteRegisterRangeFromRing(reader, index, count - 1);
   return true;
 }
 
@@ -1444,10 +1511,7 @@ bool CommandProcessor::ExecutePacketType3_SET_CONSTANT2(RingBuffer* reader,
                                                         uint32_t count) {
   uint32_t offset_type = reader->ReadAndSwap<uint32_t>();
   uint32_t index = offset_type & 0xFFFF;
-  for (uint32_t n = 0; n < count - 1; n++, index++) {
-    uint32_t data = reader->ReadAndSwap<uint32_t>();
-    WriteRegister(index, data);
-  }
+  WriteRegisterRangeFromRing(reader, index, count - 1);
   return true;
 }
 
@@ -1483,11 +1547,9 @@ bool CommandProcessor::ExecutePacketType3_LOAD_ALU_CONSTANT(RingBuffer* reader,
       return true;
   }
   trace_writer_.WriteMemoryRead(CpuToGpu(address), size_dwords * 4);
-  for (uint32_t n = 0; n < size_dwords; n++, index++) {
-    uint32_t data = xe::load_and_swap<uint32_t>(
-        memory_->TranslatePhysical(address + n * 4));
-    WriteRegister(index, data);
-  }
+  WriteRegistersFromMem(
+      index, memory_->TranslatePhysical<const uint32_t*>(address),
+      size_dwords);
   return true;
 }
 
@@ -1495,10 +1557,7 @@ bool CommandProcessor::ExecutePacketType3_SET_SHADER_CONSTANTS(
     RingBuffer* reader, uint32_t packet, uint32_t count) {
   uint32_t offset_type = reader->ReadAndSwap<uint32_t>();
   uint32_t index = offset_type & 0xFFFF;
-  for (uint32_t n = 0; n < count - 1; n++, index++) {
-    uint32_t data = reader->ReadAndSwap<uint32_t>();
-    WriteRegister(index, data);
-  }
+  WriteRegisterRangeFromRing(reader, index, count - 1);
   return true;
 }
 
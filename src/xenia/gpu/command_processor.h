@@ -152,6 +152,19 @@ class CommandProcessor {
   virtual void ShutdownContext() = 0;
 
   virtual void WriteRegister(uint32_t index, uint32_t value);
+  // Writes a contiguous range of registers from big-endian values (guest
+  // memory or the ring buffer). Registers without side effects are
+  // byte-swapped into the register file in bulk, and only the special ones
+  // (see XE_GPU_REGISTER_SPECIAL in register_table.inc) are passed to
+  // WriteRegister, preserving the order of the writes.
+  void WriteRegistersFromMem(uint32_t start_index, const uint32_t* base,
+                             uint32_t num_registers);
+  void WriteRegisterRangeFromRing(RingBuffer* ring, uint32_t start_index,
+                                  uint32_t num_registers);
+  // Called after WriteRegistersFromMem (but not after individual WriteRegister
+  // calls) with the range actually written, for invalidating state depending
+  // on the registers in it.
+  virtual void OnRegisterRangeWritten(uint32_t first_index, uint32_t count) {}
 
   const reg::DC_LUT_30_COLOR* gamma_ramp_256_entry_table() const {
     return gamma_ramp_256_entry_table_;
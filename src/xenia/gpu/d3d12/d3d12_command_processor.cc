@@ -13,6 +13,7 @@
 #include <utility>
 
 #include "xenia/base/assert.h"
+#include "xenia/base/bit_range.h"
 #include "xenia/base/byte_order.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/logging.h"
@@ -1723,6 +1724,52 @@ void D3D12CommandProcessor::WriteRegister(uint32_t index, uint32_t value) {
   }
 }
 
+void D3D12CommandProcessor::OnRegisterRangeWritten(uint32_t first_index,
+                                                   uint32_t count) {
+  uint32_t end_index = first_index + count;
+  uint32_t float_first =
+      std::max(first_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_000_X));
+  uint32_t float_end =
+      std::min(end_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_511_W) + 1);
+  if (float_first < float_end && frame_open_) {
+    // Bitmap of the vertex (0...255) and the pixel (256...511) float constants
+    // touched by the range, to be tested against the ones used by the current
+    // shaders.
+    uint64_t float_constants_written[8] = {};
+    uint32_t float_constant_first =
+        (float_first - XE_GPU_REG_SHADER_CONSTANT_000_X) >> 2;
+    uint32_t float_constant_last =
+        (float_end - 1 - XE_GPU_REG_SHADER_CONSTANT_000_X) >> 2;
+    xe::bit_range::SetRange(float_constants_written, float_constant_first,
+                            float_constant_last + 1 - float_constant_first);
+    for (uint32_t i = 0; i < 4; ++i) {
+      if (current_float_constant_map_vertex_[i] & float_constants_written[i]) {
+        cbuffer_binding_float_vertex_.up_to_date = false;
+      }
+      if (current_float_constant_map_pixel_[i] &
+          float_constants_written[4 + i]) {
+        cbuffer_binding_float_pixel_.up_to_date = false;
+      }
+    }
+  }
+  if (first_index <= XE_GPU_REG_SHADER_CONSTANT_LOOP_31 &&
+      end_index > XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031) {
+    cbuffer_binding_bool_loop_.up_to_date = false;
+  }
+  uint32_t fetch_first =
+      std::max(first_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0));
+  uint32_t fetch_end =
+      std::min(end_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_FETCH_31_5) + 1);
+  if (fetch_first < fetch_end) {
+    cbuffer_binding_fetch_.up_to_date = false;
+    if (texture_cache_ != nullptr) {
+      texture_cache_->TextureFetchConstantsWritten(
+          (fetch_first - XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0) / 6,
+          (fetch_end - 1 - XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0) / 6);
+    }
+  }
+}
+
 void D3D12CommandProcessor::OnGammaRamp256EntryTableValueWritten() {
   gamma_ramp_256_entry_table_up_to_date_ = false;
 }
@@ -2975,6 +3022,8 @@ bool D3D12CommandProcessor::EndSubmission(bool is_swap) {
     texture_cache_->EndFrame();
 
     primitive_processor_->EndFrame();
+
+    shared_memory_->EndFrame();
   }
 
   if (submission_open_) {
@@ -3001,6 +3050,8 @@ bool D3D12CommandProcessor::EndSubmission(bool is_swap) {
     command_list_->Close();
     ID3D12CommandList* execute_command_lists[] = {command_list_};
     direct_queue->ExecuteCommandLists(1, execute_command_lists);
+    profiling::TraceRecorder::Instant("gpu", "Submission",
+                                      submission_current_);
     command_allocator_writable_first_->last_usage_submission =
         submission_current_;
     if (command_allocator_submitted_last_) {
@@ -40,6 +40,7 @@
 #include "xenia/gpu/dxbc_shader_translator.h"
 #include "xenia/gpu/gpu_flags.h"
 #include "xenia/gpu/registers.h"
+#include "xenia/gpu/shader_storage.h"
 #include "xenia/gpu/xenos.h"
 #include "xenia/ui/d3d12/d3d12_util.h"
 
@@ -360,18 +361,8 @@ void PipelineCache::InitializeShaderStorage(
   }
   ++shader_storage_index_;
   shader_storage_file_flush_needed_ = false;
-  struct {
-    uint32_t magic;
-    uint32_t version_swapped;
-  } shader_storage_file_header;
-  // 'XESH'.
-  const uint32_t shader_storage_magic = 0x48534558;
-  if (fread(&shader_storage_file_header, sizeof(shader_storage_file_header), 1,
-            shader_storage_file_) &&
-      shader_storage_file_header.magic == shader_storage_magic &&
-      xe::byte_swap(shader_storage_file_header.version_swapped) ==
-          ShaderStoredHeader::kVersion) {
-    uint64_t shader_storage_valid_bytes = sizeof(shader_storage_file_header);
+  if (ReadShaderStorageFileHeader(shader_storage_file_)) {
+    uint64_t shader_storage_valid_bytes = sizeof(ShaderStorageFileHeader);
     // Load and translate shaders written by previous Xenia executions until the
     // end of the file or until a corrupted one is detected.
     ShaderStoredHeader shader_header;
@@ -469,29 +460,15 @@ void PipelineCache::InitializeShaderStorage(
     std::vector<std::unique_ptr<xe::threading::Thread>>
         shader_translation_threads;
 
-    while (true) {
-      if (!fread(&shader_header, sizeof(shader_header), 1,
-                 shader_storage_file_)) {
-        break;
-      }
-      size_t ucode_byte_count =
+    // Stop at the end of the file or if validation failed.
+    while (ReadStoredShader(shader_storage_file_, shader_header,
+                            ucode_dwords)) {
+      shader_storage_valid_bytes +=
+          sizeof(shader_header) +
           shader_header.ucode_dword_count * sizeof(uint32_t);
-      ucode_dwords.resize(shader_header.ucode_dword_count);
-      if (shader_header.ucode_dword_count &&
-          !fread(ucode_dwords.data(), ucode_byte_count, 1,
-                 shader_storage_file_)) {
-        break;
-      }
-      uint64_t ucode_data_hash =
-          XXH3_64bits(ucode_dwords.data(), ucode_byte_count);
-      if (shader_header.ucode_data_hash != ucode_data_hash) {
-        // Validation failed.
-        break;
-      }
-      shader_storage_valid_bytes += sizeof(shader_header) + ucode_byte_count;
-      D3D12Shader* shader =
-          LoadShader(shader_header.type, ucode_dwords.data(),
-                     shader_header.ucode_dword_count, ucode_data_hash);
+      D3D12Shader* shader = LoadShader(
+          shader_header.type, ucode_dwords.data(),
+          shader_header.ucode_dword_count, shader_header.ucode_data_hash);
       if (shader->ucode_storage_index() == shader_storage_index_) {
         // Appeared twice in this file for some reason - skip, otherwise race
         // condition will be caused by translating twice in parallel.
@@ -556,11 +533,7 @@ void PipelineCache::InitializeShaderStorage(
                                       shader_storage_valid_bytes);
   } else {
     xe::filesystem::TruncateStdioFile(shader_storage_file_, 0);
-    shader_storage_file_header.magic = shader_storage_magic;
-    shader_storage_file_header.version_swapped =
-        xe::byte_swap(ShaderStoredHeader::kVersion);
-    fwrite(&shader_storage_file_header, sizeof(shader_storage_file_header), 1,
-           shader_storage_file_);
+    WriteShaderStorageFileHeader(shader_storage_file_);
   }
 
   // Create the pipelines.
@@ -3224,10 +3197,6 @@ ID3D12PipelineState* PipelineCache::CreateD3D12Pipeline(
 }
 
 void PipelineCache::StorageWriteThread() {
-  ShaderStoredHeader shader_header;
-  // Don't leak anything in unused bits.
-  std::memset(&shader_header, 0, sizeof(shader_header));
-
   std::vector<uint32_t> ucode_guest_endian;
   ucode_guest_endian.reserve(0xFFFF);
 
@@ -3278,21 +3247,8 @@ void PipelineCache::StorageWriteThread() {
     }
 
     if (shader) {
-      shader_header.ucode_data_hash = shader->ucode_data_hash();
-      shader_header.ucode_dword_count = shader->ucode_dword_count();
-      shader_header.type = shader->type();
       assert_not_null(shader_storage_file_);
-      fwrite(&shader_header, sizeof(shader_header), 1, shader_storage_file_);
-      if (shader_header.ucode_dword_count) {
-        ucode_guest_endian.resize(shader_header.ucode_dword_count);
-        // Need to swap because the hash is calculated for the shader with guest
-        // endianness.
-        xe::copy_and_swap(ucode_guest_endian.data(), shader->ucode_dwords(),
-                          shader_header.ucode_dword_count);
-        fwrite(ucode_guest_endian.data(),
-               shader_header.ucode_dword_count * sizeof(uint32_t), 1,
-               shader_storage_file_);
-      }
+      WriteStoredShader(shader_storage_file_, *shader, ucode_guest_endian);
     }
 
     if (write_pipeline) {
@@ -9,6 +9,7 @@
 
 #include "xenia/gpu/register_file.h"
 
+#include <algorithm>
 #include <cstring>
 
 #include "xenia/base/math.h"
@@ -16,8 +17,54 @@
 namespace xe {
 namespace gpu {
 
+namespace {
+
+struct SpecialRegisterBitmap {
+  static constexpr size_t kBlockCount =
+      (RegisterFile::kRegisterCount + 63) / 64;
+  uint64_t blocks[kBlockCount] = {};
+
+  constexpr SpecialRegisterBitmap() {
+    const uint32_t special_registers[] = {
+#define XE_GPU_REGISTER(index, type, name)
+#define XE_GPU_REGISTER_SPECIAL(name) XE_GPU_REG_##name,
+#include "xenia/gpu/register_table.inc"
+#undef XE_GPU_REGISTER_SPECIAL
+#undef XE_GPU_REGISTER
+    };
+    for (uint32_t index : special_registers) {
+      blocks[index >> 6] |= uint64_t(1) << (index & 63);
+    }
+  }
+};
+
+constexpr SpecialRegisterBitmap kSpecialRegisters;
+
+}  // namespace
+
 RegisterFile::RegisterFile() { std::memset(values, 0, sizeof(values)); }
 
+bool RegisterFile::IsSpecialRegister(uint32_t index) {
+  if (index >= kRegisterCount) {
+    return false;
+  }
+  return (kSpecialRegisters.blocks[index >> 6] &
+          (uint64_t(1) << (index & 63))) != 0;
+}
+
+uint32_t RegisterFile::FindNextSpecialRegister(uint32_t first, uint32_t end) {
+  end = std::min(end, uint32_t(kRegisterCount));
+  while (first < end) {
+    uint64_t block = kSpecialRegisters.blocks[first >> 6] >> (first & 63);
+    uint32_t block_bit;
+    if (xe::bit_scan_forward(block, &block_bit)) {
+      return std::min(first + block_bit, end);
+    }
+    first = (first | 63) + 1;
+  }
+  return end;
+}
+
 const RegisterInfo* RegisterFile::GetRegisterInfo(uint32_t index) {
   switch (index) {
 #define XE_GPU_REGISTER(index, type, name) \
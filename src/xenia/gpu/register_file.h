@@ -34,6 +34,14 @@ class RegisterFile {
   static const RegisterInfo* GetRegisterInfo(uint32_t index);
 
   static constexpr size_t kRegisterCount = 0x5003;
+
+  // Whether writing the register has side effects other than storing the
+  // value (declared with XE_GPU_REGISTER_SPECIAL in register_table.inc).
+  static bool IsSpecialRegister(uint32_t index);
+  // Returns the index of the first special register in [first, end), or end if
+  // there are none.
+  static uint32_t FindNextSpecialRegister(uint32_t first, uint32_t end);
+
   union RegisterValue {
     uint32_t u32;
     float f32;
@@ -7,8 +7,13 @@
  ******************************************************************************
  */
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cinttypes>
 #include <cstring>
+#include <filesystem>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <utility>
@@ -16,13 +21,22 @@
 
 #include "third_party/glslang/SPIRV/disassemble.h"
 #include "xenia/base/assert.h"
+#include "xenia/base/byte_order.h"
+#include "xenia/base/clock.h"
 #include "xenia/base/console_app_main.h"
 #include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
 #include "xenia/base/logging.h"
+#include "xenia/base/math.h"
 #include "xenia/base/platform.h"
 #include "xenia/base/string.h"
 #include "xenia/base/string_buffer.h"
+#include "xenia/base/threading.h"
+#include "xenia/base/utf8.h"
+#include "xenia/base/xxhash.h"
+#include "xenia/gpu/dxbc.h"
 #include "xenia/gpu/dxbc_shader_translator.h"
+#include "xenia/gpu/shader_storage.h"
 #include "xenia/gpu/shader_translator.h"
 #include "xenia/gpu/spirv_shader_translator.h"
 #include "xenia/gpu/xenos.h"
@@ -59,11 +73,637 @@ DEFINE_bool(
     "Output host shader with a render backend implementation based on pixel "
     "shader interlock.",
     "GPU");
+DEFINE_path(
+    shader_storage_input, "",
+    "Guest shader storage (.xsh) file to load instead of --shader_input. All "
+    "shaders in it are analyzed and translated with --shader_output_type "
+    "(when it's not 'ucode'), without a host GPU device.",
+    "GPU");
+DEFINE_path(
+    shader_storage_output, "",
+    "Guest shader storage (.xsh) file to write the shaders loaded from "
+    "--shader_storage_input to, for verifying storage round-tripping.",
+    "GPU");
+DEFINE_path(
+    shader_batch_input, "",
+    "Directory to recursively load all the shader microcode from for batch "
+    "translation, used for validating and benchmarking the translators. "
+    "Loads .vs / .ps files (with --shader_input_little_endian), .vert / .frag "
+    "microcode dumps written by --dump_shaders, and .xsh shader storage files.",
+    "GPU");
+DEFINE_string(
+    shader_batch_output_types, "spirv,dxbc",
+    "Comma-separated translators to run in batch mode: [spirv, dxbc].", "GPU");
+DEFINE_int32(shader_batch_threads, 0,
+             "Number of threads for batch translation, or 0 to use all logical "
+             "processors.",
+             "GPU");
+DEFINE_bool(shader_batch_validate_spirv, false,
+            "Validate the SPIR-V translated in batch mode using SPIRV-Tools "
+            "(from the Vulkan SDK).",
+            "GPU");
+DEFINE_path(shader_batch_report, "",
+            "CSV file to write per-shader batch translation results to.",
+            "GPU");
 
 namespace xe {
 namespace gpu {
 
+namespace {
+
+// Returns nullptr if only the microcode disassembly is requested.
+std::unique_ptr<ShaderTranslator> CreateTranslator(
+    const SpirvShaderTranslator::Features& spirv_features) {
+  if (cvars::shader_output_type == "spirv" ||
+      cvars::shader_output_type == "spirvtext") {
+    return std::make_unique<SpirvShaderTranslator>(
+        spirv_features, true, true,
+        cvars::shader_output_pixel_shader_interlock);
+  }
+  if (cvars::shader_output_type == "dxbc" ||
+      cvars::shader_output_type == "dxbctext") {
+    return std::make_unique<DxbcShaderTranslator>(
+        ui::GraphicsProvider::GpuVendorID(0),
+        cvars::shader_output_bindless_resources,
+        cvars::shader_output_pixel_shader_interlock);
+  }
+  return nullptr;
+}
+
+uint64_t GetDefaultModification(const ShaderTranslator& translator,
+                                xenos::ShaderType shader_type) {
+  if (shader_type == xenos::ShaderType::kPixel) {
+    return translator.GetDefaultPixelShaderModification(
+        xenos::kMaxShaderTempRegisters);
+  }
+  Shader::HostVertexShaderType host_vertex_shader_type =
+      Shader::HostVertexShaderType::kVertex;
+  if (cvars::vertex_shader_output_type == "linedomaincp") {
+    host_vertex_shader_type =
+        Shader::HostVertexShaderType::kLineDomainCPIndexed;
+  } else if (cvars::vertex_shader_output_type == "linedomainpatch") {
+    host_vertex_shader_type =
+        Shader::HostVertexShaderType::kLineDomainPatchIndexed;
+  } else if (cvars::vertex_shader_output_type == "triangledomaincp") {
+    host_vertex_shader_type =
+        Shader::HostVertexShaderType::kTriangleDomainCPIndexed;
+  } else if (cvars::vertex_shader_output_type == "triangledomainpatch") {
+    host_vertex_shader_type =
+        Shader::HostVertexShaderType::kTriangleDomainPatchIndexed;
+  } else if (cvars::vertex_shader_output_type == "quaddomaincp") {
+    host_vertex_shader_type =
+        Shader::HostVertexShaderType::kQuadDomainCPIndexed;
+  } else if (cvars::vertex_shader_output_type == "quaddomainpatch") {
+    host_vertex_shader_type =
+        Shader::HostVertexShaderType::kQuadDomainPatchIndexed;
+  }
+  return translator.GetDefaultVertexShaderModification(
+      xenos::kMaxShaderTempRegisters, host_vertex_shader_type);
+}
+
+// Loads all the shaders from a guest shader storage file, translates them if
+// requested, and optionally writes them to another storage file, verifying
+// that they're read back identically.
+int ProcessShaderStorage() {
+  FILE* input_file = filesystem::OpenFile(cvars::shader_storage_input, "rb");
+  if (!input_file) {
+    XELOGE("Unable to open shader storage input file: {}",
+           xe::path_to_utf8(cvars::shader_storage_input));
+    return 1;
+  }
+  if (!ReadShaderStorageFileHeader(input_file)) {
+    XELOGE("{} is not a shader storage file of the current version",
+           xe::path_to_utf8(cvars::shader_storage_input));
+    fclose(input_file);
+    return 1;
+  }
+  std::vector<std::unique_ptr<Shader>> shaders;
+  ShaderStoredHeader shader_header;
+  std::vector<uint32_t> ucode_dwords;
+  while (ReadStoredShader(input_file, shader_header, ucode_dwords)) {
+    // Copying the packed bit fields since references can't be bound to them.
+    shaders.push_back(std::make_unique<Shader>(
+        xenos::ShaderType(shader_header.type),
+        uint64_t(shader_header.ucode_data_hash), ucode_dwords.data(),
+        size_t(shader_header.ucode_dword_count)));
+  }
+  bool input_fully_valid = bool(feof(input_file));
+  fclose(input_file);
+  XELOGI("Loaded {} shaders from {}{}", shaders.size(),
+         xe::path_to_utf8(cvars::shader_storage_input),
+         input_fully_valid ? "" : " (stopped at corrupted data)");
+
+  SpirvShaderTranslator::Features spirv_features(true);
+  std::unique_ptr<ShaderTranslator> translator =
+      CreateTranslator(spirv_features);
+  std::unique_ptr<ui::vulkan::SpirvToolsContext> spirv_tools_context;
+  if (cvars::shader_output_type == "spirvtext") {
+    spirv_tools_context = std::make_unique<ui::vulkan::SpirvToolsContext>();
+    if (!spirv_tools_context->Initialize(spirv_features.spirv_version)) {
+      spirv_tools_context.reset();
+    }
+  }
+  StringBuffer ucode_disasm_buffer;
+  size_t translation_failures = 0;
+  for (const std::unique_ptr<Shader>& shader : shaders) {
+    shader->AnalyzeUcode(ucode_disasm_buffer);
+    if (!translator) {
+      continue;
+    }
+    Shader::Translation& translation = *shader->GetOrCreateTranslation(
+        GetDefaultModification(*translator, shader->type()));
+    bool translated = translator->TranslateAnalyzedShader(translation);
+    if (translated && spirv_tools_context) {
+      const std::vector<uint8_t>& spirv = translation.translated_binary();
+      std::string spirv_validation_error;
+      spirv_tools_context->Validate(
+          reinterpret_cast<const uint32_t*>(spirv.data()),
+          spirv.size() / sizeof(uint32_t), &spirv_validation_error);
+      if (!spirv_validation_error.empty()) {
+        XELOGE("Shader {:016X} SPIR-V validation failed: {}",
+               shader->ucode_data_hash(), spirv_validation_error);
+        translated = false;
+      }
+    }
+    if (!translated) {
+      XELOGE("Failed to translate shader {:016X}", shader->ucode_data_hash());
+      ++translation_failures;
+    }
+  }
+  if (translator) {
+    XELOGI("Translated {} of {} shaders to {}",
+           shaders.size() - translation_failures, shaders.size(),
+           cvars::shader_output_type);
+  }
+
+  if (cvars::shader_storage_output.empty()) {
+    return translation_failures ? 1 : 0;
+  }
+  FILE* output_file = filesystem::OpenFile(cvars::shader_storage_output, "wb");
+  if (!output_file) {
+    XELOGE("Unable to open shader storage output file: {}",
+           xe::path_to_utf8(cvars::shader_storage_output));
+    return 1;
+  }
+  WriteShaderStorageFileHeader(output_file);
+  std::vector<uint32_t> ucode_guest_endian;
+  for (const std::unique_ptr<Shader>& shader : shaders) {
+    WriteStoredShader(output_file, *shader, ucode_guest_endian);
+  }
+  fclose(output_file);
+
+  // Read the written file back to make sure it's identical to what was loaded.
+  output_file = filesystem::OpenFile(cvars::shader_storage_output, "rb");
+  if (!output_file) {
+    XELOGE("Unable to reopen shader storage output file: {}",
+           xe::path_to_utf8(cvars::shader_storage_output));
+    return 1;
+  }
+  size_t shaders_verified = 0;
+  bool round_trip_valid = ReadShaderStorageFileHeader(output_file);
+  while (round_trip_valid && shaders_verified < shaders.size() &&
+         ReadStoredShader(output_file, shader_header, ucode_dwords)) {
+    const Shader& shader = *shaders[shaders_verified];
+    round_trip_valid = shader_header.ucode_data_hash ==
+                           shader.ucode_data_hash() &&
+                       shader_header.type == shader.type() &&
+                       shader_header.ucode_dword_count ==
+                           shader.ucode_dword_count();
+    if (round_trip_valid) {
+      ++shaders_verified;
+    }
+  }
+  fclose(output_file);
+  if (shaders_verified != shaders.size()) {
+    XELOGE("Shader storage round trip failed after {} of {} shaders",
+           shaders_verified, shaders.size());
+    return 1;
+  }
+  XELOGI("Wrote and verified {} shaders in {}", shaders_verified,
+         xe::path_to_utf8(cvars::shader_storage_output));
+  return translation_failures ? 1 : 0;
+}
+
+// Batch translation.
+
+struct BatchShader {
+  std::string source;
+  xenos::ShaderType type;
+  uint64_t ucode_data_hash;
+  // Big-endian, like in the guest memory.
+  std::vector<uint32_t> ucode;
+};
+
+enum BatchTranslatorIndex : size_t {
+  kBatchTranslatorSpirv,
+  kBatchTranslatorDxbc,
+
+  kBatchTranslatorCount,
+};
+
+constexpr const char* kBatchTranslatorNames[kBatchTranslatorCount] = {
+    "spirv",
+    "dxbc",
+};
+
+struct BatchTranslationResult {
+  bool attempted = false;
+  bool succeeded = false;
+  uint64_t time_us = 0;
+  size_t binary_size = 0;
+  uint32_t host_instruction_count = 0;
+  std::string error;
+};
+
+struct BatchShaderResult {
+  uint64_t analysis_time_us = 0;
+  std::array<BatchTranslationResult, kBatchTranslatorCount> translations;
+};
+
+// 1 microsecond to over 1 second in power of two buckets.
+constexpr uint32_t kBatchTimeHistogramBucketCount = 21;
+
+void AddBatchShader(std::vector<BatchShader>& shaders, std::string source,
+                    xenos::ShaderType type, std::vector<uint32_t>&& ucode) {
+  BatchShader& shader = shaders.emplace_back();
+  shader.source = std::move(source);
+  shader.type = type;
+  shader.ucode_data_hash =
+      XXH3_64bits(ucode.data(), ucode.size() * sizeof(uint32_t));
+  shader.ucode = std::move(ucode);
+}
+
+void LoadBatchShaders(const std::filesystem::path& directory,
+                      std::vector<BatchShader>& shaders) {
+  std::error_code error_code;
+  for (const std::filesystem::directory_entry& entry :
+       std::filesystem::recursive_directory_iterator(directory, error_code)) {
+    if (!entry.is_regular_file()) {
+      continue;
+    }
+    const std::filesystem::path& path = entry.path();
+    auto extension = path.extension();
+    if (extension == ".xsh") {
+      FILE* file = filesystem::OpenFile(path, "rb");
+      if (!file) {
+        continue;
+      }
+      if (ReadShaderStorageFileHeader(file)) {
+        ShaderStoredHeader shader_header;
+        std::vector<uint32_t> ucode;
+        while (ReadStoredShader(file, shader_header, ucode)) {
+          AddBatchShader(shaders,
+                         fmt::format("{}:{:016X}", xe::path_to_utf8(path),
+                                     uint64_t(shader_header.ucode_data_hash)),
+                         shader_header.type, std::move(ucode));
+        }
+      }
+      fclose(file);
+      continue;
+    }
+    xenos::ShaderType type;
+    bool little_endian;
+    if (extension == ".vs" || extension == ".ps") {
+      type = extension == ".vs" ? xenos::ShaderType::kVertex
+                                : xenos::ShaderType::kPixel;
+      little_endian = cvars::shader_input_little_endian;
+    } else if (extension == ".vert" || extension == ".frag") {
+      // Only the binary microcode dumps (shader_X.ucode.bin.vert), not the
+      // disassembly or the translated binaries (shader_X_Y.d3d12.bin.vert).
+      std::filesystem::path stem = path.stem();
+      if (stem.extension() != ".bin" || stem.stem().extension() != ".ucode") {
+        continue;
+      }
+      type = extension == ".vert" ? xenos::ShaderType::kVertex
+                                  : xenos::ShaderType::kPixel;
+      // Dumped in the host byte order.
+      little_endian = std::endian::native == std::endian::little;
+    } else {
+      continue;
+    }
+    FILE* file = filesystem::OpenFile(path, "rb");
+    if (!file) {
+      continue;
+    }
+    std::vector<uint32_t> ucode(size_t(entry.file_size()) / sizeof(uint32_t));
+    ucode.resize(fread(ucode.data(), sizeof(uint32_t), ucode.size(), file));
+    fclose(file);
+    if (ucode.empty()) {
+      continue;
+    }
+    if (little_endian) {
+      xe::copy_and_swap(ucode.data(), ucode.data(), ucode.size());
+    }
+    AddBatchShader(shaders, xe::path_to_utf8(path), type, std::move(ucode));
+  }
+}
+
+uint32_t CountSpirvInstructions(const std::vector<uint8_t>& binary) {
+  const uint32_t* words = reinterpret_cast<const uint32_t*>(binary.data());
+  size_t word_count = binary.size() / sizeof(uint32_t);
+  // Skip the 5-word module header.
+  size_t word_index = 5;
+  uint32_t instruction_count = 0;
+  while (word_index < word_count) {
+    uint32_t instruction_word_count = words[word_index] >> 16;
+    if (!instruction_word_count) {
+      break;
+    }
+    word_index += instruction_word_count;
+    ++instruction_count;
+  }
+  return instruction_count;
+}
+
+uint32_t GetDxbcInstructionCount(const std::vector<uint8_t>& binary) {
+  if (binary.size() < sizeof(dxbc::ContainerHeader)) {
+    return 0;
+  }
+  const auto& container_header =
+      *reinterpret_cast<const dxbc::ContainerHeader*>(binary.data());
+  const uint32_t* blob_offsets = reinterpret_cast<const uint32_t*>(
+      binary.data() + sizeof(dxbc::ContainerHeader));
+  for (uint32_t i = 0; i < container_header.blob_count; ++i) {
+    uint32_t blob_offset = blob_offsets[i];
+    if (blob_offset + sizeof(dxbc::BlobHeader) + sizeof(dxbc::Statistics) >
+        binary.size()) {
+      continue;
+    }
+    const auto& blob_header = *reinterpret_cast<const dxbc::BlobHeader*>(
+        binary.data() + blob_offset);
+    if (blob_header.fourcc == dxbc::BlobHeader::FourCC::kStatistics) {
+      return reinterpret_cast<const dxbc::Statistics*>(
+                 binary.data() + blob_offset + sizeof(dxbc::BlobHeader))
+          ->instruction_count;
+    }
+  }
+  return 0;
+}
+
+uint64_t HostTicksToMicroseconds(uint64_t ticks) {
+  return ticks * 1000000 / xe::Clock::QueryHostTickFrequency();
+}
+
+// Translates every shader found in a directory with the requested translators
+// on multiple threads, reporting the translation time distribution, sizes and
+// failures.
+int ProcessShaderBatch() {
+  std::array<bool, kBatchTranslatorCount> translators_enabled = {};
+  for (std::string_view type :
+       xe::utf8::split(cvars::shader_batch_output_types, ",")) {
+    bool found = false;
+    for (size_t i = 0; i < kBatchTranslatorCount; ++i) {
+      if (type == kBatchTranslatorNames[i]) {
+        translators_enabled[i] = true;
+        found = true;
+      }
+    }
+    if (!found) {
+      XELOGE("Unknown batch translator type '{}'", type);
+      return 1;
+    }
+  }
+
+  uint64_t load_start = xe::Clock::QueryHostTickCount();
+  std::vector<BatchShader> shaders;
+  LoadBatchShaders(cvars::shader_batch_input, shaders);
+  // Remove duplicates, such as the same shader present in multiple storage
+  // files, so they don't skew the statistics.
+  std::sort(shaders.begin(), shaders.end(),
+            [](const BatchShader& a, const BatchShader& b) {
+              return a.ucode_data_hash < b.ucode_data_hash;
+            });
+  shaders.erase(std::unique(shaders.begin(), shaders.end(),
+                            [](const BatchShader& a, const BatchShader& b) {
+                              return a.ucode_data_hash == b.ucode_data_hash;
+                            }),
+                shaders.end());
+  XELOGI("Loaded {} unique shaders from {} in {} ms", shaders.size(),
+         xe::path_to_utf8(cvars::shader_batch_input),
+         HostTicksToMicroseconds(xe::Clock::QueryHostTickCount() - load_start) /
+             1000);
+  if (shaders.empty()) {
+    return 1;
+  }
+
+  size_t thread_count = cvars::shader_batch_threads > 0
+                            ? size_t(cvars::shader_batch_threads)
+                            : size_t(xe::threading::logical_processor_count());
+  thread_count = std::max(std::min(thread_count, shaders.size()), size_t(1));
+
+  std::vector<BatchShaderResult> results(shaders.size());
+  std::atomic<size_t> next_shader_index(0);
+  SpirvShaderTranslator::Features spirv_features(true);
+  auto thread_function = [&]() {
+    StringBuffer ucode_disasm_buffer;
+    std::array<std::unique_ptr<ShaderTranslator>, kBatchTranslatorCount>
+        translators;
+    if (translators_enabled[kBatchTranslatorSpirv]) {
+      translators[kBatchTranslatorSpirv] =
+          std::make_unique<SpirvShaderTranslator>(
+              spirv_features, true, true,
+              cvars::shader_output_pixel_shader_interlock);
+    }
+    if (translators_enabled[kBatchTranslatorDxbc]) {
+      translators[kBatchTranslatorDxbc] =
+          std::make_unique<DxbcShaderTranslator>(
+              ui::GraphicsProvider::GpuVendorID(0),
+              cvars::shader_output_bindless_resources,
+              cvars::shader_output_pixel_shader_interlock);
+    }
+    std::unique_ptr<ui::vulkan::SpirvToolsContext> spirv_tools_context;
+    if (translators_enabled[kBatchTranslatorSpirv] &&
+        cvars::shader_batch_validate_spirv) {
+      spirv_tools_context = std::make_unique<ui::vulkan::SpirvToolsContext>();
+      if (!spirv_tools_context->Initialize(spirv_features.spirv_version)) {
+        spirv_tools_context.reset();
+      }
+    }
+    for (;;) {
+      size_t shader_index =
+          next_shader_index.fetch_add(1, std::memory_order_relaxed);
+      if (shader_index >= shaders.size()) {
+        return;
+      }
+      const BatchShader& batch_shader = shaders[shader_index];
+      BatchShaderResult& result = results[shader_index];
+      Shader shader(batch_shader.type, batch_shader.ucode_data_hash,
+                    batch_shader.ucode.data(), batch_shader.ucode.size());
+      uint64_t analysis_start = xe::Clock::QueryHostTickCount();
+      shader.AnalyzeUcode(ucode_disasm_buffer);
+      result.analysis_time_us = HostTicksToMicroseconds(
+          xe::Clock::QueryHostTickCount() - analysis_start);
+      for (size_t i = 0; i < kBatchTranslatorCount; ++i) {
+        if (!translators[i]) {
+          continue;
+        }
+        BatchTranslationResult& translation_result = result.translations[i];
+        translation_result.attempted = true;
+        Shader::Translation& translation = *shader.GetOrCreateTranslation(
+            GetDefaultModification(*translators[i], batch_shader.type));
+        uint64_t translation_start = xe::Clock::QueryHostTickCount();
+        translation_result.succeeded =
+            translators[i]->TranslateAnalyzedShader(translation);
+        translation_result.time_us = HostTicksToMicroseconds(
+            xe::Clock::QueryHostTickCount() - translation_start);
+        if (!translation_result.succeeded) {
+          translation_result.error = "translation failed";
+          continue;
+        }
+        const std::vector<uint8_t>& binary = translation.translated_binary();
+        translation_result.binary_size = binary.size();
+        if (i == kBatchTranslatorSpirv) {
+          translation_result.host_instruction_count =
+              CountSpirvInstructions(binary);
+          if (spirv_tools_context) {
+            spirv_tools_context->Validate(
+                reinterpret_cast<const uint32_t*>(binary.data()),
+                binary.size() / sizeof(uint32_t), &translation_result.error);
+            if (!translation_result.error.empty()) {
+              translation_result.succeeded = false;
+            }
+          }
+        } else if (i == kBatchTranslatorDxbc) {
+          translation_result.host_instruction_count =
+              GetDxbcInstructionCount(binary);
+        }
+      }
+    }
+  };
+
+  uint64_t batch_start = xe::Clock::QueryHostTickCount();
+  std::vector<std::unique_ptr<xe::threading::Thread>> threads;
+  for (size_t i = 1; i < thread_count; ++i) {
+    auto thread = xe::threading::Thread::Create({}, thread_function);
+    assert_not_null(thread);
+    thread->set_name("Shader Translation");
+    threads.push_back(std::move(thread));
+  }
+  thread_function();
+  for (auto& thread : threads) {
+    xe::threading::Wait(thread.get(), false);
+  }
+  uint64_t batch_time_us =
+      HostTicksToMicroseconds(xe::Clock::QueryHostTickCount() - batch_start);
+
+  XELOGI("Processed {} shaders on {} threads in {} ms", shaders.size(),
+         thread_count, batch_time_us / 1000);
+  uint64_t guest_dword_count = 0;
+  uint64_t analysis_time_us = 0;
+  for (size_t i = 0; i < shaders.size(); ++i) {
+    guest_dword_count += shaders[i].ucode.size();
+    analysis_time_us += results[i].analysis_time_us;
+  }
+  XELOGI("Microcode analysis: {} dwords total, {} us total", guest_dword_count,
+         analysis_time_us);
+
+  size_t failure_count = 0;
+  std::vector<uint64_t> times_us;
+  times_us.reserve(shaders.size());
+  for (size_t i = 0; i < kBatchTranslatorCount; ++i) {
+    if (!translators_enabled[i]) {
+      continue;
+    }
+    std::array<size_t, kBatchTimeHistogramBucketCount> histogram = {};
+    times_us.clear();
+    uint64_t total_time_us = 0;
+    uint64_t total_binary_size = 0;
+    uint64_t total_host_instruction_count = 0;
+    size_t translator_failure_count = 0;
+    for (size_t j = 0; j < shaders.size(); ++j) {
+      const BatchTranslationResult& translation_result =
+          results[j].translations[i];
+      if (!translation_result.succeeded) {
+        ++translator_failure_count;
+        XELOGE("{}: {:016X} ({}) failed: {}", kBatchTranslatorNames[i],
+               shaders[j].ucode_data_hash, shaders[j].source,
+               translation_result.error);
+      }
+      uint64_t time_us = translation_result.time_us;
+      times_us.push_back(time_us);
+      total_time_us += time_us;
+      total_binary_size += translation_result.binary_size;
+      total_host_instruction_count += translation_result.host_instruction_count;
+      // Bucket 0 is for 0 microseconds, bucket n is for [2^(n-1), 2^n).
+      uint32_t bucket = time_us ? uint32_t(64 - xe::lzcnt(time_us)) : 0;
+      ++histogram[std::min(bucket, kBatchTimeHistogramBucketCount - 1)];
+    }
+    failure_count += translator_failure_count;
+    std::sort(times_us.begin(), times_us.end());
+    XELOGI(
+        "{}: {} succeeded, {} failed; {} us total, median {} us, 99th "
+        "percentile {} us, max {} us; {} bytes, {} host instructions total",
+        kBatchTranslatorNames[i], shaders.size() - translator_failure_count,
+        translator_failure_count, total_time_us, times_us[times_us.size() / 2],
+        times_us[times_us.size() * 99 / 100], times_us.back(),
+        total_binary_size, total_host_instruction_count);
+    for (uint32_t j = 0; j < kBatchTimeHistogramBucketCount; ++j) {
+      if (!histogram[j]) {
+        continue;
+      }
+      XELOGI("{}:   {:>8} - {:>8} us: {}", kBatchTranslatorNames[i],
+             j ? uint64_t(1) << (j - 1) : 0,
+             j + 1 < kBatchTimeHistogramBucketCount
+                 ? (uint64_t(1) << j) - 1
+                 : UINT64_MAX,
+             histogram[j]);
+    }
+  }
+
+  if (!cvars::shader_batch_report.empty()) {
+    FILE* report_file = filesystem::OpenFile(cvars::shader_batch_report, "w");
+    if (report_file) {
+      std::string line = "hash,type,source,ucode_dwords,analysis_us";
+      for (size_t i = 0; i < kBatchTranslatorCount; ++i) {
+        if (translators_enabled[i]) {
+          line += fmt::format(",{0}_ok,{0}_us,{0}_bytes,{0}_instructions",
+                              kBatchTranslatorNames[i]);
+        }
+      }
+      line += '\n';
+      fwrite(line.data(), 1, line.size(), report_file);
+      for (size_t i = 0; i < shaders.size(); ++i) {
+        const BatchShader& batch_shader = shaders[i];
+        line = fmt::format(
+            "{:016X},{},\"{}\",{},{}", batch_shader.ucode_data_hash,
+            batch_shader.type == xenos::ShaderType::kVertex ? "vs" : "ps",
+            batch_shader.source, batch_shader.ucode.size(),
+            results[i].analysis_time_us);
+        for (size_t j = 0; j < kBatchTranslatorCount; ++j) {
+          if (!translators_enabled[j]) {
+            continue;
+          }
+          const BatchTranslationResult& translation_result =
+              results[i].translations[j];
+          line += fmt::format(",{},{},{},{}",
+                              translation_result.succeeded ? 1 : 0,
+                              translation_result.time_us,
+                              translation_result.binary_size,
+                              translation_result.host_instruction_count);
+        }
+        line += '\n';
+        fwrite(line.data(), 1, line.size(), report_file);
+      }
+      fclose(report_file);
+    } else {
+      XELOGE("Unable to open batch report file: {}",
+             xe::path_to_utf8(cvars::shader_batch_report));
+    }
+  }
+
+  return failure_count ? 1 : 0;
+}
+
+}  // namespace
+
 int shader_compiler_main(const std::vector<std::string>& args) {
+  if (!cvars::shader_batch_input.empty()) {
+    return ProcessShaderBatch();
+  }
+  if (!cvars::shader_storage_input.empty()) {
+    return ProcessShaderStorage();
+  }
+
   xenos::ShaderType shader_type;
   if (!cvars::shader_input_type.empty()) {
     if (cvars::shader_input_type == "vs") {
@@ -122,20 +762,10 @@ int shader_compiler_main(const std::vector<std::string>& args) {
   StringBuffer ucode_disasm_buffer;
   shader->AnalyzeUcode(ucode_disasm_buffer);
 
-  std::unique_ptr<ShaderTranslator> translator;
   SpirvShaderTranslator::Features spirv_features(true);
-  if (cvars::shader_output_type == "spirv" ||
-      cvars::shader_output_type == "spirvtext") {
-    translator = std::make_unique<SpirvShaderTranslator>(
-        spirv_features, true, true,
-        cvars::shader_output_pixel_shader_interlock);
-  } else if (cvars::shader_output_type == "dxbc" ||
-             cvars::shader_output_type == "dxbctext") {
-    translator = std::make_unique<DxbcShaderTranslator>(
-        ui::GraphicsProvider::GpuVendorID(0),
-        cvars::shader_output_bindless_resources,
-        cvars::shader_output_pixel_shader_interlock);
-  } else {
+  std::unique_ptr<ShaderTranslator> translator =
+      CreateTranslator(spirv_features);
+  if (!translator) {
     // Just output microcode disassembly generated during microcode information
     // gathering.
     if (!cvars::shader_output.empty()) {
@@ -147,43 +777,7 @@ int shader_compiler_main(const std::vector<std::string>& args) {
     return 0;
   }
 
-  Shader::HostVertexShaderType host_vertex_shader_type =
-      Shader::HostVertexShaderType::kVertex;
-  if (shader_type == xenos::ShaderType::kVertex) {
-    if (cvars::vertex_shader_output_type == "linedomaincp") {
-      host_vertex_shader_type =
-          Shader::HostVertexShaderType::kLineDomainCPIndexed;
-    } else if (cvars::vertex_shader_output_type == "linedomainpatch") {
-      host_vertex_shader_type =
-          Shader::HostVertexShaderType::kLineDomainPatchIndexed;
-    } else if (cvars::vertex_shader_output_type == "triangledomaincp") {
-      host_vertex_shader_type =
-          Shader::HostVertexShaderType::kTriangleDomainCPIndexed;
-    } else if (cvars::vertex_shader_output_type == "triangledomainpatch") {
-      host_vertex_shader_type =
-          Shader::HostVertexShaderType::kTriangleDomainPatchIndexed;
-    } else if (cvars::vertex_shader_output_type == "quaddomaincp") {
-      host_vertex_shader_type =
-          Shader::HostVertexShaderType::kQuadDomainCPIndexed;
-    } else if (cvars::vertex_shader_output_type == "quaddomainpatch") {
-      host_vertex_shader_type =
-          Shader::HostVertexShaderType::kQuadDomainPatchIndexed;
-    }
-  }
-  uint64_t modification;
-  switch (shader_type) {
-    case xenos::ShaderType::kVertex:
-      modification = translator->GetDefaultVertexShaderModification(
-          xenos::kMaxShaderTempRegisters, host_vertex_shader_type);
-      break;
-    case xenos::ShaderType::kPixel:
-      modification = translator->GetDefaultPixelShaderModification(
-          xenos::kMaxShaderTempRegisters);
-      break;
-    default:
-      assert_unhandled_case(shader_type);
-      return 1;
-  }
+  uint64_t modification = GetDefaultModification(*translator, shader_type);
 
   Shader::Translation* translation =
       shader->GetOrCreateTranslation(modification);
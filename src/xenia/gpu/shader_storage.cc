@@ -0,0 +1,71 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/shader_storage.h"
+
+#include <cstring>
+
+#include "xenia/base/byte_order.h"
+#include "xenia/base/memory.h"
+#include "xenia/base/xxhash.h"
+
+namespace xe {
+namespace gpu {
+
+bool ReadShaderStorageFileHeader(FILE* file) {
+  ShaderStorageFileHeader header;
+  return fread(&header, sizeof(header), 1, file) &&
+         header.magic == ShaderStorageFileHeader::kMagic &&
+         xe::byte_swap(header.version_swapped) == ShaderStoredHeader::kVersion;
+}
+
+void WriteShaderStorageFileHeader(FILE* file) {
+  ShaderStorageFileHeader header;
+  header.magic = ShaderStorageFileHeader::kMagic;
+  header.version_swapped = xe::byte_swap(ShaderStoredHeader::kVersion);
+  fwrite(&header, sizeof(header), 1, file);
+}
+
+bool ReadStoredShader(FILE* file, ShaderStoredHeader& header_out,
+                      std::vector<uint32_t>& ucode_guest_endian_out) {
+  if (!fread(&header_out, sizeof(header_out), 1, file)) {
+    return false;
+  }
+  size_t ucode_byte_count = header_out.ucode_dword_count * sizeof(uint32_t);
+  ucode_guest_endian_out.resize(header_out.ucode_dword_count);
+  if (header_out.ucode_dword_count &&
+      !fread(ucode_guest_endian_out.data(), ucode_byte_count, 1, file)) {
+    return false;
+  }
+  return XXH3_64bits(ucode_guest_endian_out.data(), ucode_byte_count) ==
+         header_out.ucode_data_hash;
+}
+
+void WriteStoredShader(FILE* file, const Shader& shader,
+                       std::vector<uint32_t>& ucode_guest_endian_temp) {
+  ShaderStoredHeader header;
+  // Don't leak anything in unused bits.
+  std::memset(&header, 0, sizeof(header));
+  header.ucode_data_hash = shader.ucode_data_hash();
+  header.ucode_dword_count = shader.ucode_dword_count();
+  header.type = shader.type();
+  fwrite(&header, sizeof(header), 1, file);
+  if (header.ucode_dword_count) {
+    ucode_guest_endian_temp.resize(header.ucode_dword_count);
+    // Need to swap because the hash is calculated for the shader with guest
+    // endianness.
+    xe::copy_and_swap(ucode_guest_endian_temp.data(), shader.ucode_dwords(),
+                      header.ucode_dword_count);
+    fwrite(ucode_guest_endian_temp.data(),
+           header.ucode_dword_count * sizeof(uint32_t), 1, file);
+  }
+}
+
+}  // namespace gpu
+}  // namespace xe
@@ -0,0 +1,64 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_GPU_SHADER_STORAGE_H_
+#define XENIA_GPU_SHADER_STORAGE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "xenia/base/platform.h"
+#include "xenia/gpu/shader.h"
+#include "xenia/gpu/xenos.h"
+
+namespace xe {
+namespace gpu {
+
+// Guest shader storage (.xsh) files, shared by all host GPU implementations
+// since they contain only the Xenos microcode. A file begins with the
+// ShaderStorageFileHeader, followed by a ShaderStoredHeader and the
+// guest-endian microcode for every shader.
+
+struct ShaderStorageFileHeader {
+  // 'XESH'.
+  static constexpr uint32_t kMagic = 0x48534558;
+
+  uint32_t magic;
+  uint32_t version_swapped;
+};
+
+XEPACKEDSTRUCT(ShaderStoredHeader, {
+  uint64_t ucode_data_hash;
+
+  uint32_t ucode_dword_count : 31;
+  xenos::ShaderType type : 1;
+
+  static constexpr uint32_t kVersion = 0x20201219;
+});
+
+// Reads the file header at the current position, returning whether it's a
+// shader storage file of the current version.
+bool ReadShaderStorageFileHeader(FILE* file);
+void WriteShaderStorageFileHeader(FILE* file);
+
+// Reads the next shader, returning false at the end of the file or if the data
+// is corrupted (the microcode hash doesn't match). The microcode is returned
+// with guest endianness, like it's stored in the guest memory.
+bool ReadStoredShader(FILE* file, ShaderStoredHeader& header_out,
+                      std::vector<uint32_t>& ucode_guest_endian_out);
+// ucode_guest_endian_temp is a buffer reused between calls to avoid
+// reallocation.
+void WriteStoredShader(FILE* file, const Shader& shader,
+                       std::vector<uint32_t>& ucode_guest_endian_temp);
+
+}  // namespace gpu
+}  // namespace xe
+
+#endif  // XENIA_GPU_SHADER_STORAGE_H_
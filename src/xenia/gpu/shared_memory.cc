@@ -24,6 +24,7 @@ namespace gpu {
 
 SharedMemory::SharedMemory(Memory& memory) : memory_(memory) {
   page_size_log2_ = xe::log2_ceil(uint32_t(xe::memory::page_size()));
+  assert_true(page_size_log2_ <= kWatchTreeLeafSizeLog2);
 }
 
 SharedMemory::~SharedMemory() { ShutdownCommon(); }
@@ -51,20 +52,7 @@ void SharedMemory::ShutdownCommon() {
 
   FireWatches(0, (kBufferSize - 1) >> page_size_log2_, false);
   assert_true(global_watches_.empty());
-  // No watches now, so no references to the pools accessible by guest threads -
-  // safe not to enter the global critical region.
-  watch_node_first_free_ = nullptr;
-  watch_node_current_pool_allocated_ = 0;
-  for (WatchNode* pool : watch_node_pools_) {
-    delete[] pool;
-  }
-  watch_node_pools_.clear();
-  watch_range_first_free_ = nullptr;
-  watch_range_current_pool_allocated_ = 0;
-  for (WatchRange* pool : watch_range_pools_) {
-    delete[] pool;
-  }
-  watch_range_pools_.clear();
+  ReleaseWatchRangePools();
 
   if (memory_invalidation_callback_handle_ != nullptr) {
     memory_.UnregisterPhysicalMemoryInvalidationCallback(
@@ -89,20 +77,7 @@ void SharedMemory::ShutdownCommon() {
 void SharedMemory::ClearCache() {
   // Keeping GPU-written data, so "invalidated by GPU".
   FireWatches(0, (kBufferSize - 1) >> page_size_log2_, true);
-  // No watches now, so no references to the pools accessible by guest threads -
-  // safe not to enter the global critical region.
-  watch_node_first_free_ = nullptr;
-  watch_node_current_pool_allocated_ = 0;
-  for (WatchNode* pool : watch_node_pools_) {
-    delete[] pool;
-  }
-  watch_node_pools_.clear();
-  watch_range_first_free_ = nullptr;
-  watch_range_current_pool_allocated_ = 0;
-  for (WatchRange* pool : watch_range_pools_) {
-    delete[] pool;
-  }
-  watch_range_pools_.clear();
+  ReleaseWatchRangePools();
 
   {
     auto global_lock = global_critical_region_.Acquire();
@@ -146,12 +121,17 @@ SharedMemory::WatchHandle SharedMemory::WatchMemoryRange(
     return nullptr;
   }
   length = std::min(length, kBufferSize - start);
+  uint32_t last = start + length - 1;
   uint32_t watch_page_first = start >> page_size_log2_;
-  uint32_t watch_page_last = (start + length - 1) >> page_size_log2_;
-  uint32_t bucket_first =
-      watch_page_first << page_size_log2_ >> kWatchBucketSizeLog2;
-  uint32_t bucket_last =
-      watch_page_last << page_size_log2_ >> kWatchBucketSizeLog2;
+  uint32_t watch_page_last = last >> page_size_log2_;
+  // The lowest common ancestor of the leaves containing the first and the last
+  // pages.
+  uint32_t leaf_first = start >> kWatchTreeLeafSizeLog2;
+  uint32_t leaf_last = last >> kWatchTreeLeafSizeLog2;
+  uint32_t tree_node = kWatchTreeLeafCount + leaf_first;
+  if (leaf_first != leaf_last) {
+    tree_node >>= xe::log2_floor(leaf_first ^ leaf_last) + 1;
+  }
 
   auto global_lock = global_critical_region_.Acquire();
 
@@ -174,34 +154,16 @@ SharedMemory::WatchHandle SharedMemory::WatchMemoryRange(
   range->page_first = watch_page_first;
   range->page_last = watch_page_last;
 
-  // Allocate and link the nodes.
-  WatchNode* node_previous = nullptr;
-  for (uint32_t i = bucket_first; i <= bucket_last; ++i) {
-    WatchNode* node = watch_node_first_free_;
-    if (node != nullptr) {
-      watch_node_first_free_ = node->next_free;
-    } else {
-      if (watch_node_pools_.empty() ||
-          watch_node_current_pool_allocated_ >= kWatchNodePoolSize) {
-        watch_node_pools_.push_back(new WatchNode[kWatchNodePoolSize]);
-        watch_node_current_pool_allocated_ = 0;
-      }
-      node = &(watch_node_pools_.back()[watch_node_current_pool_allocated_++]);
-    }
-    node->range = range;
-    node->range_node_next = nullptr;
-    if (node_previous != nullptr) {
-      node_previous->range_node_next = node;
-    } else {
-      range->node_first = node;
-    }
-    node_previous = node;
-    node->bucket_node_previous = nullptr;
-    node->bucket_node_next = watch_buckets_[i];
-    if (watch_buckets_[i] != nullptr) {
-      watch_buckets_[i]->bucket_node_previous = node;
-    }
-    watch_buckets_[i] = node;
+  // Link the range to the tree node.
+  range->tree_node = tree_node;
+  range->tree_node_range_previous = nullptr;
+  range->tree_node_range_next = watch_tree_node_ranges_[tree_node];
+  if (range->tree_node_range_next != nullptr) {
+    range->tree_node_range_next->tree_node_range_previous = range;
+  }
+  watch_tree_node_ranges_[tree_node] = range;
+  for (uint32_t i = tree_node; i; i >>= 1) {
+    ++watch_tree_subtree_range_counts_[i];
   }
 
   return reinterpret_cast<WatchHandle>(range);
@@ -217,31 +179,68 @@ void SharedMemory::FireWatches(uint32_t page_first, uint32_t page_last,
   uint32_t address_first = page_first << page_size_log2_;
   uint32_t address_last =
       (page_last << page_size_log2_) + ((1 << page_size_log2_) - 1);
-  uint32_t bucket_first = address_first >> kWatchBucketSizeLog2;
-  uint32_t bucket_last = address_last >> kWatchBucketSizeLog2;
+  uint32_t leaf_first = address_first >> kWatchTreeLeafSizeLog2;
+  uint32_t leaf_last = address_last >> kWatchTreeLeafSizeLog2;
+  uint32_t leaf_page_count_log2 = kWatchTreeLeafSizeLog2 - page_size_log2_;
 
   auto global_lock = global_critical_region_.Acquire();
 
+  ++watch_invalidations_frame_;
+
   // Fire global watches.
   for (const auto global_watch : global_watches_) {
     global_watch->callback(global_lock, global_watch->callback_context,
                            address_first, address_last, invalidated_by_gpu);
   }
 
-  // Fire per-range watches.
-  for (uint32_t i = bucket_first; i <= bucket_last; ++i) {
-    WatchNode* node = watch_buckets_[i];
-    while (node != nullptr) {
-      WatchRange* range = node->range;
-      // Store the next node now since when the callback is triggered, the links
-      // will be broken.
-      node = node->bucket_node_next;
-      if (page_first <= range->page_last && page_last >= range->page_first) {
+  // Fire per-range watches, visiting the non-empty subtrees overlapping the
+  // range depth-first. There's at most one pending sibling per tree level.
+  uint32_t node_stack[kWatchTreeLeafCountLog2 + 1];
+  uint32_t node_stack_size = 0;
+  if (watch_tree_subtree_range_counts_[1]) {
+    node_stack[node_stack_size++] = 1;
+  }
+  while (node_stack_size) {
+    uint32_t node = node_stack[--node_stack_size];
+    uint32_t node_leaf_count_log2 =
+        kWatchTreeLeafCountLog2 - xe::log2_floor(node);
+    uint32_t node_leaf_first =
+        (node << node_leaf_count_log2) - kWatchTreeLeafCount;
+    // If the node is fully covered, all ranges in its subtree are too.
+    bool node_covered =
+        (node_leaf_first << leaf_page_count_log2) >= page_first &&
+        (((node_leaf_first + (uint32_t(1) << node_leaf_count_log2))
+          << leaf_page_count_log2) -
+         1) <= page_last;
+    WatchRange* range = watch_tree_node_ranges_[node];
+    while (range != nullptr) {
+      // Store the next range now since when the callback is triggered, the
+      // links will be broken.
+      WatchRange* range_next = range->tree_node_range_next;
+      if (node_covered ||
+          (page_first <= range->page_last && page_last >= range->page_first)) {
         range->callback(global_lock, range->callback_context,
                         range->callback_data, range->callback_argument,
                         invalidated_by_gpu);
         UnlinkWatchRange(range);
+        ++watch_ranges_fired_frame_;
       }
+      range = range_next;
+    }
+    if (!node_leaf_count_log2) {
+      continue;
+    }
+    uint32_t node_right_leaf_first =
+        node_leaf_first + (uint32_t(1) << (node_leaf_count_log2 - 1));
+    uint32_t node_left = node << 1;
+    uint32_t node_right = node_left | 1;
+    if (leaf_last >= node_right_leaf_first &&
+        watch_tree_subtree_range_counts_[node_right]) {
+      node_stack[node_stack_size++] = node_right;
+    }
+    if (leaf_first < node_right_leaf_first &&
+        watch_tree_subtree_range_counts_[node_left]) {
+      node_stack[node_stack_size++] = node_left;
     }
   }
 }
@@ -265,6 +264,18 @@ void SharedMemory::RangeWrittenByGpu(uint32_t start, uint32_t length,
   MakeRangeValid(start, length, true, is_resolve);
 }
 
+void SharedMemory::EndFrame() {
+  auto global_lock = global_critical_region_.Acquire();
+  COUNT_profile_set("gpu/shared_memory/watch_ranges",
+                    watch_tree_subtree_range_counts_[1]);
+  COUNT_profile_set("gpu/shared_memory/watch_invalidations_per_frame",
+                    watch_invalidations_frame_);
+  COUNT_profile_set("gpu/shared_memory/watch_ranges_fired_per_frame",
+                    watch_ranges_fired_frame_);
+  watch_invalidations_frame_ = 0;
+  watch_ranges_fired_frame_ = 0;
+}
+
 bool SharedMemory::AllocateSparseHostGpuMemoryRange(
     uint32_t offset_allocations, uint32_t length_allocations) {
   assert_always(
@@ -322,28 +333,37 @@ void SharedMemory::MakeRangeValid(uint32_t start, uint32_t length,
 }
 
 void SharedMemory::UnlinkWatchRange(WatchRange* range) {
-  uint32_t bucket =
-      range->page_first << page_size_log2_ >> kWatchBucketSizeLog2;
-  WatchNode* node = range->node_first;
-  while (node != nullptr) {
-    WatchNode* node_next = node->range_node_next;
-    if (node->bucket_node_previous != nullptr) {
-      node->bucket_node_previous->bucket_node_next = node->bucket_node_next;
-    } else {
-      watch_buckets_[bucket] = node->bucket_node_next;
-    }
-    if (node->bucket_node_next != nullptr) {
-      node->bucket_node_next->bucket_node_previous = node->bucket_node_previous;
-    }
-    node->next_free = watch_node_first_free_;
-    watch_node_first_free_ = node;
-    node = node_next;
-    ++bucket;
+  uint32_t tree_node = range->tree_node;
+  if (range->tree_node_range_previous != nullptr) {
+    range->tree_node_range_previous->tree_node_range_next =
+        range->tree_node_range_next;
+  } else {
+    watch_tree_node_ranges_[tree_node] = range->tree_node_range_next;
+  }
+  if (range->tree_node_range_next != nullptr) {
+    range->tree_node_range_next->tree_node_range_previous =
+        range->tree_node_range_previous;
+  }
+  for (uint32_t i = tree_node; i; i >>= 1) {
+    assert_not_zero(watch_tree_subtree_range_counts_[i]);
+    --watch_tree_subtree_range_counts_[i];
   }
   range->next_free = watch_range_first_free_;
   watch_range_first_free_ = range;
 }
 
+void SharedMemory::ReleaseWatchRangePools() {
+  // No watches now, so no references to the pools accessible by guest threads -
+  // safe not to enter the global critical region.
+  assert_zero(watch_tree_subtree_range_counts_[1]);
+  watch_range_first_free_ = nullptr;
+  watch_range_current_pool_allocated_ = 0;
+  for (WatchRange* pool : watch_range_pools_) {
+    delete[] pool;
+  }
+  watch_range_pools_.clear();
+}
+
 bool SharedMemory::RequestRange(uint32_t start, uint32_t length,
                                 bool* any_data_resolved_out) {
   if (!length) {
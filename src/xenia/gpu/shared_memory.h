@@ -95,6 +95,9 @@ class SharedMemory {
   // regions in those pages.
   void RangeWrittenByGpu(uint32_t start, uint32_t length, bool is_resolve);
 
+  // Call when a frame is closed to publish the watch statistics of the frame.
+  void EndFrame();
+
  protected:
   SharedMemory(Memory& memory);
   // Call in implementation-specific initialization.
@@ -214,7 +217,6 @@ class SharedMemory {
     void* callback_context;
   };
   std::vector<GlobalWatch*> global_watches_;
-  struct WatchNode;
   // Watched range placed by other GPU subsystems.
   struct WatchRange {
     union {
@@ -223,50 +225,50 @@ class SharedMemory {
         void* callback_context;
         void* callback_data;
         uint64_t callback_argument;
-        WatchNode* node_first;
+        // Links to other watched ranges in the same tree node.
+        WatchRange* tree_node_range_previous;
+        WatchRange* tree_node_range_next;
         uint32_t page_first;
         uint32_t page_last;
+        uint32_t tree_node;
       };
       WatchRange* next_free;
     };
   };
-  // Node for faster checking of watches when pages have been written to - all
-  // 512 MB are split into smaller equally sized buckets, and then ranges are
-  // linearly checked.
-  struct WatchNode {
-    union {
-      struct {
-        WatchRange* range;
-        // Link to another node of this watched range in the next bucket.
-        WatchNode* range_node_next;
-        // Links to nodes belonging to other watched ranges in the bucket.
-        WatchNode* bucket_node_previous;
-        WatchNode* bucket_node_next;
-      };
-      WatchNode* next_free;
-    };
-  };
-  static constexpr uint32_t kWatchBucketSizeLog2 = 22;
-  static constexpr uint32_t kWatchBucketCount =
-      1 << (kBufferSizeLog2 - kWatchBucketSizeLog2);
-  WatchNode* watch_buckets_[kWatchBucketCount] = {};
-  // Allocation from pools - taking new WatchRanges and WatchNodes from the free
-  // list, and if there are none, creating a pool if the current one is fully
-  // used, and linearly allocating from the current pool.
+  // Watched ranges are indexed by an implicit binary interval tree over the
+  // 512 MB, with equally sized leaves. Each range is linked to a single node -
+  // the lowest common ancestor of the leaves containing its first and last
+  // pages - so watching and unwatching don't depend on the size of the range,
+  // and firing only visits subtrees that contain ranges (according to the
+  // range counts) and overlap the invalidated range. Ranges in subtrees fully
+  // covered by the invalidated range are fired without overlap checks.
+  static constexpr uint32_t kWatchTreeLeafSizeLog2 = 16;
+  static constexpr uint32_t kWatchTreeLeafCountLog2 =
+      kBufferSizeLog2 - kWatchTreeLeafSizeLog2;
+  static constexpr uint32_t kWatchTreeLeafCount = 1 << kWatchTreeLeafCountLog2;
+  // Nodes are indexed like in a binary heap - 1 is the root, 2N and 2N + 1 are
+  // the children of N, and the leaves are [kWatchTreeLeafCount,
+  // kWatchTreeLeafCount * 2).
+  WatchRange* watch_tree_node_ranges_[kWatchTreeLeafCount * 2] = {};
+  // Number of ranges linked to each node and to its descendants.
+  uint32_t watch_tree_subtree_range_counts_[kWatchTreeLeafCount * 2] = {};
+  // Allocation from the pool - taking new WatchRanges from the free list, and
+  // if there are none, creating a pool if the current one is fully used, and
+  // linearly allocating from the current pool.
   static constexpr uint32_t kWatchRangePoolSize = 8192;
-  static constexpr uint32_t kWatchNodePoolSize = 8192;
   std::vector<WatchRange*> watch_range_pools_;
-  std::vector<WatchNode*> watch_node_pools_;
   uint32_t watch_range_current_pool_allocated_ = 0;
-  uint32_t watch_node_current_pool_allocated_ = 0;
   WatchRange* watch_range_first_free_ = nullptr;
-  WatchNode* watch_node_first_free_ = nullptr;
+  // Statistics since the last EndFrame.
+  uint32_t watch_invalidations_frame_ = 0;
+  uint32_t watch_ranges_fired_frame_ = 0;
+  // Releases the watch range pools. Call when there are no watched ranges.
+  void ReleaseWatchRangePools();
   // Triggers the watches (global and per-range), removing triggered range
   // watches.
   void FireWatches(uint32_t page_first, uint32_t page_last,
                    bool invalidated_by_gpu);
-  // Unlinks and frees the range and its nodes. Call this in the global critical
-  // region.
+  // Unlinks and frees the range. Call this in the global critical region.
   void UnlinkWatchRange(WatchRange* range);
 };
 
@@ -95,6 +95,12 @@ class TextureCache {
   void TextureFetchConstantWritten(uint32_t index) {
     texture_bindings_in_sync_ &= ~(UINT32_C(1) << index);
   }
+  void TextureFetchConstantsWritten(uint32_t first_index, uint32_t last_index) {
+    // Mask of the bits first_index...last_index.
+    uint32_t mask = uint32_t((uint64_t(1) << (last_index + 1)) - 1) &
+                    ~((UINT32_C(1) << first_index) - 1);
+    texture_bindings_in_sync_ &= ~mask;
+  }
 
   virtual void RequestTextures(uint32_t used_texture_mask);
 
@@ -18,6 +18,7 @@
 #include <utility>
 
 #include "xenia/base/assert.h"
+#include "xenia/base/bit_range.h"
 #include "xenia/base/byte_order.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
@@ -95,6 +96,12 @@ void VulkanCommandProcessor::ClearCaches() {
   cache_clear_requested_ = true;
 }
 
+void VulkanCommandProcessor::InitializeShaderStorage(
+    const std::filesystem::path& cache_root, uint32_t title_id, bool blocking) {
+  CommandProcessor::InitializeShaderStorage(cache_root, title_id, blocking);
+  pipeline_cache_->InitializeShaderStorage(cache_root, title_id, blocking);
+}
+
 void VulkanCommandProcessor::TracePlaybackWroteMemory(uint32_t base_ptr,
                                                       uint32_t length) {
   shared_memory_->MemoryInvalidationCallback(base_ptr, length, true);
@@ -1244,6 +1251,56 @@ void VulkanCommandProcessor::SparseBindBuffer(
   sparse_bind_wait_stage_mask_ |= wait_stage_mask;
 }
 
+void VulkanCommandProcessor::OnRegisterRangeWritten(uint32_t first_index,
+                                                    uint32_t count) {
+  uint32_t end_index = first_index + count;
+  uint32_t float_first =
+      std::max(first_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_000_X));
+  uint32_t float_end =
+      std::min(end_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_511_W) + 1);
+  if (float_first < float_end && frame_open_) {
+    // Bitmap of the vertex (0...255) and the pixel (256...511) float constants
+    // touched by the range, to be tested against the ones used by the current
+    // shaders.
+    uint64_t float_constants_written[8] = {};
+    uint32_t float_constant_first =
+        (float_first - XE_GPU_REG_SHADER_CONSTANT_000_X) >> 2;
+    uint32_t float_constant_last =
+        (float_end - 1 - XE_GPU_REG_SHADER_CONSTANT_000_X) >> 2;
+    xe::bit_range::SetRange(float_constants_written, float_constant_first,
+                            float_constant_last + 1 - float_constant_first);
+    for (uint32_t i = 0; i < 4; ++i) {
+      if (current_float_constant_map_vertex_[i] & float_constants_written[i]) {
+        current_constant_buffers_up_to_date_ &= ~(
+            UINT32_C(1) << SpirvShaderTranslator::kConstantBufferFloatVertex);
+      }
+      if (current_float_constant_map_pixel_[i] &
+          float_constants_written[4 + i]) {
+        current_constant_buffers_up_to_date_ &= ~(
+            UINT32_C(1) << SpirvShaderTranslator::kConstantBufferFloatPixel);
+      }
+    }
+  }
+  if (first_index <= XE_GPU_REG_SHADER_CONSTANT_LOOP_31 &&
+      end_index > XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031) {
+    current_constant_buffers_up_to_date_ &=
+        ~(UINT32_C(1) << SpirvShaderTranslator::kConstantBufferBoolLoop);
+  }
+  uint32_t fetch_first =
+      std::max(first_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0));
+  uint32_t fetch_end =
+      std::min(end_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_FETCH_31_5) + 1);
+  if (fetch_first < fetch_end) {
+    current_constant_buffers_up_to_date_ &=
+        ~(UINT32_C(1) << SpirvShaderTranslator::kConstantBufferFetch);
+    if (texture_cache_) {
+      texture_cache_->TextureFetchConstantsWritten(
+          (fetch_first - XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0) / 6,
+          (fetch_end - 1 - XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0) / 6);
+    }
+  }
+}
+
 void VulkanCommandProcessor::OnGammaRamp256EntryTableValueWritten() {
   gamma_ramp_256_entry_table_current_frame_ = UINT32_MAX;
 }
@@ -2961,11 +3018,15 @@ bool VulkanCommandProcessor::EndSubmission(bool is_swap) {
 
   if (is_closing_frame) {
     primitive_processor_->EndFrame();
+
+    shared_memory_->EndFrame();
   }
 
   if (submission_open_) {
     assert_false(scratch_buffer_used_);
 
+    pipeline_cache_->EndSubmission();
+
     EndRenderPass();
 
     render_target_cache_->EndSubmission();
@@ -3094,6 +3155,7 @@ bool VulkanCommandProcessor::EndSubmission(bool is_swap) {
       return false;
     }
     uint64_t submission_current = GetCurrentSubmission();
+    profiling::TraceRecorder::Instant("gpu", "Submission", submission_current);
     current_submission_wait_stage_masks_.clear();
     for (VkSemaphore semaphore : current_submission_wait_semaphores_) {
       submissions_in_flight_semaphores_.emplace_back(submission_current,
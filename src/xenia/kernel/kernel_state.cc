@@ -50,6 +50,7 @@ KernelState::KernelState(Emulator* emulator)
 
   app_manager_ = std::make_unique<xam::AppManager>();
   user_profile_ = std::make_unique<xam::UserProfile>();
+  thread_affinity_policy_ = std::make_unique<ThreadAffinityPolicy>();
 
   auto content_root = emulator_->content_root();
   if (!content_root.empty()) {
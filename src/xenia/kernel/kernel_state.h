@@ -21,6 +21,7 @@
 #include "xenia/base/cvar.h"
 #include "xenia/base/mutex.h"
 #include "xenia/cpu/export_resolver.h"
+#include "xenia/kernel/thread_affinity_policy.h"
 #include "xenia/kernel/util/native_list.h"
 #include "xenia/kernel/util/object_table.h"
 #include "xenia/kernel/util/xdbf_utils.h"
@@ -108,6 +109,9 @@ class KernelState {
     return content_manager_.get();
   }
   xam::UserProfile* user_profile() const { return user_profile_.get(); }
+  ThreadAffinityPolicy* thread_affinity_policy() const {
+    return thread_affinity_policy_.get();
+  }
 
   // Access must be guarded by the global critical region.
   util::ObjectTable* object_table() { return &object_table_; }
@@ -210,6 +214,7 @@ class KernelState {
   std::unique_ptr<xam::AppManager> app_manager_;
   std::unique_ptr<xam::ContentManager> content_manager_;
   std::unique_ptr<xam::UserProfile> user_profile_;
+  std::unique_ptr<ThreadAffinityPolicy> thread_affinity_policy_;
 
   xe::global_critical_region global_critical_region_;
 
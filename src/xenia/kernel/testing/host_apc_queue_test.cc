@@ -0,0 +1,117 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/kernel/util/host_apc_queue.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe {
+namespace kernel {
+namespace test {
+
+using util::HostApcQueue;
+
+static HostApcQueue::Apc* MakeApc(uint32_t context, uint32_t arg1) {
+  auto apc = new HostApcQueue::Apc();
+  apc->normal_routine = 0x82000000;
+  apc->normal_context = context;
+  apc->arg1 = arg1;
+  return apc;
+}
+
+// Pops an APC and returns its arg1, or UINT32_MAX if the queue is empty.
+static uint32_t PopArg1(HostApcQueue& queue) {
+  HostApcQueue::Apc* apc = queue.Pop();
+  if (!apc) {
+    return UINT32_MAX;
+  }
+  uint32_t arg1 = apc->arg1;
+  delete apc;
+  return arg1;
+}
+
+TEST_CASE("host_apc_queue_fifo", "[host_apc_queue]") {
+  HostApcQueue queue;
+  REQUIRE_FALSE(queue.HasPending());
+  REQUIRE(queue.Pop() == nullptr);
+
+  queue.Push(MakeApc(0, 1));
+  queue.Push(MakeApc(0, 2));
+  queue.Push(MakeApc(0, 3));
+  REQUIRE(queue.HasPending());
+  REQUIRE(PopArg1(queue) == 1);
+  // Pushed while the older ones are being delivered.
+  queue.Push(MakeApc(0, 4));
+  queue.Push(MakeApc(0, 5));
+
+  // Listed in the delivery order without being removed.
+  std::vector<uint32_t> listed;
+  queue.ForEach(
+      [&listed](const HostApcQueue::Apc& apc) { listed.push_back(apc.arg1); });
+  const std::vector<uint32_t> expected_listed = {2, 3, 4, 5};
+  REQUIRE(listed == expected_listed);
+
+  for (uint32_t i = 2; i <= 5; ++i) {
+    REQUIRE(PopArg1(queue) == i);
+  }
+  REQUIRE_FALSE(queue.HasPending());
+  REQUIRE(queue.Pop() == nullptr);
+
+  // Deleted with the queue.
+  queue.Push(MakeApc(0, 6));
+}
+
+TEST_CASE("host_apc_queue_concurrent_fifo", "[host_apc_queue]") {
+  static constexpr uint32_t kProducerCount = 4;
+  static constexpr uint32_t kApcsPerProducer = 20000;
+  HostApcQueue queue;
+  std::atomic<uint32_t> producers_done = {0};
+  std::vector<std::thread> producers;
+  for (uint32_t i = 0; i < kProducerCount; ++i) {
+    producers.emplace_back([&queue, &producers_done, i]() {
+      for (uint32_t j = 0; j < kApcsPerProducer; ++j) {
+        queue.Push(MakeApc(i, j));
+      }
+      producers_done.fetch_add(1, std::memory_order_release);
+    });
+  }
+
+  // The APCs of every producer are delivered in the order it queued them.
+  uint32_t next_arg1[kProducerCount] = {};
+  uint32_t popped_count = 0;
+  bool in_order = true;
+  while (true) {
+    bool all_produced =
+        producers_done.load(std::memory_order_acquire) == kProducerCount;
+    HostApcQueue::Apc* apc = queue.Pop();
+    if (!apc) {
+      if (all_produced) {
+        break;
+      }
+      std::this_thread::yield();
+      continue;
+    }
+    in_order &= apc->arg1 == next_arg1[apc->normal_context]++;
+    ++popped_count;
+    delete apc;
+  }
+  for (std::thread& producer : producers) {
+    producer.join();
+  }
+  REQUIRE(in_order);
+  REQUIRE(popped_count == kProducerCount * kApcsPerProducer);
+}
+
+}  // namespace test
+}  // namespace kernel
+}  // namespace xe
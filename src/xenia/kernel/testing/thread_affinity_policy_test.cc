@@ -0,0 +1,146 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/kernel/thread_affinity_policy.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe {
+namespace kernel {
+namespace test {
+
+using threading::ProcessorTopology;
+using Mode = ThreadAffinityPolicy::Mode;
+
+// Logical processor i + core_count * thread is the SMT thread of core i, like
+// Linux numbers them.
+static ProcessorTopology MakeTopology(uint32_t core_count,
+                                      uint32_t threads_per_core,
+                                      uint32_t cores_per_cache_domain = 64) {
+  ProcessorTopology topology;
+  for (uint32_t thread = 0; thread < threads_per_core; ++thread) {
+    for (uint32_t core = 0; core < core_count; ++core) {
+      topology.logical_processors.push_back(
+          {core + core_count * thread, core, core / cores_per_cache_domain, 0});
+    }
+  }
+  topology.Normalize();
+  return topology;
+}
+
+static bool IsEmpty(const ThreadAffinityPolicy::Masks& masks) {
+  for (uint64_t mask : masks.guest_hardware_threads) {
+    if (mask) {
+      return false;
+    }
+  }
+  return !masks.guest_all && !masks.gpu_command_processor &&
+         !masks.audio_decoder;
+}
+
+TEST_CASE("thread_affinity_smt", "[thread_affinity]") {
+  ProcessorTopology topology = MakeTopology(8, 2);
+
+  // Guest cores on SMT sibling pairs, then one core for the GPU command
+  // processor, and the rest for audio.
+  auto masks = ThreadAffinityPolicy::ComputeMasks(topology, Mode::kCore);
+  REQUIRE(masks.guest_hardware_threads[0] == 0x0101);
+  REQUIRE(masks.guest_hardware_threads[1] == 0x0101);
+  REQUIRE(masks.guest_hardware_threads[2] == 0x0202);
+  REQUIRE(masks.guest_hardware_threads[3] == 0x0202);
+  REQUIRE(masks.guest_hardware_threads[4] == 0x0404);
+  REQUIRE(masks.guest_hardware_threads[5] == 0x0404);
+  REQUIRE(masks.guest_all == 0x0707);
+  REQUIRE(masks.gpu_command_processor == 0x0808);
+  REQUIRE(masks.audio_decoder == 0xF0F0);
+
+  masks = ThreadAffinityPolicy::ComputeMasks(topology, Mode::kStrict);
+  REQUIRE(masks.guest_hardware_threads[0] == 0x0001);
+  REQUIRE(masks.guest_hardware_threads[1] == 0x0100);
+  REQUIRE(masks.guest_hardware_threads[2] == 0x0002);
+  REQUIRE(masks.guest_hardware_threads[3] == 0x0200);
+  REQUIRE(masks.guest_hardware_threads[4] == 0x0004);
+  REQUIRE(masks.guest_hardware_threads[5] == 0x0400);
+  REQUIRE(masks.guest_all == 0x0707);
+  REQUIRE(masks.gpu_command_processor == 0x0808);
+
+  masks = ThreadAffinityPolicy::ComputeMasks(topology, Mode::kCache);
+  for (uint64_t mask : masks.guest_hardware_threads) {
+    REQUIRE(mask == 0xFFFF);
+  }
+  REQUIRE(masks.gpu_command_processor == 0xFFFF);
+
+  REQUIRE(IsEmpty(ThreadAffinityPolicy::ComputeMasks(topology, Mode::kOs)));
+}
+
+TEST_CASE("thread_affinity_no_smt", "[thread_affinity]") {
+  ProcessorTopology topology = MakeTopology(8, 1);
+
+  // A host core per guest hardware thread.
+  auto masks = ThreadAffinityPolicy::ComputeMasks(topology, Mode::kCore);
+  for (uint32_t i = 0; i < ThreadAffinityPolicy::kGuestHardwareThreadCount;
+       ++i) {
+    REQUIRE(masks.guest_hardware_threads[i] == uint64_t(1) << i);
+  }
+  REQUIRE(masks.guest_all == 0x3F);
+  REQUIRE(masks.gpu_command_processor == 0x40);
+  REQUIRE(masks.audio_decoder == 0x80);
+}
+
+TEST_CASE("thread_affinity_few_cores", "[thread_affinity]") {
+  // Fewer host cores than guest hardware threads - they're shared, and the GPU
+  // command processor runs among the guest threads.
+  ProcessorTopology topology = MakeTopology(2, 1);
+  auto masks = ThreadAffinityPolicy::ComputeMasks(topology, Mode::kCore);
+  for (uint64_t mask : masks.guest_hardware_threads) {
+    REQUIRE(mask);
+    REQUIRE((mask & ~uint64_t(0b11)) == 0);
+  }
+  REQUIRE(masks.guest_all == 0b11);
+  REQUIRE(masks.gpu_command_processor == 0b11);
+  REQUIRE(masks.audio_decoder == 0);
+
+  // A single SMT core.
+  topology = MakeTopology(1, 2);
+  masks = ThreadAffinityPolicy::ComputeMasks(topology, Mode::kStrict);
+  REQUIRE(masks.guest_hardware_threads[0] == 0b01);
+  REQUIRE(masks.guest_hardware_threads[1] == 0b10);
+  REQUIRE(masks.guest_all == 0b11);
+  REQUIRE(masks.gpu_command_processor == 0b11);
+  REQUIRE(masks.audio_decoder == 0);
+}
+
+TEST_CASE("thread_affinity_cache_domains", "[thread_affinity]") {
+  // Two CCXs of 4 cores, with the first one missing a core, so the guest goes
+  // to the second one.
+  ProcessorTopology topology = MakeTopology(8, 1, 4);
+  topology.logical_processors.erase(topology.logical_processors.begin());
+  topology.Normalize();
+  auto masks = ThreadAffinityPolicy::ComputeMasks(topology, Mode::kCache);
+  REQUIRE(masks.guest_all == 0xF0);
+  masks = ThreadAffinityPolicy::ComputeMasks(topology, Mode::kCore);
+  REQUIRE(masks.guest_all == (0xF0 | 0b110));
+}
+
+TEST_CASE("thread_affinity_invalid_topology", "[thread_affinity]") {
+  ProcessorTopology topology;
+  for (Mode mode : {Mode::kCache, Mode::kCore, Mode::kStrict}) {
+    REQUIRE(IsEmpty(ThreadAffinityPolicy::ComputeMasks(topology, mode)));
+  }
+
+  // Not normalized - the counts don't cover the cores and cache domains.
+  topology.logical_processors = {{0, 5, 3, 0}, {1, 6, 3, 0}};
+  for (Mode mode : {Mode::kCache, Mode::kCore, Mode::kStrict}) {
+    REQUIRE(IsEmpty(ThreadAffinityPolicy::ComputeMasks(topology, mode)));
+  }
+}
+
+}  // namespace test
+}  // namespace kernel
+}  // namespace xe
@@ -0,0 +1,228 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/kernel/thread_affinity_policy.h"
+
+#include <algorithm>
+#include <climits>
+
+#include "xenia/base/assert.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/profiling.h"
+
+DEFINE_string(
+    thread_affinity_policy, "os",
+    "How emulator threads are placed on host processors.\n"
+    " os: Leave scheduling to the host OS.\n"
+    " cache: Keep the guest, GPU command processor and XMA decoder threads in "
+    "the largest last-level cache domain (CCX).\n"
+    " core: Assign a host core to every guest core, with the guest hardware "
+    "threads on its SMT siblings, and separate cores to the GPU command "
+    "processor and the XMA decoders where available.\n"
+    " strict: Like core, but pin every guest hardware thread to one host "
+    "logical processor.\n"
+    "With ignore_thread_affinities, guest threads may run on the processors "
+    "of any guest hardware thread.",
+    "Kernel");
+
+namespace xe {
+namespace kernel {
+
+namespace {
+thread_local uint32_t last_processor_ = UINT32_MAX;
+}  // namespace
+
+ThreadAffinityPolicy::ThreadAffinityPolicy() {
+  if (cvars::thread_affinity_policy == "cache") {
+    mode_ = Mode::kCache;
+  } else if (cvars::thread_affinity_policy == "core") {
+    mode_ = Mode::kCore;
+  } else if (cvars::thread_affinity_policy == "strict") {
+    mode_ = Mode::kStrict;
+  } else {
+    if (cvars::thread_affinity_policy != "os") {
+      XELOGW("Unknown thread_affinity_policy '{}', using 'os'",
+             cvars::thread_affinity_policy);
+    }
+    mode_ = Mode::kOs;
+  }
+
+  const threading::ProcessorTopology& topology =
+      threading::ProcessorTopology::Get();
+  processor_cache_domains_.fill(UINT32_MAX);
+  for (const auto& logical_processor : topology.logical_processors) {
+    processor_cache_domains_[logical_processor.index] =
+        logical_processor.cache_domain;
+  }
+
+  masks_ = ComputeMasks(topology, mode_);
+  if (mode_ != Mode::kOs) {
+    XELOGI(
+        "Thread affinity: guest hardware threads {:X} {:X} {:X} {:X} {:X} "
+        "{:X}, GPU command processor {:X}, XMA decoders {:X}",
+        masks_.guest_hardware_threads[0], masks_.guest_hardware_threads[1],
+        masks_.guest_hardware_threads[2], masks_.guest_hardware_threads[3],
+        masks_.guest_hardware_threads[4], masks_.guest_hardware_threads[5],
+        masks_.gpu_command_processor, masks_.audio_decoder);
+  }
+}
+
+ThreadAffinityPolicy::~ThreadAffinityPolicy() {
+  XELOGI("Thread migrations: {} between host processors, {} between cache "
+         "domains",
+         migration_count(), cache_domain_migration_count());
+}
+
+ThreadAffinityPolicy::Masks ThreadAffinityPolicy::ComputeMasks(
+    const threading::ProcessorTopology& topology, Mode mode) {
+  Masks masks;
+  if (mode == Mode::kOs || topology.logical_processors.empty()) {
+    return masks;
+  }
+  // Let the OS place the threads if the topology is not normalized.
+  for (const auto& logical_processor : topology.logical_processors) {
+    if (logical_processor.index >= 64 ||
+        logical_processor.core >= topology.core_count ||
+        logical_processor.cache_domain >= topology.cache_domain_count) {
+      return masks;
+    }
+  }
+
+  // The processors are sorted by cache domain and core, so the cores of a
+  // domain are consecutive. Place the guest in the domain with the most cores.
+  std::vector<uint32_t> domain_core_counts(topology.cache_domain_count);
+  std::vector<uint32_t> domain_numa_nodes(topology.cache_domain_count);
+  std::vector<std::vector<uint32_t>> core_processors(topology.core_count);
+  std::vector<uint32_t> core_domains(topology.core_count);
+  for (const auto& logical_processor : topology.logical_processors) {
+    auto& processors = core_processors[logical_processor.core];
+    if (processors.empty()) {
+      ++domain_core_counts[logical_processor.cache_domain];
+    }
+    processors.push_back(logical_processor.index);
+    core_domains[logical_processor.core] = logical_processor.cache_domain;
+    domain_numa_nodes[logical_processor.cache_domain] =
+        logical_processor.numa_node;
+  }
+  uint32_t home_domain = uint32_t(
+      std::max_element(domain_core_counts.begin(), domain_core_counts.end()) -
+      domain_core_counts.begin());
+  uint64_t home_domain_mask = topology.cache_domain_mask(home_domain);
+
+  if (mode == Mode::kCache) {
+    masks.guest_hardware_threads.fill(home_domain_mask);
+    masks.guest_all = home_domain_mask;
+    masks.gpu_command_processor = home_domain_mask;
+    masks.audio_decoder = home_domain_mask;
+    return masks;
+  }
+
+  // Hand out the cores of the home domain first, then of the rest of its NUMA
+  // node, then the others.
+  std::vector<uint32_t> cores(topology.core_count);
+  for (uint32_t i = 0; i < topology.core_count; ++i) {
+    cores[i] = i;
+  }
+  auto core_distance = [&](uint32_t core) {
+    uint32_t domain = core_domains[core];
+    if (domain == home_domain) {
+      return 0;
+    }
+    return domain_numa_nodes[domain] == domain_numa_nodes[home_domain] ? 1 : 2;
+  };
+  std::stable_sort(cores.begin(), cores.end(), [&](uint32_t a, uint32_t b) {
+    return core_distance(a) < core_distance(b);
+  });
+
+  size_t next_core = 0;
+  bool cores_exhausted = false;
+  auto take_core = [&]() {
+    uint32_t core = cores[next_core];
+    if (++next_core >= cores.size()) {
+      // Not enough host cores - share them.
+      next_core = 0;
+      cores_exhausted = true;
+    }
+    return core;
+  };
+  auto processor_mask = [](uint32_t index) { return uint64_t(1) << index; };
+  for (uint32_t guest_core = 0; guest_core < kGuestHardwareThreadCount / 2;
+       ++guest_core) {
+    uint32_t core = take_core();
+    const auto& processors = core_processors[core];
+    uint64_t& mask_0 = masks.guest_hardware_threads[guest_core * 2];
+    uint64_t& mask_1 = masks.guest_hardware_threads[guest_core * 2 + 1];
+    if (processors.size() >= 2) {
+      // SMT siblings, like the hardware threads of a Xenon core.
+      if (mode == Mode::kStrict) {
+        mask_0 = processor_mask(processors[0]);
+        mask_1 = processor_mask(processors[1]);
+      } else {
+        mask_0 = mask_1 = topology.core_mask(core);
+      }
+    } else {
+      mask_0 = processor_mask(processors[0]);
+      mask_1 = processor_mask(core_processors[take_core()][0]);
+    }
+    masks.guest_all |= mask_0 | mask_1;
+  }
+
+  if (!cores_exhausted) {
+    masks.gpu_command_processor = topology.core_mask(take_core());
+  } else {
+    masks.gpu_command_processor = masks.guest_all;
+  }
+  // Audio decoding is latency-tolerant - give it all the remaining cores, or
+  // let the OS place it if none are left.
+  while (!cores_exhausted) {
+    masks.audio_decoder |= topology.core_mask(take_core());
+  }
+  return masks;
+}
+
+uint64_t ThreadAffinityPolicy::GetAffinityMask(
+    ThreadAffinityRole role, uint8_t cpu_index,
+    bool follow_guest_affinity) const {
+  switch (role) {
+    case ThreadAffinityRole::kGpuCommandProcessor:
+      return masks_.gpu_command_processor;
+    case ThreadAffinityRole::kAudioDecoder:
+      return masks_.audio_decoder;
+    default:
+      assert_true(cpu_index < kGuestHardwareThreadCount);
+      return follow_guest_affinity ? masks_.guest_hardware_threads[cpu_index]
+                                   : masks_.guest_all;
+  }
+}
+
+void ThreadAffinityPolicy::SampleCurrentProcessor() {
+  uint32_t processor = threading::current_processor_number();
+  uint32_t last_processor = last_processor_;
+  if (processor == last_processor || processor >= 64) {
+    return;
+  }
+  last_processor_ = processor;
+  if (last_processor == UINT32_MAX) {
+    return;
+  }
+  COUNT_profile_set("kernel/thread_migrations",
+                    migration_count_.fetch_add(1, std::memory_order_relaxed) +
+                        1);
+  if (processor_cache_domains_[processor] !=
+      processor_cache_domains_[last_processor]) {
+    COUNT_profile_set("kernel/thread_cache_domain_migrations",
+                      cache_domain_migration_count_.fetch_add(
+                          1, std::memory_order_relaxed) +
+                          1);
+  }
+}
+
+}  // namespace kernel
+}  // namespace xe
@@ -0,0 +1,108 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_KERNEL_THREAD_AFFINITY_POLICY_H_
+#define XENIA_KERNEL_THREAD_AFFINITY_POLICY_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "xenia/base/processor_topology.h"
+
+namespace xe {
+namespace kernel {
+
+// What an XThread is used for, determining the host processors it may run on.
+enum class ThreadAffinityRole {
+  // Placed according to the guest hardware thread it's running on.
+  kGuestHardwareThread,
+  kGpuCommandProcessor,
+  kAudioDecoder,
+};
+
+// Maps the 6 guest hardware threads (3 cores with 2 threads each) and the
+// host threads working closely with them to sets of host logical processors,
+// following the host topology, so the partitioning of work done by the game
+// between the hardware threads is preserved, and threads that wake each other
+// up share caches. Also counts how often the threads move between host
+// processors, and between last-level cache domains, which is expensive on
+// hosts with multiple CCXs.
+class ThreadAffinityPolicy {
+ public:
+  static constexpr uint32_t kGuestHardwareThreadCount = 6;
+
+  enum class Mode {
+    // The host OS schedules all threads.
+    kOs,
+    // All threads are kept in one last-level cache domain.
+    kCache,
+    // Every guest core is assigned a host core, with the guest hardware
+    // threads mapped to its SMT siblings, and the GPU command processor and
+    // the XMA decoders get their own cores where possible.
+    kCore,
+    // Like kCore, but every guest hardware thread is pinned to one host
+    // logical processor.
+    kStrict,
+  };
+
+  struct Masks {
+    // 0 where the thread is not pinned.
+    std::array<uint64_t, kGuestHardwareThreadCount> guest_hardware_threads{};
+    uint64_t guest_all = 0;
+    uint64_t gpu_command_processor = 0;
+    uint64_t audio_decoder = 0;
+  };
+
+  // Creates the policy for the host from the cvars.
+  ThreadAffinityPolicy();
+  ~ThreadAffinityPolicy();
+
+  // Computes where threads should be placed for the given normalized host
+  // topology. All masks are 0, leaving the placement to the OS, if the
+  // topology is empty or not normalized.
+  static Masks ComputeMasks(const threading::ProcessorTopology& topology,
+                            Mode mode);
+
+  Mode mode() const { return mode_; }
+  const Masks& masks() const { return masks_; }
+
+  // Returns the affinity mask for a thread with the role currently running on
+  // the guest hardware thread, or 0 if the thread shouldn't be pinned. With
+  // follow_guest_affinity false, guest threads may run on the processors of
+  // any guest hardware thread.
+  uint64_t GetAffinityMask(ThreadAffinityRole role, uint8_t cpu_index,
+                           bool follow_guest_affinity) const;
+
+  // Checks whether the calling thread has been moved to a different host
+  // processor since the last call on it, updating the migration counters.
+  // Cheap enough to be called whenever a thread wakes up.
+  void SampleCurrentProcessor();
+
+  uint64_t migration_count() const {
+    return migration_count_.load(std::memory_order_relaxed);
+  }
+  uint64_t cache_domain_migration_count() const {
+    return cache_domain_migration_count_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  Mode mode_;
+  Masks masks_;
+  // Host logical processor index to its last-level cache domain.
+  std::array<uint32_t, 64> processor_cache_domains_;
+  std::atomic<uint64_t> migration_count_{0};
+  std::atomic<uint64_t> cache_domain_migration_count_{0};
+};
+
+}  // namespace kernel
+}  // namespace xe
+
+#endif  // XENIA_KERNEL_THREAD_AFFINITY_POLICY_H_
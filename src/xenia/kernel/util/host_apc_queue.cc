@@ -0,0 +1,52 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/kernel/util/host_apc_queue.h"
+
+namespace xe {
+namespace kernel {
+namespace util {
+
+void HostApcQueue::Push(Apc* apc) {
+  Apc* head = incoming_.load(std::memory_order_relaxed);
+  do {
+    apc->next = head;
+  } while (!incoming_.compare_exchange_weak(
+      head, apc, std::memory_order_release, std::memory_order_relaxed));
+}
+
+HostApcQueue::Apc* HostApcQueue::Pop() {
+  Apc* apc = outgoing_.load(std::memory_order_relaxed);
+  if (!apc) {
+    // Reverse the pushed APCs to get the order they were queued in.
+    Apc* incoming = incoming_.exchange(nullptr, std::memory_order_acquire);
+    while (incoming) {
+      Apc* next = incoming->next;
+      incoming->next = apc;
+      apc = incoming;
+      incoming = next;
+    }
+    if (!apc) {
+      return nullptr;
+    }
+  }
+  outgoing_.store(apc->next, std::memory_order_relaxed);
+  apc->next = nullptr;
+  return apc;
+}
+
+void HostApcQueue::Clear() {
+  while (Apc* apc = Pop()) {
+    delete apc;
+  }
+}
+
+}  // namespace util
+}  // namespace kernel
+}  // namespace xe
@@ -0,0 +1,84 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2022 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_KERNEL_UTIL_HOST_APC_QUEUE_H_
+#define XENIA_KERNEL_UTIL_HOST_APC_QUEUE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace xe {
+namespace kernel {
+namespace util {
+
+// FIFO queue of the user mode APCs queued for a thread by the kernel, which
+// have no kernel and rundown routines, so they don't need guest XAPC objects.
+// Pushing is lock-free and can be done from any thread, while everything else
+// must be done by one consumer at a time (under the APC lock of the thread).
+class HostApcQueue {
+ public:
+  struct Apc {
+    Apc* next;
+    uint32_t normal_routine;
+    uint32_t normal_context;
+    uint32_t arg1;
+    uint32_t arg2;
+    // Host ticks.
+    uint64_t enqueue_time;
+  };
+
+  HostApcQueue() = default;
+  HostApcQueue(const HostApcQueue&) = delete;
+  HostApcQueue& operator=(const HostApcQueue&) = delete;
+  ~HostApcQueue() { Clear(); }
+
+  // Takes the ownership of the APC.
+  void Push(Apc* apc);
+  // Can be called from any thread, but may be outdated by the time it returns.
+  bool HasPending() const {
+    return incoming_.load(std::memory_order_relaxed) ||
+           outgoing_.load(std::memory_order_relaxed);
+  }
+  // Removes the oldest APC, returning its ownership, or returns nullptr.
+  Apc* Pop();
+  // Calls the function for every pending APC from the oldest, without
+  // removing them.
+  template <typename F>
+  void ForEach(F&& function) const {
+    for (const Apc* apc = outgoing_.load(std::memory_order_relaxed); apc;
+         apc = apc->next) {
+      function(*apc);
+    }
+    // Pushed ones are linked from the newest.
+    std::vector<const Apc*> incoming;
+    for (const Apc* apc = incoming_.load(std::memory_order_acquire); apc;
+         apc = apc->next) {
+      incoming.push_back(apc);
+    }
+    for (auto it = incoming.crbegin(); it != incoming.crend(); ++it) {
+      function(**it);
+    }
+  }
+  // Deletes all pending APCs.
+  void Clear();
+
+ private:
+  // Pushed APCs, linked from the newest.
+  std::atomic<Apc*> incoming_ = {nullptr};
+  // APCs taken from incoming_ by the consumer, linked from the oldest. Atomic
+  // only for HasPending.
+  std::atomic<Apc*> outgoing_ = {nullptr};
+};
+
+}  // namespace util
+}  // namespace kernel
+}  // namespace xe
+
+#endif  // XENIA_KERNEL_UTIL_HOST_APC_QUEUE_H_
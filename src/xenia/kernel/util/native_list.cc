@@ -19,12 +19,34 @@ NativeList::NativeList(Memory* memory)
     : memory_(memory), head_(kInvalidPointer) {}
 
 void NativeList::Insert(uint32_t ptr) {
-  xe::store_and_swap<uint32_t>(memory_->TranslateVirtual(ptr + 0), head_);
-  xe::store_and_swap<uint32_t>(memory_->TranslateVirtual(ptr + 4), 0);
-  if (head_) {
-    xe::store_and_swap<uint32_t>(memory_->TranslateVirtual(head_ + 4), ptr);
+  // Appended to the tail, like InsertTailList, so entries are shifted in the
+  // order they were inserted in.
+  xe::store_and_swap<uint32_t>(memory_->TranslateVirtual(ptr + 0),
+                               kInvalidPointer);
+  if (!HasPending()) {
+    xe::store_and_swap<uint32_t>(memory_->TranslateVirtual(ptr + 4), 0);
+    head_ = ptr;
+    tail_ = ptr;
+    return;
+  }
+  if (!IsEntry(tail_)) {
+    tail_ = FindTail();
+  }
+  xe::store_and_swap<uint32_t>(memory_->TranslateVirtual(tail_ + 0), ptr);
+  xe::store_and_swap<uint32_t>(memory_->TranslateVirtual(ptr + 4), tail_);
+  tail_ = ptr;
+}
+
+uint32_t NativeList::FindTail() const {
+  uint32_t tail = head_;
+  while (true) {
+    uint32_t flink =
+        xe::load_and_swap<uint32_t>(memory_->TranslateVirtual(tail + 0));
+    if (!IsEntry(flink)) {
+      return tail;
+    }
+    tail = flink;
   }
-  head_ = ptr;
 }
 
 bool NativeList::IsQueued(uint32_t ptr) {
@@ -40,16 +62,20 @@ void NativeList::Remove(uint32_t ptr) {
       xe::load_and_swap<uint32_t>(memory_->TranslateVirtual(ptr + 0));
   uint32_t blink =
       xe::load_and_swap<uint32_t>(memory_->TranslateVirtual(ptr + 4));
+  if (ptr == tail_) {
+    // The previous entry, or none if it was the only one.
+    tail_ = ptr == head_ ? 0 : blink;
+  }
   if (ptr == head_) {
     head_ = flink;
-    if (flink) {
+    if (IsEntry(flink)) {
       xe::store_and_swap<uint32_t>(memory_->TranslateVirtual(flink + 4), 0);
     }
   } else {
     if (blink) {
       xe::store_and_swap<uint32_t>(memory_->TranslateVirtual(blink + 0), flink);
     }
-    if (flink) {
+    if (IsEntry(flink)) {
       xe::store_and_swap<uint32_t>(memory_->TranslateVirtual(flink + 4), blink);
     }
   }
@@ -58,7 +84,7 @@ void NativeList::Remove(uint32_t ptr) {
 }
 
 uint32_t NativeList::Shift() {
-  if (!head_) {
+  if (!HasPending()) {
     return 0;
   }
 
@@ -67,7 +93,7 @@ uint32_t NativeList::Shift() {
   return ptr;
 }
 
-bool NativeList::HasPending() { return head_ != kInvalidPointer; }
+bool NativeList::HasPending() { return IsEntry(head_); }
 
 }  // namespace util
 }  // namespace kernel
@@ -39,16 +39,27 @@ class NativeList {
   bool HasPending();
 
   uint32_t head() const { return head_; }
-  void set_head(uint32_t head) { head_ = head; }
+  void set_head(uint32_t head) {
+    head_ = head;
+    tail_ = 0;
+  }
 
   void set_memory(Memory* mem) { memory_ = mem; }
 
  private:
   const uint32_t kInvalidPointer = 0xE0FE0FFF;
 
+  // The end of the list is marked with kInvalidPointer, a null link is treated
+  // the same way.
+  bool IsEntry(uint32_t ptr) const { return ptr && ptr != kInvalidPointer; }
+  uint32_t FindTail() const;
+
  private:
   Memory* memory_ = nullptr;
   uint32_t head_;
+  // Last entry, so inserting doesn't walk the list, or 0 if not known yet
+  // after set_head.
+  uint32_t tail_ = 0;
 };
 
 }  // namespace util
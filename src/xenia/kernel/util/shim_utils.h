@@ -574,6 +574,12 @@ using xe::cpu::ExportTag;
                       xe::cpu::ExportCategory::category)                   \
                   << xe::cpu::ExportTag::CategoryShift)));
 
+// Attaches name##_fast_path (see cpu::ExportFastPath) to a declared export.
+#define DECLARE_EXPORT_FAST_PATH(module_name, name)             \
+  const auto EXPORT_FAST_PATH_##module_name##_##name =          \
+      (EXPORT_##module_name##_##name->function_data.fast_path = \
+           &name##_fast_path);
+
 #define DECLARE_EMPTY_REGISTER_EXPORTS(module_name, group_name) \
   void xe::kernel::module_name::Register##group_name##Exports(  \
       xe::cpu::ExportResolver* export_resolver,                 \
@@ -614,6 +620,9 @@ using xe::cpu::ExportTag;
                  xe::cpu::ExportTag::tag1 | xe::cpu::ExportTag::tag2 |   \
                      xe::cpu::ExportTag::tag3 | xe::cpu::ExportTag::tag4)
 
+#define DECLARE_XBOXKRNL_EXPORT_FAST_PATH(name) \
+  DECLARE_EXPORT_FAST_PATH(xboxkrnl, name)
+
 #define DECLARE_XBOXKRNL_EMPTY_REGISTER_EXPORTS(group_name) \
   DECLARE_EMPTY_REGISTER_EXPORTS(xboxkrnl, group_name)
 
@@ -17,6 +17,7 @@
 #include "xenia/base/logging.h"
 #include "xenia/base/string.h"
 #include "xenia/base/threading.h"
+#include "xenia/cpu/ppc/ppc_hir_builder.h"
 #include "xenia/kernel/kernel_state.h"
 #include "xenia/kernel/user_module.h"
 #include "xenia/kernel/util/shim_utils.h"
@@ -452,6 +453,38 @@ void RtlEnterCriticalSection_entry(pointer_t<X_RTL_CRITICAL_SECTION> cs) {
 DECLARE_XBOXKRNL_EXPORT2(RtlEnterCriticalSection, kNone, kImplemented,
                          kHighFrequency);
 
+cpu::hir::Value* EmitCriticalSectionAddress(cpu::ppc::PPCHIRBuilder& f) {
+  using namespace cpu::hir;
+  return f.ZeroExtend(f.Truncate(f.LoadGPR(3), INT32_TYPE), INT64_TYPE);
+}
+
+bool RtlEnterCriticalSection_fast_path(cpu::ppc::PPCHIRBuilder& f,
+                                       cpu::hir::Label* slow_path_label) {
+  using namespace cpu::hir;
+  // Only takes a free critical section, recursion and waiting are done by the
+  // export.
+  auto acquired = f.AtomicCompareExchange(
+      f.Add(EmitCriticalSectionAddress(f),
+            f.LoadConstantUint64(offsetof(X_RTL_CRITICAL_SECTION, lock_count))),
+      f.LoadConstantInt32(-1), f.LoadZeroInt32());
+  f.BranchFalse(acquired, slow_path_label);
+  // HIR values are local to the block, and the branch has ended it.
+  auto cs_address = EmitCriticalSectionAddress(f);
+  // Both are big-endian, copied without swapping.
+  auto current_thread = f.Load(
+      f.Add(f.LoadGPR(13),
+            f.LoadConstantUint64(offsetof(X_KPCR, current_thread))),
+      INT32_TYPE);
+  f.Store(f.Add(cs_address, f.LoadConstantUint64(offsetof(
+                                X_RTL_CRITICAL_SECTION, owning_thread))),
+          current_thread);
+  f.Store(f.Add(cs_address, f.LoadConstantUint64(offsetof(
+                                X_RTL_CRITICAL_SECTION, recursion_count))),
+          f.LoadConstantInt32(xe::byte_swap(int32_t(1))));
+  return true;
+}
+DECLARE_XBOXKRNL_EXPORT_FAST_PATH(RtlEnterCriticalSection);
+
 dword_result_t RtlTryEnterCriticalSection_entry(
     pointer_t<X_RTL_CRITICAL_SECTION> cs) {
   uint32_t thread = XThread::GetCurrentThread()->guest_object();
@@ -12,6 +12,17 @@
 
 #include "xenia/xbox.h"
 
+namespace xe {
+namespace cpu {
+namespace hir {
+class Label;
+}  // namespace hir
+namespace ppc {
+class PPCHIRBuilder;
+}  // namespace ppc
+}  // namespace cpu
+}  // namespace xe
+
 namespace xe {
 namespace kernel {
 namespace xboxkrnl {
@@ -24,6 +35,10 @@ X_STATUS xeRtlInitializeCriticalSectionAndSpinCount(X_RTL_CRITICAL_SECTION* cs,
                                                     uint32_t cs_ptr,
                                                     uint32_t spin_count);
 
+// Inline fast path of the export (see cpu::ExportFastPath).
+bool RtlEnterCriticalSection_fast_path(cpu::ppc::PPCHIRBuilder& f,
+                                       cpu::hir::Label* slow_path_label);
+
 }  // namespace xboxkrnl
 }  // namespace kernel
 }  // namespace xe
@@ -14,6 +14,7 @@
 #include "xenia/base/clock.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/mutex.h"
+#include "xenia/cpu/ppc/ppc_hir_builder.h"
 #include "xenia/cpu/processor.h"
 #include "xenia/kernel/kernel_state.h"
 #include "xenia/kernel/user_module.h"
@@ -300,6 +301,21 @@ dword_result_t KeGetCurrentProcessType_entry() {
 DECLARE_XBOXKRNL_EXPORT2(KeGetCurrentProcessType, kThreading, kImplemented,
                          kHighFrequency);
 
+bool KeGetCurrentProcessType_fast_path(cpu::ppc::PPCHIRBuilder& f,
+                                       cpu::hir::Label* slow_path_label) {
+  uint32_t pib_address = kernel_state()->process_info_block_address();
+  if (!pib_address) {
+    return false;
+  }
+  auto process_type = f.Load(
+      f.LoadConstantUint64(pib_address +
+                           offsetof(ProcessInfoBlock, process_type)),
+      cpu::hir::INT8_TYPE);
+  f.StoreGPR(3, f.ZeroExtend(process_type, cpu::hir::INT64_TYPE));
+  return true;
+}
+DECLARE_XBOXKRNL_EXPORT_FAST_PATH(KeGetCurrentProcessType);
+
 void KeSetCurrentProcessType_entry(dword_t type) {
   // One of X_PROCTYPE_?
 
@@ -377,6 +393,38 @@ dword_result_t KeTlsGetValue_entry(dword_t tls_index) {
 DECLARE_XBOXKRNL_EXPORT2(KeTlsGetValue, kThreading, kImplemented,
                          kHighFrequency);
 
+void EmitTlsGetValue(cpu::ppc::PPCHIRBuilder& f,
+                     cpu::hir::Label* slow_path_label,
+                     uint32_t tls_static_size, uint32_t tls_total_size) {
+  using namespace cpu::hir;
+  // Same bounds check as XThread::GetTLSValue.
+  auto emit_slot_offset = [&f]() {
+    return f.Shl(f.Truncate(f.LoadGPR(3), INT32_TYPE), int8_t(2));
+  };
+  f.BranchTrue(
+      f.CompareUGT(emit_slot_offset(), f.LoadConstantUint32(tls_total_size)),
+      slow_path_label);
+  // HIR values are local to the block, and the branch has ended it.
+  auto slot_offset = emit_slot_offset();
+  // r13 is the KPCR, beginning with the TLS block pointer.
+  auto tls_address = f.ByteSwap(f.Load(f.LoadGPR(13), INT32_TYPE));
+  auto slot_address =
+      f.Add(f.Add(tls_address, f.LoadConstantUint32(tls_static_size)),
+            slot_offset);
+  auto value =
+      f.ByteSwap(f.Load(f.ZeroExtend(slot_address, INT64_TYPE), INT32_TYPE));
+  f.StoreGPR(3, f.ZeroExtend(value, INT64_TYPE));
+}
+
+bool KeTlsGetValue_fast_path(cpu::ppc::PPCHIRBuilder& f,
+                             cpu::hir::Label* slow_path_label) {
+  uint32_t tls_static_size, tls_total_size;
+  XThread::GetTLSLayout(kernel_state(), &tls_static_size, &tls_total_size);
+  EmitTlsGetValue(f, slow_path_label, tls_static_size, tls_total_size);
+  return true;
+}
+DECLARE_XBOXKRNL_EXPORT_FAST_PATH(KeTlsGetValue);
+
 // https://msdn.microsoft.com/en-us/library/ms686818
 dword_result_t KeTlsSetValue_entry(dword_t tls_index, dword_t tls_value) {
   // xboxkrnl doesn't actually have an error branch - it always succeeds, even
@@ -964,6 +1012,23 @@ void KeAcquireSpinLockAtRaisedIrql_entry(lpdword_t lock_ptr) {
 DECLARE_XBOXKRNL_EXPORT3(KeAcquireSpinLockAtRaisedIrql, kThreading,
                          kImplemented, kBlocking, kHighFrequency);
 
+// The lock word is accessed in host byte order by the exports.
+cpu::hir::Value* EmitTryToAcquireSpinLock(cpu::ppc::PPCHIRBuilder& f) {
+  using namespace cpu::hir;
+  auto lock_address =
+      f.ZeroExtend(f.Truncate(f.LoadGPR(3), INT32_TYPE), INT64_TYPE);
+  return f.AtomicCompareExchange(lock_address, f.LoadZeroInt32(),
+                                 f.LoadConstantInt32(1));
+}
+
+bool KeAcquireSpinLockAtRaisedIrql_fast_path(
+    cpu::ppc::PPCHIRBuilder& f, cpu::hir::Label* slow_path_label) {
+  // Spinning is done by the export.
+  f.BranchFalse(EmitTryToAcquireSpinLock(f), slow_path_label);
+  return true;
+}
+DECLARE_XBOXKRNL_EXPORT_FAST_PATH(KeAcquireSpinLockAtRaisedIrql);
+
 dword_result_t KeTryToAcquireSpinLockAtRaisedIrql_entry(lpdword_t lock_ptr) {
   // Lock.
   auto lock = reinterpret_cast<uint32_t*>(lock_ptr.host_address());
@@ -975,6 +1040,14 @@ dword_result_t KeTryToAcquireSpinLockAtRaisedIrql_entry(lpdword_t lock_ptr) {
 DECLARE_XBOXKRNL_EXPORT4(KeTryToAcquireSpinLockAtRaisedIrql, kThreading,
                          kImplemented, kBlocking, kHighFrequency, kSketchy);
 
+bool KeTryToAcquireSpinLockAtRaisedIrql_fast_path(
+    cpu::ppc::PPCHIRBuilder& f, cpu::hir::Label* slow_path_label) {
+  f.StoreGPR(3, f.ZeroExtend(EmitTryToAcquireSpinLock(f),
+                             cpu::hir::INT64_TYPE));
+  return true;
+}
+DECLARE_XBOXKRNL_EXPORT_FAST_PATH(KeTryToAcquireSpinLockAtRaisedIrql);
+
 void KeReleaseSpinLockFromRaisedIrql_entry(lpdword_t lock_ptr) {
   // Unlock.
   auto lock = reinterpret_cast<uint32_t*>(lock_ptr.host_address());
@@ -1026,6 +1099,8 @@ void NtQueueApcThread_entry(dword_t thread_handle, lpvoid_t apc_routine,
     return;
   }
 
+  // Allocated by the kernel, so the guest can't dequeue it, and it can be
+  // queued on the host.
   thread->EnqueueApc(apc_routine, apc_routine_context, arg1, arg2);
 }
 DECLARE_XBOXKRNL_EXPORT1(NtQueueApcThread, kThreading, kImplemented);
@@ -1069,6 +1144,9 @@ dword_result_t KeInsertQueueApc_entry(pointer_t<XAPC> apc, lpvoid_t arg1,
   apc->arg2 = arg2.guest_address();
   apc->enqueued = 1;
 
+  // The APCs queued by the kernel on the host before this one must be
+  // delivered first.
+  thread->MoveHostApcsToGuestList();
   auto apc_list = thread->apc_list();
 
   uint32_t list_entry_ptr = apc.guest_address() + 8;
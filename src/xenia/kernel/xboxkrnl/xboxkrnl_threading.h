@@ -32,6 +32,17 @@ uint32_t xeKeWaitForSingleObject(void* object_ptr, uint32_t wait_reason,
                                  uint64_t* timeout_ptr);
 uint32_t xeKeSetEvent(X_KEVENT* event_ptr, uint32_t increment, uint32_t wait);
 
+// Inline fast paths of the exports (see cpu::ExportFastPath).
+// Reads the TLS slot in r3 of the current thread into r3, with the TLS layout
+// given explicitly rather than taken from the executable.
+void EmitTlsGetValue(cpu::ppc::PPCHIRBuilder& f,
+                     cpu::hir::Label* slow_path_label,
+                     uint32_t tls_static_size, uint32_t tls_total_size);
+bool KeAcquireSpinLockAtRaisedIrql_fast_path(cpu::ppc::PPCHIRBuilder& f,
+                                             cpu::hir::Label* slow_path_label);
+bool KeTryToAcquireSpinLockAtRaisedIrql_fast_path(
+    cpu::ppc::PPCHIRBuilder& f, cpu::hir::Label* slow_path_label);
+
 }  // namespace xboxkrnl
 }  // namespace kernel
 }  // namespace xe
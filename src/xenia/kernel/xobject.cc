@@ -206,6 +206,7 @@ X_STATUS XObject::Wait(uint32_t wait_reason, uint32_t processor_mode,
 
   auto result =
       xe::threading::Wait(wait_handle, alertable ? true : false, timeout_ms);
+  kernel_state()->thread_affinity_policy()->SampleCurrentProcessor();
   switch (result) {
     case xe::threading::WaitResult::kSuccess:
       WaitCallback();
@@ -234,6 +235,9 @@ X_STATUS XObject::SignalAndWait(XObject* signal_object, XObject* wait_object,
   auto result = xe::threading::SignalAndWait(
       signal_object->GetWaitHandle(), wait_object->GetWaitHandle(),
       alertable ? true : false, timeout_ms);
+  wait_object->kernel_state()
+      ->thread_affinity_policy()
+      ->SampleCurrentProcessor();
   switch (result) {
     case xe::threading::WaitResult::kSuccess:
       wait_object->WaitCallback();
@@ -269,6 +273,9 @@ X_STATUS XObject::WaitMultiple(uint32_t count, XObject** objects,
   if (wait_type) {
     auto result = xe::threading::WaitAny(std::move(wait_handles),
                                          alertable ? true : false, timeout_ms);
+    objects[0]->kernel_state()
+        ->thread_affinity_policy()
+        ->SampleCurrentProcessor();
     switch (result.first) {
       case xe::threading::WaitResult::kSuccess:
         objects[result.second]->WaitCallback();
@@ -289,6 +296,9 @@ X_STATUS XObject::WaitMultiple(uint32_t count, XObject** objects,
   } else {
     auto result = xe::threading::WaitAll(std::move(wait_handles),
                                          alertable ? true : false, timeout_ms);
+    objects[0]->kernel_state()
+        ->thread_affinity_policy()
+        ->SampleCurrentProcessor();
     switch (result) {
       case xe::threading::WaitResult::kSuccess:
         for (uint32_t i = 0; i < count; i++) {
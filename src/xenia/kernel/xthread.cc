@@ -31,7 +31,10 @@
 DEFINE_bool(ignore_thread_priorities, true,
             "Ignores game-specified thread priorities.", "Kernel");
 DEFINE_bool(ignore_thread_affinities, true,
-            "Ignores game-specified thread affinities.", "Kernel");
+            "Ignores game-specified thread affinities. With a "
+            "thread_affinity_policy other than os, guest threads may run on "
+            "the host processors of any guest hardware thread.",
+            "Kernel");
 
 namespace xe {
 namespace kernel {
@@ -89,6 +92,17 @@ XThread::~XThread() {
 
   thread_.reset();
 
+  if (host_apc_delivered_count_) {
+    double tick_us = 1000000.0 / double(Clock::QueryHostTickFrequency());
+    XELOGD(
+        "XThread {:08X} delivered {} APCs in {} batches, latency average "
+        "{:.1f} us, max {:.1f} us",
+        thread_id_, host_apc_delivered_count_, host_apc_batch_count_,
+        double(host_apc_latency_total_) /
+            double(host_apc_delivered_count_) * tick_us,
+        double(host_apc_latency_max_) * tick_us);
+  }
+
   if (thread_state_) {
     delete thread_state_;
   }
@@ -285,26 +299,8 @@ X_STATUS XThread::Create() {
   scratch_address_ = memory()->SystemHeapAlloc(scratch_size_);
 
   // Allocate TLS block.
-  // Games will specify a certain number of 4b slots that each thread will get.
-  xex2_opt_tls_info* tls_header = nullptr;
-  auto module = kernel_state()->GetExecutableModule();
-  if (module) {
-    module->GetOptHeader(XEX_HEADER_TLS_INFO, &tls_header);
-  }
-
-  const uint32_t kDefaultTlsSlotCount = 1024;
-  uint32_t tls_slots = kDefaultTlsSlotCount;
-  uint32_t tls_extended_size = 0;
-  if (tls_header && tls_header->slot_count) {
-    tls_slots = tls_header->slot_count;
-    tls_extended_size = tls_header->data_size;
-  }
-
-  // Allocate both the slots and the extended data.
-  // Some TLS is compiled with the binary (declspec(thread)) vars. The game
-  // will directly access those through 0(r13).
-  uint32_t tls_slot_size = tls_slots * 4;
-  tls_total_size_ = tls_slot_size + tls_extended_size;
+  uint32_t tls_extended_size;
+  GetTLSLayout(kernel_state(), &tls_extended_size, &tls_total_size_);
   tls_static_address_ = memory()->SystemHeapAlloc(tls_total_size_);
   tls_dynamic_address_ = tls_static_address_ + tls_extended_size;
   if (!tls_static_address_) {
@@ -316,6 +312,9 @@ X_STATUS XThread::Create() {
   memory()->Fill(tls_static_address_, tls_total_size_, 0);
   if (tls_extended_size) {
     // If game has extended data, copy in the default values.
+    xex2_opt_tls_info* tls_header = nullptr;
+    kernel_state()->GetExecutableModule()->GetOptHeader(XEX_HEADER_TLS_INFO,
+                                                        &tls_header);
     assert_not_zero(tls_header->raw_data_address);
     memory()->Copy(tls_static_address_, tls_header->raw_data_address,
                    tls_header->raw_data_size);
@@ -384,6 +383,7 @@ X_STATUS XThread::Create() {
 
     // Profiler needs to know about the thread.
     xe::Profiler::ThreadEnter(thread_name_.c_str());
+    xe::profiling::TraceRecorder::SetThreadGuestId(thread_id_);
 
     // Execute user code.
     current_xthread_tls_ = this;
@@ -580,7 +580,15 @@ uint32_t XThread::RaiseIrql(uint32_t new_irql) {
 
 void XThread::LowerIrql(uint32_t new_irql) { irql_ = new_irql; }
 
-void XThread::CheckApcs() { DeliverAPCs(); }
+void XThread::CheckApcs() {
+  // Called on every IRQL lowering, so avoid taking the global lock when
+  // there's nothing to deliver. Racing with a concurrent enqueue is fine as
+  // that queues a delivery by itself.
+  if (!apc_list_.HasPending() && !host_apcs_.HasPending()) {
+    return;
+  }
+  DeliverAPCs();
+}
 
 void XThread::LockApc() { global_critical_region_.mutex().lock(); }
 
@@ -594,98 +602,161 @@ void XThread::UnlockApc(bool queue_delivery) {
 
 void XThread::EnqueueApc(uint32_t normal_routine, uint32_t normal_context,
                          uint32_t arg1, uint32_t arg2) {
-  LockApc();
-
-  // Allocate APC.
-  // We'll tag it as special and free it when dispatched.
-  uint32_t apc_ptr = memory()->SystemHeapAlloc(XAPC::kSize);
-  auto apc = reinterpret_cast<XAPC*>(memory()->TranslateVirtual(apc_ptr));
-
-  apc->Initialize();
-  apc->kernel_routine = XAPC::kDummyKernelRoutine;
-  apc->rundown_routine = XAPC::kDummyRundownRoutine;
+  auto apc = new util::HostApcQueue::Apc;
   apc->normal_routine = normal_routine;
   apc->normal_context = normal_context;
   apc->arg1 = arg1;
   apc->arg2 = arg2;
-  apc->enqueued = 1;
-
-  uint32_t list_entry_ptr = apc_ptr + 8;
-  apc_list_.Insert(list_entry_ptr);
-
-  UnlockApc(true);
+  apc->enqueue_time = Clock::QueryHostTickCount();
+  host_apcs_.Push(apc);
+
+  // Delivery takes all APCs queued by then, so only the first of a burst
+  // needs to alert the thread. If the thread hasn't been created yet, they're
+  // delivered when it starts.
+  if (!host_apc_delivery_queued_.exchange(true, std::memory_order_acq_rel) &&
+      thread_) {
+    thread_->QueueUserCallback([this]() { DeliverAPCs(); });
+  }
 }
 
 void XThread::DeliverAPCs() {
   // https://www.drdobbs.com/inside-nts-asynchronous-procedure-call/184416590?pgno=1
   // https://www.drdobbs.com/inside-nts-asynchronous-procedure-call/184416590?pgno=7
+  // The host APCs queued from now on need a new delivery.
+  host_apc_delivery_queued_.store(false, std::memory_order_release);
+
   auto processor = kernel_state()->processor();
+  uint32_t host_batch_size = 0;
+  uint64_t host_batch_latency_max = 0;
   LockApc();
   auto kthread = guest_object<X_KTHREAD>();
-  while (apc_list_.HasPending() && kthread->apc_disable_count == 0) {
-    // Get APC entry (offset for LIST_ENTRY offset) and cache what we need.
-    // Calling the routine may delete the memory/overwrite it.
-    uint32_t apc_ptr = apc_list_.Shift() - 8;
-    auto apc = reinterpret_cast<XAPC*>(memory()->TranslateVirtual(apc_ptr));
-    bool needs_freeing = apc->kernel_routine == XAPC::kDummyKernelRoutine;
-
-    XELOGD("Delivering APC to {:08X}", uint32_t(apc->normal_routine));
+  // Everything queued until both lists run out is delivered in this call,
+  // including the APCs queued by the routines themselves. The APCs in the
+  // guest list were queued before all the host ones.
+  while (kthread->apc_disable_count == 0) {
+    if (apc_list_.HasPending()) {
+      // Get APC entry (offset for LIST_ENTRY offset) and cache what we need.
+      // Calling the routine may delete the memory/overwrite it.
+      uint32_t apc_ptr = apc_list_.Shift() - 8;
+      auto apc = reinterpret_cast<XAPC*>(memory()->TranslateVirtual(apc_ptr));
+      bool needs_freeing = apc->kernel_routine == XAPC::kDummyKernelRoutine;
+
+      XELOGD("Delivering APC to {:08X}", uint32_t(apc->normal_routine));
+
+      // Mark as uninserted so that it can be reinserted again by the routine.
+      apc->enqueued = 0;
+
+      // Call kernel routine.
+      // The routine can modify all of its arguments before passing it on.
+      // Since we need to give guest accessible pointers over, we copy things
+      // into and out of scratch.
+      uint8_t* scratch_ptr = memory()->TranslateVirtual(scratch_address_);
+      xe::store_and_swap<uint32_t>(scratch_ptr + 0, apc->normal_routine);
+      xe::store_and_swap<uint32_t>(scratch_ptr + 4, apc->normal_context);
+      xe::store_and_swap<uint32_t>(scratch_ptr + 8, apc->arg1);
+      xe::store_and_swap<uint32_t>(scratch_ptr + 12, apc->arg2);
+      if (apc->kernel_routine != XAPC::kDummyKernelRoutine) {
+        // kernel_routine(apc_address, &normal_routine, &normal_context,
+        // &system_arg1, &system_arg2)
+        uint64_t kernel_args[] = {
+            apc_ptr,
+            scratch_address_ + 0,
+            scratch_address_ + 4,
+            scratch_address_ + 8,
+            scratch_address_ + 12,
+        };
+        processor->Execute(thread_state_, apc->kernel_routine, kernel_args,
+                           xe::countof(kernel_args));
+      }
+      uint32_t normal_routine = xe::load_and_swap<uint32_t>(scratch_ptr + 0);
+      uint32_t normal_context = xe::load_and_swap<uint32_t>(scratch_ptr + 4);
+      uint32_t arg1 = xe::load_and_swap<uint32_t>(scratch_ptr + 8);
+      uint32_t arg2 = xe::load_and_swap<uint32_t>(scratch_ptr + 12);
+
+      // Call the normal routine. Note that it may have been killed by the
+      // kernel routine.
+      if (normal_routine) {
+        UnlockApc(false);
+        // normal_routine(normal_context, system_arg1, system_arg2)
+        uint64_t normal_args[] = {normal_context, arg1, arg2};
+        processor->Execute(thread_state_, normal_routine, normal_args,
+                           xe::countof(normal_args));
+        LockApc();
+      }
 
-    // Mark as uninserted so that it can be reinserted again by the routine.
-    apc->enqueued = 0;
+      XELOGD("Completed delivery of APC to {:08X} ({:08X}, {:08X}, {:08X})",
+             normal_routine, normal_context, arg1, arg2);
 
-    // Call kernel routine.
-    // The routine can modify all of its arguments before passing it on.
-    // Since we need to give guest accessible pointers over, we copy things
-    // into and out of scratch.
-    uint8_t* scratch_ptr = memory()->TranslateVirtual(scratch_address_);
-    xe::store_and_swap<uint32_t>(scratch_ptr + 0, apc->normal_routine);
-    xe::store_and_swap<uint32_t>(scratch_ptr + 4, apc->normal_context);
-    xe::store_and_swap<uint32_t>(scratch_ptr + 8, apc->arg1);
-    xe::store_and_swap<uint32_t>(scratch_ptr + 12, apc->arg2);
-    if (apc->kernel_routine != XAPC::kDummyKernelRoutine) {
-      // kernel_routine(apc_address, &normal_routine, &normal_context,
-      // &system_arg1, &system_arg2)
-      uint64_t kernel_args[] = {
-          apc_ptr,
-          scratch_address_ + 0,
-          scratch_address_ + 4,
-          scratch_address_ + 8,
-          scratch_address_ + 12,
-      };
-      processor->Execute(thread_state_, apc->kernel_routine, kernel_args,
-                         xe::countof(kernel_args));
+      // If special, free it.
+      if (needs_freeing) {
+        memory()->SystemHeapFree(apc_ptr);
+      }
+      continue;
     }
-    uint32_t normal_routine = xe::load_and_swap<uint32_t>(scratch_ptr + 0);
-    uint32_t normal_context = xe::load_and_swap<uint32_t>(scratch_ptr + 4);
-    uint32_t arg1 = xe::load_and_swap<uint32_t>(scratch_ptr + 8);
-    uint32_t arg2 = xe::load_and_swap<uint32_t>(scratch_ptr + 12);
 
-    // Call the normal routine. Note that it may have been killed by the kernel
-    // routine.
+    util::HostApcQueue::Apc* host_apc = host_apcs_.Pop();
+    if (!host_apc) {
+      break;
+    }
+    uint32_t normal_routine = host_apc->normal_routine;
+    uint64_t normal_args[] = {host_apc->normal_context, host_apc->arg1,
+                              host_apc->arg2};
+    uint64_t latency = Clock::QueryHostTickCount() - host_apc->enqueue_time;
+    delete host_apc;
+
+    ++host_batch_size;
+    host_batch_latency_max = std::max(host_batch_latency_max, latency);
+    ++host_apc_delivered_count_;
+    host_apc_latency_total_ += latency;
+    host_apc_latency_max_ = std::max(host_apc_latency_max_, latency);
+
+    XELOGD("Delivering APC to {:08X} ({:08X}, {:08X}, {:08X})", normal_routine,
+           uint32_t(normal_args[0]), uint32_t(normal_args[1]),
+           uint32_t(normal_args[2]));
     if (normal_routine) {
       UnlockApc(false);
       // normal_routine(normal_context, system_arg1, system_arg2)
-      uint64_t normal_args[] = {normal_context, arg1, arg2};
       processor->Execute(thread_state_, normal_routine, normal_args,
                          xe::countof(normal_args));
       LockApc();
     }
+  }
+  UnlockApc(true);
 
-    XELOGD("Completed delivery of APC to {:08X} ({:08X}, {:08X}, {:08X})",
-           normal_routine, normal_context, arg1, arg2);
+  if (host_batch_size) {
+    ++host_apc_batch_count_;
+    COUNT_profile_set("kernel/apc_batch_size", host_batch_size);
+    COUNT_profile_set("kernel/apc_latency_us",
+                      host_batch_latency_max * 1000000 /
+                          Clock::QueryHostTickFrequency());
+  }
+}
 
-    // If special, free it.
-    if (needs_freeing) {
-      memory()->SystemHeapFree(apc_ptr);
-    }
+void XThread::MoveHostApcsToGuestList() {
+  while (util::HostApcQueue::Apc* apc = host_apcs_.Pop()) {
+    // Queued the same way as a guest APC with dummy kernel and rundown
+    // routines, freed when delivered.
+    uint32_t guest_apc_ptr = memory()->SystemHeapAlloc(XAPC::kSize);
+    auto guest_apc =
+        reinterpret_cast<XAPC*>(memory()->TranslateVirtual(guest_apc_ptr));
+    guest_apc->Initialize();
+    guest_apc->kernel_routine = XAPC::kDummyKernelRoutine;
+    guest_apc->rundown_routine = XAPC::kDummyRundownRoutine;
+    guest_apc->normal_routine = apc->normal_routine;
+    guest_apc->normal_context = apc->normal_context;
+    guest_apc->arg1 = apc->arg1;
+    guest_apc->arg2 = apc->arg2;
+    guest_apc->enqueued = 1;
+    apc_list_.Insert(guest_apc_ptr + 8);
+    delete apc;
   }
-  UnlockApc(true);
 }
 
 void XThread::RundownAPCs() {
   assert_true(XThread::GetCurrentThread() == this);
   LockApc();
+  // Host APCs have no rundown routine.
+  host_apcs_.Clear();
   while (apc_list_.HasPending()) {
     // Get APC entry (offset for LIST_ENTRY offset) and cache what we need.
     // Calling the routine may delete the memory/overwrite it.
@@ -758,7 +829,12 @@ void XThread::SetActiveCpu(uint8_t cpu_index) {
     thread_object.current_cpu = cpu_index;
   }
 
-  if (xe::threading::logical_processor_count() >= 6) {
+  uint64_t affinity_mask =
+      kernel_state()->thread_affinity_policy()->GetAffinityMask(
+          affinity_role_, cpu_index, !cvars::ignore_thread_affinities);
+  if (affinity_mask) {
+    thread_->set_affinity_mask(affinity_mask);
+  } else if (xe::threading::logical_processor_count() >= 6) {
     if (!cvars::ignore_thread_affinities) {
       thread_->set_affinity_mask(uint64_t(1) << cpu_index);
     }
@@ -767,6 +843,31 @@ void XThread::SetActiveCpu(uint8_t cpu_index) {
   }
 }
 
+void XThread::GetTLSLayout(KernelState* kernel_state,
+                           uint32_t* static_size_out,
+                           uint32_t* total_size_out) {
+  // Games will specify a certain number of 4b slots that each thread will get.
+  xex2_opt_tls_info* tls_header = nullptr;
+  auto module = kernel_state->GetExecutableModule();
+  if (module) {
+    module->GetOptHeader(XEX_HEADER_TLS_INFO, &tls_header);
+  }
+
+  const uint32_t kDefaultTlsSlotCount = 1024;
+  uint32_t tls_slots = kDefaultTlsSlotCount;
+  uint32_t tls_extended_size = 0;
+  if (tls_header && tls_header->slot_count) {
+    tls_slots = tls_header->slot_count;
+    tls_extended_size = tls_header->data_size;
+  }
+
+  // Both the slots and the extended data are allocated.
+  // Some TLS is compiled with the binary (declspec(thread)) vars. The game
+  // will directly access those through 0(r13).
+  *static_size_out = tls_extended_size;
+  *total_size_out = tls_slots * 4 + tls_extended_size;
+}
+
 bool XThread::GetTLSValue(uint32_t slot, uint32_t* value_out) {
   if (slot * 4 > tls_total_size_) {
     return false;
@@ -837,6 +938,7 @@ X_STATUS XThread::Delay(uint32_t processor_mode, uint32_t alertable,
   if (alertable) {
     auto result =
         xe::threading::AlertableSleep(std::chrono::milliseconds(timeout_ms));
+    kernel_state()->thread_affinity_policy()->SampleCurrentProcessor();
     switch (result) {
       default:
       case xe::threading::SleepResult::kSuccess:
@@ -846,6 +948,7 @@ X_STATUS XThread::Delay(uint32_t processor_mode, uint32_t alertable,
     }
   } else {
     xe::threading::Sleep(std::chrono::milliseconds(timeout_ms));
+    kernel_state()->thread_affinity_policy()->SampleCurrentProcessor();
     return X_STATUS_SUCCESS;
   }
 }
@@ -947,6 +1050,22 @@ bool XThread::Save(ByteStream* stream) {
   }
 
   stream->Write(&state, sizeof(ThreadSavedState));
+
+  // APCs queued by EnqueueApc, which are not in the guest list, from the
+  // oldest.
+  std::vector<util::HostApcQueue::Apc> host_apcs;
+  LockApc();
+  host_apcs_.ForEach([&host_apcs](const util::HostApcQueue::Apc& apc) {
+    host_apcs.push_back(apc);
+  });
+  UnlockApc(false);
+  stream->Write(uint32_t(host_apcs.size()));
+  for (const util::HostApcQueue::Apc& apc : host_apcs) {
+    stream->Write(apc.normal_routine);
+    stream->Write(apc.normal_context);
+    stream->Write(apc.arg1);
+    stream->Write(apc.arg2);
+  }
   return true;
 }
 
@@ -961,7 +1080,9 @@ object_ref<XThread> XThread::Restore(KernelState* kernel_state,
     return nullptr;
   }
 
-  if (stream->Read<uint32_t>() != kThreadSaveSignature) {
+  uint32_t signature = stream->Read<uint32_t>();
+  if (signature != kThreadSaveSignature &&
+      signature != kThreadSaveSignatureWithoutHostApcs) {
     XELOGE("Could not restore XThread - invalid magic!");
     return nullptr;
   }
@@ -986,6 +1107,19 @@ object_ref<XThread> XThread::Restore(KernelState* kernel_state,
   thread->stack_alloc_size_ = state.stack_alloc_size;
 
   thread->apc_list_.set_memory(kernel_state->memory());
+  // Delivered on the first APC check after the thread is resumed.
+  uint32_t host_apc_count =
+      signature == kThreadSaveSignature ? stream->Read<uint32_t>() : 0;
+  uint64_t host_apc_enqueue_time = Clock::QueryHostTickCount();
+  for (uint32_t i = 0; i < host_apc_count; ++i) {
+    auto apc = new util::HostApcQueue::Apc;
+    apc->normal_routine = stream->Read<uint32_t>();
+    apc->normal_context = stream->Read<uint32_t>();
+    apc->arg1 = stream->Read<uint32_t>();
+    apc->arg2 = stream->Read<uint32_t>();
+    apc->enqueue_time = host_apc_enqueue_time;
+    thread->host_apcs_.Push(apc);
+  }
 
   // Register now that we know our thread ID.
   kernel_state->RegisterThread(thread);
@@ -17,6 +17,8 @@
 #include "xenia/base/threading.h"
 #include "xenia/cpu/thread.h"
 #include "xenia/cpu/thread_state.h"
+#include "xenia/kernel/thread_affinity_policy.h"
+#include "xenia/kernel/util/host_apc_queue.h"
 #include "xenia/kernel/util/native_list.h"
 #include "xenia/kernel/xmutant.h"
 #include "xenia/kernel/xobject.h"
@@ -25,7 +27,9 @@
 namespace xe {
 namespace kernel {
 
-constexpr fourcc_t kThreadSaveSignature = make_fourcc("THRD");
+constexpr fourcc_t kThreadSaveSignature = make_fourcc("THRA");
+// Older saves, without the APCs queued on the host side after the state.
+constexpr fourcc_t kThreadSaveSignatureWithoutHostApcs = make_fourcc("THRD");
 
 class XEvent;
 
@@ -206,8 +210,15 @@ class XThread : public XObject, public cpu::Thread {
   void LockApc();
   void UnlockApc(bool queue_delivery);
   util::NativeList* apc_list() { return &apc_list_; }
+  // Queues a user mode APC without kernel and rundown routines, for I/O and
+  // timer completions and NtQueueApcThread. Can be called from any host
+  // thread.
   void EnqueueApc(uint32_t normal_routine, uint32_t normal_context,
                   uint32_t arg1, uint32_t arg2);
+  // Moves the APCs queued by EnqueueApc to the guest APC list. Must be called
+  // with the APC lock held before inserting an APC into the guest list, so
+  // they're delivered in the order they were queued in.
+  void MoveHostApcsToGuestList();
 
   int32_t priority() const { return priority_; }
   int32_t QueryPriority();
@@ -223,7 +234,17 @@ class XThread : public XObject, public cpu::Thread {
   void SetAffinity(uint32_t affinity);
   uint8_t active_cpu() const;
   void SetActiveCpu(uint8_t cpu_index);
-
+  // How the host thread is placed by the ThreadAffinityPolicy. Must be set
+  // before Create.
+  ThreadAffinityRole affinity_role() const { return affinity_role_; }
+  void set_affinity_role(ThreadAffinityRole role) { affinity_role_ = role; }
+
+  // Sizes of the TLS blocks of threads created for the current executable.
+  // The static data (accessed directly through 0(r13) by the game) is followed
+  // by the dynamic KeTls* slots.
+  static void GetTLSLayout(KernelState* kernel_state,
+                           uint32_t* static_size_out,
+                           uint32_t* total_size_out);
   bool GetTLSValue(uint32_t slot, uint32_t* value_out);
   bool SetTLSValue(uint32_t slot, uint32_t value);
 
@@ -272,12 +293,28 @@ class XThread : public XObject, public cpu::Thread {
   bool guest_thread_ = false;
   bool main_thread_ = false;  // Entry-point thread
   bool running_ = false;
+  ThreadAffinityRole affinity_role_ = ThreadAffinityRole::kGuestHardwareThread;
 
   int32_t priority_ = 0;
 
   xe::global_critical_region global_critical_region_;
   std::atomic<uint32_t> irql_ = {0};
   util::NativeList apc_list_;
+
+  // APCs queued by EnqueueApc. These have no kernel and rundown routines, so
+  // they are kept on the host rather than in the guest APC list, without
+  // taking the global lock or allocating guest memory when queued, and are
+  // delivered in batches. Consumed under the APC lock. All of them were
+  // queued after the APCs in the guest list.
+  util::HostApcQueue host_apcs_;
+  // Whether a delivery callback is already queued for the host APCs, so a
+  // burst of completions alerts the thread only once.
+  std::atomic<bool> host_apc_delivery_queued_ = {false};
+  // APC delivery statistics (latency in host ticks).
+  uint64_t host_apc_delivered_count_ = 0;
+  uint64_t host_apc_batch_count_ = 0;
+  uint64_t host_apc_latency_total_ = 0;
+  uint64_t host_apc_latency_max_ = 0;
 };
 
 class XHostThread : public XThread {
@@ -20,6 +20,7 @@
 #include "xenia/base/cvar.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
+#include "xenia/base/profiling.h"
 #include "xenia/base/threading.h"
 #include "xenia/cpu/mmio_handler.h"
 
@@ -32,6 +33,14 @@ DEFINE_bool(protect_on_release, false,
             "Protect released memory to prevent accesses.", "Memory");
 DEFINE_bool(scribble_heap, false,
             "Scribble 0xCD into all allocated heap memory.", "Memory");
+DEFINE_bool(
+    physical_memory_write_watch, false,
+    "Track guest writes to physical memory cached on the GPU using host write "
+    "watching (asynchronous userfaultfd write protection on Linux 6.7+), with "
+    "written pages collected before processing GPU commands, instead of access "
+    "violations on every first write to a watched page. Falls back to access "
+    "violations if not supported by the host.",
+    "Memory");
 
 namespace xe {
 uint32_t get_page_count(uint32_t value, uint32_t page_size) {
@@ -102,6 +111,9 @@ Memory::~Memory() {
   for (auto invalidation_callback : physical_memory_invalidation_callbacks_) {
     delete invalidation_callback;
   }
+  for (auto protection_callback : writable_protection_callbacks_) {
+    delete protection_callback;
+  }
 
   heaps_.v00000000.Dispose();
   heaps_.v40000000.Dispose();
@@ -472,6 +484,12 @@ bool Memory::AccessViolationCallbackThunk(
       std::move(global_lock_locked_once), host_address, is_write);
 }
 
+void Memory::TriggerWrittenPhysicalMemoryCallbacks() {
+  heaps_.vA0000000.TriggerWriteWatchCallbacks();
+  heaps_.vC0000000.TriggerWriteWatchCallbacks();
+  heaps_.vE0000000.TriggerWriteWatchCallbacks();
+}
+
 bool Memory::TriggerPhysicalMemoryCallbacks(
     std::unique_lock<std::recursive_mutex> global_lock_locked_once,
     uint32_t virtual_address, uint32_t length, bool is_write,
@@ -512,6 +530,30 @@ void Memory::UnregisterPhysicalMemoryInvalidationCallback(
   delete entry;
 }
 
+void* Memory::RegisterWritableProtectionCallback(
+    WritableProtectionCallback callback, void* callback_context) {
+  auto entry = new std::pair<WritableProtectionCallback, void*>(
+      callback, callback_context);
+  auto lock = global_critical_region_.Acquire();
+  writable_protection_callbacks_.push_back(entry);
+  return entry;
+}
+
+void Memory::UnregisterWritableProtectionCallback(void* callback_handle) {
+  auto entry = reinterpret_cast<std::pair<WritableProtectionCallback, void*>*>(
+      callback_handle);
+  {
+    auto lock = global_critical_region_.Acquire();
+    auto it = std::find(writable_protection_callbacks_.begin(),
+                        writable_protection_callbacks_.end(), entry);
+    assert_true(it != writable_protection_callbacks_.end());
+    if (it != writable_protection_callbacks_.end()) {
+      writable_protection_callbacks_.erase(it);
+    }
+  }
+  delete entry;
+}
+
 void Memory::EnablePhysicalMemoryAccessCallbacks(
     uint32_t physical_address, uint32_t length,
     bool enable_invalidation_notifications, bool enable_data_providers) {
@@ -1226,12 +1268,29 @@ bool BaseHeap::Protect(uint32_t address, uint32_t size, uint32_t protect,
   }
 
   // Perform table change.
+  bool made_writable = false;
   for (uint32_t page_number = start_page_number; page_number <= end_page_number;
        ++page_number) {
     auto& page_entry = page_table_[page_number];
+    if ((protect & kMemoryProtectWrite) &&
+        !(page_entry.current_protect & kMemoryProtectWrite)) {
+      made_writable = true;
+    }
     page_entry.current_protect = protect;
   }
 
+  // Before releasing the lock, so the memory can't be accessed through data
+  // derived from it while it was read-only anymore once it's writable. The
+  // lock may be held by the caller too, so it's not released for the
+  // callbacks, and they must not wait for other threads.
+  if (made_writable) {
+    uint32_t region_address = heap_base_ + start_page_number * page_size_;
+    uint32_t region_length = page_count * page_size_;
+    for (auto callback : memory_->writable_protection_callbacks_) {
+      callback->first(callback->second, region_address, region_length);
+    }
+  }
+
   return true;
 }
 
@@ -1384,6 +1443,9 @@ void PhysicalHeap::Initialize(Memory* memory, uint8_t* membase,
       (size_t(heap_size_) + host_address_offset + (system_page_size_ - 1)) /
       system_page_size_;
   system_page_flags_.resize((system_page_count_ + 63) / 64);
+
+  write_watch_ = cvars::physical_memory_write_watch &&
+                 xe::memory::IsWriteWatchSupported();
 }
 
 bool PhysicalHeap::Alloc(uint32_t size, uint32_t alignment,
@@ -1603,7 +1665,6 @@ void PhysicalHeap::EnableAccessCallbacks(uint32_t physical_address,
   xe::memory::PageAccess protect_access =
       enable_data_providers ? xe::memory::PageAccess::kNoAccess
                             : xe::memory::PageAccess::kReadOnly;
-  uint8_t* protect_base = membase_ + heap_base_;
   uint32_t protect_system_page_first = UINT32_MAX;
   auto global_lock = global_critical_region_.Acquire();
   for (uint32_t i = system_page_first; i <= system_page_last; ++i) {
@@ -1658,19 +1719,131 @@ void PhysicalHeap::EnableAccessCallbacks(uint32_t physical_address,
       }
     } else {
       if (protect_system_page_first != UINT32_MAX) {
-        xe::memory::Protect(
-            protect_base + protect_system_page_first * system_page_size_,
-            (i - protect_system_page_first) * system_page_size_,
-            protect_access);
+        WatchSystemPagesForInvalidation(protect_system_page_first,
+                                        i - protect_system_page_first,
+                                        protect_access);
         protect_system_page_first = UINT32_MAX;
       }
     }
   }
   if (protect_system_page_first != UINT32_MAX) {
-    xe::memory::Protect(
-        protect_base + protect_system_page_first * system_page_size_,
-        (system_page_last + 1 - protect_system_page_first) * system_page_size_,
-        protect_access);
+    WatchSystemPagesForInvalidation(
+        protect_system_page_first,
+        system_page_last + 1 - protect_system_page_first, protect_access);
+  }
+}
+
+void PhysicalHeap::WatchSystemPagesForInvalidation(
+    uint32_t system_page_first, uint32_t system_page_count,
+    xe::memory::PageAccess protect_access) {
+  uint8_t* watch_base =
+      membase_ + heap_base_ + system_page_first * system_page_size_;
+  size_t watch_length = size_t(system_page_count) * system_page_size_;
+  // Data providers need reads to be caught too, which is only possible with
+  // protection.
+  if (write_watch_ && protect_access == xe::memory::PageAccess::kReadOnly &&
+      xe::memory::WatchWrites(watch_base, watch_length)) {
+    uint32_t system_page_last = system_page_first + system_page_count - 1;
+    for (uint32_t i = system_page_first >> 6; i <= system_page_last >> 6;
+         ++i) {
+      uint64_t watch_bits = UINT64_MAX;
+      if (i == system_page_first >> 6) {
+        watch_bits &= ~((uint64_t(1) << (system_page_first & 63)) - 1);
+      }
+      if (i == system_page_last >> 6 && (system_page_last & 63) != 63) {
+        watch_bits &= (uint64_t(1) << ((system_page_last & 63) + 1)) - 1;
+      }
+      system_page_flags_[i].write_watched |= watch_bits;
+    }
+    return;
+  }
+  xe::memory::Protect(watch_base, watch_length, protect_access);
+}
+
+void PhysicalHeap::TriggerWriteWatchCallbacks() {
+  if (!write_watch_) {
+    return;
+  }
+  SCOPE_profile_cpu_f("memory");
+
+  // Gather the runs of the write-watched pages, and then query which of them
+  // have been written to outside the global critical region, as guest threads
+  // may need it. If a page stops being watched in between, an excess callback
+  // may be triggered for it, which is fine.
+  std::vector<std::pair<uint32_t, uint32_t>> watched_ranges;
+  {
+    auto global_lock = global_critical_region_.Acquire();
+    uint32_t watched_range_start = UINT32_MAX;
+    for (uint32_t i = 0; i < uint32_t(system_page_flags_.size()); ++i) {
+      uint64_t watched_block = system_page_flags_[i].write_watched;
+      uint64_t watched_break_block = ~watched_block;
+      while (true) {
+        uint32_t watched_block_page;
+        if (!xe::bit_scan_forward(watched_range_start == UINT32_MAX
+                                      ? watched_block
+                                      : watched_break_block,
+                                  &watched_block_page)) {
+          break;
+        }
+        uint32_t watched_page = (i << 6) + watched_block_page;
+        if (watched_range_start == UINT32_MAX) {
+          watched_range_start = watched_page;
+        } else {
+          watched_ranges.emplace_back(watched_range_start,
+                                      watched_page - watched_range_start);
+          watched_range_start = UINT32_MAX;
+        }
+        uint64_t watched_block_mask =
+            ~((uint64_t(1) << watched_block_page) - 1);
+        watched_block &= watched_block_mask;
+        watched_break_block &= watched_block_mask;
+      }
+    }
+    if (watched_range_start != UINT32_MAX) {
+      watched_ranges.emplace_back(watched_range_start,
+                                  system_page_count_ - watched_range_start);
+    }
+  }
+  if (watched_ranges.empty()) {
+    return;
+  }
+
+  // <Offset from the first system page of the heap, length> in bytes.
+  std::vector<std::pair<size_t, size_t>> written_ranges;
+  uint8_t* watch_base = membase_ + heap_base_;
+  for (const std::pair<uint32_t, uint32_t>& watched_range : watched_ranges) {
+    size_t watched_offset = size_t(watched_range.first) * system_page_size_;
+    size_t watched_length = size_t(watched_range.second) * system_page_size_;
+    size_t written_ranges_previous_count = written_ranges.size();
+    if (xe::memory::GetWrittenRanges(watch_base + watched_offset,
+                                     watched_length, written_ranges)) {
+      for (size_t i = written_ranges_previous_count; i < written_ranges.size();
+           ++i) {
+        written_ranges[i].first += watched_offset;
+      }
+    } else {
+      // Can't tell which pages have been written to - invalidate everything.
+      written_ranges.resize(written_ranges_previous_count);
+      written_ranges.emplace_back(watched_offset, watched_length);
+    }
+  }
+
+  for (const std::pair<size_t, size_t>& written_range : written_ranges) {
+    uint32_t heap_relative_first =
+        xe::sat_sub(uint32_t(written_range.first), host_address_offset());
+    uint32_t heap_relative_end =
+        std::min(xe::sat_sub(uint32_t(written_range.first +
+                                      written_range.second),
+                             host_address_offset()),
+                 heap_size_);
+    if (heap_relative_end <= heap_relative_first) {
+      continue;
+    }
+    // Like for an access violation, letting the callbacks unwatch excess pages
+    // around the written ones.
+    TriggerCallbacks(global_critical_region_.Acquire(),
+                     heap_base_ + heap_relative_first,
+                     heap_relative_end - heap_relative_first, true, false);
   }
 }
 
@@ -1797,7 +1970,10 @@ bool PhysicalHeap::TriggerCallbacks(
     uint32_t unprotect_system_page_first = UINT32_MAX;
     for (uint32_t i = system_page_first; i <= system_page_last; ++i) {
       // Check if need to allow writing to this page.
-      bool unprotect_page = (system_page_flags_[i >> 6].notify_on_invalidation &
+      // Pages watched via host write watching were not protected.
+      const SystemPageFlagsBlock& page_flags_block = system_page_flags_[i >> 6];
+      bool unprotect_page = ((page_flags_block.notify_on_invalidation &
+                              ~page_flags_block.write_watched) &
                              (uint64_t(1) << (i & 63))) != 0;
       if (unprotect_page) {
         uint32_t guest_page_number =
@@ -1841,6 +2017,7 @@ bool PhysicalHeap::TriggerCallbacks(
       mask |= ~((uint64_t(1) << ((system_page_last & 63) + 1)) - 1);
     }
     system_page_flags_[i].notify_on_invalidation &= mask;
+    system_page_flags_[i].write_watched &= mask;
   }
 
   return true;
@@ -260,6 +260,10 @@ class PhysicalHeap : public BaseHeap {
       std::unique_lock<std::recursive_mutex> global_lock_locked_once,
       uint32_t virtual_address, uint32_t length, bool is_write,
       bool unwatch_exact_range, bool unprotect = true);
+  // Triggers the callbacks for the pages watched via host write watching
+  // rather than protection that have been written to. Must be called without
+  // the global critical region locked.
+  void TriggerWriteWatchCallbacks();
 
   uint32_t GetPhysicalAddress(uint32_t address) const;
 
@@ -273,10 +277,24 @@ class PhysicalHeap : public BaseHeap {
     // Whether writing to each page should result trigger invalidation
     // callbacks.
     uint64_t notify_on_invalidation;
+    // Subset of notify_on_invalidation - whether writes to each page are
+    // tracked via host write watching rather than protection, and need to be
+    // collected by TriggerWriteWatchCallbacks.
+    uint64_t write_watched;
   };
   // Protected by global_critical_region. Flags for each 64 system pages,
   // interleaved as blocks, so bit scan can be used to quickly extract ranges.
   std::vector<SystemPageFlagsBlock> system_page_flags_;
+
+  // Whether invalidation notifications may use host write watching instead of
+  // protection.
+  bool write_watch_ = false;
+  // Starts watching the system pages for writes for invalidation
+  // notifications, with host write watching if possible, or by protecting
+  // them. Call in the global critical region.
+  void WatchSystemPagesForInvalidation(uint32_t system_page_first,
+                                       uint32_t system_page_count,
+                                       xe::memory::PageAccess protect_access);
 };
 
 // Models the entire guest memory system on the console.
@@ -432,6 +450,22 @@ class Memory {
   // RegisterPhysicalMemoryInvalidationCallback.
   void UnregisterPhysicalMemoryInvalidationCallback(void* callback_handle);
 
+  // Called after guest virtual memory that wasn't writable has been made
+  // writable with BaseHeap::Protect, for invalidation of data derived from
+  // memory assumed to be constant. Called with the global critical region
+  // held, which may also be held by the caller of BaseHeap::Protect, so the
+  // callbacks must not wait for other threads - only invalidate the data, and
+  // recreate it later when it's needed.
+  typedef void (*WritableProtectionCallback)(void* context_ptr,
+                                             uint32_t virtual_address,
+                                             uint32_t length);
+  // Returns a handle for unregistering.
+  void* RegisterWritableProtectionCallback(WritableProtectionCallback callback,
+                                           void* callback_context);
+  // Unregisters a callback previously added with
+  // RegisterWritableProtectionCallback.
+  void UnregisterWritableProtectionCallback(void* callback_handle);
+
   // Enables physical memory access callbacks for the specified memory range,
   // snapped to system page boundaries.
   void EnablePhysicalMemoryAccessCallbacks(
@@ -448,6 +482,15 @@ class Memory {
       uint32_t virtual_address, uint32_t length, bool is_write,
       bool unwatch_exact_range, bool unprotect = true);
 
+  // If host write watching is used instead of protection for invalidation
+  // notifications (see the physical_memory_write_watch cvar), triggers the
+  // callbacks for the watched pages written to since the last call. Writes
+  // don't cause access violations in this mode, so this must be called before
+  // using the data cached by the invalidation callback handlers - like before
+  // processing GPU commands submitted by the guest. Must be called without the
+  // global critical region locked.
+  void TriggerWrittenPhysicalMemoryCallbacks();
+
   // Allocates virtual memory from the 'system' heap.
   // System memory is kept separate from game memory but is still accessible
   // using normal guest virtual addresses. Kernel structures and other internal
@@ -536,6 +579,8 @@ class Memory {
   xe::global_critical_region global_critical_region_;
   std::vector<std::pair<PhysicalMemoryInvalidationCallback, void*>*>
       physical_memory_invalidation_callbacks_;
+  std::vector<std::pair<WritableProtectionCallback, void*>*>
+      writable_protection_callbacks_;
 };
 
 }  // namespace xe